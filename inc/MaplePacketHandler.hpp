@@ -0,0 +1,39 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "hal/MapleBus/MaplePacket.hpp"
+
+//! Interface for a peripheral which answers Maple Bus packets locally, without any bus traffic
+class MaplePacketHandler
+{
+public:
+    virtual ~MaplePacketHandler() {}
+
+    //! Handles a packet meant for this peripheral
+    //! @param[in] in  The packet to handle
+    //! @param[out] out  The response packet when true is returned
+    //! @returns true iff the packet was handled
+    virtual bool handlePacket(const MaplePacket& in, MaplePacket& out) = 0;
+};
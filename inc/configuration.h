@@ -31,6 +31,23 @@
 // true to enable USB CDC (serial) interface to directly control the maple bus
 #define USB_CDC_ENABLED true
 
+// true to show each save on a VMU as its own .VMS file within a directory for that VMU instead of
+// one 128 KB image file (only the blocks of the accessed save are transferred over maple bus)
+#define USB_MSC_EXPORT_SAVES false
+
+// Number of written blocks held for each VMU while they are written over maple bus; the host is told
+// the write is done once the block is queued, so commands to other VMUs proceed meanwhile (0 makes
+// each write complete on the VMU before the host's next command)
+// Blocks still queued when a VMU is unplugged are lost even though the host was told they were
+// written; the loss is reported on the host's next cache flush or eject, so this is off by default
+#define USB_MSC_WRITE_BEHIND_BLOCKS 0
+
+// Player index [0,3] whose first sub-slot holds a virtual VMU stored in flash, answered locally for
+// flycast without any maple bus traffic, or -1 to disable; this keeps a 128 KB copy of the storage in
+// RAM, and the host binary is then built to run from RAM (copy_to_ram, set by src/main/Host/CMakeLists.txt)
+// so that flash may be written
+#define HOST_VIRTUAL_VMU_PLAYER -1
+
 // Adjust the CPU clock frequency here (133 MHz is maximum documented stable frequency)
 #define CPU_FREQ_KHZ 133000
 
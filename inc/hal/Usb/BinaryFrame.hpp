@@ -0,0 +1,273 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "hal/MapleBus/MaplePacket.hpp"
+#include "hal/Usb/TtyParser.hpp"
+
+// Binary frame structure (after COBS decoding): <command-char><tag><data...><checksum>
+// Binary response structure (after COBS decoding): <command-char><tag><status><data...><checksum>
+// Every frame is COBS encoded, so it never contains a 0x00 byte, and is terminated by a single 0x00.
+
+//! Helpers for the binary framed TTY mode
+class BinaryFrame
+{
+public:
+    //! Status byte values placed in binary response frames
+    enum Status : uint8_t
+    {
+        //! Command executed; data contains the response, if any
+        STATUS_OK = 0,
+        //! Write to the Maple Bus failed
+        STATUS_FAILED_WRITE,
+        //! No valid response read from the Maple Bus
+        STATUS_FAILED_READ,
+        //! The sender address doesn't match any bus
+        STATUS_INVALID_SENDER,
+        //! The data doesn't make up a valid packet
+        STATUS_INVALID_PACKET,
+        //! COBS decoding or checksum failed
+        STATUS_BAD_FRAME,
+        //! No parser accepts binary frames for the given command character
+        STATUS_UNSUPPORTED,
+        //! Command executed, but its response didn't fit in the response frame
+        STATUS_TRUNCATED,
+        //! The addressed device can't accept the command right now; send it again later
+        STATUS_BUSY
+    };
+
+    //! Frame delimiter
+    static const uint8_t DELIMITER = 0x00;
+    //! Number of bytes in a frame other than data: command char, tag, and checksum
+    static const uint32_t FRAME_OVERHEAD = 3;
+    //! Number of bytes in a response frame other than data: command char, tag, status, and checksum
+    static const uint32_t RESPONSE_OVERHEAD = 4;
+    //! Maximum number of bytes in a Maple packet (frame word + 255 payload words)
+    static const uint32_t MAX_PACKET_BYTES = 256 * sizeof(uint32_t);
+    //! Maximum number of bytes in a decoded response frame
+    static const uint32_t MAX_RESPONSE_SIZE = RESPONSE_OVERHEAD + MAX_PACKET_BYTES;
+    //! Maximum number of bytes in an encoded response frame, including delimiter
+    static const uint32_t MAX_ENCODED_RESPONSE_SIZE = MAX_RESPONSE_SIZE + (MAX_RESPONSE_SIZE / 254) + 2;
+
+    //! @param[in] len  Number of bytes to encode
+    //! @returns the maximum number of bytes encode() writes, including the delimiter
+    static inline uint32_t maxEncodedSize(uint32_t len)
+    {
+        return len + (len / 254) + 2;
+    }
+
+    //! COBS encodes the given data, appending the delimiter
+    //! @param[in] in  The data to encode
+    //! @param[in] len  Number of bytes in in
+    //! @param[out] out  Output buffer of at least maxEncodedSize(len) bytes (must not overlap in)
+    //! @returns the number of bytes written to out
+    static inline uint32_t encode(const uint8_t* in, uint32_t len, uint8_t* out)
+    {
+        uint8_t* codePtr = out;
+        uint8_t* dst = out + 1;
+        uint8_t code = 1;
+        for (const uint8_t* end = in + len; in < end; ++in)
+        {
+            if (*in == 0)
+            {
+                *codePtr = code;
+                codePtr = dst++;
+                code = 1;
+            }
+            else
+            {
+                *dst++ = *in;
+                if (++code == 0xFF)
+                {
+                    *codePtr = code;
+                    codePtr = dst++;
+                    code = 1;
+                }
+            }
+        }
+        *codePtr = code;
+        *dst++ = DELIMITER;
+        return dst - out;
+    }
+
+    //! COBS decodes the given data in place
+    //! @param[in,out] buffer  The encoded frame, excluding the delimiter
+    //! @param[in] len  Number of bytes in buffer
+    //! @returns the number of decoded bytes or a negative value if the data is not valid COBS
+    static inline int32_t decode(uint8_t* buffer, uint32_t len)
+    {
+        const uint8_t* src = buffer;
+        const uint8_t* const end = buffer + len;
+        uint8_t* dst = buffer;
+        while (src < end)
+        {
+            uint8_t code = *src++;
+            if (code == 0 || (end - src) < (code - 1))
+            {
+                return -1;
+            }
+            for (uint8_t i = 1; i < code; ++i)
+            {
+                if (*src == 0)
+                {
+                    return -1;
+                }
+                *dst++ = *src++;
+            }
+            if (code != 0xFF && src < end)
+            {
+                *dst++ = 0;
+            }
+        }
+        return dst - buffer;
+    }
+
+    //! @param[in] data  The data to compute checksum over
+    //! @param[in] len  Number of bytes in data
+    //! @returns the XOR of all given bytes
+    static inline uint8_t checksum(const uint8_t* data, uint32_t len)
+    {
+        uint8_t value = 0;
+        for (const uint8_t* end = data + len; data < end; ++data)
+        {
+            value ^= *data;
+        }
+        return value;
+    }
+
+    //! @param[in] data  The data to compute CRC over
+    //! @param[in] len  Number of bytes in data
+    //! @returns the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of the given bytes
+    static inline uint16_t crc16(const uint8_t* data, uint32_t len)
+    {
+        uint16_t crc = 0xFFFF;
+        for (const uint8_t* end = data + len; data < end; ++data)
+        {
+            crc ^= static_cast<uint16_t>(*data) << 8;
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    //! Writes the given word into the given buffer, most significant byte first
+    //! @param[in] word  The word to write
+    //! @param[out] out  The buffer to write 4 bytes to
+    //! @returns out + 4
+    static inline uint8_t* putWord(uint32_t word, uint8_t* out)
+    {
+        *out++ = static_cast<uint8_t>(word >> 24);
+        *out++ = static_cast<uint8_t>(word >> 16);
+        *out++ = static_cast<uint8_t>(word >> 8);
+        *out++ = static_cast<uint8_t>(word);
+        return out;
+    }
+
+    //! @param[in] in  The buffer to read 4 bytes from, most significant byte first
+    //! @returns the word read
+    static inline uint32_t getWord(const uint8_t* in)
+    {
+        return (static_cast<uint32_t>(in[0]) << 24
+                | static_cast<uint32_t>(in[1]) << 16
+                | static_cast<uint32_t>(in[2]) << 8
+                | static_cast<uint32_t>(in[3]));
+    }
+
+    //! Builds, encodes, and writes a response frame to the CDC TTY
+    //! @note Not reentrant - only to be called from the core which runs the TTY parser
+    //! @param[in] commandChar  The command character of the frame being responded to
+    //! @param[in] tag  The tag of the frame being responded to
+    //! @param[in] status  The status of the command
+    //! @param[in] packet  The packet to place in the data section or nullptr for no data; a packet
+    //!                    with too many payload words to fit is replaced by STATUS_TRUNCATED
+    //! @returns false iff the frame was dropped since the CDC TX buffer was full
+    static inline bool writeResponse(char commandChar,
+                                     uint8_t tag,
+                                     uint8_t status,
+                                     const MaplePacket* packet = nullptr)
+    {
+        static uint8_t data[MAX_PACKET_BYTES];
+
+        uint8_t* ptr = data;
+        if (packet != nullptr && packet->payload.size() >= 256)
+        {
+            // The frame word can't describe this many words, so it can't be sent as OK
+            if (status == STATUS_OK)
+            {
+                status = STATUS_TRUNCATED;
+            }
+        }
+        else if (packet != nullptr)
+        {
+            ptr = putWord(packet->frame.toWord(), ptr);
+            for (std::vector<uint32_t>::const_iterator iter = packet->payload.begin();
+                 iter != packet->payload.end();
+                 ++iter)
+            {
+                ptr = putWord(*iter, ptr);
+            }
+        }
+
+        return writeResponse(commandChar, tag, status, data, ptr - data);
+    }
+
+    //! Builds, encodes, and writes a response frame holding the given data to the CDC TTY
+    //! @note Not reentrant - only to be called from the core which runs the TTY parser
+    //! @param[in] commandChar  The command character of the frame being responded to
+    //! @param[in] tag  The tag of the frame being responded to
+    //! @param[in] status  The status of the command
+    //! @param[in] data  The data section
+    //! @param[in] len  Number of bytes in data (at most MAX_PACKET_BYTES)
+    //! @returns false iff the frame was dropped since the CDC TX buffer was full
+    static inline bool writeResponse(char commandChar,
+                                     uint8_t tag,
+                                     uint8_t status,
+                                     const uint8_t* data,
+                                     uint32_t len)
+    {
+        static uint8_t raw[MAX_RESPONSE_SIZE];
+        static uint8_t encoded[MAX_ENCODED_RESPONSE_SIZE];
+
+        if (len > MAX_PACKET_BYTES)
+        {
+            len = MAX_PACKET_BYTES;
+        }
+
+        uint8_t* ptr = raw;
+        *ptr++ = static_cast<uint8_t>(commandChar);
+        *ptr++ = tag;
+        *ptr++ = status;
+        memcpy(ptr, data, len);
+        ptr += len;
+        *ptr = checksum(raw, ptr - raw);
+        ++ptr;
+
+        uint32_t encodedLen = encode(raw, ptr - raw, encoded);
+        return usb_cdc_write(reinterpret_cast<const char*>(encoded), encodedLen);
+    }
+};
@@ -41,8 +41,26 @@ public:
     virtual const char* getCommandChars() = 0;
 
     //! Called when newline reached; submit command and reset
-    virtual void submit(const char* chars, uint32_t len) = 0;
+    //! @returns false iff the command was rejected as invalid
+    virtual bool submit(const char* chars, uint32_t len) = 0;
 
     //! Prints help message for this command
     virtual void printHelp() = 0;
+
+    //! @returns true iff this parser handles binary frames through submitBinary
+    virtual bool isBinarySupported()
+    {
+        return false;
+    }
+
+    //! Called when a binary frame for this parser is received while the TTY is in binary mode; only
+    //! called when isBinarySupported() returns true, and the parser always writes the response
+    //! @param[in] tag  The tag of the frame which is to be echoed in the response frame
+    //! @param[in] data  The data of the frame between the tag and checksum
+    //! @param[in] len  Number of bytes in data
+    //! @returns false iff the frame was rejected as invalid
+    virtual bool submitBinary(uint8_t tag, const uint8_t* data, uint32_t len)
+    {
+        return false;
+    }
 };
@@ -40,3 +40,14 @@ public:
 };
 
 TtyParser* usb_cdc_create_parser(MutexInterface* m, char helpChar);
+
+//! Writes raw bytes to the CDC TTY, bypassing stdio and its newline translation; from the core which
+//! doesn't run USB, the bytes are queued whole or dropped if they don't fit
+//! @param[in] buf  The bytes to write
+//! @param[in] len  Number of bytes in buf
+//! @returns false iff the bytes were dropped since they didn't fit
+bool usb_cdc_write(const char* buf, uint32_t len);
+
+//! @returns the number of lines and binary frames from the core which doesn't run USB which were
+//!          dropped because the TX buffer was full
+uint32_t usb_cdc_tx_overflow_count();
@@ -38,6 +38,17 @@ class UsbFile
         virtual uint32_t getFileSize() = 0;
         //! @returns true iff this file is read only
         virtual bool isReadOnly() = 0;
+        //! Retrieves where the device behind this file is plugged in so that it may be shown at the
+        //! same location each time it is attached
+        //! @param[out] port  The controller port index
+        //! @param[out] subSlot  The slot index within the controller
+        //! @returns true iff the location is known
+        virtual bool getLocation(uint8_t& port, uint8_t& subSlot)
+        {
+            (void)port;
+            (void)subSlot;
+            return false;
+        }
         //! Blocking read (must only be called from the core not operating maple bus)
         //! @param[in] blockNum  Block number to read (a block is 512 bytes)
         //! @param[out] buffer  Buffer output
@@ -62,6 +73,81 @@ class UsbFile
                               const void* buffer,
                               uint16_t bufferLen,
                               uint32_t timeoutUs) = 0;
+        //! Non-blocking read (must only be called from the core not operating maple bus); the first
+        //! call starts the read, and calling again with the same block number polls for completion
+        //! @param[in] blockNum  Block number to read (a block is 512 bytes)
+        //! @param[out] buffer  Buffer output (only written once the read completes)
+        //! @param[in] bufferLen  The length of buffer (only up to 512 bytes will be read)
+        //! @param[in] timeoutUs  Timeout in microseconds, counted from the first call
+        //! @returns Positive value indicating how many bytes were read
+        //! @returns Zero if the read is still in progress
+        //! @returns Negative value if read failure occurred or timeout elapsed
+        virtual int32_t readAsync(uint8_t blockNum,
+                                  void* buffer,
+                                  uint16_t bufferLen,
+                                  uint32_t timeoutUs) = 0;
+        //! Non-blocking write (must only be called from the core not operating maple bus); the first
+        //! call copies the data and starts the write, and calling again with the same block number
+        //! polls for completion
+        //! @param[in] blockNum  Block number to write (block is 512 bytes)
+        //! @param[in] buffer  Buffer (only read on the first call)
+        //! @param[in] bufferLen  The length of buffer (but only up to 512 bytes will be written)
+        //! @param[in] timeoutUs  Timeout in microseconds, counted from the first call
+        //! @returns Positive value indicating how many bytes were written
+        //! @returns Zero if the write is still in progress
+        //! @returns Negative value if write failure occurred or timeout elapsed
+        virtual int32_t writeAsync(uint8_t blockNum,
+                                   const void* buffer,
+                                   uint16_t bufferLen,
+                                   uint32_t timeoutUs) = 0;
+        //! Hints that the given blocks are about to be read so that they may be requested together
+        //! (must only be called from the core not operating maple bus)
+        //! @param[in] blockNum  The first block number to be read
+        //! @param[in] numBlocks  The number of blocks to be read
+        virtual void prefetch(uint8_t blockNum, uint8_t numBlocks)
+        {
+            (void)blockNum;
+            (void)numBlocks;
+        }
+        //! Non-blocking load of the list of files held within this file, such as the saves on a
+        //! memory unit (must only be called from the core not operating maple bus)
+        //! @param[in] timeoutUs  Timeout in microseconds for each block read
+        //! @returns Positive value once the list is loaded
+        //! @returns Zero while the load is in progress
+        //! @returns Negative value if failure occurred or this file doesn't hold other files
+        virtual int32_t loadSubFilesAsync(uint32_t timeoutUs)
+        {
+            (void)timeoutUs;
+            return -1;
+        }
+        //! @returns the number of files within this file (once loadSubFilesAsync() succeeds)
+        virtual uint32_t getNumSubFiles()
+        {
+            return 0;
+        }
+        //! @param[in] idx  Index of the sub file
+        //! @returns the null terminated name of the sub file or nullptr if idx is invalid
+        virtual const char* getSubFileName(uint32_t idx)
+        {
+            (void)idx;
+            return nullptr;
+        }
+        //! @param[in] idx  Index of the sub file
+        //! @returns the number of blocks in the sub file
+        virtual uint16_t getSubFileNumBlocks(uint32_t idx)
+        {
+            (void)idx;
+            return 0;
+        }
+        //! @param[in] idx  Index of the sub file
+        //! @param[in] blockIdx  The index of the block within the sub file
+        //! @returns the block number within this file which holds the given block or -1 if invalid
+        virtual int32_t getSubFileBlock(uint32_t idx, uint16_t blockIdx)
+        {
+            (void)idx;
+            (void)blockIdx;
+            return -1;
+        }
 };
 
 #endif // __USB_FILE_H__
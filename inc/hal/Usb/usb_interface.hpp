@@ -26,11 +26,16 @@
 
 #include "UsbFileSystem.hpp"
 #include "DreamcastControllerObserver.hpp"
+#include "VibrationObserver.hpp"
 #include "hal/System/MutexInterface.hpp"
 #include <vector>
 
 //! @returns array of the USB controller observers
 DreamcastControllerObserver** get_usb_controller_observers();
+//! Sets the observer which receives vibration requested by the host through a gamepad's output report
+//! @param[in] idx  The gamepad index
+//! @param[in] observer  The observer to receive vibration (called from USB callbacks)
+void set_usb_vibration_observer(uint32_t idx, VibrationObserver* observer);
 //! USB initialization
 void usb_init(
   MutexInterface* mscMutex,
@@ -29,11 +29,12 @@
 #include "hal/MapleBus/MaplePacket.hpp"
 #include "hal/MapleBus/MapleBusInterface.hpp"
 #include "DreamcastPeripheralFunction.hpp"
+#include "MaplePacketHandler.hpp"
 
 namespace client
 {
 
-class DreamcastPeripheral
+class DreamcastPeripheral : public MaplePacketHandler
 {
 public:
     DreamcastPeripheral() = delete;
@@ -0,0 +1,55 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "DreamcastPeripheral.hpp"
+#include "DreamcastStorage.hpp"
+
+#include "hal/System/SystemMemory.hpp"
+
+#include <memory>
+
+namespace client
+{
+
+//! Visual Memory sub peripheral which only holds the storage function; used by host mode to answer
+//! an emulator's storage requests from local memory in place of a physical memory unit
+class DreamcastVmu : public DreamcastPeripheral
+{
+public:
+    //! Constructor
+    //! @param[in] addr  Address (mask) of this sub peripheral
+    //! @param[in] systemMemory  The memory which holds the storage data
+    //! @param[in] memoryOffset  Byte offset of the storage data in systemMemory
+    DreamcastVmu(uint8_t addr, std::shared_ptr<SystemMemory> systemMemory, uint32_t memoryOffset);
+
+    //! @returns the storage function of this peripheral
+    inline std::shared_ptr<DreamcastStorage> getStorage() { return mStorage; }
+
+private:
+    //! The storage function
+    const std::shared_ptr<DreamcastStorage> mStorage;
+};
+
+}
@@ -0,0 +1,142 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+//! Lock-free ring of bytes waiting to be written to the CDC endpoint. There must be exactly one
+//! producer (the core which doesn't run USB) and one consumer (the core which runs USB).
+//! The producer builds each record (a text line or a binary frame) with append() then makes it
+//! visible with commit(), so the consumer never sees part of a record and a record which doesn't
+//! fit is dropped whole.
+//! @tparam SIZE  Number of bytes in the ring (must be a power of 2)
+template <uint32_t SIZE>
+class CdcTxRing
+{
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+public:
+    //! Constructor
+    CdcTxRing() : mHead(0), mTail(0), mOverflowCount(0), mPending(0), mPendingDropped(false) {}
+
+    //! Adds bytes to the record being built without blocking (producer only); nothing is visible
+    //! to the consumer until commit()
+    //! @param[in] buf  The bytes to add
+    //! @param[in] len  Number of bytes in buf
+    //! @returns false if the record didn't fit, in which case the whole record is dropped on commit
+    bool append(const char* buf, uint32_t len)
+    {
+        if (mPendingDropped)
+        {
+            return false;
+        }
+
+        const uint32_t head = mHead.load(std::memory_order_relaxed) + mPending;
+        const uint32_t tail = mTail.load(std::memory_order_acquire);
+        if (len > SIZE - (head - tail))
+        {
+            mPendingDropped = true;
+            return false;
+        }
+
+        const uint32_t idx = head & (SIZE - 1);
+        const uint32_t first = (len < SIZE - idx) ? len : (SIZE - idx);
+        memcpy(&mBuffer[idx], buf, first);
+        memcpy(&mBuffer[0], buf + first, len - first);
+        mPending += len;
+        return true;
+    }
+
+    //! Makes the record built by append() visible to the consumer (producer only)
+    //! @returns true iff the record was added or false if it was dropped since it didn't fit
+    bool commit()
+    {
+        const bool added = !mPendingDropped;
+        if (added)
+        {
+            mHead.store(mHead.load(std::memory_order_relaxed) + mPending, std::memory_order_release);
+        }
+        else
+        {
+            // Only the producer increments this, so no read-modify-write atomic is needed
+            mOverflowCount.store(mOverflowCount.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+        }
+        mPending = 0;
+        mPendingDropped = false;
+        return added;
+    }
+
+    //! Adds bytes as a record of their own, along with anything appended before (producer only)
+    //! @param[in] buf  The bytes to add
+    //! @param[in] len  Number of bytes in buf
+    //! @returns true iff the bytes were added or false if there wasn't enough space
+    bool write(const char* buf, uint32_t len)
+    {
+        append(buf, len);
+        return commit();
+    }
+
+    //! Retrieves the next contiguous run of bytes to be written (consumer only)
+    //! @param[out] ptr  Set to the first byte to be written
+    //! @returns number of contiguous bytes available at ptr
+    uint32_t peek(const uint8_t*& ptr) const
+    {
+        const uint32_t tail = mTail.load(std::memory_order_relaxed);
+        const uint32_t head = mHead.load(std::memory_order_acquire);
+        const uint32_t idx = tail & (SIZE - 1);
+        const uint32_t available = head - tail;
+        ptr = &mBuffer[idx];
+        return (available < SIZE - idx) ? available : (SIZE - idx);
+    }
+
+    //! Releases bytes which were retrieved by peek (consumer only)
+    //! @param[in] len  Number of bytes to release
+    void consume(uint32_t len)
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    //! @returns the number of records which were dropped because the ring was full
+    uint32_t getOverflowCount() const
+    {
+        return mOverflowCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    //! The byte storage
+    uint8_t mBuffer[SIZE];
+    //! Free running count of bytes written (only written by producer)
+    std::atomic<uint32_t> mHead;
+    //! Free running count of bytes read (only written by consumer)
+    std::atomic<uint32_t> mTail;
+    //! Number of records dropped due to overflow
+    std::atomic<uint32_t> mOverflowCount;
+    //! Number of bytes appended past mHead which aren't committed yet (producer only)
+    uint32_t mPending;
+    //! Set when a part of the record being built didn't fit (producer only)
+    bool mPendingDropped;
+};
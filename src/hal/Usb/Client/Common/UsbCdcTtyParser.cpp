@@ -23,6 +23,7 @@
 
 #include "UsbCdcTtyParser.hpp"
 #include "hal/System/LockGuard.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
 
 #include <limits>
 #include <string.h>
@@ -31,22 +32,87 @@
 
 const char* UsbCdcTtyParser::WHITESPACE_CHARS = "\r\n\t ";
 const char* UsbCdcTtyParser::INPUT_EOL_CHARS = "\r\n";
-const char UsbCdcTtyParser::RX_EOL_CHAR = '\n';
 const char* UsbCdcTtyParser::BACKSPACE_CHARS = "\x08\x7F";
 
 UsbCdcTtyParser::UsbCdcTtyParser(MutexInterface& m, char helpChar) :
-    mParserRx(),
+    mRxBuffer(),
+    mRxHead(0),
+    mRxTail(0),
+    mRxCommandStart(0),
+    mEolQueue(),
+    mEolHead(0),
+    mEolTail(0),
+    mCommandBuffer(),
     mLastIsEol(false),
     mParserMutex(m),
     mCommandReady(false),
     mHelpChar(helpChar),
     mParsers(),
-    mOverflowDetected(false)
+    mDispatchTable(),
+    mUnhandledCount(0),
+    mOverflowDetected(false),
+    mBinaryMode(false)
 {}
 
 void UsbCdcTtyParser::addCommandParser(std::shared_ptr<CommandParser> parser)
 {
-    mParsers.push_back(parser);
+    if (mParsers.size() >= std::numeric_limits<uint8_t>::max())
+    {
+        printf("Error: Too many command parsers\n");
+        return;
+    }
+
+    mParsers.push_back(ParserEntry{parser, ParserStats()});
+    const uint8_t dispatchValue = static_cast<uint8_t>(mParsers.size());
+    for (const char* commandChar = parser->getCommandChars(); *commandChar != '\0'; ++commandChar)
+    {
+        uint8_t& entry = mDispatchTable[static_cast<uint8_t>(*commandChar)];
+        // The first parser added for a character keeps it
+        if (entry == 0)
+        {
+            entry = dispatchValue;
+        }
+    }
+}
+
+bool UsbCdcTtyParser::isBinaryMode() const
+{
+    return mBinaryMode;
+}
+
+void UsbCdcTtyParser::resetMode()
+{
+    changeMode(false);
+}
+
+void UsbCdcTtyParser::changeMode(bool binaryMode)
+{
+    LockGuard lockGuard(mParserMutex);
+    if (lockGuard.isLocked())
+    {
+        // Anything received but not yet processed was interpreted under the previous mode
+        mRxTail = mRxHead = mRxCommandStart = 0;
+        mEolTail = mEolHead = 0;
+        mLastIsEol = false;
+        mOverflowDetected = false;
+        mCommandReady = false;
+    }
+    mBinaryMode = binaryMode;
+}
+
+bool UsbCdcTtyParser::pushCommand()
+{
+    if ((mEolHead - mEolTail) >= MAX_PENDING_COMMANDS)
+    {
+        // Too many commands waiting - drop this one
+        mRxHead = mRxCommandStart;
+        return false;
+    }
+
+    mEolQueue[mEolHead++ & (MAX_PENDING_COMMANDS - 1)] = mRxHead;
+    mRxCommandStart = mRxHead;
+    mCommandReady = true;
+    return true;
 }
 
 void UsbCdcTtyParser::addChars(const char* chars, uint32_t len)
@@ -54,40 +120,62 @@ void UsbCdcTtyParser::addChars(const char* chars, uint32_t len)
     // Entire function is locked
     LockGuard lockGuard(mParserMutex);
 
-    // Reserve space for new characters
-    uint32_t newCapacity = mParserRx.size() + len;
-    if (newCapacity > MAX_QUEUE_SIZE)
+    if (mBinaryMode)
     {
-        newCapacity = MAX_QUEUE_SIZE;
+        // Frames are kept as they are received, each one ended at the delimiter
+        for (const char* const end = chars + len; chars < end; ++chars)
+        {
+            if (static_cast<uint8_t>(*chars) == BinaryFrame::DELIMITER)
+            {
+                if (mOverflowDetected)
+                {
+                    // Drop only the frame that overflowed
+                    mRxHead = mRxCommandStart;
+                    mOverflowDetected = false;
+                }
+                else if (mRxHead != mRxCommandStart)
+                {
+                    // Empty frames are ignored
+                    pushCommand();
+                }
+            }
+            else if (mOverflowDetected)
+            {
+                // Ignore until delimiter
+            }
+            else if ((mRxHead - mRxTail) >= MAX_QUEUE_SIZE)
+            {
+                mOverflowDetected = true;
+            }
+            else
+            {
+                mRxBuffer[mRxHead++ & (MAX_QUEUE_SIZE - 1)] = *chars;
+            }
+        }
+        return;
     }
-    mParserRx.reserve(newCapacity);
 
-    for (uint32_t i = 0; i < len; ++i, ++chars)
+    for (const char* const end = chars + len; chars < end; ++chars)
     {
-        // Flag overflow - next command will be ignored
-        if (mParserRx.size() >= MAX_QUEUE_SIZE && *chars != 0x08)
+        if (!mOverflowDetected
+            && *chars >= ' '
+            && *chars < '\x7F'
+            && (mRxHead - mRxTail) < MAX_QUEUE_SIZE)
         {
-            mOverflowDetected = true;
+            // Fast path for printable characters which are neither EOL nor backspace
+            mRxBuffer[mRxHead++ & (MAX_QUEUE_SIZE - 1)] = *chars;
+            mLastIsEol = false;
         }
-
-        if (mOverflowDetected)
+        else if (mOverflowDetected)
         {
             if (strchr(INPUT_EOL_CHARS, *chars) != NULL)
             {
-                printf("Error: Command input overflow %lu\n", (long unsigned int)mParserRx.size());
+                printf("Error: Command input overflow %lu\n",
+                       (long unsigned int)(mRxHead - mRxCommandStart));
                 // Remove only command that overflowed
-                std::vector<char>::reverse_iterator lastEnd =
-                    std::find(mParserRx.rbegin(), mParserRx.rend(), RX_EOL_CHAR);
-                if (lastEnd == mParserRx.rend())
-                {
-                    mParserRx.clear();
-                }
-                else
-                {
-                    // We still captured a full command, so at least leave that for processing
-                    mParserRx.erase((lastEnd + 1).base(), mParserRx.end());
-                }
+                mRxHead = mRxCommandStart;
                 mOverflowDetected = false;
+                mLastIsEol = true;
             }
             else
             {
@@ -96,25 +184,34 @@ void UsbCdcTtyParser::addChars(const char* chars, uint32_t len)
         }
         else if (strchr(BACKSPACE_CHARS, *chars) != NULL)
         {
-            // Can't backspace before EOL character or if list is empty
-            if (!mLastIsEol && !mParserRx.empty())
+            // Can't backspace before EOL character or if command is empty
+            if (!mLastIsEol && mRxHead != mRxCommandStart)
             {
                 // Backspace
-                mParserRx.pop_back();
+                --mRxHead;
             }
         }
         else if (strchr(INPUT_EOL_CHARS, *chars) != NULL)
         {
             if (!mLastIsEol)
             {
-                mCommandReady = true;
-                mParserRx.push_back(RX_EOL_CHAR);
+                if (!pushCommand())
+                {
+                    printf("Error: Command input overflow %lu\n",
+                           (long unsigned int)(mEolHead - mEolTail));
+                }
                 mLastIsEol = true;
             }
         }
+        else if ((mRxHead - mRxTail) >= MAX_QUEUE_SIZE)
+        {
+            // Flag overflow - this command will be ignored
+            mOverflowDetected = true;
+            mLastIsEol = false;
+        }
         else
         {
-            mParserRx.push_back(*chars);
+            mRxBuffer[mRxHead++ & (MAX_QUEUE_SIZE - 1)] = *chars;
             mLastIsEol = false;
         }
     }
@@ -122,77 +219,187 @@ void UsbCdcTtyParser::addChars(const char* chars, uint32_t len)
 
 void UsbCdcTtyParser::process()
 {
-    // Only do something if a command is ready
-    if (mCommandReady)
+    // Handle every complete command that is waiting
+    while (mCommandReady)
     {
-        // Begin lock guard context
-        LockGuard lockGuard(mParserMutex);
+        uint32_t len = 0;
+        bool binaryMode = false;
 
-        // End of command is at the new line character
-        std::vector<char>::iterator eol =
-            std::find(mParserRx.begin(), mParserRx.end(), RX_EOL_CHAR);
+        // Begin lock guard context - the command is copied out so that the lock isn't held while
+        // the command executes
+        {
+            LockGuard lockGuard(mParserMutex);
+            if (!lockGuard.isLocked() || mEolTail == mEolHead)
+            {
+                return;
+            }
+
+            const uint32_t end = mEolQueue[mEolTail++ & (MAX_PENDING_COMMANDS - 1)];
+            const uint32_t idx = mRxTail & (MAX_QUEUE_SIZE - 1);
+            len = end - mRxTail;
+            const uint32_t first = std::min(len, MAX_QUEUE_SIZE - idx);
+            memcpy(mCommandBuffer, &mRxBuffer[idx], first);
+            memcpy(mCommandBuffer + first, &mRxBuffer[0], len - first);
+            mRxTail = end;
 
-        if (eol == mParserRx.end()
-            || std::find(eol + 1, mParserRx.end(), RX_EOL_CHAR) == mParserRx.end())
+            if (mEolTail == mEolHead)
+            {
+                // No further commands
+                mCommandReady = false;
+            }
+
+            binaryMode = mBinaryMode;
+        } // End lock guard context
+
+        // Just in case it gets parsed as a string, terminate with NULL
+        mCommandBuffer[len] = '\0';
+
+        if (binaryMode)
         {
-            // No further commands found
-            mCommandReady = false;
+            processFrame(reinterpret_cast<uint8_t*>(mCommandBuffer), len);
         }
+        else
+        {
+            processCommand(mCommandBuffer, len);
+        }
+    }
+}
 
-        if (eol != mParserRx.end())
+void UsbCdcTtyParser::processCommand(const char* chars, uint32_t len)
+{
+    const char* ptr = chars;
+    // Move past whitespace characters
+    while (len > 0 && strchr(WHITESPACE_CHARS, *ptr) != NULL)
+    {
+        --len;
+        ++ptr;
+    }
+
+    if (len > 0)
+    {
+        if (*ptr == mHelpChar)
         {
-            // Just in case it gets parsed as a string, changed EOL to NULL
-            *eol = '\0';
-            // Move past whitespace characters
-            const char* ptr = &mParserRx[0];
-            uint32_t len = eol - mParserRx.begin();
-            while (len > 0 && strchr(WHITESPACE_CHARS, *ptr) != NULL)
+            printf("HELP\n"
+                   "Command structure: [whitespace]<command-char>[command]<\\n>\n"
+                   "\n"
+                   "COMMANDS:\n");
+            printf("%c: Prints this help\n", mHelpChar);
+            printf("%c: Enters binary framed mode\n", BINARY_MODE_CHAR);
+            printf("%c: Prints statistics of each command parser and dropped output\n", STATS_CHAR);
+            // Print help for all commands
+            for (std::vector<ParserEntry>::iterator iter = mParsers.begin();
+                iter != mParsers.end();
+                ++iter)
             {
-                --len;
-                ++ptr;
+                iter->parser->printHelp();
             }
-
-            if (len > 0)
+        }
+        else if (*ptr == BINARY_MODE_CHAR)
+        {
+            changeMode(true);
+            printf("*binary\n");
+        }
+        else if (*ptr == STATS_CHAR)
+        {
+            printStats();
+        }
+        else
+        {
+            // Find command parser that can process this command
+            ParserEntry* entry = findParser(*ptr);
+            if (entry != nullptr)
             {
-                if (*ptr == mHelpChar)
+                ++entry->stats.commands;
+                entry->stats.bytes += len;
+                if (!entry->parser->submit(ptr, len))
                 {
-                    printf("HELP\n"
-                           "Command structure: [whitespace]<command-char>[command]<\\n>\n"
-                           "\n"
-                           "COMMANDS:\n");
-                    printf("%c: Prints this help\n", mHelpChar);
-                    // Print help for all commands
-                    for (std::vector<std::shared_ptr<CommandParser>>::iterator iter = mParsers.begin();
-                        iter != mParsers.end();
-                        ++iter)
-                    {
-                        (*iter)->printHelp();
-                    }
-                }
-                else
-                {
-                    // Find command parser that can process this command
-                    bool processed = false;
-                    for (std::vector<std::shared_ptr<CommandParser>>::iterator iter = mParsers.begin();
-                        iter != mParsers.end() && !processed;
-                        ++iter)
-                    {
-                        if (strchr((*iter)->getCommandChars(), *ptr) != NULL)
-                        {
-                            (*iter)->submit(ptr, len);
-                            processed = true;
-                        }
-                    }
-
-                    if (!processed)
-                    {
-                        printf("Error: Invalid command\n");
-                    }
+                    ++entry->stats.errors;
                 }
             }
-            // Else: empty string - do nothing
+            else
+            {
+                ++mUnhandledCount;
+                printf("Error: Invalid command\n");
+            }
+        }
+    }
+    // Else: empty string - do nothing
+}
+
+void UsbCdcTtyParser::processFrame(uint8_t* frame, uint32_t len)
+{
+    int32_t decodedLen = BinaryFrame::decode(frame, len);
+
+    if (decodedLen < static_cast<int32_t>(BinaryFrame::FRAME_OVERHEAD))
+    {
+        // Not enough is known to even echo the command character and tag - respond with what's there
+        BinaryFrame::writeResponse(
+            (decodedLen > 0) ? frame[0] : 0,
+            (decodedLen > 1) ? frame[1] : 0,
+            BinaryFrame::STATUS_BAD_FRAME);
+        return;
+    }
 
-            mParserRx.erase(mParserRx.begin(), eol + 1);
+    const char commandChar = static_cast<char>(frame[0]);
+    const uint8_t tag = frame[1];
+    const uint32_t dataLen = decodedLen - BinaryFrame::FRAME_OVERHEAD;
+
+    if (BinaryFrame::checksum(frame, decodedLen - 1) != frame[decodedLen - 1])
+    {
+        BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_BAD_FRAME);
+    }
+    else if (commandChar == BINARY_MODE_CHAR)
+    {
+        // Go back to text mode then acknowledge
+        changeMode(false);
+        BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_OK);
+    }
+    else
+    {
+        ParserEntry* entry = findParser(commandChar);
+        if (entry == nullptr)
+        {
+            ++mUnhandledCount;
+            BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_UNSUPPORTED);
         }
-    } // End lock guard context
+        else
+        {
+            ++entry->stats.commands;
+            entry->stats.bytes += dataLen;
+            if (!entry->parser->isBinarySupported())
+            {
+                ++entry->stats.errors;
+                BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_UNSUPPORTED);
+            }
+            else if (!entry->parser->submitBinary(tag, &frame[2], dataLen))
+            {
+                // The parser already responded
+                ++entry->stats.errors;
+            }
+        }
+    }
+}
+
+UsbCdcTtyParser::ParserEntry* UsbCdcTtyParser::findParser(char commandChar)
+{
+    // Never set for '\0', since command strings are null terminated
+    const uint8_t dispatchValue = mDispatchTable[static_cast<uint8_t>(commandChar)];
+    return (dispatchValue > 0) ? &mParsers[dispatchValue - 1] : nullptr;
+}
+
+void UsbCdcTtyParser::printStats()
+{
+    for (std::vector<ParserEntry>::const_iterator iter = mParsers.begin();
+         iter != mParsers.end();
+         ++iter)
+    {
+        printf("%c%s: commands: %lu errors: %lu bytes: %lu\n",
+               STATS_CHAR,
+               iter->parser->getCommandChars(),
+               (long unsigned int)iter->stats.commands,
+               (long unsigned int)iter->stats.errors,
+               (long unsigned int)iter->stats.bytes);
+    }
+    printf("%cunhandled: %lu\n", STATS_CHAR, (long unsigned int)mUnhandledCount);
+    printf("%ctx dropped: %lu\n", STATS_CHAR, (long unsigned int)usb_cdc_tx_overflow_count());
 }
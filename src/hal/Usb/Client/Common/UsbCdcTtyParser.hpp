@@ -33,6 +33,8 @@
 #include "hal/Usb/CommandParser.hpp"
 
 // Command structure: [whitespace]<command-char>[command]<\n>
+// Binary mode is entered with the text command '#' and left with a binary frame whose command
+// character is '#'. See hal/Usb/BinaryFrame.hpp for binary frame structure.
 
 //! Command parser for processing commands from a TTY stream
 class UsbCdcTtyParser : public TtyParser
@@ -46,30 +48,98 @@ public:
     void addChars(const char* chars, uint32_t len);
     //! Called from the process handling maple bus execution
     virtual void process() final;
+    //! @returns true iff the TTY is currently in binary framed mode
+    bool isBinaryMode() const;
+    //! Drops any pending input and returns to text mode (called when the host disconnects)
+    void resetMode();
 
 private:
-    //! Max of 2 KB of memory to use for tty RX queue
+    //! Completes the command currently being received
+    //! @returns false iff there was no room to queue the command, in which case it is dropped
+    bool pushCommand();
+    //! Drops all pending input and switches to the given mode
+    //! @param[in] binaryMode  true for binary framed mode or false for text mode
+    void changeMode(bool binaryMode);
+    //! Processes a single text command
+    //! @param[in] chars  The command characters
+    //! @param[in] len  Number of characters in chars
+    void processCommand(const char* chars, uint32_t len);
+    //! Processes a single binary frame, still COBS encoded and without delimiter
+    //! @param[in] frame  The encoded frame (decoded in place)
+    //! @param[in] len  Number of bytes in frame
+    void processFrame(uint8_t* frame, uint32_t len);
+    //! Prints the statistics of each command parser
+    void printStats();
+
+    //! Statistics kept for each command parser
+    struct ParserStats
+    {
+        //! Number of text commands and binary frames submitted to the parser
+        uint32_t commands;
+        //! Number of commands the parser rejected
+        uint32_t errors;
+        //! Number of command and frame data bytes submitted to the parser
+        uint32_t bytes;
+    };
+
+    //! A command parser along with its statistics
+    struct ParserEntry
+    {
+        std::shared_ptr<CommandParser> parser;
+        ParserStats stats;
+    };
+
+    //! @param[in] commandChar  A command character
+    //! @returns the parser which handles the given command character or nullptr if none does
+    ParserEntry* findParser(char commandChar);
+
+private:
+    //! Max of 2 KB of memory to use for tty RX queue (must be a power of 2)
     static const uint32_t MAX_QUEUE_SIZE = 2048;
+    //! Maximum number of complete commands which may wait in the RX queue (must be a power of 2)
+    static const uint32_t MAX_PENDING_COMMANDS = 64;
     //! String of characters that are considered whitespace
     static const char* WHITESPACE_CHARS;
     //! String of characters that are considered end of line characters
     static const char* INPUT_EOL_CHARS;
-    //! The singular character that is replaced in the RX list as the EOL char
-    static const char RX_EOL_CHAR;
     //! String of characters that are treated as a backspace
     static const char* BACKSPACE_CHARS;
-    //! Receive queue
-    std::vector<char> mParserRx;
+    //! Command character which enters binary mode from text and exits binary mode from a frame
+    static const char BINARY_MODE_CHAR = '#';
+    //! Command character which prints command parser statistics
+    static const char STATS_CHAR = '$';
+    //! Receive ring buffer; EOL characters and delimiters are not stored
+    char mRxBuffer[MAX_QUEUE_SIZE];
+    //! Free running index where the next received character is written
+    uint32_t mRxHead;
+    //! Free running index of the first character of the oldest pending command
+    uint32_t mRxTail;
+    //! Free running index of the first character of the command currently being received
+    uint32_t mRxCommandStart;
+    //! Free running end indices of complete commands, in order of reception
+    uint32_t mEolQueue[MAX_PENDING_COMMANDS];
+    //! Free running index where the next end index is written into mEolQueue
+    uint32_t mEolHead;
+    //! Free running index of the oldest end index in mEolQueue
+    uint32_t mEolTail;
+    //! Contiguous, null terminated copy of the command being processed
+    char mCommandBuffer[MAX_QUEUE_SIZE + 1];
     //! Flag that is set to true if the last read character is an EOL (used to ignore further EOL)
     bool mLastIsEol;
     //! Mutex used to serialize addChars and process
     MutexInterface& mParserMutex;
-    //! Flag when end of line detected on add
+    //! Flag set when a complete command is waiting in the RX queue
     std::atomic<bool> mCommandReady;
     //! The command character which prints help for all commands
     const char mHelpChar;
     //! Parsers that may handle data
-    std::vector<std::shared_ptr<CommandParser>> mParsers;
-    //! true when overflow in mParserRx
+    std::vector<ParserEntry> mParsers;
+    //! For each command character, 1 + the index of its parser in mParsers or 0 when none
+    uint8_t mDispatchTable[256];
+    //! Number of text commands and binary frames which no parser handles
+    uint32_t mUnhandledCount;
+    //! true when the command currently being received overflowed the RX queue
     bool mOverflowDetected;
+    //! true when in binary framed mode, false when in text mode
+    std::atomic<bool> mBinaryMode;
 };
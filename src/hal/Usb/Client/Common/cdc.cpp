@@ -40,6 +40,9 @@
 #include "class/cdc/cdc_device.h"
 
 #include "UsbCdcTtyParser.hpp"
+#include "CdcTxRing.hpp"
+
+#include <algorithm>
 
 
 UsbCdcTtyParser* ttyParser = nullptr;
@@ -58,6 +61,46 @@ TtyParser* usb_cdc_create_parser(MutexInterface* m, char helpChar)
 
 static MutexInterface* stdioMutex = nullptr;
 
+//! Bytes written by the core which doesn't run USB, waiting to be sent by cdc_task()
+static CdcTxRing<4096> txRing;
+
+//! The core which runs USB (set in cdc_init())
+static uint32_t usbCoreNum = 0;
+
+//! Moves as much as possible from txRing into the CDC endpoint (USB core only)
+static void cdc_tx_drain()
+{
+    const uint8_t* ptr = nullptr;
+    uint32_t len = txRing.peek(ptr);
+    bool written = false;
+
+    while (len > 0)
+    {
+        uint32_t avail = tud_cdc_write_available();
+        if (avail == 0)
+        {
+            // Endpoint busy - try again on next task
+            break;
+        }
+
+        // tud_cdc_write() sends each full 64-byte packet as soon as it is buffered
+        uint32_t n = tud_cdc_write(ptr, std::min(len, avail));
+        if (n == 0)
+        {
+            break;
+        }
+        txRing.consume(n);
+        written = true;
+        len = txRing.peek(ptr);
+    }
+
+    if (written && len == 0)
+    {
+        // Nothing else queued - send any partial packet now
+        tud_cdc_write_flush();
+    }
+}
+
 // Can't use stdio_usb_init() because it checks tud_cdc_connected(), and that doesn't always return
 // true when a connection is made. Not all terminal client set this when making connection.
 
@@ -69,6 +112,29 @@ static void stdio_usb_out_chars2(const char *buf, int length)
 {
     if (length <= 0) return;
 
+    if (get_core_num() != usbCoreNum)
+    {
+        // Never stall the other core on USB; each line is queued whole once its newline is printed
+        // (printf and fwrite hand over a line in several pieces), and a line which doesn't fit is
+        // dropped and counted
+        const char* const end = buf + length;
+        while (buf < end)
+        {
+            const char* eol = static_cast<const char*>(memchr(buf, '\n', end - buf));
+            const char* next = (eol != nullptr) ? (eol + 1) : end;
+            txRing.append(buf, next - buf);
+            if (eol != nullptr)
+            {
+                txRing.commit();
+            }
+            buf = next;
+        }
+        return;
+    }
+
+    // Keep output in order by sending what the other core queued first
+    cdc_tx_drain();
+
     static uint64_t last_avail_time;
 
     LockGuard lockGuard(*stdioMutex);
@@ -138,15 +204,37 @@ struct stdio_driver stdio_usb2 =
 
 } // extern "C"
 
+bool usb_cdc_write(const char* buf, uint32_t len)
+{
+    if (get_core_num() != usbCoreNum)
+    {
+        // A binary frame is queued whole (no crlf processing since calling directly)
+        return txRing.write(buf, len);
+    }
+
+    // No crlf processing since calling directly; this waits for room in the endpoint
+    stdio_usb_out_chars2(buf, len);
+    return true;
+}
+
+uint32_t usb_cdc_tx_overflow_count()
+{
+    return txRing.getOverflowCount();
+}
+
 void cdc_init(MutexInterface* cdcStdioMutex)
 {
     stdioMutex = cdcStdioMutex;
+    usbCoreNum = get_core_num();
     stdio_set_driver_enabled(&stdio_usb2, true);
 }
 
 void cdc_task()
 {
 #if USB_CDC_ENABLED
+    // Send anything the other core has queued
+    cdc_tx_drain();
+
     // connected and there are data available
     if (tud_cdc_available())
     {
@@ -160,8 +248,11 @@ void cdc_task()
 
             if (count > 0)
             {
-                // Echo back (no crlf processing since calling directly)
-                stdio_usb_out_chars2(buf, count);
+                if (!ttyParser->isBinaryMode())
+                {
+                    // Echo back (no crlf processing since calling directly)
+                    stdio_usb_out_chars2(buf, count);
+                }
                 // Add to parser
                 ttyParser->addChars(buf, count);
             }
@@ -180,6 +271,12 @@ void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 {
   (void) itf;
   (void) rts;
+
+  if (!dtr && ttyParser)
+  {
+    // Host closed the port - the next client to connect will expect text mode
+    ttyParser->resetMode();
+  }
 }
 
 // Invoked when CDC interface received data from host
@@ -29,6 +29,7 @@
 #include "tusb.h"
 
 #include "utils.h"
+#include "configuration.h"
 
 #include <string.h>
 
@@ -44,6 +45,11 @@
 #define BLOCKS_PER_FILE 0x100
 #define START_EXTERNAL_FILE_BLOCK 0x100
 
+// Every VMU slot of each controller port gets its own fixed region on the drive
+#define NUM_PORTS 4
+#define VMUS_PER_PLAYER 2
+#define MAX_FILES (NUM_PORTS * VMUS_PER_PLAYER)
+
 static MutexInterface* fileMutex = nullptr;
 
 struct FileEntry
@@ -54,9 +60,12 @@ struct FileEntry
   uint32_t size;
   const char* filename;
   UsbFile* handle;
+  // Incremented each time a file is added to this slot so that state kept for a file which was
+  // since removed is recognized
+  uint32_t generation;
 };
 
-static FileEntry fileEntries[8] = {};
+static FileEntry fileEntries[MAX_FILES] = {};
 static uint32_t numFileEntries = 0;
 
 // whether host does safe-eject
@@ -67,6 +76,9 @@ static uint8_t errorCount = 0;
 // Once this threshold is reached, drive will be forcibly ejected
 #define MAX_ERROR_COUNT 50
 
+// SCSI command which flushes written data (not in TinyUSB's list of SCSI commands)
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10 0x35
+
 // 1 README included in root directory
 #define NUM_INTERNAL_FILES 1
 
@@ -197,7 +209,8 @@ enum
 
 #define NUM_RESERVED_SECTORS 1
 #define NUM_FAT_COPIES 1
-#define SECTORS_PER_FAT 10
+// One FAT sector covers the internal files, one covers the region of each file, and the last is free
+#define SECTORS_PER_FAT (1 + MAX_FILES + 1)
 #define NUM_ROOT_ENTRIES 16
 
 #define NUM_FAT_SECTORS (NUM_FAT_COPIES * SECTORS_PER_FAT)
@@ -206,261 +219,145 @@ enum
 
 #define FIRST_VALID_FAT_ADDRESS 2
 
-#define VMUS_PER_PLAYER 2
+#define INTERNAL_FAT_SECTOR NUM_RESERVED_SECTORS
+#define FIRST_FILE_FAT_SECTOR (INTERNAL_FAT_SECTOR + 1)
+#define ROOT_DIR_SECTOR (NUM_RESERVED_SECTORS + NUM_FAT_SECTORS)
+#define FIRST_FILE_ROOT_ENTRY (1 + NUM_INTERNAL_FILES)
+
+// Each file's region of the FAT must fill exactly one FAT sector so that a slot can be regenerated
+// without touching the others
+static_assert(BLOCKS_PER_FILE * 2 == DISK_BLOCK_SIZE, "File region must fill one FAT sector");
+static_assert(START_EXTERNAL_FILE_BLOCK == BLOCKS_PER_FILE, "Internal files must fill one FAT sector");
+static_assert(ALLOCATED_DISK_BLOCK_NUM == NUM_HEADER_SECTORS + NUM_INTERNAL_FILES, "RAM disk size mismatch");
+static_assert(EXTERNAL_DISK_BLOCK_NUM == MAX_FILES * BLOCKS_PER_FILE, "External disk size mismatch");
+static_assert(NUM_ROOT_ENTRIES >= FIRST_FILE_ROOT_ENTRY + MAX_FILES, "Root directory too small");
 
 const uint8_t defaultRootEntry[BYTES_PER_ROOT_ENTRY] =
   {SIMPLE_DIR_ENTRY("        ", "   ", ATTR1_ARCHIVE, ATTR2_LOWERCASE_BASENAME | ATTR2_LOWERCASE_EXT, 0, 0)};
 
-#define FULL_PAGE_FAT_ENTRY(startAddr) \
-      U16_TO_U8S_LE(startAddr + 0x01), U16_TO_U8S_LE(startAddr + 0x02), U16_TO_U8S_LE(startAddr + 0x03), U16_TO_U8S_LE(startAddr + 0x04), \
-      U16_TO_U8S_LE(startAddr + 0x05), U16_TO_U8S_LE(startAddr + 0x06), U16_TO_U8S_LE(startAddr + 0x07), U16_TO_U8S_LE(startAddr + 0x08), \
-      U16_TO_U8S_LE(startAddr + 0x09), U16_TO_U8S_LE(startAddr + 0x0A), U16_TO_U8S_LE(startAddr + 0x0B), U16_TO_U8S_LE(startAddr + 0x0C), \
-      U16_TO_U8S_LE(startAddr + 0x0D), U16_TO_U8S_LE(startAddr + 0x0E), U16_TO_U8S_LE(startAddr + 0x0F), U16_TO_U8S_LE(startAddr + 0x10), \
-      U16_TO_U8S_LE(startAddr + 0x11), U16_TO_U8S_LE(startAddr + 0x12), U16_TO_U8S_LE(startAddr + 0x13), U16_TO_U8S_LE(startAddr + 0x14), \
-      U16_TO_U8S_LE(startAddr + 0x15), U16_TO_U8S_LE(startAddr + 0x16), U16_TO_U8S_LE(startAddr + 0x17), U16_TO_U8S_LE(startAddr + 0x18), \
-      U16_TO_U8S_LE(startAddr + 0x19), U16_TO_U8S_LE(startAddr + 0x1A), U16_TO_U8S_LE(startAddr + 0x1B), U16_TO_U8S_LE(startAddr + 0x1C), \
-      U16_TO_U8S_LE(startAddr + 0x1D), U16_TO_U8S_LE(startAddr + 0x1E), U16_TO_U8S_LE(startAddr + 0x1F), U16_TO_U8S_LE(startAddr + 0x20), \
-      U16_TO_U8S_LE(startAddr + 0x21), U16_TO_U8S_LE(startAddr + 0x22), U16_TO_U8S_LE(startAddr + 0x23), U16_TO_U8S_LE(startAddr + 0x24), \
-      U16_TO_U8S_LE(startAddr + 0x25), U16_TO_U8S_LE(startAddr + 0x26), U16_TO_U8S_LE(startAddr + 0x27), U16_TO_U8S_LE(startAddr + 0x28), \
-      U16_TO_U8S_LE(startAddr + 0x29), U16_TO_U8S_LE(startAddr + 0x2A), U16_TO_U8S_LE(startAddr + 0x2B), U16_TO_U8S_LE(startAddr + 0x2C), \
-      U16_TO_U8S_LE(startAddr + 0x2D), U16_TO_U8S_LE(startAddr + 0x2E), U16_TO_U8S_LE(startAddr + 0x2F), U16_TO_U8S_LE(startAddr + 0x30), \
-      U16_TO_U8S_LE(startAddr + 0x31), U16_TO_U8S_LE(startAddr + 0x32), U16_TO_U8S_LE(startAddr + 0x33), U16_TO_U8S_LE(startAddr + 0x34), \
-      U16_TO_U8S_LE(startAddr + 0x35), U16_TO_U8S_LE(startAddr + 0x36), U16_TO_U8S_LE(startAddr + 0x37), U16_TO_U8S_LE(startAddr + 0x38), \
-      U16_TO_U8S_LE(startAddr + 0x39), U16_TO_U8S_LE(startAddr + 0x3A), U16_TO_U8S_LE(startAddr + 0x3B), U16_TO_U8S_LE(startAddr + 0x3C), \
-      U16_TO_U8S_LE(startAddr + 0x3D), U16_TO_U8S_LE(startAddr + 0x3E), U16_TO_U8S_LE(startAddr + 0x3F), U16_TO_U8S_LE(startAddr + 0x40), \
-      U16_TO_U8S_LE(startAddr + 0x41), U16_TO_U8S_LE(startAddr + 0x42), U16_TO_U8S_LE(startAddr + 0x43), U16_TO_U8S_LE(startAddr + 0x44), \
-      U16_TO_U8S_LE(startAddr + 0x45), U16_TO_U8S_LE(startAddr + 0x46), U16_TO_U8S_LE(startAddr + 0x47), U16_TO_U8S_LE(startAddr + 0x48), \
-      U16_TO_U8S_LE(startAddr + 0x49), U16_TO_U8S_LE(startAddr + 0x4A), U16_TO_U8S_LE(startAddr + 0x4B), U16_TO_U8S_LE(startAddr + 0x4C), \
-      U16_TO_U8S_LE(startAddr + 0x4D), U16_TO_U8S_LE(startAddr + 0x4E), U16_TO_U8S_LE(startAddr + 0x4F), U16_TO_U8S_LE(startAddr + 0x50), \
-      U16_TO_U8S_LE(startAddr + 0x51), U16_TO_U8S_LE(startAddr + 0x52), U16_TO_U8S_LE(startAddr + 0x53), U16_TO_U8S_LE(startAddr + 0x54), \
-      U16_TO_U8S_LE(startAddr + 0x55), U16_TO_U8S_LE(startAddr + 0x56), U16_TO_U8S_LE(startAddr + 0x57), U16_TO_U8S_LE(startAddr + 0x58), \
-      U16_TO_U8S_LE(startAddr + 0x59), U16_TO_U8S_LE(startAddr + 0x5A), U16_TO_U8S_LE(startAddr + 0x5B), U16_TO_U8S_LE(startAddr + 0x5C), \
-      U16_TO_U8S_LE(startAddr + 0x5D), U16_TO_U8S_LE(startAddr + 0x5E), U16_TO_U8S_LE(startAddr + 0x5F), U16_TO_U8S_LE(startAddr + 0x60), \
-      U16_TO_U8S_LE(startAddr + 0x61), U16_TO_U8S_LE(startAddr + 0x62), U16_TO_U8S_LE(startAddr + 0x63), U16_TO_U8S_LE(startAddr + 0x64), \
-      U16_TO_U8S_LE(startAddr + 0x65), U16_TO_U8S_LE(startAddr + 0x66), U16_TO_U8S_LE(startAddr + 0x67), U16_TO_U8S_LE(startAddr + 0x68), \
-      U16_TO_U8S_LE(startAddr + 0x69), U16_TO_U8S_LE(startAddr + 0x6A), U16_TO_U8S_LE(startAddr + 0x6B), U16_TO_U8S_LE(startAddr + 0x6C), \
-      U16_TO_U8S_LE(startAddr + 0x6D), U16_TO_U8S_LE(startAddr + 0x6E), U16_TO_U8S_LE(startAddr + 0x6F), U16_TO_U8S_LE(startAddr + 0x70), \
-      U16_TO_U8S_LE(startAddr + 0x71), U16_TO_U8S_LE(startAddr + 0x72), U16_TO_U8S_LE(startAddr + 0x73), U16_TO_U8S_LE(startAddr + 0x74), \
-      U16_TO_U8S_LE(startAddr + 0x75), U16_TO_U8S_LE(startAddr + 0x76), U16_TO_U8S_LE(startAddr + 0x77), U16_TO_U8S_LE(startAddr + 0x78), \
-      U16_TO_U8S_LE(startAddr + 0x79), U16_TO_U8S_LE(startAddr + 0x7A), U16_TO_U8S_LE(startAddr + 0x7B), U16_TO_U8S_LE(startAddr + 0x7C), \
-      U16_TO_U8S_LE(startAddr + 0x7D), U16_TO_U8S_LE(startAddr + 0x7E), U16_TO_U8S_LE(startAddr + 0x7F), U16_TO_U8S_LE(startAddr + 0x80), \
-      U16_TO_U8S_LE(startAddr + 0x81), U16_TO_U8S_LE(startAddr + 0x82), U16_TO_U8S_LE(startAddr + 0x83), U16_TO_U8S_LE(startAddr + 0x84), \
-      U16_TO_U8S_LE(startAddr + 0x85), U16_TO_U8S_LE(startAddr + 0x86), U16_TO_U8S_LE(startAddr + 0x87), U16_TO_U8S_LE(startAddr + 0x88), \
-      U16_TO_U8S_LE(startAddr + 0x89), U16_TO_U8S_LE(startAddr + 0x8A), U16_TO_U8S_LE(startAddr + 0x8B), U16_TO_U8S_LE(startAddr + 0x8C), \
-      U16_TO_U8S_LE(startAddr + 0x8D), U16_TO_U8S_LE(startAddr + 0x8E), U16_TO_U8S_LE(startAddr + 0x8F), U16_TO_U8S_LE(startAddr + 0x90), \
-      U16_TO_U8S_LE(startAddr + 0x91), U16_TO_U8S_LE(startAddr + 0x92), U16_TO_U8S_LE(startAddr + 0x93), U16_TO_U8S_LE(startAddr + 0x94), \
-      U16_TO_U8S_LE(startAddr + 0x95), U16_TO_U8S_LE(startAddr + 0x96), U16_TO_U8S_LE(startAddr + 0x97), U16_TO_U8S_LE(startAddr + 0x98), \
-      U16_TO_U8S_LE(startAddr + 0x99), U16_TO_U8S_LE(startAddr + 0x9A), U16_TO_U8S_LE(startAddr + 0x9B), U16_TO_U8S_LE(startAddr + 0x9C), \
-      U16_TO_U8S_LE(startAddr + 0x9D), U16_TO_U8S_LE(startAddr + 0x9E), U16_TO_U8S_LE(startAddr + 0x9F), U16_TO_U8S_LE(startAddr + 0xA0), \
-      U16_TO_U8S_LE(startAddr + 0xA1), U16_TO_U8S_LE(startAddr + 0xA2), U16_TO_U8S_LE(startAddr + 0xA3), U16_TO_U8S_LE(startAddr + 0xA4), \
-      U16_TO_U8S_LE(startAddr + 0xA5), U16_TO_U8S_LE(startAddr + 0xA6), U16_TO_U8S_LE(startAddr + 0xA7), U16_TO_U8S_LE(startAddr + 0xA8), \
-      U16_TO_U8S_LE(startAddr + 0xA9), U16_TO_U8S_LE(startAddr + 0xAA), U16_TO_U8S_LE(startAddr + 0xAB), U16_TO_U8S_LE(startAddr + 0xAC), \
-      U16_TO_U8S_LE(startAddr + 0xAD), U16_TO_U8S_LE(startAddr + 0xAE), U16_TO_U8S_LE(startAddr + 0xAF), U16_TO_U8S_LE(startAddr + 0xB0), \
-      U16_TO_U8S_LE(startAddr + 0xB1), U16_TO_U8S_LE(startAddr + 0xB2), U16_TO_U8S_LE(startAddr + 0xB3), U16_TO_U8S_LE(startAddr + 0xB4), \
-      U16_TO_U8S_LE(startAddr + 0xB5), U16_TO_U8S_LE(startAddr + 0xB6), U16_TO_U8S_LE(startAddr + 0xB7), U16_TO_U8S_LE(startAddr + 0xB8), \
-      U16_TO_U8S_LE(startAddr + 0xB9), U16_TO_U8S_LE(startAddr + 0xBA), U16_TO_U8S_LE(startAddr + 0xBB), U16_TO_U8S_LE(startAddr + 0xBC), \
-      U16_TO_U8S_LE(startAddr + 0xBD), U16_TO_U8S_LE(startAddr + 0xBE), U16_TO_U8S_LE(startAddr + 0xBF), U16_TO_U8S_LE(startAddr + 0xC0), \
-      U16_TO_U8S_LE(startAddr + 0xC1), U16_TO_U8S_LE(startAddr + 0xC2), U16_TO_U8S_LE(startAddr + 0xC3), U16_TO_U8S_LE(startAddr + 0xC4), \
-      U16_TO_U8S_LE(startAddr + 0xC5), U16_TO_U8S_LE(startAddr + 0xC6), U16_TO_U8S_LE(startAddr + 0xC7), U16_TO_U8S_LE(startAddr + 0xC8), \
-      U16_TO_U8S_LE(startAddr + 0xC9), U16_TO_U8S_LE(startAddr + 0xCA), U16_TO_U8S_LE(startAddr + 0xCB), U16_TO_U8S_LE(startAddr + 0xCC), \
-      U16_TO_U8S_LE(startAddr + 0xCD), U16_TO_U8S_LE(startAddr + 0xCE), U16_TO_U8S_LE(startAddr + 0xCF), U16_TO_U8S_LE(startAddr + 0xD0), \
-      U16_TO_U8S_LE(startAddr + 0xD1), U16_TO_U8S_LE(startAddr + 0xD2), U16_TO_U8S_LE(startAddr + 0xD3), U16_TO_U8S_LE(startAddr + 0xD4), \
-      U16_TO_U8S_LE(startAddr + 0xD5), U16_TO_U8S_LE(startAddr + 0xD6), U16_TO_U8S_LE(startAddr + 0xD7), U16_TO_U8S_LE(startAddr + 0xD8), \
-      U16_TO_U8S_LE(startAddr + 0xD9), U16_TO_U8S_LE(startAddr + 0xDA), U16_TO_U8S_LE(startAddr + 0xDB), U16_TO_U8S_LE(startAddr + 0xDC), \
-      U16_TO_U8S_LE(startAddr + 0xDD), U16_TO_U8S_LE(startAddr + 0xDE), U16_TO_U8S_LE(startAddr + 0xDF), U16_TO_U8S_LE(startAddr + 0xE0), \
-      U16_TO_U8S_LE(startAddr + 0xE1), U16_TO_U8S_LE(startAddr + 0xE2), U16_TO_U8S_LE(startAddr + 0xE3), U16_TO_U8S_LE(startAddr + 0xE4), \
-      U16_TO_U8S_LE(startAddr + 0xE5), U16_TO_U8S_LE(startAddr + 0xE6), U16_TO_U8S_LE(startAddr + 0xE7), U16_TO_U8S_LE(startAddr + 0xE8), \
-      U16_TO_U8S_LE(startAddr + 0xE9), U16_TO_U8S_LE(startAddr + 0xEA), U16_TO_U8S_LE(startAddr + 0xEB), U16_TO_U8S_LE(startAddr + 0xEC), \
-      U16_TO_U8S_LE(startAddr + 0xED), U16_TO_U8S_LE(startAddr + 0xEE), U16_TO_U8S_LE(startAddr + 0xEF), U16_TO_U8S_LE(startAddr + 0xF0), \
-      U16_TO_U8S_LE(startAddr + 0xF1), U16_TO_U8S_LE(startAddr + 0xF2), U16_TO_U8S_LE(startAddr + 0xF3), U16_TO_U8S_LE(startAddr + 0xF4), \
-      U16_TO_U8S_LE(startAddr + 0xF5), U16_TO_U8S_LE(startAddr + 0xF6), U16_TO_U8S_LE(startAddr + 0xF7), U16_TO_U8S_LE(startAddr + 0xF8), \
-      U16_TO_U8S_LE(startAddr + 0xF9), U16_TO_U8S_LE(startAddr + 0xFA), U16_TO_U8S_LE(startAddr + 0xFB), U16_TO_U8S_LE(startAddr + 0xFC), \
-      U16_TO_U8S_LE(startAddr + 0xFD), U16_TO_U8S_LE(startAddr + 0xFE), U16_TO_U8S_LE(startAddr + 0xFF), U16_TO_U8S_LE(0xFFFF)
-
-// The ramdisk
-uint8_t msc_disk[ALLOCATED_DISK_BLOCK_NUM][DISK_BLOCK_SIZE] =
-{
-  //------------- Block0: Boot Sector -------------//
-  {
-      // Jump instruction
-      0xEB, 0x3C, 0x90,
-      // OEM Name
-      CHARACTERIFY8("MSDOS5.0"),
-
-      // BIOS Parameter Block
-      // Bytes per sector
-      U16_TO_U8S_LE(DISK_BLOCK_SIZE),
-      // Sectors per cluster
-      0x01,
-      // Reserved sectors
-      U16_TO_U8S_LE(NUM_RESERVED_SECTORS),
-      // Number of copies of file allocation tables
-      NUM_FAT_COPIES,
-      // Number of root entries (maximum number of files under root)
-      U16_TO_U8S_LE(NUM_ROOT_ENTRIES),
-      // Number of sectors (small)
-      U16_TO_U8S_LE(REPORTED_BLOCK_NUM),
-      // Media type (hard disk)
-      0xF8,
-      // Sectors per FAT
-      U16_TO_U8S_LE(SECTORS_PER_FAT),
-      // Sectors per track
-      U16_TO_U8S_LE(1),
-      // Number of heads
-      U16_TO_U8S_LE(1),
-      // Hidden sectors
-      U32_TO_U8S_LE(0),
-      // Number of sectors (large) (only used if small value is 0)
-      U32_TO_U8S_LE(0),
-      // Physical disk number
-      0x80,
-      // Current head
-      0x00,
-      // signature (must be either 0x28 or 0x29)
-      0x29,
-      // Volume serial number
-      0x34, 0x12, 0x00, 0x00,
-      // Volume label (11 bytes) (no longer actually used)
-      CHARACTERIFY11(VOLUME_LABEL11_STR),
-      // System ID (8 bytes) (host doesn't even use this)
-      CHARACTERIFY8("FAT16   "),
-
-      // Zero up to 2 last bytes of FAT magic code
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-
-      // FAT magic code
-      0x55, 0xAA
-  },
-
-  //------------- Block1-9: FAT16 Table -------------//
-  {
-      // first 16 bit entry must be FFF8
-      U16_TO_U8S_LE(0xFFF8),
-      // End of chain indicator / maintenance flags (reserved for cluster 1)
-      U16_TO_U8S_LE(0xFFFF),
-      // The rest is pointers to next cluster number or 0xFFFF if end (for page 2+)
-      U16_TO_U8S_LE(0xFFFF),
-      // Bad sectors for the rest of this block of addresses
-      U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7),
-      U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7), U16_TO_U8S_LE(0xFFF7)
-  },
-  // Each one of these blocks address the 128KB needed for each memory file
-  {FULL_PAGE_FAT_ENTRY(0x0100)},
-  {FULL_PAGE_FAT_ENTRY(0x0200)},
-  {FULL_PAGE_FAT_ENTRY(0x0300)},
-  {FULL_PAGE_FAT_ENTRY(0x0400)},
-  {FULL_PAGE_FAT_ENTRY(0x0500)},
-  {FULL_PAGE_FAT_ENTRY(0x0600)},
-  {FULL_PAGE_FAT_ENTRY(0x0700)},
-  {FULL_PAGE_FAT_ENTRY(0x0800)},
-  // Some hosts (looking at you, Windows) check if there is empty space available before overwriting
-  // an EXISTING file of the same size. For that fact, 128 kb will look available to fill just so
-  // the host proceeds past that check. This area is not actually writeable.
-  {},
+// Leading fields of the boot sector; the rest of the sector is filled in by build_boot_sector()
+static const uint8_t bootSectorHeader[] =
+{
+  // Jump instruction
+  0xEB, 0x3C, 0x90,
+  // OEM Name
+  CHARACTERIFY8("MSDOS5.0"),
+
+  // BIOS Parameter Block
+  // Bytes per sector
+  U16_TO_U8S_LE(DISK_BLOCK_SIZE),
+  // Sectors per cluster
+  0x01,
+  // Reserved sectors
+  U16_TO_U8S_LE(NUM_RESERVED_SECTORS),
+  // Number of copies of file allocation tables
+  NUM_FAT_COPIES,
+  // Number of root entries (maximum number of files under root)
+  U16_TO_U8S_LE(NUM_ROOT_ENTRIES),
+  // Number of sectors (small)
+  U16_TO_U8S_LE(REPORTED_BLOCK_NUM),
+  // Media type (hard disk)
+  0xF8,
+  // Sectors per FAT
+  U16_TO_U8S_LE(SECTORS_PER_FAT),
+  // Sectors per track
+  U16_TO_U8S_LE(1),
+  // Number of heads
+  U16_TO_U8S_LE(1),
+  // Hidden sectors
+  U32_TO_U8S_LE(0),
+  // Number of sectors (large) (only used if small value is 0)
+  U32_TO_U8S_LE(0),
+  // Physical disk number
+  0x80,
+  // Current head
+  0x00,
+  // signature (must be either 0x28 or 0x29)
+  0x29,
+  // Volume serial number
+  0x34, 0x12, 0x00, 0x00,
+  // Volume label (11 bytes) (no longer actually used)
+  CHARACTERIFY11(VOLUME_LABEL11_STR),
+  // System ID (8 bytes) (host doesn't even use this)
+  CHARACTERIFY8("FAT16   "),
+};
+
+// Root directory entries which are always present
+static const uint8_t internalRootEntries[FIRST_FILE_ROOT_ENTRY * BYTES_PER_ROOT_ENTRY] =
+{
+  // first entry is volume label
+  VOLUME_ENTRY(),
+  // second entry is readme file (will always be read only)
+  SIMPLE_DIR_ENTRY("README  ", "TXT", ATTR1_READ_ONLY, ATTR2_LOWERCASE_EXT, FIRST_VALID_FAT_ADDRESS, README_SIZE),
+};
+
+// The ramdisk: boot sector, FAT, root directory, then internal file contents; it is generated by
+// msc_init() and each slot is regenerated by msc_task() as VMUs are attached and detached
+static uint8_t msc_disk[ALLOCATED_DISK_BLOCK_NUM][DISK_BLOCK_SIZE];
+
+// Mask of slots whose region of the FAT and root directory entry are waiting to be regenerated
+static uint32_t dirtySlots = 0;
 
-  //------------- Block11: Root Directory -------------//
+static void set_fat_entry(uint32_t cluster, uint16_t value)
+{
+  // All FAT sectors are contiguous in the RAM disk
+  uint8_t entry[2] = {U16_TO_U8S_LE(value)};
+  memcpy(msc_disk[INTERNAL_FAT_SECTOR] + (cluster * 2), entry, sizeof(entry));
+}
+
+static void build_boot_sector()
+{
+  uint8_t* block = msc_disk[0];
+  memset(block, 0, DISK_BLOCK_SIZE);
+  memcpy(block, bootSectorHeader, sizeof(bootSectorHeader));
+  // FAT magic code
+  block[DISK_BLOCK_SIZE - 2] = 0x55;
+  block[DISK_BLOCK_SIZE - 1] = 0xAA;
+}
+
+// Builds the FAT sector which covers the internal files and clears all file regions
+static void build_internal_fat()
+{
+  // Some hosts (looking at you, Windows) check if there is empty space available before overwriting
+  // an EXISTING file of the same size. For that fact, the last FAT sector is left empty so 128 kb
+  // looks available to fill just so the host proceeds past that check. This area is not actually
+  // writeable.
+  memset(msc_disk[INTERNAL_FAT_SECTOR], 0, NUM_FAT_SECTORS * DISK_BLOCK_SIZE);
+  // first 16 bit entry must be FFF8
+  set_fat_entry(0, 0xFFF8);
+  // End of chain indicator / maintenance flags (reserved for cluster 1)
+  set_fat_entry(1, 0xFFFF);
+  // Each internal file fits in a single cluster
+  uint32_t cluster = FIRST_VALID_FAT_ADDRESS;
+  for (; cluster < FIRST_VALID_FAT_ADDRESS + NUM_INTERNAL_FILES; ++cluster)
+  {
+    set_fat_entry(cluster, 0xFFFF);
+  }
+  // Bad sectors for the rest of this block of addresses
+  for (; cluster < START_EXTERNAL_FILE_BLOCK; ++cluster)
   {
-      // first entry is volume label
-      VOLUME_ENTRY(),
-      // second entry is readme file (will always be read only)
-      SIMPLE_DIR_ENTRY("README  ", "TXT", ATTR1_READ_ONLY, ATTR2_LOWERCASE_EXT, FIRST_VALID_FAT_ADDRESS, README_SIZE),
-  },
+    set_fat_entry(cluster, 0xFFF7);
+  }
+}
 
-  //------------- Block12+: File Content -------------//
-  {README_CONTENTS}
-};
+#if !USB_MSC_EXPORT_SAVES
+// Lays out a slot's region of the FAT as one contiguous chain when a file is present or as bad
+// clusters otherwise so that the host never allocates anything there
+static void build_file_fat(uint32_t idx)
+{
+  uint32_t startCluster = START_EXTERNAL_FILE_BLOCK + (idx * BLOCKS_PER_FILE);
+  bool present = (fileEntries[idx].handle != nullptr);
+  for (uint32_t i = 0; i < BLOCKS_PER_FILE; ++i)
+  {
+    uint16_t value = 0xFFF7;
+    if (present)
+    {
+      value = (i < (BLOCKS_PER_FILE - 1)) ? (startCluster + i + 1) : 0xFFFF;
+    }
+    set_fat_entry(startCluster + i, value);
+  }
+}
+#endif
 
 bool upper_found(const char* name, uint32_t len)
 {
@@ -527,43 +424,564 @@ uint8_t parse_filename(const char* filename, uint8_t* name8, uint8_t* ext3)
   return rv;
 }
 
-void set_file_entries()
+// Returns true iff a write to a directory block leaves the name and location fields unchanged
+static bool directory_write_ok(const uint8_t* addr, uint32_t offset, const uint8_t* buffer, uint32_t bufsize)
+{
+  for (uint32_t idx = offset; idx < offset + bufsize; ++idx, ++addr, ++buffer)
+  {
+    if (*addr != *buffer)
+    {
+      uint32_t entryIdx = idx % BYTES_PER_ROOT_ENTRY;
+      // If it touches name field or location, that's bad!
+      if ((entryIdx >= 0 && entryIdx <= 10) || entryIdx == 26 || entryIdx == 27)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+
+// Blocks written by the host which wait to be written to a VMU; each VMU has its own queue so that a
+// slow write to one VMU doesn't hold up commands to the VMUs on the other buses
+// Queues are only accessed from the USB core; file add/remove on the other core never touches them
+struct WriteQueue
 {
-    uint8_t* rootDirEntry = msc_disk[NUM_RESERVED_SECTORS + NUM_FAT_SECTORS];
-    uint8_t const * rootEnd = msc_disk[NUM_HEADER_SECTORS];
-    // Move past volume label and internal files
-    rootDirEntry += ((1 + NUM_INTERNAL_FILES) * BYTES_PER_ROOT_ENTRY);
+  // Generation of the file entry which the queued blocks belong to
+  uint32_t generation;
+  // Index of the oldest queued block
+  uint8_t head;
+  // Number of queued blocks
+  uint8_t count;
+  // True once the oldest block was handed to writeAsync(), after which its data may not change
+  bool headStarted;
+  // Set when a queued write failed or was dropped because its VMU was removed; reported on the
+  // host's next access of this slot or its next cache flush
+  bool failed;
+  uint8_t blockNums[USB_MSC_WRITE_BEHIND_BLOCKS];
+  uint8_t data[USB_MSC_WRITE_BEHIND_BLOCKS][DISK_BLOCK_SIZE];
+};
+
+static WriteQueue writeQueues[sizeof(fileEntries) / sizeof(fileEntries[0])] = {};
 
-    // Set all files in fileEntries
-    for (uint32_t i = 0;
-         i < (sizeof(fileEntries) / sizeof(fileEntries[0])) && (rootDirEntry < rootEnd);
-         ++i)
+// Drops blocks queued for a file which was since removed (fileMutex must be locked)
+static void check_write_queue_owner(uint32_t idx)
+{
+  WriteQueue& queue = writeQueues[idx];
+  const FileEntry& entry = fileEntries[idx];
+  if (entry.handle != nullptr && queue.generation == entry.generation)
+  {
+    return;
+  }
+
+  if (queue.count > 0)
+  {
+    // The host was already told these were written, so the loss stays latched until reported
+    queue.failed = true;
+    queue.head = 0;
+    queue.count = 0;
+    queue.headStarted = false;
+  }
+
+  if (entry.handle != nullptr)
+  {
+    queue.generation = entry.generation;
+  }
+}
+
+// Continues writing the oldest block queued for a VMU (fileMutex must be locked)
+// Returns true iff nothing is left in the queue
+static bool drain_write_queue(uint32_t idx)
+{
+  check_write_queue_owner(idx);
+
+  WriteQueue& queue = writeQueues[idx];
+  if (queue.count == 0)
+  {
+    return true;
+  }
+
+  int32_t numWrite = fileEntries[idx].handle->writeAsync(
+    queue.blockNums[queue.head], queue.data[queue.head], DISK_BLOCK_SIZE, 250000);
+  queue.headStarted = true;
+  if (numWrite == 0)
+  {
+    return false;
+  }
+  else if (numWrite < 0)
+  {
+    // The host was already told this succeeded, so the failure is reported on its next access
+    queue.failed = true;
+    if (errorCount < MAX_ERROR_COUNT)
     {
-      // File entry is only considered set if handle is set
-      if (fileEntries[i].handle != nullptr)
+      ++errorCount;
+    }
+  }
+
+  queue.head = (queue.head + 1) % USB_MSC_WRITE_BEHIND_BLOCKS;
+  --queue.count;
+  queue.headStarted = false;
+  return (queue.count == 0);
+}
+
+// Queues a block to be written to a VMU (fileMutex must be locked)
+// Returns number of bytes queued or 0 while the queue is full
+static int32_t queue_write(uint32_t idx, uint8_t vmuAddr, const uint8_t* buffer)
+{
+  check_write_queue_owner(idx);
+
+  WriteQueue& queue = writeQueues[idx];
+
+  // A block written again before it reaches the VMU is only written once
+  for (int32_t i = queue.count - 1; i >= 0; --i)
+  {
+    uint32_t pos = (queue.head + i) % USB_MSC_WRITE_BEHIND_BLOCKS;
+    if (queue.blockNums[pos] == vmuAddr)
+    {
+      if (i == 0 && queue.headStarted)
       {
-        memcpy(rootDirEntry, defaultRootEntry, sizeof(defaultRootEntry));
-        // Parse filename into the name and extension fields
-        rootDirEntry[12] = parse_filename(fileEntries[i].filename, rootDirEntry, rootDirEntry + 8);
-        // Set address and size
-        uint8_t addrAndSize[6] = {U16_TO_U8S_LE(fileEntries[i].startBlock),
-                                  U32_TO_U8S_LE(fileEntries[i].size)};
-        memcpy(rootDirEntry + (BYTES_PER_ROOT_ENTRY - 6), addrAndSize, 6);
-        // Set read only flag is it is set
-        if (fileEntries[i].isReadOnly)
-        {
-          rootDirEntry[11] |= ATTR1_READ_ONLY;
-        }
-        // Move to next entry in FAT
-        rootDirEntry += BYTES_PER_ROOT_ENTRY;
+        // Already being written with the old data
+        break;
+      }
+      memcpy(queue.data[pos], buffer, DISK_BLOCK_SIZE);
+      return DISK_BLOCK_SIZE;
+    }
+  }
+
+  if (queue.count >= USB_MSC_WRITE_BEHIND_BLOCKS)
+  {
+    drain_write_queue(idx);
+    return 0;
+  }
+
+  uint32_t pos = (queue.head + queue.count) % USB_MSC_WRITE_BEHIND_BLOCKS;
+  queue.blockNums[pos] = vmuAddr;
+  memcpy(queue.data[pos], buffer, DISK_BLOCK_SIZE);
+  ++queue.count;
+  return DISK_BLOCK_SIZE;
+}
+
+// Copies the newest data queued for a block into buffer (fileMutex must be locked)
+// Returns true iff the block is queued
+static bool read_queued(uint32_t idx, uint8_t vmuAddr, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  check_write_queue_owner(idx);
+
+  WriteQueue& queue = writeQueues[idx];
+  for (int32_t i = queue.count - 1; i >= 0; --i)
+  {
+    uint32_t pos = (queue.head + i) % USB_MSC_WRITE_BEHIND_BLOCKS;
+    if (queue.blockNums[pos] == vmuAddr)
+    {
+      memcpy(buffer, queue.data[pos] + offset, bufsize);
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif // USB_MSC_WRITE_BEHIND_BLOCKS > 0
+
+// Returns true and sets sense when a queued write to a VMU slot failed or was dropped since the host
+// last accessed it (fileMutex must be locked)
+static bool report_write_failure(uint8_t lun, uint32_t idx)
+{
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  if (writeQueues[idx].failed)
+  {
+    writeQueues[idx].failed = false;
+    tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00);
+    return true;
+  }
+#else
+  (void)lun;
+  (void)idx;
+#endif
+  return false;
+}
+
+// Reads a VMU block, serving data which is still queued to be written (fileMutex must be locked)
+// Returns number of bytes read, 0 while in progress, or negative on failure
+static int32_t read_vmu_block(uint32_t idx, uint8_t vmuAddr, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  if (read_queued(idx, vmuAddr, offset, buffer, bufsize))
+  {
+    return bufsize;
+  }
+  else if (!drain_write_queue(idx))
+  {
+    // This VMU finishes its queued writes first; other VMUs aren't held up
+    return 0;
+  }
+#endif
+  // Zero is returned while the read is in progress, and TinyUSB will call again later
+  return fileEntries[idx].handle->readAsync(vmuAddr, buffer, bufsize, 20000);
+}
+
+// Writes a VMU block, queueing it when it is a whole block (fileMutex must be locked)
+// Returns number of bytes written or queued, 0 while in progress, or negative on failure
+static int32_t write_vmu_block(uint32_t idx, uint8_t vmuAddr, uint32_t offset, const uint8_t* buffer, uint32_t bufsize)
+{
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  if (offset == 0 && bufsize == DISK_BLOCK_SIZE)
+  {
+    return queue_write(idx, vmuAddr, buffer);
+  }
+  else if (!drain_write_queue(idx))
+  {
+    // A partial block is written once everything before it is written
+    return 0;
+  }
+#else
+  (void)offset;
+#endif
+  // Zero is returned while the write is in progress, and TinyUSB will call again later
+  return fileEntries[idx].handle->writeAsync(vmuAddr, buffer, bufsize, 250000);
+}
+
+#if USB_MSC_EXPORT_SAVES
+
+// Each file's region of clusters holds its saves followed by a directory listing them in the last
+// cluster of the region
+#define SAVE_DIRECTORY_OFFSET (BLOCKS_PER_FILE - 1)
+// Number of saves which fit in the directory cluster after the "." and ".." entries
+#define MAX_EXPORTED_SAVES ((DISK_BLOCK_SIZE / BYTES_PER_ROOT_ENTRY) - 2)
+
+struct SaveExport
+{
+  bool loaded;
+  uint8_t numSaves;
+  // Cluster offset of each save within the file's region
+  uint8_t offsets[MAX_EXPORTED_SAVES];
+  uint8_t numBlocks[MAX_EXPORTED_SAVES];
+};
+
+static SaveExport saveExports[sizeof(fileEntries) / sizeof(fileEntries[0])] = {};
+
+// Forgets the saves of a file so they are loaded again before its slot is regenerated
+static void forget_saves(uint32_t idx)
+{
+  saveExports[idx].loaded = false;
+  saveExports[idx].numSaves = 0;
+}
+
+// Loads the list of saves of a file and lays them out within its region; a file whose saves fail
+// to load is shown with no saves
+// Returns positive once loaded, 0 while loading, or negative on failure
+static int32_t load_saves(uint32_t idx)
+{
+  SaveExport& saves = saveExports[idx];
+  FileEntry& entry = fileEntries[idx];
+  int32_t result = entry.handle->loadSubFilesAsync(20000);
+  if (result != 0)
+  {
+    saves.numSaves = 0;
+    saves.loaded = true;
+  }
+  if (result > 0)
+  {
+    uint32_t offset = 0;
+    uint32_t numSubFiles = entry.handle->getNumSubFiles();
+    for (uint32_t i = 0; i < numSubFiles && saves.numSaves < MAX_EXPORTED_SAVES; ++i)
+    {
+      uint16_t numBlocks = entry.handle->getSubFileNumBlocks(i);
+      if ((offset + numBlocks) > SAVE_DIRECTORY_OFFSET)
+      {
+        // No more room before the directory cluster
+        break;
       }
+      saves.offsets[saves.numSaves] = offset;
+      saves.numBlocks[saves.numSaves] = numBlocks;
+      ++saves.numSaves;
+      offset += numBlocks;
+    }
+  }
+
+  return result;
+}
+
+// Lays out a slot's region of the FAT from its loaded saves: a chain for each save and one for the
+// directory cluster. Every other cluster is marked bad so that the host never allocates it.
+static void build_save_fat(uint32_t idx)
+{
+  uint32_t startCluster = START_EXTERNAL_FILE_BLOCK + (idx * BLOCKS_PER_FILE);
+  for (uint32_t i = 0; i < BLOCKS_PER_FILE; ++i)
+  {
+    set_fat_entry(startCluster + i, 0xFFF7);
+  }
+
+  if (fileEntries[idx].handle == nullptr)
+  {
+    return;
+  }
+
+  const SaveExport& saves = saveExports[idx];
+  for (uint32_t i = 0; i < saves.numSaves; ++i)
+  {
+    uint32_t cluster = startCluster + saves.offsets[i];
+    uint32_t lastCluster = cluster + saves.numBlocks[i] - 1;
+    for (; cluster < lastCluster; ++cluster)
+    {
+      set_fat_entry(cluster, cluster + 1);
+    }
+    set_fat_entry(lastCluster, 0xFFFF);
+  }
+  set_fat_entry(startCluster + SAVE_DIRECTORY_OFFSET, 0xFFFF);
+}
+
+// Returns the VMU block which holds the given cluster of a file's region or -1 if not in a save
+static int32_t find_save_block(uint32_t idx, uint32_t clusterOffset)
+{
+  const SaveExport& saves = saveExports[idx];
+  for (uint32_t i = 0; i < saves.numSaves; ++i)
+  {
+    if (clusterOffset >= saves.offsets[i] && clusterOffset < (uint32_t)(saves.offsets[i] + saves.numBlocks[i]))
+    {
+      return fileEntries[idx].handle->getSubFileBlock(i, clusterOffset - saves.offsets[i]);
+    }
+  }
+  return -1;
+}
+
+static void set_directory_entry(uint8_t* dirEntry, const uint8_t* name8, const char* ext3, uint8_t attr1, uint16_t cluster, uint32_t size)
+{
+  memcpy(dirEntry, defaultRootEntry, BYTES_PER_ROOT_ENTRY);
+  memcpy(dirEntry, name8, 8);
+  memcpy(dirEntry + 8, ext3, 3);
+  dirEntry[11] = attr1;
+  dirEntry[12] = 0;
+  uint8_t addrAndSize[6] = {U16_TO_U8S_LE(cluster), U32_TO_U8S_LE(size)};
+  memcpy(dirEntry + (BYTES_PER_ROOT_ENTRY - 6), addrAndSize, 6);
+}
+
+// Converts a VMU file name into an 8 character FAT name
+static void make_save_name(const char* vmuName, uint8_t* name8)
+{
+  memset(name8, ' ', 8);
+  uint32_t len = strlen(vmuName);
+  if (len > 8) len = 8;
+  while (len > 0 && vmuName[len - 1] == ' ')
+  {
+    --len;
+  }
+
+  if (len == 0)
+  {
+    memcpy(name8, "SAVE", 4);
+    return;
+  }
+
+  for (uint32_t i = 0; i < len; ++i)
+  {
+    uint8_t c = CHAR_TO_UPPER(vmuName[i]);
+    if (c <= ' ' || c > '~' || strchr("\"*+,./:;<=>?[\\]|", c) != nullptr)
+    {
+      c = '_';
+    }
+    name8[i] = c;
+  }
+}
+
+// Generates the directory cluster which lists the saves of a file
+static void build_save_directory(uint32_t idx, uint8_t* block)
+{
+  const FileEntry& entry = fileEntries[idx];
+  const SaveExport& saves = saveExports[idx];
+  const uint8_t dotName[8] = {'.', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+  const uint8_t dotDotName[8] = {'.', '.', ' ', ' ', ' ', ' ', ' ', ' '};
+  uint8_t attr1 = entry.isReadOnly ? (ATTR1_ARCHIVE | ATTR1_READ_ONLY) : ATTR1_ARCHIVE;
+
+  memset(block, 0, DISK_BLOCK_SIZE);
+  set_directory_entry(block, dotName, "   ", ATTR1_SUBDIR, entry.startBlock + SAVE_DIRECTORY_OFFSET, 0);
+  // Parent is the root directory
+  set_directory_entry(block + BYTES_PER_ROOT_ENTRY, dotDotName, "   ", ATTR1_SUBDIR, 0, 0);
+
+  uint8_t* dirEntry = block + (2 * BYTES_PER_ROOT_ENTRY);
+  for (uint32_t i = 0; i < saves.numSaves; ++i, dirEntry += BYTES_PER_ROOT_ENTRY)
+  {
+    uint8_t name8[8];
+    const char* vmuName = entry.handle->getSubFileName(i);
+    make_save_name((vmuName != nullptr) ? vmuName : "", name8);
+
+    // VMU names are 12 characters, so the shortened names may collide
+    for (uint8_t* prev = block + (2 * BYTES_PER_ROOT_ENTRY); prev < dirEntry; prev += BYTES_PER_ROOT_ENTRY)
+    {
+      if (memcmp(prev, name8, 8) == 0)
+      {
+        name8[6] = '~';
+        name8[7] = "0123456789ABCDEF"[i & 0x0F];
+        break;
+      }
+    }
+
+    set_directory_entry(dirEntry,
+                        name8,
+                        "VMS",
+                        attr1,
+                        entry.startBlock + saves.offsets[i],
+                        saves.numBlocks[i] * DISK_BLOCK_SIZE);
+  }
+}
+
+// Reads a cluster of a file's region: either the directory of saves or a block of a save
+// Returns number of bytes read, 0 while in progress, or negative on failure
+static int32_t read_save_block(FileEntry& entry, uint32_t realAddr, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  uint32_t idx = &entry - fileEntries;
+  uint32_t clusterOffset = realAddr - entry.startBlock;
+
+  if (!saveExports[idx].loaded)
+  {
+    // msc_task() is still regenerating this slot
+    return 0;
+  }
+
+  if (clusterOffset == SAVE_DIRECTORY_OFFSET)
+  {
+    uint8_t block[DISK_BLOCK_SIZE];
+    build_save_directory(idx, block);
+    memcpy(buffer, block + offset, bufsize);
+    return bufsize;
+  }
+
+  int32_t vmuAddr = find_save_block(idx, clusterOffset);
+  if (vmuAddr < 0)
+  {
+    // Not part of any save
+    memset(buffer, 0, bufsize);
+    return bufsize;
+  }
+
+  return read_vmu_block(idx, vmuAddr, offset, buffer, bufsize);
+}
+
+// Writes a cluster of a file's region; only blocks of existing saves may be overwritten
+// Returns number of bytes written, 0 while in progress, or negative on failure (sense is set)
+static int32_t write_save_block(uint8_t lun, FileEntry& entry, uint32_t realAddr, uint32_t offset, const uint8_t* buffer, uint32_t bufsize)
+{
+  uint32_t idx = &entry - fileEntries;
+  uint32_t clusterOffset = realAddr - entry.startBlock;
+
+  if (!saveExports[idx].loaded)
+  {
+    // msc_task() is still regenerating this slot
+    return 0;
+  }
+
+  int32_t vmuAddr = -1;
+  if (clusterOffset == SAVE_DIRECTORY_OFFSET)
+  {
+    // Same as the root directory: pretend to accept changes which don't matter
+    uint8_t block[DISK_BLOCK_SIZE];
+    build_save_directory(idx, block);
+    if (directory_write_ok(block + offset, offset, buffer, bufsize))
+    {
+      return bufsize;
+    }
+  }
+  else if (!entry.isReadOnly)
+  {
+    vmuAddr = find_save_block(idx, clusterOffset);
+  }
+
+  if (vmuAddr < 0)
+  {
+    // Throw a data protect error to stop the host from writing here
+    tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x00, 0x06);
+    return -1;
+  }
+
+  int32_t numWrite = write_vmu_block(idx, vmuAddr, offset, buffer, bufsize);
+  if (numWrite < 0)
+  {
+    // timeout
+    tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00);
+    if (errorCount < MAX_ERROR_COUNT)
+    {
+      ++errorCount;
     }
+  }
+  return numWrite;
+}
+
+#endif // USB_MSC_EXPORT_SAVES
+
+// Builds the root directory entry of a slot; an empty slot is marked as a deleted entry so that
+// the entries which follow it are still listed
+static void build_root_entry(uint32_t idx)
+{
+  uint8_t* rootDirEntry =
+    msc_disk[ROOT_DIR_SECTOR] + ((FIRST_FILE_ROOT_ENTRY + idx) * BYTES_PER_ROOT_ENTRY);
+  FileEntry& entry = fileEntries[idx];
+
+  if (entry.handle == nullptr)
+  {
+    memset(rootDirEntry, 0, BYTES_PER_ROOT_ENTRY);
+    rootDirEntry[0] = 0xE5;
+    return;
+  }
+
+  memcpy(rootDirEntry, defaultRootEntry, sizeof(defaultRootEntry));
+  // Parse filename into the name and extension fields
+  rootDirEntry[12] = parse_filename(entry.filename, rootDirEntry, rootDirEntry + 8);
+#if USB_MSC_EXPORT_SAVES
+  // The file is shown as a directory of its saves, named without the extension
+  memset(rootDirEntry + 8, ' ', 3);
+  rootDirEntry[11] = ATTR1_SUBDIR;
+  rootDirEntry[12] &= ~ATTR2_LOWERCASE_EXT;
+  uint8_t addrAndSize[6] = {U16_TO_U8S_LE(entry.startBlock + SAVE_DIRECTORY_OFFSET),
+                            U32_TO_U8S_LE(0)};
+  memcpy(rootDirEntry + (BYTES_PER_ROOT_ENTRY - 6), addrAndSize, 6);
+#else
+  // Set address and size
+  uint8_t addrAndSize[6] = {U16_TO_U8S_LE(entry.startBlock),
+                            U32_TO_U8S_LE(entry.size)};
+  memcpy(rootDirEntry + (BYTES_PER_ROOT_ENTRY - 6), addrAndSize, 6);
+  // Set read only flag is it is set
+  if (entry.isReadOnly)
+  {
+    rootDirEntry[11] |= ATTR1_READ_ONLY;
+  }
+#endif
+}
 
-    // Empty out everything else
-    if (rootDirEntry < rootEnd)
+// Regenerates the region of the FAT and the root directory entry of a slot
+static void build_slot(uint32_t idx)
+{
+#if USB_MSC_EXPORT_SAVES
+  build_save_fat(idx);
+#else
+  build_file_fat(idx);
+#endif
+  build_root_entry(idx);
+}
+
+// Finds the slot to show a file in; a VMU always lands in the slot of its port and sub-slot so that
+// its location on the drive doesn't depend on the order things were attached
+// Returns the slot index or -1 if no slot is available
+static int32_t find_free_slot(UsbFile* file)
+{
+  uint8_t port = 0;
+  uint8_t subSlot = 0;
+  if (file->getLocation(port, subSlot) && port < NUM_PORTS && subSlot < VMUS_PER_PLAYER)
+  {
+    uint32_t idx = (port * VMUS_PER_PLAYER) + subSlot;
+    return (fileEntries[idx].handle == nullptr) ? (int32_t)idx : -1;
+  }
+
+  // Files without a location take the first empty slot
+  for (uint32_t i = 0; i < (sizeof(fileEntries) / sizeof(fileEntries[0])); ++i)
+  {
+    if (fileEntries[i].handle == nullptr)
     {
-      memset(rootDirEntry, 0, rootEnd - rootDirEntry);
+      return i;
     }
+  }
+
+  return -1;
 }
 
 void usb_msc_add(UsbFile* file)
@@ -572,31 +990,28 @@ void usb_msc_add(UsbFile* file)
   assert(lockGuard.isLocked());
 
   const char* filename = file->getFileName();
-  if (*filename != '\0')
+  int32_t idx = (*filename != '\0') ? find_free_slot(file) : -1;
+  if (idx >= 0)
   {
-    // Find first empty slot and add file
-    for (uint32_t i = 0;
-         i < (sizeof(fileEntries) / sizeof(fileEntries[0]));
-         ++i)
+    FileEntry& entry = fileEntries[idx];
+    entry.handle = file;
+    entry.filename = filename;
+    entry.size = file->getFileSize();
+    if (entry.size > MAX_FILE_SIZE_BYTES)
     {
-      if (fileEntries[i].handle == nullptr)
-      {
-        fileEntries[i].handle = file;
-        fileEntries[i].filename = file->getFileName();
-        fileEntries[i].size = file->getFileSize();
-        if (fileEntries[i].size > MAX_FILE_SIZE_BYTES)
-        {
-          fileEntries[i].size = MAX_FILE_SIZE_BYTES;
-        }
-        fileEntries[i].startBlock = START_EXTERNAL_FILE_BLOCK + (i * BLOCKS_PER_FILE);
-        fileEntries[i].numBlocks = INT_DIVIDE_CEILING(fileEntries[i].size, DISK_BLOCK_SIZE);
-        fileEntries[i].isReadOnly = file->isReadOnly();
-        ++numFileEntries;
-        set_file_entries();
-        new_data = true;
-        break;
-      }
+      entry.size = MAX_FILE_SIZE_BYTES;
     }
+    entry.startBlock = START_EXTERNAL_FILE_BLOCK + (idx * BLOCKS_PER_FILE);
+    entry.numBlocks = INT_DIVIDE_CEILING(entry.size, DISK_BLOCK_SIZE);
+    entry.isReadOnly = file->isReadOnly();
+    ++entry.generation;
+#if USB_MSC_EXPORT_SAVES
+    // Saves are loaded by msc_task() before the slot is regenerated
+    forget_saves(idx);
+#endif
+    ++numFileEntries;
+    // The tables are regenerated by msc_task() so this core isn't held up
+    dirtySlots |= (1 << idx);
   }
 }
 
@@ -619,10 +1034,13 @@ void usb_msc_remove(UsbFile* file)
         fileEntries[i].filename = nullptr;
         fileEntries[i].size = 0;
         fileEntries[i].startBlock = 0;
+#if USB_MSC_EXPORT_SAVES
+        forget_saves(i);
+#endif
+        // Anything still queued for this VMU is dropped by the USB core, which reports the loss
         --numFileEntries;
-        set_file_entries();
-        // Only tell host to update data if device isn't ejected
-        new_data = true;
+        // The tables are regenerated by msc_task() so this core isn't held up
+        dirtySlots |= (1 << i);
         break;
       }
   }
@@ -650,9 +1068,150 @@ UsbFileSystem& usb_msc_get_file_system()
   return fileSystem;
 }
 
+// Files are laid out at a fixed stride, so the entry which holds an address is found directly
+// instead of scanning fileEntries (fileMutex must be locked)
+static FileEntry* find_file_entry(uint32_t realAddr)
+{
+  if (realAddr < START_EXTERNAL_FILE_BLOCK)
+  {
+    return nullptr;
+  }
+
+  uint32_t idx = (realAddr - START_EXTERNAL_FILE_BLOCK) / BLOCKS_PER_FILE;
+  if (idx >= (sizeof(fileEntries) / sizeof(fileEntries[0])))
+  {
+    return nullptr;
+  }
+
+  FileEntry* entry = &fileEntries[idx];
+  if (entry->handle == nullptr || realAddr >= (uint32_t)(entry->startBlock + entry->numBlocks))
+  {
+    return nullptr;
+  }
+
+  return entry;
+}
+
 void msc_init(MutexInterface* mutex)
 {
   fileMutex = mutex;
+
+  LockGuard lockGuard(*fileMutex);
+  assert(lockGuard.isLocked());
+
+  build_boot_sector();
+  build_internal_fat();
+
+  memset(msc_disk[ROOT_DIR_SECTOR], 0, NUM_ROOT_SECTORS * DISK_BLOCK_SIZE);
+  memcpy(msc_disk[ROOT_DIR_SECTOR], internalRootEntries, sizeof(internalRootEntries));
+
+  memset(msc_disk[NUM_HEADER_SECTORS], 0, DISK_BLOCK_SIZE);
+  memcpy(msc_disk[NUM_HEADER_SECTORS], README_CONTENTS, README_SIZE);
+
+  for (uint32_t i = 0; i < (sizeof(fileEntries) / sizeof(fileEntries[0])); ++i)
+  {
+    build_slot(i);
+  }
+  dirtySlots = 0;
+}
+
+void msc_task()
+{
+  LockGuard lockGuard(*fileMutex);
+  assert(lockGuard.isLocked());
+
+  if (dirtySlots != 0)
+  {
+    // Only one slot is regenerated per call so that a hot-plug doesn't stall the USB stack
+    uint32_t idx = 0;
+    while ((dirtySlots & (1 << idx)) == 0)
+    {
+      ++idx;
+    }
+
+    bool ready = true;
+#if USB_MSC_EXPORT_SAVES
+    // The FAT depends on the saves, so they are laid out before the host is told about the change
+    if (fileEntries[idx].handle != nullptr && !saveExports[idx].loaded)
+    {
+      ready = (load_saves(idx) != 0);
+    }
+#endif
+
+    if (ready)
+    {
+      dirtySlots &= ~(1 << idx);
+      build_slot(idx);
+
+      if (dirtySlots == 0)
+      {
+        // The host is told about the change only once the tables are consistent again
+        new_data = true;
+      }
+    }
+  }
+
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  // Each VMU is written independently, so VMUs on separate buses are written concurrently; queues of
+  // removed VMUs are dropped here too
+  for (uint32_t i = 0; i < (sizeof(fileEntries) / sizeof(fileEntries[0])); ++i)
+  {
+    drain_write_queue(i);
+  }
+#endif
+}
+
+// Checks whether everything queued is stored without blocking (used when the host flushes its cache);
+// msc_task() continues the queued writes meanwhile
+// Returns true once all queued writes are done; otherwise, false is returned and sense is set so that
+// the host retries later
+static bool flush_write_queues(uint8_t lun)
+{
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  LockGuard lockGuard(*fileMutex);
+  assert(lockGuard.isLocked());
+
+  bool empty = true;
+  for (uint32_t i = 0; i < (sizeof(fileEntries) / sizeof(fileEntries[0])); ++i)
+  {
+    if (!drain_write_queue(i))
+    {
+      empty = false;
+    }
+  }
+
+  if (!empty)
+  {
+    // Logical unit is in process of becoming ready
+    tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x04, 0x01);
+    return false;
+  }
+#else
+  (void)lun;
+#endif
+  return true;
+}
+
+// Reports any queued write which failed or was dropped, including those of removed VMUs
+// Returns true and sets sense iff there was a failure
+static bool report_write_failures(uint8_t lun)
+{
+  bool failed = false;
+#if USB_MSC_WRITE_BEHIND_BLOCKS > 0
+  LockGuard lockGuard(*fileMutex);
+  assert(lockGuard.isLocked());
+
+  for (uint32_t i = 0; i < (sizeof(fileEntries) / sizeof(fileEntries[0])); ++i)
+  {
+    if (report_write_failure(lun, i))
+    {
+      failed = true;
+    }
+  }
+#else
+  (void)lun;
+#endif
+  return failed;
 }
 
 // Invoked when received SCSI_CMD_INQUIRY
@@ -681,6 +1240,16 @@ bool tud_msc_test_unit_ready_cb(uint8_t lun)
     // Force eject
     ejected = true;
   }
+  else if (dirtySlots != 0)
+  {
+    // Tables are still being regenerated after a hot-plug - the host is asked to wait instead of
+    // reading them half way through
+    if (!ejected)
+    {
+      tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x04, 0x01);
+      return false;
+    }
+  }
   else if (new_data)
   {
     new_data = false;
@@ -738,7 +1307,11 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, boo
     }
     else
     {
-      // unload disk storage
+      // unload disk storage once everything written is stored
+      if (!flush_write_queues(lun) || report_write_failures(lun))
+      {
+        return false;
+      }
       ejected = true;
     }
   }
@@ -746,9 +1319,9 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, boo
   return true;
 }
 
-// Callback invoked when received READ10 command.
-// Copy disk's data to buffer (up to bufsize) and return number of copied bytes.
-int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+// Copies up to 1 block of disk's data to buffer and returns number of copied bytes, 0 if the data
+// isn't ready yet, or negative on failure
+static int32_t read_block(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize, uint32_t numBlocksAhead)
 {
   (void) lun;
 
@@ -778,27 +1351,44 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buff
 
     uint32_t realAddr = lba + FIRST_VALID_FAT_ADDRESS - NUM_HEADER_SECTORS;
 
-    // Find the file which contains this address
-    for (uint32_t i = 0;
-        i < (sizeof(fileEntries) / sizeof(fileEntries[0]));
-        ++i)
+    FileEntry* entry = find_file_entry(realAddr);
+    if (entry != nullptr && report_write_failure(lun, entry - fileEntries))
     {
-        if (realAddr >= fileEntries[i].startBlock && realAddr < (fileEntries[i].startBlock + fileEntries[i].numBlocks))
+      numRead = -1;
+    }
+    else if (entry != nullptr)
+    {
+#if USB_MSC_EXPORT_SAVES
+      (void)numBlocksAhead;
+      numRead = read_save_block(*entry, realAddr, offset, buffer, bufsize);
+      if (numRead < 0)
+#else
+      uint32_t vmuAddr = realAddr & 0xFF;
+      numRead = read_vmu_block(entry - fileEntries, vmuAddr, offset, buffer, bufsize);
+      if (numRead == 0 && numBlocksAhead > 0)
+      {
+        // Request the rest of the blocks in the transfer all at once
+        uint32_t lastAddr = realAddr + numBlocksAhead;
+        uint32_t fileEndAddr = entry->startBlock + entry->numBlocks - 1;
+        if (lastAddr > fileEndAddr)
         {
-          // Found the matching file!
-          uint32_t vmuAddr = realAddr & 0xFF;
-          numRead = fileEntries[i].handle->read(vmuAddr, buffer, bufsize, 20000);
-          if (numRead < 0)
-          {
-            // timeout
-            tud_msc_set_sense(lun, SCSI_SENSE_ABORTED_COMMAND, 0x1B, 0x00);
-            if (errorCount < MAX_ERROR_COUNT)
-            {
-              ++errorCount;
-            }
-          }
-          break;
+          lastAddr = fileEndAddr;
+        }
+        if (lastAddr > realAddr)
+        {
+          entry->handle->prefetch(vmuAddr + 1, lastAddr - realAddr);
         }
+      }
+      else if (numRead < 0)
+#endif
+      {
+        // timeout
+        tud_msc_set_sense(lun, SCSI_SENSE_ABORTED_COMMAND, 0x1B, 0x00);
+        if (errorCount < MAX_ERROR_COUNT)
+        {
+          ++errorCount;
+        }
+      }
     }
   }
   else if (lba < REPORTED_BLOCK_NUM)
@@ -816,6 +1406,48 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buff
   return numRead;
 }
 
+// Callback invoked when received READ10 command.
+// Copy disk's data to buffer (up to bufsize) and return number of copied bytes.
+// The buffer may span several blocks; blocks which are ready are returned, and TinyUSB calls again
+// for the rest.
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  uint8_t* buffer8 = (uint8_t*)buffer;
+  uint32_t numRead = 0;
+
+  while (numRead < bufsize)
+  {
+    uint32_t len = DISK_BLOCK_SIZE - offset;
+    if (len > (bufsize - numRead))
+    {
+      len = bufsize - numRead;
+    }
+    uint32_t numBlocksAhead = (bufsize - numRead - len + DISK_BLOCK_SIZE - 1) / DISK_BLOCK_SIZE;
+
+    int32_t result = read_block(lun, lba, offset, buffer8 + numRead, len, numBlocksAhead);
+    if (result < 0)
+    {
+      // Sense is set, so the command fails here; a partial count would have TinyUSB carry on
+      return result;
+    }
+    else if (result == 0)
+    {
+      // Return what is ready, if anything
+      return numRead;
+    }
+
+    numRead += result;
+    if ((uint32_t)result < len)
+    {
+      break;
+    }
+    ++lba;
+    offset = 0;
+  }
+
+  return numRead;
+}
+
 bool tud_msc_is_writable_cb (uint8_t lun)
 {
   (void) lun;
@@ -823,9 +1455,9 @@ bool tud_msc_is_writable_cb (uint8_t lun)
   return true;
 }
 
-// Callback invoked when received WRITE10 command.
-// Process data in buffer to disk's storage and return number of written bytes
-int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+// Processes up to 1 block of data in buffer to disk's storage and returns number of written bytes,
+// 0 if the storage isn't done yet, or negative on failure
+static int32_t write_block(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
 {
   (void) lun;
 
@@ -835,25 +1467,10 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t*
   {
     // RAM disk area
     uint8_t const* addr = msc_disk[lba] + offset;
-    if (lba == NUM_RESERVED_SECTORS + NUM_FAT_SECTORS)
+    if (lba == ROOT_DIR_SECTOR)
     {
       // Special case: allow host to write only if it isn't changing important things
-      bool ok = true;
-      for (uint32_t idx = offset; idx < offset + bufsize; ++idx, ++addr, ++buffer)
-      {
-        if (*addr != *buffer)
-        {
-          uint32_t entryIdx = idx % BYTES_PER_ROOT_ENTRY;
-          // If it touches name field or location, that's bad!
-          if ((entryIdx >= 0 && entryIdx <= 10) || entryIdx == 26 || entryIdx == 27)
-          {
-            ok = false;
-            break;
-          }
-        }
-      }
-
-      if (ok)
+      if (directory_write_ok(addr, offset, buffer, bufsize))
       {
         // Tell the host this was successful, but don't actually change anything
         numWrite = bufsize;
@@ -893,41 +1510,39 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t*
 
     uint32_t realAddr = lba + FIRST_VALID_FAT_ADDRESS - NUM_HEADER_SECTORS;
 
-    // Find the file which contains this address
-    bool found = false;
-    for (uint32_t i = 0;
-        i < (sizeof(fileEntries) / sizeof(fileEntries[0]));
-        ++i)
+    FileEntry* entry = find_file_entry(realAddr);
+    if (entry != nullptr && report_write_failure(lun, entry - fileEntries))
+    {
+      numWrite = -1;
+    }
+    else if (entry != nullptr)
     {
-        if (realAddr >= fileEntries[i].startBlock && realAddr < (fileEntries[i].startBlock + fileEntries[i].numBlocks))
+#if USB_MSC_EXPORT_SAVES
+      numWrite = write_save_block(lun, *entry, realAddr, offset, buffer, bufsize);
+#else
+      uint32_t vmuAddr = realAddr & 0xFF;
+      if (!entry->isReadOnly)
+      {
+        numWrite = write_vmu_block(entry - fileEntries, vmuAddr, offset, buffer, bufsize);
+        if (numWrite < 0)
         {
-          // Found the matching file!
-          found = true;
-          uint32_t vmuAddr = realAddr & 0xFF;
-          if (!fileEntries[i].isReadOnly)
-          {
-            numWrite = fileEntries[i].handle->write(vmuAddr, buffer, bufsize, 250000);
-            if (numWrite < 0)
-            {
-              // timeout
-              tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00);
-              if (errorCount < MAX_ERROR_COUNT)
-              {
-                ++errorCount;
-              }
-            }
-          }
-          else
+          // timeout
+          tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00);
+          if (errorCount < MAX_ERROR_COUNT)
           {
-            // Throw a data protect error to stop the host from writing here
-            tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x00, 0x06);
-            numWrite = -1;
+            ++errorCount;
           }
-          break;
         }
+      }
+      else
+      {
+        // Throw a data protect error to stop the host from writing here
+        tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x00, 0x06);
+        numWrite = -1;
+      }
+#endif
     }
-
-    if (!found)
+    else
     {
       tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x00, 0x06);
       numWrite = -1;
@@ -949,6 +1564,45 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t*
   return numWrite;
 }
 
+// Callback invoked when received WRITE10 command.
+// Process data in buffer to disk's storage and return number of written bytes
+// The buffer may span several blocks; TinyUSB calls again with whatever isn't consumed.
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  uint32_t numWrite = 0;
+
+  while (numWrite < bufsize)
+  {
+    uint32_t len = DISK_BLOCK_SIZE - offset;
+    if (len > (bufsize - numWrite))
+    {
+      len = bufsize - numWrite;
+    }
+
+    int32_t result = write_block(lun, lba, offset, buffer + numWrite, len);
+    if (result < 0)
+    {
+      // Sense is set, so the command fails here; a partial count would have TinyUSB carry on
+      return result;
+    }
+    else if (result == 0)
+    {
+      // Report what was consumed, if anything
+      return numWrite;
+    }
+
+    numWrite += result;
+    if ((uint32_t)result < len)
+    {
+      break;
+    }
+    ++lba;
+    offset = 0;
+  }
+
+  return numWrite;
+}
+
 // Callback invoked when received an SCSI command not in built-in list below
 // - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, MODE_SENSE6, REQUEST_SENSE
 // - READ10 and WRITE10 has their own callbacks
@@ -969,6 +1623,11 @@ int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer,
       resplen = 0;
     break;
 
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+      // Host expects everything it wrote to be stored once this completes
+      resplen = (flush_write_queues(lun) && !report_write_failures(lun)) ? 0 : -1;
+    break;
+
     default:
       // Set Sense = Invalid Command Operation
       tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
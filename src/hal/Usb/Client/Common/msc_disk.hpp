@@ -24,3 +24,7 @@
 #include "hal/System/MutexInterface.hpp"
 
 void msc_init(MutexInterface* mutex);
+
+// Regenerates the drive tables after VMUs are attached or detached and continues writing the blocks
+// queued for each VMU; called periodically from the USB core
+void msc_task();
@@ -91,8 +91,8 @@ extern "C" {
 // CDC Endpoint transfer buffer size, more is faster
 #define CFG_TUD_CDC_EP_BUFSIZE   64
 
-// MSC Buffer size of Device Mass storage
-#define CFG_TUD_MSC_EP_BUFSIZE   512
+// MSC Buffer size of Device Mass storage (multiple blocks per transfer callback)
+#define CFG_TUD_MSC_EP_BUFSIZE   4096
 
 #ifdef __cplusplus
 }
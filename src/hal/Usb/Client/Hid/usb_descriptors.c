@@ -102,6 +102,14 @@ uint8_t get_usb_descriptor_number_of_gamepads()
     HID_REPORT_COUNT   ( 32                                     ) ,\
     HID_REPORT_SIZE    ( 1                                      ) ,\
     HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
+    /* Vendor defined vibration output (see usb_descriptors.h for layout) */ \
+    HID_USAGE_PAGE_N   ( HID_USAGE_PAGE_VENDOR, 2               ) ,\
+    HID_USAGE          ( 0x01                                   ) ,\
+    HID_LOGICAL_MIN    ( 0x00                                   ) ,\
+    HID_LOGICAL_MAX_N  ( 0xFF, 2                                ) ,\
+    HID_REPORT_COUNT   ( VIBRATION_REPORT_SIZE                  ) ,\
+    HID_REPORT_SIZE    ( 8                                      ) ,\
+    HID_OUTPUT         ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE ) ,\
   HID_COLLECTION_END \
 
 //--------------------------------------------------------------------+
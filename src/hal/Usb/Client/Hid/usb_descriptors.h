@@ -48,4 +48,16 @@ static const int8_t MIN_TRIGGER_VALUE = MIN_ANALOG_VALUE;
 //! Maximum trigger value defined in USB HID descriptors
 static const int8_t MAX_TRIGGER_VALUE = MAX_ANALOG_VALUE;
 
+// Gamepad vibration output report layout (vendor defined)
+//! Intensity: 0 to stop, otherwise 1 (low) to 255 (high)
+#define VIBRATION_REPORT_INTENSITY_IDX (0)
+//! Inclination as signed byte: negative to ramp down, 0 for constant, positive to ramp up
+#define VIBRATION_REPORT_INCLINATION_IDX (1)
+//! Pulsation frequency in Hz (0 to let the device select)
+#define VIBRATION_REPORT_FREQUENCY_IDX (2)
+//! Duration in ms as 16-bit little endian (0 to vibrate until the next report)
+#define VIBRATION_REPORT_DURATION_IDX (3)
+//! Size of the vibration output report
+#define VIBRATION_REPORT_SIZE (5)
+
 #endif // __USB_DESCRITORS_H__
@@ -26,6 +26,7 @@
 #include "UsbGamepad.h"
 #include "configuration.h"
 #include "hal/Usb/client_usb_interface.hpp"
+#include "hal/Usb/usb_interface.hpp"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -72,6 +73,16 @@ DreamcastControllerObserver** get_usb_controller_observers()
   return observers;
 }
 
+VibrationObserver* vibrationObservers[MAX_NUMBER_OF_USB_GAMEPADS] = {};
+
+void set_usb_vibration_observer(uint32_t idx, VibrationObserver* observer)
+{
+  if (idx < MAX_NUMBER_OF_USB_GAMEPADS)
+  {
+    vibrationObservers[idx] = observer;
+  }
+}
+
 uint32_t get_num_usb_controllers()
 {
   uint8_t installedGamepads = get_usb_descriptor_number_of_gamepads();
@@ -195,6 +206,7 @@ void usb_init(
 void usb_task()
 {
   tud_task(); // tinyusb device task
+  msc_task();
   led_task();
   cdc_task();
 }
@@ -282,9 +294,30 @@ void tud_hid_set_report_cb(uint8_t instance,
                            uint8_t const *buffer,
                            uint16_t bufsize)
 {
-  (void) instance;
-  (void) report_type;
+  (void) report_id;
+
+  // Only the vibration output report is accepted (type is invalid when received on an OUT endpoint)
+  if ((report_type != HID_REPORT_TYPE_OUTPUT && report_type != HID_REPORT_TYPE_INVALID)
+      || bufsize < VIBRATION_REPORT_SIZE
+      || instance >= numUsbDevices)
+  {
+    return;
+  }
 
-  // echo back anything we received from host
-  tud_hid_report(report_id, buffer, bufsize);
+  // Interfaces are numbered in reverse order of gamepads
+  uint8_t idx = ITF_NUM_GAMEPAD(numUsbDevices, instance);
+  VibrationObserver* observer = vibrationObservers[idx];
+  if (observer != nullptr)
+  {
+    // Handed straight to the latest-value slot of the player; nothing is queued here
+    float intensity = buffer[VIBRATION_REPORT_INTENSITY_IDX] / 255.0f;
+    int8_t inclination = static_cast<int8_t>(buffer[VIBRATION_REPORT_INCLINATION_IDX]);
+    float frequency = buffer[VIBRATION_REPORT_FREQUENCY_IDX];
+    uint16_t durationMs = buffer[VIBRATION_REPORT_DURATION_IDX]
+                          | (buffer[VIBRATION_REPORT_DURATION_IDX + 1] << 8);
+    observer->vibrate(frequency,
+                      intensity,
+                      (inclination < 0) ? -1 : ((inclination > 0) ? 1 : 0),
+                      durationMs / 1000.0f);
+  }
 }
\ No newline at end of file
@@ -41,7 +41,8 @@ DreamcastMainNode::DreamcastMainNode(MapleBusInterface& bus,
     mSubNodes(),
     mTransmissionTimeliner(bus, prioritizedTxScheduler),
     mScheduleId(-1),
-    mCommFailCount(0)
+    mCommFailCount(0),
+    mSubPeripheralAddrs(0)
 {
     addInfoRequestToSchedule();
     mSubNodes.reserve(DreamcastPeripheral::MAX_SUB_PERIPHERALS);
@@ -99,6 +100,8 @@ void DreamcastMainNode::txComplete(std::shared_ptr<const MaplePacket> packet,
 void DreamcastMainNode::disconnectMainPeripheral(uint64_t currentTimeUs)
 {
     mPeripherals.clear();
+    mPlayerData.responseCache.clearDeviceInfo(mAddr);
+    mSubPeripheralAddrs = 0;
     mEndpointTxScheduler->cancelByRecipient(getRecipientAddress());
     for (std::vector<std::shared_ptr<DreamcastSubNode>>::iterator iter = mSubNodes.begin();
             iter != mSubNodes.end();
@@ -114,6 +117,13 @@ void DreamcastMainNode::readTask(uint64_t currentTimeUs)
 {
     TransmissionTimeliner::ReadStatus readStatus = mTransmissionTimeliner.readTask(currentTimeUs);
 
+    if (readStatus.transmission != nullptr)
+    {
+        // Storage must learn of blocks written by others, such as a flycast or passthrough client,
+        // before the peripherals may be deleted below
+        mPlayerData.storageRegistry.txFinished(*readStatus.transmission);
+    }
+
     // WARNING: The below is handled with care so that the transmitter pointer is guaranteed to be
     //          valid if not set to nullptr. Peripherals are only deleted in 2 places below*
 
@@ -134,6 +144,7 @@ void DreamcastMainNode::readTask(uint64_t currentTimeUs)
             {
                 // This was meant for the main node or one of the main node's peripherals
                 // Use the sender address to determine what sub peripherals are connected
+                uint8_t subPeripheralAddrs = 0;
                 for (std::vector<std::shared_ptr<DreamcastSubNode>>::iterator iter = mSubNodes.begin();
                      iter != mSubNodes.end();
                      ++iter)
@@ -143,10 +154,27 @@ void DreamcastMainNode::readTask(uint64_t currentTimeUs)
 
                     uint8_t mask = (*iter)->getAddr();
                     (*iter)->setConnected((sendAddr & mask) != 0, currentTimeUs);
+                    subPeripheralAddrs |= (sendAddr & mask);
+                }
+
+                if (subPeripheralAddrs != mSubPeripheralAddrs)
+                {
+                    // The cached main peripheral device info carries the old presence bits in its
+                    // sender address
+                    mPlayerData.responseCache.clearDeviceInfo(mAddr);
+                    mSubPeripheralAddrs = subPeripheralAddrs;
                 }
             }
         }
 
+        // Keep the latest device info of every peripheral for external requests
+        if (readStatus.received->frame.command == COMMAND_RESPONSE_DEVICE_INFO)
+        {
+            mPlayerData.responseCache.setDeviceInfo(
+                readStatus.transmission->packet->frame.recipientAddr,
+                readStatus.received);
+        }
+
         // Send this off to the one who transmitted this
         Transmitter* transmitter = readStatus.transmission->transmitter;
         if (transmitter != nullptr)
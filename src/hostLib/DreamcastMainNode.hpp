@@ -100,4 +100,6 @@ class DreamcastMainNode : public DreamcastNode
         int64_t mScheduleId;
         //! Current count of number of communication failures
         uint32_t mCommFailCount;
+        //! Sub peripheral presence bits last seen in the sender address of a main peripheral response
+        uint8_t mSubPeripheralAddrs;
 };
\ No newline at end of file
@@ -102,6 +102,7 @@ void DreamcastSubNode::setConnected(bool connected, uint64_t currentTimeUs)
     {
         mConnected = connected;
         mPeripherals.clear();
+        mPlayerData.responseCache.clearDeviceInfo(mAddr);
         mEndpointTxScheduler->cancelByRecipient(getRecipientAddress());
         if (mConnected)
         {
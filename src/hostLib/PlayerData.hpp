@@ -26,6 +26,9 @@
 #include "hal/Usb/DreamcastControllerObserver.hpp"
 #include "hal/System/ClockInterface.hpp"
 #include "ScreenData.hpp"
+#include "ResponseCache.hpp"
+#include "StorageRegistry.hpp"
+#include "RumbleSlot.hpp"
 #include "hal/Usb/UsbFileSystem.hpp"
 
 //! Contains data that is tied to a specific player
@@ -36,16 +39,25 @@ struct PlayerData
     ScreenData& screenData;
     ClockInterface& clock;
     UsbFileSystem& fileSystem;
+    ResponseCache& responseCache;
+    StorageRegistry& storageRegistry;
+    RumbleSlot& rumbleSlot;
 
     PlayerData(uint32_t playerIndex,
                DreamcastControllerObserver& gamepad,
                ScreenData& screenData,
                ClockInterface& clock,
-               UsbFileSystem& fileSystem) :
+               UsbFileSystem& fileSystem,
+               ResponseCache& responseCache,
+               StorageRegistry& storageRegistry,
+               RumbleSlot& rumbleSlot) :
         playerIndex(playerIndex),
         gamepad(gamepad),
         screenData(screenData),
         clock(clock),
-        fileSystem(fileSystem)
+        fileSystem(fileSystem),
+        responseCache(responseCache),
+        storageRegistry(storageRegistry),
+        rumbleSlot(rumbleSlot)
     {}
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ResponseCache.hpp"
+
+ResponseCache::ResponseCache() :
+    mCondition(nullptr),
+    mConditionTimeUs(0),
+    mDeviceInfo(),
+    mDeviceInfoHits(0),
+    mDeviceInfoMisses(0)
+{}
+
+void ResponseCache::setCondition(std::shared_ptr<const MaplePacket> packet, uint64_t timeUs)
+{
+    mCondition = packet;
+    mConditionTimeUs = timeUs;
+}
+
+void ResponseCache::clearCondition()
+{
+    mCondition = nullptr;
+    mConditionTimeUs = 0;
+}
+
+std::shared_ptr<const MaplePacket> ResponseCache::getCondition(uint64_t& timeUs) const
+{
+    timeUs = mConditionTimeUs;
+    return mCondition;
+}
+
+int32_t ResponseCache::deviceInfoIndex(uint8_t addr)
+{
+    addr &= 0x3F;
+    if (addr == DreamcastPeripheral::MAIN_PERIPHERAL_ADDR_MASK)
+    {
+        return 0;
+    }
+    int32_t subIdx = DreamcastPeripheral::subPeripheralIndex(addr);
+    return (subIdx >= 0) ? (subIdx + 1) : -1;
+}
+
+void ResponseCache::setDeviceInfo(uint8_t addr, std::shared_ptr<const MaplePacket> packet)
+{
+    int32_t idx = deviceInfoIndex(addr);
+    if (idx >= 0 && packet != nullptr && packet->payload.size() > 3)
+    {
+        mDeviceInfo[idx] = packet;
+    }
+}
+
+void ResponseCache::clearDeviceInfo(uint8_t addr)
+{
+    int32_t idx = deviceInfoIndex(addr);
+    if (idx >= 0)
+    {
+        mDeviceInfo[idx] = nullptr;
+    }
+}
+
+std::shared_ptr<const MaplePacket> ResponseCache::lookupDeviceInfo(uint8_t addr)
+{
+    int32_t idx = deviceInfoIndex(addr);
+    std::shared_ptr<const MaplePacket> packet = (idx >= 0) ? mDeviceInfo[idx] : nullptr;
+    if (packet != nullptr)
+    {
+        ++mDeviceInfoHits;
+    }
+    else
+    {
+        ++mDeviceInfoMisses;
+    }
+    return packet;
+}
+
+uint32_t ResponseCache::getDeviceInfoHits() const
+{
+    return mDeviceInfoHits;
+}
+
+uint32_t ResponseCache::getDeviceInfoMisses() const
+{
+    return mDeviceInfoMisses;
+}
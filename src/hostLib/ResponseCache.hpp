@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "hal/MapleBus/MaplePacket.hpp"
+#include "DreamcastPeripheral.hpp"
+
+#include <stdint.h>
+#include <memory>
+
+//! Holds the most recent responses received from the peripherals of a single player so that
+//! external requests may be answered without waiting on a Maple Bus round trip
+//! @note This is only to be accessed from the core which executes the nodes and the TTY parser
+class ResponseCache
+{
+    public:
+        //! Constructor
+        ResponseCache();
+
+        //! Sets the latest controller condition
+        //! @param[in] packet  The condition response packet received from the controller
+        //! @param[in] timeUs  The time at which the packet was received
+        void setCondition(std::shared_ptr<const MaplePacket> packet, uint64_t timeUs);
+
+        //! Clears the cached controller condition (called when the controller disconnects)
+        void clearCondition();
+
+        //! @param[out] timeUs  The time at which the returned packet was received
+        //! @returns the latest controller condition response or nullptr if none is available
+        std::shared_ptr<const MaplePacket> getCondition(uint64_t& timeUs) const;
+
+        //! Sets the latest device info response for a peripheral; a response carrying a different
+        //! function code than the one cached replaces it
+        //! @param[in] addr  The address the device info request was sent to
+        //! @param[in] packet  The device info response packet
+        void setDeviceInfo(uint8_t addr, std::shared_ptr<const MaplePacket> packet);
+
+        //! Invalidates the cached device info for a peripheral (called on disconnect)
+        //! @param[in] addr  The address of the peripheral
+        void clearDeviceInfo(uint8_t addr);
+
+        //! Looks up the cached device info for a peripheral, counting the lookup as a hit or miss
+        //! @param[in] addr  The address the device info request is destined for
+        //! @returns the cached device info response or nullptr if none is available
+        std::shared_ptr<const MaplePacket> lookupDeviceInfo(uint8_t addr);
+
+        //! @returns the number of device info lookups which were served from cache
+        uint32_t getDeviceInfoHits() const;
+
+        //! @returns the number of device info lookups which were not served from cache
+        uint32_t getDeviceInfoMisses() const;
+
+    private:
+        //! @param[in] addr  A peripheral address
+        //! @returns the index into mDeviceInfo for the given address or -1 if not a peripheral
+        static int32_t deviceInfoIndex(uint8_t addr);
+
+    private:
+        //! Number of cacheable device info entries (main peripheral + sub peripherals)
+        static const uint32_t NUM_DEVICE_INFO_ENTRIES = DreamcastPeripheral::MAX_SUB_PERIPHERALS + 1;
+        //! The latest condition response from the controller
+        std::shared_ptr<const MaplePacket> mCondition;
+        //! The time at which mCondition was received
+        uint64_t mConditionTimeUs;
+        //! The latest device info responses (main peripheral first, then sub peripherals)
+        std::shared_ptr<const MaplePacket> mDeviceInfo[NUM_DEVICE_INFO_ENTRIES];
+        //! Number of device info lookups served from cache
+        uint32_t mDeviceInfoHits;
+        //! Number of device info lookups not served from cache
+        uint32_t mDeviceInfoMisses;
+};
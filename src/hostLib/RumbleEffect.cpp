@@ -0,0 +1,237 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RumbleEffect.hpp"
+#include "DreamcastVibration.hpp"
+#include "dreamcast_constants.h"
+#include "global_constants.h"
+#include "utils.h"
+
+// Pulsation frequency in Hz is about half of (freqValue + 1), so a cycle lasts this many microseconds
+// multiplied by 1 / (freqValue + 1)
+#define CYCLE_NUMERATOR_US 2000000ULL
+
+RumbleEffectCompiler::RumbleEffectCompiler() :
+    mAutoStopValue(-1)
+{}
+
+void RumbleEffectCompiler::forgetAutoStop()
+{
+    mAutoStopValue = -1;
+}
+
+bool RumbleEffectCompiler::compile(const RumbleEnvelope* envelopes,
+                                   uint32_t numEnvelopes,
+                                   RumbleCommand* out,
+                                   uint32_t maxCommands,
+                                   uint32_t& numCommands)
+{
+    numCommands = 0;
+    Output output = {out, maxCommands, 0, mAutoStopValue, false, 0};
+    uint64_t offsetUs = 0;
+
+    for (uint32_t i = 0; i < numEnvelopes; ++i)
+    {
+        const RumbleEnvelope& envelope = envelopes[i];
+        uint64_t durationUs = static_cast<uint64_t>(envelope.durationMs) * MICROSECONDS_PER_MILLISECOND;
+
+        if (envelope.intensity == 0 || durationUs == 0)
+        {
+            // Silence
+            if (!stopBy(output, offsetUs))
+            {
+                return false;
+            }
+        }
+        else if (envelope.decay == 0)
+        {
+            // Following segments which hold the same intensity are played by the same command
+            while (i + 1 < numEnvelopes
+                   && envelopes[i + 1].decay == 0
+                   && envelopes[i + 1].intensity == envelope.intensity
+                   && envelopes[i + 1].frequency == envelope.frequency)
+            {
+                ++i;
+                durationUs += static_cast<uint64_t>(envelopes[i].durationMs) * MICROSECONDS_PER_MILLISECOND;
+            }
+
+            if (!compileConstant(output, offsetUs, envelope.intensity, envelope.frequency, durationUs))
+            {
+                return false;
+            }
+        }
+        else if (!compileRamp(output, offsetUs, envelope.intensity, envelope.decay, envelope.frequency, durationUs))
+        {
+            return false;
+        }
+
+        offsetUs += durationUs;
+    }
+
+    if (!stopBy(output, offsetUs))
+    {
+        return false;
+    }
+
+    // Only commit the auto-stop time once the whole effect is known to fit
+    mAutoStopValue = output.autoStopValue;
+    numCommands = output.numCommands;
+    return true;
+}
+
+bool RumbleEffectCompiler::addCommand(Output& output, uint64_t offsetUs, uint8_t command, uint32_t word)
+{
+    if (output.numCommands >= output.maxCommands)
+    {
+        return false;
+    }
+
+    RumbleCommand& rumbleCommand = output.commands[output.numCommands++];
+    rumbleCommand.offsetUs = static_cast<uint32_t>(offsetUs);
+    rumbleCommand.command = command;
+    rumbleCommand.word = word;
+    return true;
+}
+
+bool RumbleEffectCompiler::compileConstant(Output& output,
+                                           uint64_t offsetUs,
+                                           uint8_t power,
+                                           uint8_t frequency,
+                                           uint64_t durationUs)
+{
+    power = limit_value(power, DreamcastVibration::MIN_POWER, DreamcastVibration::MAX_POWER);
+    uint8_t freq = DreamcastVibration::MAX_FREQ_VALUE;
+    if (frequency != 0)
+    {
+        freq = limit_value(frequency, DreamcastVibration::MIN_FREQ_VALUE, DreamcastVibration::MAX_FREQ_VALUE);
+    }
+
+    const uint32_t condition = STOP_CONDITION | CONTINUOUS_FLAG | (power << 20) | (freq << 8);
+    const uint64_t maxChunkUs = static_cast<uint64_t>(MAX_AUTO_STOP + 1) * AUTO_STOP_STEP_US;
+
+    // The pack stops after at most 64 seconds, so anything longer is restarted in chunks
+    while (durationUs > 0)
+    {
+        uint64_t chunkUs = std::min(durationUs, maxChunkUs);
+        int16_t autoStopValue = INT_DIVIDE_CEILING(chunkUs, AUTO_STOP_STEP_US) - 1;
+
+        if (autoStopValue != output.autoStopValue)
+        {
+            if (!addCommand(output, offsetUs, COMMAND_BLOCK_WRITE, 0x00020000 | (autoStopValue << 8)))
+            {
+                return false;
+            }
+            output.autoStopValue = autoStopValue;
+        }
+
+        if (!addCommand(output, offsetUs, COMMAND_SET_CONDITION, condition))
+        {
+            return false;
+        }
+
+        output.running = true;
+        output.selfStopUs = offsetUs + (autoStopValue + 1) * static_cast<uint64_t>(AUTO_STOP_STEP_US);
+
+        offsetUs += chunkUs;
+        durationUs -= chunkUs;
+    }
+
+    return true;
+}
+
+bool RumbleEffectCompiler::compileRamp(Output& output,
+                                       uint64_t offsetUs,
+                                       uint8_t power,
+                                       int8_t decay,
+                                       uint8_t frequency,
+                                       uint64_t durationUs)
+{
+    power = limit_value(power, DreamcastVibration::MIN_POWER, DreamcastVibration::MAX_POWER);
+
+    // The pack always ramps all the way to min or max intensity, one increment per intensity
+    uint32_t fullIncrements = 0;
+    uint32_t segmentIncrements = 0;
+    uint32_t condition = STOP_CONDITION;
+    if (decay > 0)
+    {
+        fullIncrements = power - DreamcastVibration::MIN_POWER + 1;
+        segmentIncrements = std::min(static_cast<uint32_t>(decay), fullIncrements);
+        condition |= (power << 16) | 0x800000;
+    }
+    else
+    {
+        fullIncrements = DreamcastVibration::MAX_POWER - power + 1;
+        segmentIncrements = std::min(static_cast<uint32_t>(-decay), fullIncrements);
+        condition |= (power << 20) | 0x080000;
+    }
+
+    uint64_t incrementUs = durationUs / segmentIncrements;
+
+    // Select the smoothest frequency which can still stretch an increment across its duration
+    uint8_t freq = DreamcastVibration::MIN_FREQ_VALUE;
+    if (frequency != 0)
+    {
+        freq = limit_value(frequency, DreamcastVibration::MIN_FREQ_VALUE, DreamcastVibration::MAX_FREQ_VALUE);
+    }
+    else
+    {
+        for (uint32_t f = DreamcastVibration::MAX_FREQ_VALUE; f >= DreamcastVibration::MIN_FREQ_VALUE; --f)
+        {
+            if (incrementUs * (f + 1) <= (DreamcastVibration::MAX_CYCLES + 1) * CYCLE_NUMERATOR_US)
+            {
+                freq = f;
+                break;
+            }
+        }
+    }
+
+    // Cycles of 0 isn't valid while ramping
+    uint32_t cycles = limit_value<uint64_t>(
+        INT_DIVIDE_ROUND(incrementUs * (freq + 1), CYCLE_NUMERATOR_US),
+        2,
+        DreamcastVibration::MAX_CYCLES + 1) - 1;
+    uint64_t actualIncrementUs = (cycles + 1) * CYCLE_NUMERATOR_US / (freq + 1);
+
+    condition |= (freq << 8) | cycles;
+    if (!addCommand(output, offsetUs, COMMAND_SET_CONDITION, condition))
+    {
+        return false;
+    }
+
+    output.running = true;
+    output.selfStopUs = offsetUs + fullIncrements * actualIncrementUs;
+    return true;
+}
+
+bool RumbleEffectCompiler::stopBy(Output& output, uint64_t offsetUs)
+{
+    if (output.running)
+    {
+        output.running = false;
+        if (output.selfStopUs > offsetUs + STOP_TOLERANCE_US)
+        {
+            return addCommand(output, offsetUs, COMMAND_SET_CONDITION, STOP_CONDITION);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,140 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+//! A segment of a rumble effect
+struct RumbleEnvelope
+{
+    //! Intensity at the start of the segment [0,7] (0 for silence)
+    uint8_t intensity;
+    //! Pulsation frequency value [7,59]; 0 selects the smoothest frequency which fits the duration
+    uint8_t frequency;
+    //! Length of the segment in milliseconds
+    uint32_t durationMs;
+    //! Number of intensity steps lost by the end of the segment; negative to rise instead
+    int8_t decay;
+};
+
+//! A single vibration command compiled from an effect
+struct RumbleCommand
+{
+    //! Time from the start of the effect to send this command in microseconds
+    uint32_t offsetUs;
+    //! Maple command to send (COMMAND_SET_CONDITION or COMMAND_BLOCK_WRITE)
+    uint8_t command;
+    //! The condition word or, for a block write, the auto-stop word
+    uint32_t word;
+};
+
+//! Compiles rumble effects into the fewest vibration pack commands which play them.
+//! Constant segments become one continuous condition which the pack stops on its own using its
+//! auto-stop time, so only a change of auto-stop time costs an extra command. Ramping segments use
+//! the pack's inclination so that a whole fade is a single command. A stop is only sent when the
+//! pack would otherwise keep vibrating past the end of a segment which isn't followed by another.
+//! @note This is only to be accessed from the core which executes the nodes
+class RumbleEffectCompiler
+{
+    public:
+        //! Constructor
+        RumbleEffectCompiler();
+
+        //! Compiles segments which play back to back
+        //! @param[in] envelopes  The segments of the effect
+        //! @param[in] numEnvelopes  Number of segments
+        //! @param[out] out  The commands to send, in order of offset
+        //! @param[in] maxCommands  Maximum number of commands which may be written to out
+        //! @param[out] numCommands  The number of commands written
+        //! @returns false iff the effect needs more than maxCommands commands
+        bool compile(const RumbleEnvelope* envelopes,
+                     uint32_t numEnvelopes,
+                     RumbleCommand* out,
+                     uint32_t maxCommands,
+                     uint32_t& numCommands);
+
+        //! Called when the auto-stop time set in the pack is no longer known
+        void forgetAutoStop();
+
+    public:
+        //! Maximum number of commands a single effect may compile to
+        static const uint32_t MAX_COMMANDS = 16;
+        //! Duration of each auto-stop time step in microseconds
+        static const uint32_t AUTO_STOP_STEP_US = 250000;
+        //! Maximum auto-stop time value
+        static const uint8_t MAX_AUTO_STOP = 0xFF;
+        //! How far past the end of a segment the pack may keep vibrating before a stop is sent
+        static const uint32_t STOP_TOLERANCE_US = 20000;
+        //! Condition word which stops vibration
+        static const uint32_t STOP_CONDITION = 0x10000000;
+        //! Condition word flag which vibrates continuously until the auto-stop time elapses
+        static const uint32_t CONTINUOUS_FLAG = 0x01000000;
+
+    private:
+        //! Compilation state of a single effect
+        struct Output
+        {
+            //! Where commands are written
+            RumbleCommand* commands;
+            //! Capacity of commands
+            uint32_t maxCommands;
+            //! Number of commands written so far
+            uint32_t numCommands;
+            //! Auto-stop time the pack will have once commands are sent (negative when unknown)
+            int16_t autoStopValue;
+            //! True iff the pack is vibrating as of the current offset
+            bool running;
+            //! Offset at which the pack stops on its own
+            uint64_t selfStopUs;
+        };
+
+        //! Adds a command to the output
+        //! @returns false iff the output is full
+        static bool addCommand(Output& output, uint64_t offsetUs, uint8_t command, uint32_t word);
+
+        //! Compiles a segment of constant intensity
+        //! @returns false iff the output is full
+        static bool compileConstant(Output& output,
+                                    uint64_t offsetUs,
+                                    uint8_t power,
+                                    uint8_t frequency,
+                                    uint64_t durationUs);
+
+        //! Compiles a segment of changing intensity
+        //! @returns false iff the output is full
+        static bool compileRamp(Output& output,
+                                uint64_t offsetUs,
+                                uint8_t power,
+                                int8_t decay,
+                                uint8_t frequency,
+                                uint64_t durationUs);
+
+        //! Stops the pack at the given offset if it wouldn't stop on its own by then
+        //! @returns false iff the output is full
+        static bool stopBy(Output& output, uint64_t offsetUs);
+
+    private:
+        //! Auto-stop time currently set in the pack (negative when unknown)
+        int16_t mAutoStopValue;
+};
@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RumbleSlot.hpp"
+#include "DreamcastVibration.hpp"
+#include "global_constants.h"
+#include "utils.h"
+
+RumbleSlot::RumbleSlot(ClockInterface& clock) :
+    mClock(clock),
+    mBuffers{},
+    mWriteIdx(0),
+    mReadIdx(1),
+    mSharedIdx(2),
+    mLastLatencyUs(0),
+    mMaxLatencyUs(0),
+    mNumLate(0),
+    mNumReplaced(0)
+{}
+
+void RumbleSlot::vibrate(float frequency, float intensity, int8_t inclination, float duration)
+{
+    Request& request = mBuffers[mWriteIdx];
+
+    request.envelope.intensity = static_cast<uint8_t>(
+        limit_value(intensity, 0.0f, 1.0f) * DreamcastVibration::MAX_POWER + 0.5f);
+
+    // Pulsation frequency in Hz is about half of (freqValue + 1)
+    request.envelope.frequency = 0;
+    if (frequency > 0)
+    {
+        request.envelope.frequency = static_cast<uint8_t>(limit_value(
+            frequency * 2.0f - 1.0f + 0.5f,
+            static_cast<float>(DreamcastVibration::MIN_FREQ_VALUE),
+            static_cast<float>(DreamcastVibration::MAX_FREQ_VALUE)));
+    }
+
+    // Ramps always run all the way to min or max intensity
+    request.envelope.decay = 0;
+    if (inclination < 0)
+    {
+        request.envelope.decay = DreamcastVibration::MAX_POWER;
+    }
+    else if (inclination > 0)
+    {
+        request.envelope.decay = -DreamcastVibration::MAX_POWER;
+    }
+
+    request.envelope.durationMs = INDEFINITE_DURATION_MS;
+    if (duration > 0)
+    {
+        request.envelope.durationMs = static_cast<uint32_t>(
+            limit_value(duration, 0.0f, INDEFINITE_DURATION_MS / 1000.0f) * MILLISECONDS_PER_SECOND + 0.5f);
+    }
+
+    request.receivedTimeUs = mClock.getTimeUs();
+
+    // The exchange releases the request to the reader along with its index
+    uint8_t previous = mSharedIdx.exchange(mWriteIdx | NEW_DATA_FLAG, std::memory_order_acq_rel);
+    mWriteIdx = previous & BUFFER_IDX_MASK;
+    if ((previous & NEW_DATA_FLAG) != 0)
+    {
+        mNumReplaced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool RumbleSlot::take(RumbleEnvelope& envelope, uint64_t& receivedTimeUs)
+{
+    if ((mSharedIdx.load(std::memory_order_acquire) & NEW_DATA_FLAG) == 0)
+    {
+        return false;
+    }
+
+    uint8_t previous = mSharedIdx.exchange(mReadIdx, std::memory_order_acq_rel);
+    mReadIdx = previous & BUFFER_IDX_MASK;
+
+    const Request& request = mBuffers[mReadIdx];
+    envelope = request.envelope;
+    receivedTimeUs = request.receivedTimeUs;
+
+    // Don't play the part of the request which already elapsed while it waited
+    uint64_t waitedMs = (mClock.getTimeUs() - receivedTimeUs) / MICROSECONDS_PER_MILLISECOND;
+    if (waitedMs >= envelope.durationMs)
+    {
+        envelope.intensity = 0;
+        envelope.durationMs = 0;
+    }
+    else
+    {
+        envelope.durationMs -= waitedMs;
+    }
+
+    return true;
+}
+
+void RumbleSlot::recordSent(uint64_t receivedTimeUs)
+{
+    uint64_t latencyUs = mClock.getTimeUs() - receivedTimeUs;
+    uint32_t latency = static_cast<uint32_t>(std::min(latencyUs, static_cast<uint64_t>(UINT32_MAX)));
+
+    mLastLatencyUs.store(latency, std::memory_order_relaxed);
+    if (latency > mMaxLatencyUs.load(std::memory_order_relaxed))
+    {
+        mMaxLatencyUs.store(latency, std::memory_order_relaxed);
+    }
+    if (latency > MAX_LATENCY_US)
+    {
+        mNumLate.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t RumbleSlot::getLastLatencyUs() const
+{
+    return mLastLatencyUs.load(std::memory_order_relaxed);
+}
+
+uint32_t RumbleSlot::getMaxLatencyUs() const
+{
+    return mMaxLatencyUs.load(std::memory_order_relaxed);
+}
+
+uint32_t RumbleSlot::getNumLate() const
+{
+    return mNumLate.load(std::memory_order_relaxed);
+}
+
+uint32_t RumbleSlot::getNumReplaced() const
+{
+    return mNumReplaced.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "VibrationObserver.hpp"
+#include "RumbleEffect.hpp"
+#include "hal/System/ClockInterface.hpp"
+
+#include <atomic>
+#include <stdint.h>
+
+//! Passes the latest vibration requested by the USB host to the vibration peripheral of a player.
+//! A request which hasn't been taken yet is replaced by a newer one, so a burst of reports never
+//! queues up behind the bus. The request is passed through three buffers in the same way as
+//! ScreenData, and each one is stamped on arrival so the time until its first command goes out can
+//! be measured.
+class RumbleSlot : public VibrationObserver
+{
+    public:
+        //! Constructor
+        //! @param[in] clock  Clock used to stamp and measure requests (must be readable from both cores)
+        RumbleSlot(ClockInterface& clock);
+
+        //! Inherited from VibrationObserver (must only be called by the single writer)
+        void vibrate(float frequency, float intensity, int8_t inclination, float duration) final;
+
+        //! Takes the latest request if it hasn't been taken yet (must only be called by the single
+        //! reader)
+        //! @param[out] envelope  The request with its duration shortened by the time it waited
+        //! @param[out] receivedTimeUs  The time the request was received
+        //! @returns true iff a request was taken
+        bool take(RumbleEnvelope& envelope, uint64_t& receivedTimeUs);
+
+        //! Records that the first command of a request was sent (must only be called by the single
+        //! reader)
+        //! @param[in] receivedTimeUs  The time the request was received
+        void recordSent(uint64_t receivedTimeUs);
+
+        //! @returns the time between receiving the last sent request and sending its first command
+        uint32_t getLastLatencyUs() const;
+
+        //! @returns the longest time between receiving a request and sending its first command
+        uint32_t getMaxLatencyUs() const;
+
+        //! @returns the number of requests which took longer than MAX_LATENCY_US to be sent
+        uint32_t getNumLate() const;
+
+        //! @returns the number of requests replaced by a newer one before they were taken
+        uint32_t getNumReplaced() const;
+
+    public:
+        //! Latency which a request is expected to be sent within
+        static const uint32_t MAX_LATENCY_US = 10000;
+        //! Duration used when the host doesn't specify one; the pack still stops on its own after
+        //! this long in case the host never follows up
+        static const uint32_t INDEFINITE_DURATION_MS = 64000;
+
+    private:
+        //! A request along with the time it was received
+        struct Request
+        {
+            RumbleEnvelope envelope;
+            uint64_t receivedTimeUs;
+        };
+
+        //! Clock used to stamp and measure requests
+        ClockInterface& mClock;
+        //! Number of buffers requests are passed through
+        static const uint8_t NUM_BUFFERS = 3;
+        //! Flag set in mSharedIdx when the shared buffer holds a request the reader hasn't taken yet
+        static const uint8_t NEW_DATA_FLAG = 0x80;
+        //! Mask of the buffer index within mSharedIdx
+        static const uint8_t BUFFER_IDX_MASK = 0x7F;
+        //! The buffers requests are passed through
+        Request mBuffers[NUM_BUFFERS];
+        //! Index of the buffer owned by the writer
+        uint8_t mWriteIdx;
+        //! Index of the buffer owned by the reader
+        uint8_t mReadIdx;
+        //! Index of the shared buffer along with NEW_DATA_FLAG
+        std::atomic<uint8_t> mSharedIdx;
+        //! Time between receiving the last sent request and sending its first command
+        std::atomic<uint32_t> mLastLatencyUs;
+        //! Longest time between receiving a request and sending its first command
+        std::atomic<uint32_t> mMaxLatencyUs;
+        //! Number of requests which took longer than MAX_LATENCY_US to be sent
+        std::atomic<uint32_t> mNumLate;
+        //! Number of requests replaced before they were taken
+        std::atomic<uint32_t> mNumReplaced;
+};
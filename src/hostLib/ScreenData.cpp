@@ -24,8 +24,6 @@
 #include "ScreenData.hpp"
 #include <cstring>
 #include <assert.h>
-#include "hal/System/LockGuard.hpp"
-#include "utils.h"
 
 // Default screen is a little VMU icon
 const uint32_t ScreenData::DEFAULT_SCREEN_DATA[ScreenData::NUM_SCREEN_WORDS] = {
@@ -37,51 +35,78 @@ const uint32_t ScreenData::DEFAULT_SCREEN_DATA[ScreenData::NUM_SCREEN_WORDS] = {
     0x10000008, 0x7FFE1000, 0x000C0000, 0x30000006, 0x00006000, 0x00038001, 0xC0000000, 0xFFFF0000
 };
 
-ScreenData::ScreenData(MutexInterface& mutex) :
-    mMutex(mutex),
-    mNewDataAvailable(false)
+ScreenData::ScreenData() :
+    mScreenData{},
+    mBuffers{},
+    mWriteIdx(0),
+    mReadIdx(1),
+    mSharedIdx(2),
+    mLastWritten{},
+    mLastWrittenValid(false),
+    mWritesSaved(0)
 {
     resetToDefault();
 }
 
-void ScreenData::setData(uint32_t* data, uint32_t startIndex, uint32_t numWords)
+void ScreenData::setData(const uint32_t* data, uint32_t startIndex, uint32_t numWords)
 {
-    assert(startIndex + numWords <= sizeof(mScreenData));
-    LockGuard lockGuard(mMutex);
-    if (lockGuard.isLocked())
-    {
-        std::memcpy(mScreenData + startIndex, data, numWords);
-        mNewDataAvailable = true;
-    }
-    else
-    {
-        DEBUG_PRINT("FAULT: failed to set screen data\n");
-    }
+    assert(startIndex + numWords <= NUM_SCREEN_WORDS);
+    std::memcpy(mScreenData + startIndex, data, numWords * sizeof(mScreenData[0]));
+    publish();
 }
 
 void ScreenData::resetToDefault()
 {
     std::memcpy(mScreenData, DEFAULT_SCREEN_DATA, sizeof(mScreenData));
     // Always force an update
-    mNewDataAvailable = true;
+    publish();
+}
+
+void ScreenData::publish()
+{
+    std::memcpy(mBuffers[mWriteIdx], mScreenData, sizeof(mScreenData));
+    // The exchange releases the buffer contents to the reader along with its index
+    uint8_t previous = mSharedIdx.exchange(mWriteIdx | NEW_DATA_FLAG, std::memory_order_acq_rel);
+    mWriteIdx = previous & BUFFER_IDX_MASK;
 }
 
 bool ScreenData::isNewDataAvailable() const
 {
-    return mNewDataAvailable;
+    return ((mSharedIdx.load(std::memory_order_acquire) & NEW_DATA_FLAG) != 0);
 }
 
 void ScreenData::readData(uint32_t* out)
 {
-    LockGuard lockGuard(mMutex);
-    if (lockGuard.isLocked())
+    if (isNewDataAvailable())
     {
-        mNewDataAvailable = false;
+        uint8_t previous = mSharedIdx.exchange(mReadIdx, std::memory_order_acq_rel);
+        mReadIdx = previous & BUFFER_IDX_MASK;
     }
-    else
+    std::memcpy(out, mBuffers[mReadIdx], sizeof(mBuffers[mReadIdx]));
+}
+
+bool ScreenData::isRedundantWrite(const uint32_t* frame)
+{
+    if (mLastWrittenValid && std::memcmp(frame, mLastWritten, sizeof(mLastWritten)) == 0)
     {
-        DEBUG_PRINT("FAULT: failed to properly read screen data\n");
+        mWritesSaved.fetch_add(1, std::memory_order_relaxed);
+        return true;
     }
-    // Allow this to happen, even if locking failed
-    std::memcpy(out, mScreenData, sizeof(mScreenData));
+    return false;
+}
+
+void ScreenData::setLastWritten(const uint32_t* frame)
+{
+    std::memcpy(mLastWritten, frame, sizeof(mLastWritten));
+    mLastWrittenValid = true;
+}
+
+void ScreenData::clearLastWritten()
+{
+    mLastWrittenValid = false;
+}
+
+uint32_t ScreenData::getWritesSaved() const
+{
+    return mWritesSaved.load(std::memory_order_relaxed);
 }
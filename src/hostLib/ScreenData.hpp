@@ -23,45 +23,85 @@
 
 #pragma once
 
-#include "hal/System/MutexInterface.hpp"
+#include <atomic>
 #include <stdint.h>
 
 //! Contains monochrome screen data
 //! A screen is 48 bits wide and 32 bits tall
+//! The latest screen is passed from one writer to one reader through three buffers: the writer fills
+//! its own buffer then swaps it with the shared one, and the reader swaps the shared one for its own
+//! when new data is flagged. No locks are taken, so updates never mask interrupts on either core.
 class ScreenData
 {
     public:
         //! Constructor
-        //! @param[in] mutex  Reference to the mutex to use (critical section mutex recommended)
-        ScreenData(MutexInterface& mutex);
+        ScreenData();
 
-        //! Set the screen bits
+        //! Set the screen bits (must only be called by the single writer)
         //! @param[in] data  Screen words to set
         //! @param[in] startIndex  Starting screen word index (left to right, top to bottom)
         //! @param[in] numWords  Number of words to write
-        void setData(uint32_t* data, uint32_t startIndex=0, uint32_t numWords=NUM_SCREEN_WORDS);
+        void setData(const uint32_t* data, uint32_t startIndex=0, uint32_t numWords=NUM_SCREEN_WORDS);
 
-        //! Resets the screen to its initialized default
+        //! Resets the screen to its initialized default (must only be called by the single writer)
         void resetToDefault();
 
         //! @returns true if new data is available since last call to readData
         bool isNewDataAvailable() const;
 
-        //! Copies screen data to the given array
+        //! Copies the latest screen data to the given array (must only be called by the single reader)
         //! @param[out] out  The array to write to (must be at least 48 words in length)
         void readData(uint32_t* out);
 
+        //! Checks a screen about to be written against the last one the screen acknowledged, counting
+        //! a saved write when they match (must only be called by the single reader)
+        //! @param[in] frame  The screen about to be written (48 words)
+        //! @returns true iff the frame matches the last written screen and need not be sent
+        bool isRedundantWrite(const uint32_t* frame);
+
+        //! Records the screen which was acknowledged by the peripheral (must only be called by the
+        //! single reader)
+        //! @param[in] frame  The written screen (48 words)
+        void setLastWritten(const uint32_t* frame);
+
+        //! Forgets the last written screen so that the next screen is always sent (must only be called
+        //! by the single reader)
+        void clearLastWritten();
+
+        //! @returns the number of screen writes skipped because the content was already displayed
+        uint32_t getWritesSaved() const;
+
     public:
         //! Number of words in a screen
         static const uint32_t NUM_SCREEN_WORDS = 48;
 
+    private:
+        //! Copies the writer's screen into its buffer and hands that buffer to the reader
+        void publish();
+
     private:
         //! The default screen data on initialization and resetToDefault()
         static const uint32_t DEFAULT_SCREEN_DATA[NUM_SCREEN_WORDS];
-        //! Mutex used to ensure integrity of data between multiple cores
-        MutexInterface& mMutex;
-        //! The current screen data
+        //! Number of buffers the screen is passed through
+        static const uint8_t NUM_BUFFERS = 3;
+        //! Flag set in mSharedIdx when the shared buffer holds data the reader hasn't taken yet
+        static const uint8_t NEW_DATA_FLAG = 0x80;
+        //! Mask of the buffer index within mSharedIdx
+        static const uint8_t BUFFER_IDX_MASK = 0x7F;
+        //! The full screen as set by the writer, which partial writes are applied to
         uint32_t mScreenData[NUM_SCREEN_WORDS];
-        //! Flag set to true in setData and set to false in readData
-        bool mNewDataAvailable;
+        //! The buffers the screen is passed through
+        uint32_t mBuffers[NUM_BUFFERS][NUM_SCREEN_WORDS];
+        //! Index of the buffer owned by the writer
+        uint8_t mWriteIdx;
+        //! Index of the buffer owned by the reader
+        uint8_t mReadIdx;
+        //! Index of the shared buffer along with NEW_DATA_FLAG
+        std::atomic<uint8_t> mSharedIdx;
+        //! The last screen acknowledged by the peripheral (owned by the reader)
+        uint32_t mLastWritten[NUM_SCREEN_WORDS];
+        //! True iff mLastWritten holds what is currently displayed
+        bool mLastWrittenValid;
+        //! Number of writes skipped because the screen already displayed the data
+        std::atomic<uint32_t> mWritesSaved;
 };
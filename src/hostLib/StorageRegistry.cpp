@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "StorageRegistry.hpp"
+#include "DreamcastStorage.hpp"
+#include "Transmission.hpp"
+#include "dreamcast_constants.h"
+
+StorageRegistry::StorageRegistry() :
+    mStorage()
+{}
+
+void StorageRegistry::add(int32_t idx, DreamcastStorage* storage)
+{
+    if (idx >= 0 && static_cast<uint32_t>(idx) < MAX_STORAGE)
+    {
+        mStorage[idx] = storage;
+    }
+}
+
+void StorageRegistry::remove(DreamcastStorage* storage)
+{
+    for (uint32_t i = 0; i < MAX_STORAGE; ++i)
+    {
+        if (mStorage[i] == storage)
+        {
+            mStorage[i] = nullptr;
+        }
+    }
+}
+
+DreamcastStorage* StorageRegistry::get(int32_t idx) const
+{
+    if (idx < 0 || static_cast<uint32_t>(idx) >= MAX_STORAGE)
+    {
+        return nullptr;
+    }
+    return mStorage[idx];
+}
+
+void StorageRegistry::txFinished(const Transmission& tx) const
+{
+    const MaplePacket& packet = *tx.packet;
+    if (packet.frame.command != COMMAND_BLOCK_WRITE && packet.frame.command != COMMAND_GET_LAST_ERROR)
+    {
+        return;
+    }
+
+    DreamcastStorage* storage =
+        get(DreamcastPeripheral::subPeripheralIndex(packet.frame.recipientAddr));
+    if (storage != nullptr)
+    {
+        storage->externalWriteObserved(tx);
+    }
+}
@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+class DreamcastStorage;
+struct Transmission;
+
+//! Tracks the storage peripherals currently attached to a single player so that commands may
+//! address them by sub-peripheral index
+//! @note This is only to be accessed from the core which executes the nodes and the TTY parser
+class StorageRegistry
+{
+    public:
+        //! Constructor
+        StorageRegistry();
+
+        //! Registers a storage peripheral (called when the peripheral is created)
+        //! @param[in] idx  Sub-peripheral index of the storage [0,MAX_STORAGE)
+        //! @param[in] storage  The storage peripheral
+        void add(int32_t idx, DreamcastStorage* storage);
+
+        //! Unregisters a storage peripheral (called when the peripheral is destroyed)
+        //! @param[in] storage  The storage peripheral
+        void remove(DreamcastStorage* storage);
+
+        //! @param[in] idx  Sub-peripheral index of the storage
+        //! @returns the storage peripheral at the given index or nullptr if none is attached
+        DreamcastStorage* get(int32_t idx) const;
+
+        //! Lets the storage peripheral addressed by a finished or failed transmission drop what it
+        //! knows about a block which the transmission wrote (called for every transmission of the
+        //! player's bus)
+        //! @param[in] tx  The transmission
+        void txFinished(const Transmission& tx) const;
+
+    public:
+        //! Maximum number of storage peripherals per player (one per sub-peripheral)
+        static const uint32_t MAX_STORAGE = 5;
+
+    private:
+        //! Storage peripherals indexed by sub-peripheral index
+        DreamcastStorage* mStorage[MAX_STORAGE];
+};
@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuBlockCache.hpp"
+
+#include <string.h>
+
+static_assert(VmuBlockCache::NUM_ENTRIES > VmuBlockCache::NUM_PINNED_BLOCKS,
+              "Evictable entries are required so that pinned blocks always fit");
+static_assert(VmuBlockCache::NUM_ENTRIES <= 127, "Entry indices must fit in int8_t");
+
+VmuBlockCache::VmuBlockCache() :
+    mEntries(),
+    mIndex(),
+    mUseCounter(0),
+    mHits(0),
+    mMisses(0)
+{
+    invalidateAll();
+}
+
+bool VmuBlockCache::isPinned(uint8_t blockNum)
+{
+    return (blockNum == SYSTEM_BLOCK || blockNum == FAT_BLOCK);
+}
+
+bool VmuBlockCache::isFileSystemBlock(uint8_t blockNum)
+{
+    return (
+        isPinned(blockNum)
+        || (blockNum <= DIRECTORY_FIRST_BLOCK
+            && blockNum > (DIRECTORY_FIRST_BLOCK - NUM_DIRECTORY_BLOCKS))
+    );
+}
+
+uint32_t VmuBlockCache::hash(const void* data)
+{
+    const uint8_t* data8 = static_cast<const uint8_t*>(data);
+    uint32_t value = 0x811C9DC5;
+    for (const uint8_t* end = data8 + BLOCK_SIZE; data8 < end; ++data8)
+    {
+        value = (value ^ *data8) * 0x01000193;
+    }
+    return value;
+}
+
+bool VmuBlockCache::lookup(uint8_t blockNum, void* buffer, uint16_t bufferLen)
+{
+    int8_t idx = mIndex[blockNum];
+    if (idx == NOT_CACHED)
+    {
+        ++mMisses;
+        return false;
+    }
+
+    Entry& entry = mEntries[idx];
+    touch(entry);
+    memcpy(buffer, entry.data, (bufferLen > BLOCK_SIZE) ? BLOCK_SIZE : bufferLen);
+    ++mHits;
+    return true;
+}
+
+const uint8_t* VmuBlockCache::peek(uint8_t blockNum) const
+{
+    int8_t idx = mIndex[blockNum];
+    return (idx == NOT_CACHED) ? nullptr : mEntries[idx].data;
+}
+
+void VmuBlockCache::store(uint8_t blockNum, const void* data)
+{
+    int8_t idx = mIndex[blockNum];
+    if (idx == NOT_CACHED)
+    {
+        idx = selectVictim();
+        Entry& victim = mEntries[idx];
+        if (victim.valid)
+        {
+            mIndex[victim.blockNum] = NOT_CACHED;
+        }
+        victim.valid = true;
+        victim.blockNum = blockNum;
+        mIndex[blockNum] = idx;
+    }
+
+    Entry& entry = mEntries[idx];
+    memcpy(entry.data, data, BLOCK_SIZE);
+    touch(entry);
+}
+
+void VmuBlockCache::invalidate(uint8_t blockNum)
+{
+    int8_t idx = mIndex[blockNum];
+    if (idx != NOT_CACHED)
+    {
+        mEntries[idx].valid = false;
+        mIndex[blockNum] = NOT_CACHED;
+    }
+}
+
+void VmuBlockCache::invalidateAll()
+{
+    for (uint32_t i = 0; i < NUM_ENTRIES; ++i)
+    {
+        mEntries[i].valid = false;
+    }
+    for (uint32_t i = 0; i < (sizeof(mIndex) / sizeof(mIndex[0])); ++i)
+    {
+        mIndex[i] = NOT_CACHED;
+    }
+}
+
+uint32_t VmuBlockCache::getHits() const
+{
+    return mHits;
+}
+
+uint32_t VmuBlockCache::getMisses() const
+{
+    return mMisses;
+}
+
+void VmuBlockCache::touch(Entry& entry)
+{
+    entry.lastUse = ++mUseCounter;
+}
+
+int8_t VmuBlockCache::selectVictim() const
+{
+    int8_t victim = NOT_CACHED;
+    for (uint32_t i = 0; i < NUM_ENTRIES; ++i)
+    {
+        const Entry& entry = mEntries[i];
+        if (!entry.valid)
+        {
+            // Empty entries are always used first
+            return i;
+        }
+        else if (!isPinned(entry.blockNum)
+                 && (victim == NOT_CACHED || entry.lastUse < mEntries[victim].lastUse))
+        {
+            victim = i;
+        }
+    }
+    // The static_assert above guarantees at least one unpinned entry when all are valid
+    return victim;
+}
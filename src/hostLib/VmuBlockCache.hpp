@@ -0,0 +1,133 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+//! A fixed-size LRU cache of 512-byte VMU blocks for a single storage device. The system and FAT
+//! blocks of a standard VMU are pinned since hosts re-read them on nearly every access; directory
+//! and data blocks share the remaining entries.
+//! RAM budget: NUM_ENTRIES * (BLOCK_SIZE + 8) + 256 bytes, about 3.4 KB per storage device or
+//! 27 KB with all 8 VMUs attached.
+//! @note This is only to be accessed from the core which executes UsbFile read() and write()
+class VmuBlockCache
+{
+    public:
+        //! Constructor
+        VmuBlockCache();
+
+        //! @param[in] blockNum  A block number
+        //! @returns true iff the given block is never evicted once cached
+        static bool isPinned(uint8_t blockNum);
+
+        //! @param[in] blockNum  A block number
+        //! @returns true iff the given block is the system, FAT or a directory block
+        static bool isFileSystemBlock(uint8_t blockNum);
+
+        //! @param[in] data  BLOCK_SIZE bytes of block data
+        //! @returns the 32-bit FNV-1a hash of the given block
+        static uint32_t hash(const void* data);
+
+        //! Looks up a block, counting the lookup as a hit or miss
+        //! @param[in] blockNum  The block number to look up
+        //! @param[out] buffer  Set to the cached block data on hit
+        //! @param[in] bufferLen  The length of buffer (only up to BLOCK_SIZE bytes will be written)
+        //! @returns true iff the block was cached and copied into buffer
+        bool lookup(uint8_t blockNum, void* buffer, uint16_t bufferLen);
+
+        //! @param[in] blockNum  The block number to look up
+        //! @returns the cached block data (BLOCK_SIZE bytes) or nullptr if not cached; hit and miss
+        //!          counters are not modified
+        const uint8_t* peek(uint8_t blockNum) const;
+
+        //! Adds or replaces a block, evicting the least recently used unpinned block when full
+        //! @param[in] blockNum  The block number to store
+        //! @param[in] data  BLOCK_SIZE bytes of block data
+        void store(uint8_t blockNum, const void* data);
+
+        //! Removes a block from the cache
+        //! @param[in] blockNum  The block number to remove
+        void invalidate(uint8_t blockNum);
+
+        //! Removes all blocks from the cache
+        void invalidateAll();
+
+        //! @returns the number of lookups which were served from cache
+        uint32_t getHits() const;
+
+        //! @returns the number of lookups which were not served from cache
+        uint32_t getMisses() const;
+
+    public:
+        //! Number of bytes in each block
+        static const uint32_t BLOCK_SIZE = 512;
+        //! Block number of the system (root) block
+        static const uint8_t SYSTEM_BLOCK = 255;
+        //! Block number of the FAT block
+        static const uint8_t FAT_BLOCK = 254;
+        //! Block number of the first (highest) directory block
+        static const uint8_t DIRECTORY_FIRST_BLOCK = 253;
+        //! Number of directory blocks, counting down from DIRECTORY_FIRST_BLOCK
+        static const uint8_t NUM_DIRECTORY_BLOCKS = 13;
+        //! Number of pinned blocks (system and FAT)
+        static const uint32_t NUM_PINNED_BLOCKS = 2;
+        //! Total number of cache entries (pinned blocks plus a few evictable directory and data
+        //! blocks)
+        static const uint32_t NUM_ENTRIES = NUM_PINNED_BLOCKS + 4;
+
+    private:
+        //! A single cached block
+        struct Entry
+        {
+            //! True iff this entry holds a block
+            bool valid;
+            //! The block number held
+            uint8_t blockNum;
+            //! Value of mUseCounter when this entry was last accessed
+            uint32_t lastUse;
+            //! Block data
+            uint8_t data[BLOCK_SIZE];
+        };
+
+        //! Marks an entry as most recently used
+        //! @param[in] entry  The entry to touch
+        void touch(Entry& entry);
+
+        //! @returns the index of an empty entry or of the least recently used unpinned entry
+        int8_t selectVictim() const;
+
+    private:
+        //! The value written to mIndex for blocks which are not cached
+        static const int8_t NOT_CACHED = -1;
+        //! Cache entries
+        Entry mEntries[NUM_ENTRIES];
+        //! Maps block number to index into mEntries (or NOT_CACHED)
+        int8_t mIndex[256];
+        //! Incremented on each access in order to track recency
+        uint32_t mUseCounter;
+        //! Number of lookups served from cache
+        uint32_t mHits;
+        //! Number of lookups not served from cache
+        uint32_t mMisses;
+};
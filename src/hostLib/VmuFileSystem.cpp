@@ -0,0 +1,196 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuFileSystem.hpp"
+
+#include <string.h>
+
+VmuFileSystem::VmuFileSystem() :
+    mStep(LOAD_SYSTEM),
+    mFatBlock(0),
+    mDirectoryBlock(0),
+    mNumDirectoryBlocks(0),
+    mDirectoryIdx(0),
+    mFat(),
+    mBlock(),
+    mFiles(),
+    mNumFiles(0)
+{}
+
+void VmuFileSystem::invalidate()
+{
+    mStep = LOAD_SYSTEM;
+    mNumFiles = 0;
+}
+
+int32_t VmuFileSystem::loadAsync(UsbFile& storage, uint32_t timeoutUs)
+{
+    while (mStep != LOAD_DONE)
+    {
+        uint8_t blockNum = 0;
+        switch (mStep)
+        {
+            case LOAD_SYSTEM: blockNum = VmuBlockCache::SYSTEM_BLOCK; break;
+            case LOAD_FAT: blockNum = mFatBlock; break;
+            default: blockNum = mDirectoryBlock - mDirectoryIdx; break;
+        }
+
+        int32_t numRead = storage.readAsync(blockNum, mBlock, sizeof(mBlock), timeoutUs);
+        if (numRead == 0)
+        {
+            return 0;
+        }
+        else if (numRead != sizeof(mBlock))
+        {
+            invalidate();
+            return -1;
+        }
+
+        switch (mStep)
+        {
+            case LOAD_SYSTEM:
+            {
+                if (!parseSystemBlock())
+                {
+                    invalidate();
+                    return -1;
+                }
+                mNumFiles = 0;
+                mDirectoryIdx = 0;
+                mStep = LOAD_FAT;
+            }
+            break;
+
+            case LOAD_FAT:
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    mFat[i] = getU16(&mBlock[i * 2]);
+                }
+                mStep = LOAD_DIRECTORY;
+            }
+            break;
+
+            default:
+            {
+                parseDirectoryBlock();
+                if (++mDirectoryIdx >= mNumDirectoryBlocks)
+                {
+                    mStep = LOAD_DONE;
+                }
+            }
+            break;
+        }
+    }
+
+    return 1;
+}
+
+bool VmuFileSystem::isLoaded() const
+{
+    return (mStep == LOAD_DONE);
+}
+
+uint32_t VmuFileSystem::getNumFiles() const
+{
+    return isLoaded() ? mNumFiles : 0;
+}
+
+const char* VmuFileSystem::getFileName(uint32_t idx) const
+{
+    return (idx < getNumFiles()) ? mFiles[idx].name : nullptr;
+}
+
+uint16_t VmuFileSystem::getFileNumBlocks(uint32_t idx) const
+{
+    return (idx < getNumFiles()) ? mFiles[idx].numBlocks : 0;
+}
+
+int32_t VmuFileSystem::getBlock(uint32_t idx, uint16_t blockIdx) const
+{
+    if (idx >= getNumFiles() || blockIdx >= mFiles[idx].numBlocks)
+    {
+        return -1;
+    }
+
+    uint16_t block = mFiles[idx].firstBlock;
+    for (uint16_t i = 0; i < blockIdx; ++i)
+    {
+        block = mFat[block];
+        if (block > 0xFF)
+        {
+            // End of chain, free or corrupted
+            return -1;
+        }
+    }
+
+    return block;
+}
+
+bool VmuFileSystem::parseSystemBlock()
+{
+    for (uint32_t i = 0; i < FORMAT_LEN; ++i)
+    {
+        if (mBlock[i] != FORMAT_BYTE)
+        {
+            return false;
+        }
+    }
+
+    mFatBlock = getU16(&mBlock[SYSTEM_FAT_LOCATION_OFFSET]);
+    mDirectoryBlock = getU16(&mBlock[SYSTEM_DIRECTORY_LOCATION_OFFSET]);
+    mNumDirectoryBlocks = getU16(&mBlock[SYSTEM_DIRECTORY_SIZE_OFFSET]);
+
+    return (
+        mFatBlock <= 0xFF
+        && mDirectoryBlock <= 0xFF
+        && mNumDirectoryBlocks > 0
+        && mNumDirectoryBlocks <= (mDirectoryBlock + 1)
+    );
+}
+
+void VmuFileSystem::parseDirectoryBlock()
+{
+    for (uint32_t offset = 0;
+         offset < sizeof(mBlock) && mNumFiles < MAX_FILES;
+         offset += DIRECTORY_ENTRY_SIZE)
+    {
+        const uint8_t* entry = &mBlock[offset];
+        uint16_t firstBlock = getU16(&entry[ENTRY_FIRST_BLOCK_OFFSET]);
+        uint16_t numBlocks = getU16(&entry[ENTRY_SIZE_OFFSET]);
+        // The first byte is the file type (0x33: data, 0xCC: game, 0x00: no file)
+        if (entry[0] != 0x00 && firstBlock <= 0xFF && numBlocks > 0 && numBlocks <= 256)
+        {
+            File& file = mFiles[mNumFiles++];
+            memcpy(file.name, &entry[ENTRY_NAME_OFFSET], FILE_NAME_LEN);
+            file.name[FILE_NAME_LEN] = '\0';
+            file.firstBlock = firstBlock;
+            file.numBlocks = numBlocks;
+        }
+    }
+}
+
+uint16_t VmuFileSystem::getU16(const uint8_t* data)
+{
+    return (static_cast<uint16_t>(data[1]) << 8) | data[0];
+}
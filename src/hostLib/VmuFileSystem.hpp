@@ -0,0 +1,154 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "hal/Usb/UsbFile.hpp"
+#include "VmuBlockCache.hpp"
+
+#include <stdint.h>
+
+//! Parses the system, FAT and directory blocks of a VMU so that each save may be accessed on its
+//! own. Blocks are loaded without blocking through UsbFile::readAsync().
+//! @note This is only to be accessed from the core which executes UsbFile read() and write()
+class VmuFileSystem
+{
+    public:
+        //! Constructor
+        VmuFileSystem();
+
+        //! Forgets the loaded file list so that the next loadAsync() reads it again
+        void invalidate();
+
+        //! Loads the file list, continuing where the previous call left off
+        //! @param[in] storage  The VMU to read from
+        //! @param[in] timeoutUs  Timeout in microseconds for each block read
+        //! @returns Positive value once the file list is loaded
+        //! @returns Zero while the load is in progress
+        //! @returns Negative value if the VMU isn't formatted or a read failed (the next call starts
+        //!          over)
+        int32_t loadAsync(UsbFile& storage, uint32_t timeoutUs);
+
+        //! @returns true iff the file list is loaded
+        bool isLoaded() const;
+
+        //! @returns the number of files loaded (up to MAX_FILES)
+        uint32_t getNumFiles() const;
+
+        //! @param[in] idx  File index
+        //! @returns the null terminated file name (up to FILE_NAME_LEN characters) or nullptr if
+        //!          idx is invalid
+        const char* getFileName(uint32_t idx) const;
+
+        //! @param[in] idx  File index
+        //! @returns the number of blocks in the file or 0 if idx is invalid
+        uint16_t getFileNumBlocks(uint32_t idx) const;
+
+        //! Follows the FAT chain of a file
+        //! @param[in] idx  File index
+        //! @param[in] blockIdx  The index of the block within the file
+        //! @returns the VMU block number or -1 if the chain doesn't reach blockIdx
+        int32_t getBlock(uint32_t idx, uint16_t blockIdx) const;
+
+    public:
+        //! Maximum number of files tracked (keeps RAM usage small; the rest are ignored)
+        static const uint32_t MAX_FILES = 16;
+        //! Maximum number of characters in a file name
+        static const uint32_t FILE_NAME_LEN = 12;
+        //! FAT value of an unallocated block
+        static const uint16_t FAT_FREE = 0xFFFC;
+        //! FAT value of the last block in a chain
+        static const uint16_t FAT_END = 0xFFFA;
+
+    private:
+        //! A single file listed in the directory
+        struct File
+        {
+            //! Null terminated file name
+            char name[FILE_NAME_LEN + 1];
+            //! The first block of the FAT chain
+            uint16_t firstBlock;
+            //! Number of blocks in the file
+            uint16_t numBlocks;
+        };
+
+        //! Which block is being loaded
+        enum LoadStep : uint8_t
+        {
+            LOAD_SYSTEM = 0,
+            LOAD_FAT,
+            LOAD_DIRECTORY,
+            LOAD_DONE
+        };
+
+        //! Parses the system block held in mBlock
+        //! @returns true iff the VMU is formatted with a usable layout
+        bool parseSystemBlock();
+
+        //! Adds the files listed in the directory block held in mBlock
+        void parseDirectoryBlock();
+
+        //! Reads a little endian 16-bit value
+        //! @param[in] data  Pointer to the first byte
+        //! @returns the value
+        static uint16_t getU16(const uint8_t* data);
+
+    private:
+        //! Offset of the FAT location within the system block
+        static const uint32_t SYSTEM_FAT_LOCATION_OFFSET = 0x46;
+        //! Offset of the directory location within the system block
+        static const uint32_t SYSTEM_DIRECTORY_LOCATION_OFFSET = 0x4A;
+        //! Offset of the number of directory blocks within the system block
+        static const uint32_t SYSTEM_DIRECTORY_SIZE_OFFSET = 0x4C;
+        //! Number of bytes at the start of a formatted system block which are set to FORMAT_BYTE
+        static const uint32_t FORMAT_LEN = 16;
+        //! Value of the format bytes at the start of the system block
+        static const uint8_t FORMAT_BYTE = 0x55;
+        //! Number of bytes in each directory entry
+        static const uint32_t DIRECTORY_ENTRY_SIZE = 32;
+        //! Offset of the first block within a directory entry
+        static const uint32_t ENTRY_FIRST_BLOCK_OFFSET = 0x02;
+        //! Offset of the file name within a directory entry
+        static const uint32_t ENTRY_NAME_OFFSET = 0x04;
+        //! Offset of the number of blocks within a directory entry
+        static const uint32_t ENTRY_SIZE_OFFSET = 0x18;
+
+        //! Which block is being loaded
+        LoadStep mStep;
+        //! Block number of the FAT
+        uint16_t mFatBlock;
+        //! Block number of the first (highest) directory block
+        uint16_t mDirectoryBlock;
+        //! Number of directory blocks
+        uint16_t mNumDirectoryBlocks;
+        //! Number of directory blocks loaded so far
+        uint16_t mDirectoryIdx;
+        //! The FAT, converted to host byte order
+        uint16_t mFat[256];
+        //! Block being loaded
+        uint8_t mBlock[VmuBlockCache::BLOCK_SIZE];
+        //! The files found so far
+        File mFiles[MAX_FILES];
+        //! Number of valid entries in mFiles
+        uint32_t mNumFiles;
+};
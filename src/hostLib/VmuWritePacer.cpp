@@ -0,0 +1,114 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuWritePacer.hpp"
+
+VmuWritePacer::VmuWritePacer(uint32_t initialGapUs) :
+    mGapUs(initialGapUs),
+    mReliableGapUs(initialGapUs),
+    mFailedGapUs(0),
+    mSuccessStreak(0),
+    mFailureCount(0)
+{}
+
+uint32_t VmuWritePacer::getGapUs() const
+{
+    return mGapUs;
+}
+
+void VmuWritePacer::blockSucceeded()
+{
+    ++mSuccessStreak;
+
+    if (mGapUs < mReliableGapUs)
+    {
+        // A probe succeeded
+        mReliableGapUs = mGapUs;
+    }
+
+    if (mGapUs > mReliableGapUs)
+    {
+        // Slowly recover from back off
+        uint32_t diff = mGapUs - mReliableGapUs;
+        mGapUs -= (diff > RECOVERY_STEP_US) ? RECOVERY_STEP_US : diff;
+    }
+    else if (mSuccessStreak >= SUCCESSES_PER_PROBE)
+    {
+        mSuccessStreak = 0;
+        if (mGapUs >= (MIN_GAP_US + PROBE_STEP_US))
+        {
+            uint32_t probeGapUs = mGapUs - PROBE_STEP_US;
+            if (probeGapUs > mFailedGapUs)
+            {
+                mGapUs = probeGapUs;
+            }
+            else
+            {
+                // Slowly forget about the failure in case the device was only temporarily slow
+                mFailedGapUs = (mFailedGapUs > PROBE_STEP_US) ? (mFailedGapUs - PROBE_STEP_US) : 0;
+            }
+        }
+    }
+}
+
+void VmuWritePacer::phaseFailed()
+{
+    ++mFailureCount;
+    mSuccessStreak = 0;
+
+    if (mGapUs > mFailedGapUs)
+    {
+        mFailedGapUs = mGapUs;
+    }
+
+    if (mReliableGapUs <= mGapUs)
+    {
+        // What was reliable isn't any longer
+        mReliableGapUs = mGapUs + PROBE_STEP_US;
+    }
+
+    uint32_t backoffUs = mGapUs / 2;
+    if (backoffUs < MIN_BACKOFF_US)
+    {
+        backoffUs = MIN_BACKOFF_US;
+    }
+    mGapUs += backoffUs;
+    if (mGapUs > MAX_GAP_US)
+    {
+        mGapUs = MAX_GAP_US;
+    }
+    if (mReliableGapUs > mGapUs)
+    {
+        mReliableGapUs = mGapUs;
+    }
+}
+
+uint32_t VmuWritePacer::getReliableGapUs() const
+{
+    return mReliableGapUs;
+}
+
+uint32_t VmuWritePacer::getFailureCount() const
+{
+    return mFailureCount;
+}
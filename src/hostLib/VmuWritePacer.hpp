@@ -0,0 +1,83 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+//! Adapts the duration between VMU write phases to the fastest rate a device handles reliably.
+//! Starting from a known safe duration, each block written without failure eases the duration
+//! down toward the fastest one proven reliable and periodically probes one step faster. A failed
+//! phase or commit backs off multiplicatively and remembers the failing duration so that it isn't
+//! probed again until it has been slowly forgotten.
+//! @note This is only to be accessed from the core which executes the nodes
+class VmuWritePacer
+{
+    public:
+        //! Constructor
+        //! @param[in] initialGapUs  The duration between write phases to start with
+        VmuWritePacer(uint32_t initialGapUs = DEFAULT_GAP_US);
+
+        //! @returns the current minimum duration between write phases in microseconds
+        uint32_t getGapUs() const;
+
+        //! Called when all phases of a block and its commit were acknowledged
+        void blockSucceeded();
+
+        //! Called when a write phase or commit failed
+        void phaseFailed();
+
+        //! @returns the fastest duration which completed a block without failure
+        uint32_t getReliableGapUs() const;
+
+        //! @returns the number of failures reported
+        uint32_t getFailureCount() const;
+
+    public:
+        //! Duration which is known to work for standard VMUs
+        static const uint32_t DEFAULT_GAP_US = 10000;
+        //! Fastest duration which will ever be probed
+        static const uint32_t MIN_GAP_US = 1000;
+        //! Slowest duration backed off to
+        static const uint32_t MAX_GAP_US = 100000;
+        //! Minimum amount to back off on failure
+        static const uint32_t MIN_BACKOFF_US = 5000;
+        //! Amount each successful block eases the duration toward the reliable duration
+        static const uint32_t RECOVERY_STEP_US = 1000;
+        //! Amount each probe lowers the duration
+        static const uint32_t PROBE_STEP_US = 1000;
+        //! Number of consecutive successful blocks at the reliable duration before probing faster
+        static const uint32_t SUCCESSES_PER_PROBE = 4;
+
+    private:
+        //! The current minimum duration between write phases
+        uint32_t mGapUs;
+        //! The fastest duration which completed a block without failure
+        uint32_t mReliableGapUs;
+        //! The slowest duration which recently failed (0 when none)
+        uint32_t mFailedGapUs;
+        //! Number of consecutive successful blocks
+        uint32_t mSuccessStreak;
+        //! Number of failures reported
+        uint32_t mFailureCount;
+};
@@ -1,16 +1,99 @@
 #include "FlycastCommandParser.hpp"
 #include "hal/MapleBus/MaplePacket.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
+#include "DreamcastPeripheral.hpp"
+#include "HexCodec.hpp"
+#include "dreamcast_constants.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <cctype>
-#include <cstring>
-#include <string>
-#include <cstdlib>
+#include <algorithm>
 
-// Simple definition of a transmitter which just echos status and received data
-class FlycastEchoTransmitter : public Transmitter
+// The command character handled by this parser
+static const char COMMAND_CHAR = 'X';
+
+// Starts a text response line with the tag of the request, if it was tagged
+static void putTextTag(HexEncoder& out, const FlycastCommandParser::ResponseTag& tag)
+{
+    if (tag.textTag[0] != '\0')
+    {
+        out.putChar(FlycastCommandParser::TEXT_TAG_CHAR);
+        out.putString(tag.textTag);
+    }
+}
+
+// Writes a text response line holding the given message, preceded by the tag of the request
+static void putTextMessage(const FlycastCommandParser::ResponseTag& tag, const char* message)
+{
+    HexEncoder out;
+    putTextTag(out, tag);
+    if (tag.textTag[0] != '\0')
+    {
+        out.putChar(' ');
+    }
+    out.putString(message);
+}
+
+// Marks the sub-slots answered by local peripherals as occupied in a response from a main peripheral,
+// just as a main peripheral does for what is plugged into it
+// @param[in] packet  The response packet
+// @param[in] mask  The sub-slots of the responding player which are answered by a local peripheral
+static std::shared_ptr<const MaplePacket> addLocalSubPeripherals(std::shared_ptr<const MaplePacket> packet,
+                                                                 uint8_t mask)
+{
+    const uint8_t senderAddr = packet->frame.senderAddr;
+    if (mask == 0
+        || (senderAddr & DreamcastPeripheral::MAIN_PERIPHERAL_ADDR_MASK) == 0
+        || (senderAddr & mask) == mask)
+    {
+        return packet;
+    }
+
+    std::shared_ptr<MaplePacket> augmented = std::make_shared<MaplePacket>(*packet);
+    augmented->frame.senderAddr |= mask;
+    return augmented;
+}
+
+// Appends the given response packet to a text response, followed by its age if it was cached
+static void putTextPacket(HexEncoder& out, const MaplePacket& packet, int64_t ageUs)
+{
+    out.putPacketBytes(packet);
+    if (ageUs != FlycastCommandParser::NO_AGE)
+    {
+        out.putString(" @");
+        out.putUnsigned(ageUs);
+    }
+}
+
+// Transmitter which echos status and received data, tagged with the tag of the request; one
+// instance answers in text and the other in binary frames
+class FlycastTransmitter : public Transmitter
 {
 public:
+    //! Constructor
+    //! @param[in] echoUntagged  true to echo in text when no tag was saved for a transmission
+    FlycastTransmitter(bool echoUntagged) :
+        mEchoUntagged(echoUntagged),
+        mPending(),
+        mNextPendingIdx(0)
+    {}
+
+    //! Saves the tag to respond with once the given transmission completes
+    //! @param[in] senderAddr  The sender address of the scheduler the transmission was added to
+    //! @param[in] transmissionId  The ID of the transmission
+    //! @param[in] tag  How to respond to the request which caused this transmission
+    //! @param[in] localMask  Sub-slots of the player which are answered by a local peripheral
+    void addPending(uint8_t senderAddr,
+                    uint32_t transmissionId,
+                    const FlycastCommandParser::ResponseTag& tag,
+                    uint8_t localMask)
+    {
+        // Oldest entry is overwritten (its transmission was likely canceled)
+        mPending[mNextPendingIdx] = PendingTag{true, senderAddr, transmissionId, tag, localMask};
+        mNextPendingIdx = (mNextPendingIdx + 1) % MAX_PENDING;
+    }
+
     virtual void txStarted(std::shared_ptr<const Transmission> tx) final
     {}
 
@@ -18,28 +101,394 @@ public:
                           bool readFailed,
                           std::shared_ptr<const Transmission> tx) final
     {
-        if (writeFailed)
+        FlycastCommandParser::ResponseTag tag;
+        uint8_t localMask = 0;
+        if (!popTag(*tx, tag, localMask))
         {
-            printf("*failed write\n");
+            return;
+        }
+
+        if (tag.binaryTag == FlycastCommandParser::TEXT_RESPONSE)
+        {
+            putTextMessage(tag, writeFailed ? "*failed write\n" : "*failed read\n");
         }
         else
         {
-            printf("*failed read\n");
+            BinaryFrame::writeResponse(
+                COMMAND_CHAR,
+                tag.binaryTag,
+                writeFailed ? BinaryFrame::STATUS_FAILED_WRITE : BinaryFrame::STATUS_FAILED_READ);
         }
     }
 
     virtual void txComplete(std::shared_ptr<const MaplePacket> packet,
                             std::shared_ptr<const Transmission> tx) final
     {
-        char buffer[9];
-        snprintf(buffer, sizeof(buffer), "%08lX", (long unsigned int)packet->frame.toWord());
-        for (int i = 0; i < 8; i += 2)
+        FlycastCommandParser::ResponseTag tag;
+        uint8_t localMask = 0;
+        if (!popTag(*tx, tag, localMask))
+        {
+            return;
+        }
+
+        packet = addLocalSubPeripherals(packet, localMask);
+        if (tag.binaryTag == FlycastCommandParser::TEXT_RESPONSE)
+        {
+            HexEncoder out;
+            putTextTag(out, tag);
+            out.putPacketBytes(*packet);
+            out.putChar('\n');
+        }
+        else
         {
-            printf(" %c%c", buffer[i], buffer[i + 1]);
+            BinaryFrame::writeResponse(COMMAND_CHAR, tag.binaryTag, BinaryFrame::STATUS_OK, packet.get());
         }
-        printf("\n");
     }
-} flycastEchoTransmitter;
+
+private:
+    //! Looks up and removes the tag for the given transmission
+    //! @param[in] tx  The transmission
+    //! @param[out] tag  The tag that was saved for the transmission
+    //! @param[out] localMask  The local sub-slot mask that was saved for the transmission
+    //! @returns true iff the transmission should be answered using tag
+    bool popTag(const Transmission& tx, FlycastCommandParser::ResponseTag& tag, uint8_t& localMask)
+    {
+        for (uint32_t i = 0; i < MAX_PENDING; ++i)
+        {
+            PendingTag& pending = mPending[i];
+            if (pending.valid
+                && pending.transmissionId == tx.transmissionId
+                && pending.senderAddr == tx.packet->frame.senderAddr)
+            {
+                pending.valid = false;
+                tag = pending.tag;
+                localMask = pending.localMask;
+                return true;
+            }
+        }
+
+        if (mEchoUntagged)
+        {
+            tag.binaryTag = FlycastCommandParser::TEXT_RESPONSE;
+            tag.textTag[0] = '\0';
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    struct PendingTag
+    {
+        bool valid;
+        uint8_t senderAddr;
+        uint32_t transmissionId;
+        FlycastCommandParser::ResponseTag tag;
+        uint8_t localMask;
+    };
+
+    //! Maximum number of tagged requests which may be outstanding at once
+    static const uint32_t MAX_PENDING = 64;
+    //! When true, transmissions without a saved tag are answered in text without a tag
+    const bool mEchoUntagged;
+    PendingTag mPending[MAX_PENDING];
+    uint32_t mNextPendingIdx;
+};
+
+static FlycastTransmitter flycastEchoTransmitter(true);
+static FlycastTransmitter flycastBinaryTransmitter(false);
+
+// Transmitter which collects the results of each packet of a batch command, then responds once
+// with the results of all of them
+class FlycastBatchTransmitter : public Transmitter
+{
+public:
+    FlycastBatchTransmitter() : mBatches(), mNextSequence(0) {}
+
+    //! Starts a new batch, abandoning the oldest one if all are in use
+    //! @param[in] tag  How to respond to the batch
+    //! @param[in] numPackets  Number of packets in the batch [1,MAX_BATCH_PACKETS]
+    //! @returns the index of the batch
+    uint32_t begin(const FlycastCommandParser::ResponseTag& tag, uint32_t numPackets)
+    {
+        uint32_t batchIdx = 0;
+        for (uint32_t i = 0; i < MAX_BATCHES; ++i)
+        {
+            if (!mBatches[i].active)
+            {
+                batchIdx = i;
+                break;
+            }
+            else if (mBatches[i].sequence < mBatches[batchIdx].sequence)
+            {
+                batchIdx = i;
+            }
+        }
+
+        Batch& batch = mBatches[batchIdx];
+        if (batch.active)
+        {
+            // A transmission of this batch was likely canceled - respond with what is available
+            for (uint32_t i = 0; i < batch.numEntries; ++i)
+            {
+                if (!batch.entries[i].done)
+                {
+                    setResult(batchIdx, i, BinaryFrame::STATUS_FAILED_READ, nullptr);
+                }
+            }
+            finishIfDone(batchIdx);
+        }
+
+        batch.active = true;
+        batch.sequence = mNextSequence++;
+        batch.tag = tag;
+        batch.numEntries = numPackets;
+        batch.numRemaining = numPackets;
+        for (uint32_t i = 0; i < numPackets; ++i)
+        {
+            batch.entries[i] = Entry();
+        }
+        return batchIdx;
+    }
+
+    //! Saves the transmission which will produce the result of a packet of a batch
+    //! @param[in] batchIdx  The index of the batch
+    //! @param[in] entryIdx  The index of the packet within the batch
+    //! @param[in] senderAddr  The sender address of the scheduler the transmission was added to
+    //! @param[in] transmissionId  The ID of the transmission
+    //! @param[in] localMask  Sub-slots of the player which are answered by a local peripheral
+    void setPending(uint32_t batchIdx,
+                    uint32_t entryIdx,
+                    uint8_t senderAddr,
+                    uint32_t transmissionId,
+                    uint8_t localMask)
+    {
+        Entry& entry = mBatches[batchIdx].entries[entryIdx];
+        entry.pending = true;
+        entry.senderAddr = senderAddr;
+        entry.transmissionId = transmissionId;
+        entry.localMask = localMask;
+    }
+
+    //! Sets the result of a packet of a batch
+    //! @param[in] batchIdx  The index of the batch
+    //! @param[in] entryIdx  The index of the packet within the batch
+    //! @param[in] status  The BinaryFrame status of the packet
+    //! @param[in] packet  The response packet or nullptr if none
+    //! @param[in] ageUs  The age of the packet if it was served from cache or NO_AGE
+    void setResult(uint32_t batchIdx,
+                   uint32_t entryIdx,
+                   uint8_t status,
+                   std::shared_ptr<const MaplePacket> packet,
+                   int64_t ageUs = FlycastCommandParser::NO_AGE)
+    {
+        Batch& batch = mBatches[batchIdx];
+        Entry& entry = batch.entries[entryIdx];
+        if (!entry.done)
+        {
+            entry.done = true;
+            entry.pending = false;
+            entry.status = status;
+            entry.packet = packet;
+            entry.ageUs = ageUs;
+            --batch.numRemaining;
+        }
+    }
+
+    //! Responds to the given batch if the results of all of its packets are set
+    //! @param[in] batchIdx  The index of the batch
+    void finishIfDone(uint32_t batchIdx)
+    {
+        Batch& batch = mBatches[batchIdx];
+        if (!batch.active || batch.numRemaining > 0)
+        {
+            return;
+        }
+
+        if (batch.tag.binaryTag == FlycastCommandParser::TEXT_RESPONSE)
+        {
+            writeTextResponse(batch);
+        }
+        else
+        {
+            writeBinaryResponse(batch);
+        }
+
+        batch.active = false;
+        for (uint32_t i = 0; i < batch.numEntries; ++i)
+        {
+            // Release response packets
+            batch.entries[i].packet = nullptr;
+        }
+    }
+
+    virtual void txStarted(std::shared_ptr<const Transmission> tx) final
+    {}
+
+    virtual void txFailed(bool writeFailed,
+                          bool readFailed,
+                          std::shared_ptr<const Transmission> tx) final
+    {
+        uint32_t batchIdx = 0;
+        uint32_t entryIdx = 0;
+        if (findEntry(*tx, batchIdx, entryIdx))
+        {
+            setResult(batchIdx,
+                      entryIdx,
+                      writeFailed ? BinaryFrame::STATUS_FAILED_WRITE : BinaryFrame::STATUS_FAILED_READ,
+                      nullptr);
+            finishIfDone(batchIdx);
+        }
+    }
+
+    virtual void txComplete(std::shared_ptr<const MaplePacket> packet,
+                            std::shared_ptr<const Transmission> tx) final
+    {
+        uint32_t batchIdx = 0;
+        uint32_t entryIdx = 0;
+        if (findEntry(*tx, batchIdx, entryIdx))
+        {
+            const uint8_t localMask = mBatches[batchIdx].entries[entryIdx].localMask;
+            setResult(batchIdx, entryIdx, BinaryFrame::STATUS_OK, addLocalSubPeripherals(packet, localMask));
+            finishIfDone(batchIdx);
+        }
+    }
+
+private:
+    struct Entry
+    {
+        //! Set when the transmission below was added to a scheduler
+        bool pending = false;
+        //! Set once the result is known
+        bool done = false;
+        uint8_t senderAddr = 0;
+        uint32_t transmissionId = 0;
+        //! Sub-slots of the player which are answered by a local peripheral
+        uint8_t localMask = 0;
+        uint8_t status = BinaryFrame::STATUS_OK;
+        std::shared_ptr<const MaplePacket> packet;
+        int64_t ageUs = FlycastCommandParser::NO_AGE;
+    };
+
+    struct Batch
+    {
+        bool active = false;
+        //! Increments with each new batch; used to find the oldest one
+        uint32_t sequence = 0;
+        FlycastCommandParser::ResponseTag tag;
+        uint32_t numEntries = 0;
+        uint32_t numRemaining = 0;
+        Entry entries[FlycastCommandParser::MAX_BATCH_PACKETS];
+    };
+
+    //! Looks up the batch packet which the given transmission was sent for
+    //! @param[in] tx  The transmission
+    //! @param[out] batchIdx  The index of the batch
+    //! @param[out] entryIdx  The index of the packet within the batch
+    //! @returns true iff found
+    bool findEntry(const Transmission& tx, uint32_t& batchIdx, uint32_t& entryIdx)
+    {
+        for (batchIdx = 0; batchIdx < MAX_BATCHES; ++batchIdx)
+        {
+            const Batch& batch = mBatches[batchIdx];
+            for (entryIdx = 0; batch.active && entryIdx < batch.numEntries; ++entryIdx)
+            {
+                const Entry& entry = batch.entries[entryIdx];
+                if (entry.pending
+                    && entry.transmissionId == tx.transmissionId
+                    && entry.senderAddr == tx.packet->frame.senderAddr)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    //! Writes the results of the given batch as one line, separated by BATCH_SEPARATOR_CHAR
+    static void writeTextResponse(const Batch& batch)
+    {
+        HexEncoder out;
+        putTextTag(out, batch.tag);
+        for (uint32_t i = 0; i < batch.numEntries; ++i)
+        {
+            const Entry& entry = batch.entries[i];
+            if (i > 0)
+            {
+                out.putChar(FlycastCommandParser::BATCH_SEPARATOR_CHAR);
+            }
+
+            switch (entry.status)
+            {
+                case BinaryFrame::STATUS_OK:
+                    if (entry.packet != nullptr)
+                    {
+                        putTextPacket(out, *entry.packet, entry.ageUs);
+                    }
+                    break;
+                case BinaryFrame::STATUS_FAILED_WRITE:
+                    out.putString(" *failed write");
+                    break;
+                case BinaryFrame::STATUS_INVALID_SENDER:
+                    out.putString(" *failed invalid sender");
+                    break;
+                case BinaryFrame::STATUS_FAILED_READ: // Fall through
+                default:
+                    out.putString(" *failed read");
+                    break;
+            }
+        }
+        out.putChar('\n');
+    }
+
+    //! Writes the results of the given batch as one frame; the data holds a status byte for each
+    //! packet, each followed by the response packet when the status is STATUS_OK
+    static void writeBinaryResponse(const Batch& batch)
+    {
+        static uint8_t data[BinaryFrame::MAX_PACKET_BYTES];
+        uint8_t* ptr = data;
+        for (uint32_t i = 0; i < batch.numEntries; ++i)
+        {
+            const Entry& entry = batch.entries[i];
+            if (entry.status == BinaryFrame::STATUS_OK && entry.packet != nullptr)
+            {
+                // Room is kept for the status byte of each of the following entries
+                const uint32_t available = sizeof(data) - (ptr - data) - (batch.numEntries - i - 1);
+                const uint32_t packetBytes = (entry.packet->payload.size() + 1) * sizeof(uint32_t);
+                if (1 + packetBytes > available)
+                {
+                    *ptr++ = BinaryFrame::STATUS_TRUNCATED;
+                }
+                else
+                {
+                    *ptr++ = BinaryFrame::STATUS_OK;
+                    ptr = BinaryFrame::putWord(entry.packet->frame.toWord(), ptr);
+                    for (std::vector<uint32_t>::const_iterator iter = entry.packet->payload.begin();
+                         iter != entry.packet->payload.end();
+                         ++iter)
+                    {
+                        ptr = BinaryFrame::putWord(*iter, ptr);
+                    }
+                }
+            }
+            else
+            {
+                *ptr++ = entry.status;
+            }
+        }
+
+        BinaryFrame::writeResponse(
+            COMMAND_CHAR, batch.tag.binaryTag, BinaryFrame::STATUS_OK, data, ptr - data);
+    }
+
+private:
+    //! Maximum number of batches which may be outstanding at once
+    static const uint32_t MAX_BATCHES = 4;
+    Batch mBatches[MAX_BATCHES];
+    uint32_t mNextSequence;
+};
+
+static FlycastBatchTransmitter flycastBatchTransmitter;
 
 FlycastCommandParser::FlycastCommandParser(
     std::shared_ptr<PrioritizedTxScheduler>* schedulers,
@@ -50,26 +499,52 @@ FlycastCommandParser::FlycastCommandParser(
     mSchedulers(schedulers),
     mSenderAddresses(senderAddresses),
     mNumSenders(numSenders),
-    mPlayerData(playerData)
+    mPlayerData(playerData),
+    mServeCachedCondition(false),
+    mWords(),
+    mLocalPeripherals(numSenders * DreamcastPeripheral::MAX_SUB_PERIPHERALS),
+    // Nothing is answered locally until a peripheral is attached
+    mLocalSubPeripheralMasks(numSenders, 0)
 {}
 
+bool FlycastCommandParser::attachLocalPeripheral(uint32_t playerIdx,
+                                                 uint32_t subSlot,
+                                                 std::shared_ptr<MaplePacketHandler> handler)
+{
+    if (playerIdx >= mNumSenders || subSlot >= DreamcastPeripheral::MAX_SUB_PERIPHERALS)
+    {
+        return false;
+    }
+
+    mLocalPeripherals[(playerIdx * DreamcastPeripheral::MAX_SUB_PERIPHERALS) + subSlot] = handler;
+
+    uint8_t& mask = mLocalSubPeripheralMasks[playerIdx];
+    if (handler != nullptr)
+    {
+        mask |= DreamcastPeripheral::subPeripheralMask(subSlot);
+    }
+    else
+    {
+        mask &= ~DreamcastPeripheral::subPeripheralMask(subSlot);
+    }
+    return true;
+}
+
 const char* FlycastCommandParser::getCommandChars()
 {
     // X is reserved for command from flycast emulator
     return "X";
 }
 
-void FlycastCommandParser::submit(const char* chars, uint32_t len)
+bool FlycastCommandParser::submit(const char* chars, uint32_t len)
 {
     if (len == 0)
     {
         // This shouldn't happen, but handle it regardless
-        return;
+        return false;
     }
 
-    bool valid = false;
     const char* eol = chars + len;
-    std::vector<uint32_t> words;
     const char* iter = chars + 1; // Skip past 'X' (implied)
 
     // left strip
@@ -83,6 +558,34 @@ void FlycastCommandParser::submit(const char* chars, uint32_t len)
         --eol;
     }
 
+    // Optional tag which is echoed at the start of the response, i.e. X#<tag> <packet>
+    ResponseTag tag;
+    tag.binaryTag = TEXT_RESPONSE;
+    tag.textTag[0] = '\0';
+    if (iter < eol && *iter == TEXT_TAG_CHAR)
+    {
+        // Remove tag character
+        ++iter;
+        uint32_t tagLen = 0;
+        while (iter < eol && std::isalnum(*iter) && tagLen < MAX_TEXT_TAG_LEN)
+        {
+            tag.textTag[tagLen++] = *iter++;
+        }
+        tag.textTag[tagLen] = '\0';
+
+        if (tagLen == 0 || (iter < eol && std::isalnum(*iter)))
+        {
+            // Empty or too long
+            HexEncoder().putString("*failed invalid tag\n");
+            return false;
+        }
+
+        while (iter < eol && std::isspace(*iter))
+        {
+            ++iter;
+        }
+    }
+
     // Check for special commanding
     if (iter < eol)
     {
@@ -93,19 +596,18 @@ void FlycastCommandParser::submit(const char* chars, uint32_t len)
             {
                 // Remove minus
                 ++iter;
-                int idx = -1;
-                if (iter < eol)
+                // Default to all when no player number is given
+                int32_t idx = -1;
+                while (iter < eol && std::isspace(*iter))
                 {
-                    std::string number;
-                    number.assign(iter, eol - iter);
-                    try
-                    {
-                        idx = std::stoi(number);
-                    }
-                    catch(...)
+                    ++iter;
+                }
+                if (iter < eol && std::isdigit(*iter))
+                {
+                    idx = 0;
+                    while (iter < eol && std::isdigit(*iter) && idx <= MAX_PLAYER_NUMBER)
                     {
-                        // Default to all
-                        idx = -1;
+                        idx = (idx * 10) + (*iter++ - '0');
                     }
                 }
 
@@ -123,107 +625,418 @@ void FlycastCommandParser::submit(const char* chars, uint32_t len)
                     mPlayerData[idx]->screenData.resetToDefault();
                 }
             }
-            return;
+            return true;
+
+            // XS0 to disable or XS1 to enable serving controller condition from cache
+            case 'S':
+            {
+                // Remove S
+                ++iter;
+                while (iter < eol && std::isspace(*iter))
+                {
+                    ++iter;
+                }
+                if (iter < eol && (*iter == '0' || *iter == '1'))
+                {
+                    mServeCachedCondition = (*iter == '1');
+                }
+                printf("*cached condition %s\n", mServeCachedCondition ? "on" : "off");
+            }
+            return true;
+
+            // X? to print response cache, screen write, and rumble latency statistics
+            case '?':
+            {
+                for (std::shared_ptr<PlayerData>& playerData : mPlayerData)
+                {
+                    uint32_t hits = playerData->responseCache.getDeviceInfoHits();
+                    uint32_t misses = playerData->responseCache.getDeviceInfoMisses();
+                    uint32_t total = hits + misses;
+                    printf("*P%lu device info cache hits: %lu misses: %lu ratio: %lu%%\n",
+                           (long unsigned int)(playerData->playerIndex + 1),
+                           (long unsigned int)hits,
+                           (long unsigned int)misses,
+                           (long unsigned int)((total > 0) ? (hits * 100ULL / total) : 0));
+                    printf("*P%lu screen writes saved: %lu\n",
+                           (long unsigned int)(playerData->playerIndex + 1),
+                           (long unsigned int)playerData->screenData.getWritesSaved());
+                    printf("*P%lu rumble latency last: %lu us max: %lu us late: %lu replaced: %lu\n",
+                           (long unsigned int)(playerData->playerIndex + 1),
+                           (long unsigned int)playerData->rumbleSlot.getLastLatencyUs(),
+                           (long unsigned int)playerData->rumbleSlot.getMaxLatencyUs(),
+                           (long unsigned int)playerData->rumbleSlot.getNumLate(),
+                           (long unsigned int)playerData->rumbleSlot.getNumReplaced());
+                }
+            }
+            return true;
 
             // No special case
             default: break;
         }
     }
 
-    while (iter < eol)
+    if (std::find(iter, eol, static_cast<char>(BATCH_SEPARATOR_CHAR)) != eol)
     {
-        uint32_t word = 0;
-        uint32_t i = 0;
-        while (i < 8 && iter < eol)
-        {
-            char v = *iter++;
-            uint_fast8_t value = 0;
+        return submitTextBatch(iter, eol - iter, tag);
+    }
 
-            if (v >= '0' && v <= '9')
-            {
-                value = v - '0';
-            }
-            else if (v >= 'a' && v <= 'f')
-            {
-                value = v - 'a' + 0xa;
-            }
-            else if (v >= 'A' && v <= 'F')
-            {
-                value = v - 'A' + 0xA;
-            }
-            else
-            {
-                // Ignore this character
-                continue;
-            }
+    HexDecoder decoder(mWords, MAX_PACKET_WORDS);
+    decoder.feed(iter, eol - iter);
 
-            // Apply value into current word
-            word |= (value << ((8 - i) * 4 - 4));
-            ++i;
+    if (decoder.isOverflowed())
+    {
+        putTextMessage(tag, "*failed packet invalid\n");
+        return false;
+    }
+    else if (decoder.isComplete())
+    {
+        MaplePacket packet(MaplePacket::Frame::fromWord(mWords[0]),
+                           &mWords[1],
+                           decoder.getNumWords() - 1);
+        if (packet.isValid())
+        {
+            return sendPacket(packet, tag);
+        }
+        else
+        {
+            putTextMessage(tag, "*failed packet invalid\n");
+            return false;
         }
+    }
+    else
+    {
+        putTextMessage(tag, "*failed missing data\n");
+        return false;
+    }
+}
+
+bool FlycastCommandParser::submitTextBatch(const char* chars, uint32_t len, const ResponseTag& tag)
+{
+    MaplePacket packets[MAX_BATCH_PACKETS];
+    uint32_t numPackets = 0;
+    const char* const eol = chars + len;
+    const char* iter = chars;
+    while (iter < eol)
+    {
+        const char* separator = std::find(iter, eol, static_cast<char>(BATCH_SEPARATOR_CHAR));
 
-        // Invalid if a partial word was given
-        valid = ((i == 8) || (i == 0));
+        HexDecoder decoder(mWords, MAX_PACKET_WORDS);
+        decoder.feed(iter, separator - iter);
+        if (numPackets >= MAX_BATCH_PACKETS || decoder.isOverflowed())
+        {
+            putTextMessage(tag, "*failed packet invalid\n");
+            return false;
+        }
+        else if (!decoder.isComplete())
+        {
+            putTextMessage(tag, "*failed missing data\n");
+            return false;
+        }
 
-        if (i == 8)
+        MaplePacket& packet = packets[numPackets++];
+        packet = MaplePacket(MaplePacket::Frame::fromWord(mWords[0]),
+                             &mWords[1],
+                             decoder.getNumWords() - 1);
+        if (!packet.isValid())
         {
-            words.push_back(word);
+            putTextMessage(tag, "*failed packet invalid\n");
+            return false;
         }
+
+        // Skip past separator
+        iter = separator + 1;
     }
 
-    if (valid)
+    sendBatch(packets, numPackets, tag);
+    return true;
+}
+
+bool FlycastCommandParser::isBinarySupported()
+{
+    return true;
+}
+
+bool FlycastCommandParser::submitBinary(uint8_t tag, const uint8_t* data, uint32_t len)
+{
+    // The frame word's length byte serves as the length prefix of each packet, so the data may
+    // hold several packets back to back which are then handled as a batch
+    MaplePacket packets[MAX_BATCH_PACKETS];
+    uint32_t numPackets = 0;
+    bool valid = (len >= sizeof(uint32_t) && (len % sizeof(uint32_t)) == 0);
+    const uint8_t* const end = data + len;
+    while (valid && data < end)
     {
-        MaplePacket packet(&words[0], words.size());
-        if (packet.isValid())
+        const uint32_t numWords =
+            MaplePacket::Frame::getFramePacketLength(BinaryFrame::getWord(data)) + 1;
+        if (numPackets >= MAX_BATCH_PACKETS
+            || static_cast<uint32_t>(end - data) < (numWords * sizeof(uint32_t)))
         {
-            uint8_t sender = packet.frame.senderAddr;
-            int32_t idx = -1;
-            const uint8_t* senderAddress = mSenderAddresses;
+            valid = false;
+            break;
+        }
 
-            if (mNumSenders == 1)
-            {
-                // Single player special case - always send to the one available, regardless of address
-                idx = 0;
-                packet.frame.senderAddr = *senderAddress;
-                packet.frame.recipientAddr = (packet.frame.recipientAddr & 0x3F) | *senderAddress;
-            }
-            else
-            {
-                for (uint32_t i = 0; i < mNumSenders && idx < 0; ++i, ++senderAddress)
-                {
-                    if (sender == *senderAddress)
-                    {
-                        idx = i;
-                    }
-                }
-            }
+        for (uint32_t i = 0; i < numWords; ++i, data += sizeof(uint32_t))
+        {
+            mWords[i] = BinaryFrame::getWord(data);
+        }
 
-            if (idx >= 0)
-            {
-                mSchedulers[idx]->add(
-                    PrioritizedTxScheduler::EXTERNAL_TRANSMISSION_PRIORITY,
-                    PrioritizedTxScheduler::TX_TIME_ASAP,
-                    &flycastEchoTransmitter,
-                    packet,
-                    true);
-            }
-            else
+        MaplePacket& packet = packets[numPackets++];
+        packet = MaplePacket(MaplePacket::Frame::fromWord(mWords[0]), &mWords[1], numWords - 1);
+        valid = packet.isValid();
+    }
+
+    if (!valid)
+    {
+        BinaryFrame::writeResponse(COMMAND_CHAR, tag, BinaryFrame::STATUS_INVALID_PACKET);
+        return false;
+    }
+
+    ResponseTag responseTag;
+    responseTag.binaryTag = tag;
+    responseTag.textTag[0] = '\0';
+    if (numPackets == 1)
+    {
+        return sendPacket(packets[0], responseTag);
+    }
+
+    sendBatch(packets, numPackets, responseTag);
+    return true;
+}
+
+int32_t FlycastCommandParser::findPlayerIndex(MaplePacket& packet)
+{
+    uint8_t sender = packet.frame.senderAddr;
+    int32_t idx = -1;
+    const uint8_t* senderAddress = mSenderAddresses;
+
+    if (mNumSenders == 1)
+    {
+        // Single player special case - always send to the one available, regardless of address
+        idx = 0;
+        packet.frame.senderAddr = *senderAddress;
+        packet.frame.recipientAddr = (packet.frame.recipientAddr & 0x3F) | *senderAddress;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < mNumSenders && idx < 0; ++i, ++senderAddress)
+        {
+            if (sender == *senderAddress)
             {
-                printf("*failed invalid sender\n");
+                idx = i;
             }
         }
+    }
+
+    return idx;
+}
+
+bool FlycastCommandParser::sendPacket(MaplePacket& packet, const ResponseTag& tag)
+{
+    int32_t idx = findPlayerIndex(packet);
+    if (idx < 0)
+    {
+        if (tag.binaryTag == TEXT_RESPONSE)
+        {
+            putTextMessage(tag, "*failed invalid sender\n");
+        }
         else
         {
-            printf("*failed packet invalid\n");
+            BinaryFrame::writeResponse(COMMAND_CHAR, tag.binaryTag, BinaryFrame::STATUS_INVALID_SENDER);
         }
+        return false;
     }
-    else
+
+    int64_t ageUs = NO_AGE;
+    std::shared_ptr<const MaplePacket> cached = handleLocally(idx, packet);
+    if (cached == nullptr)
+    {
+        cached = lookupCachedDeviceInfo(idx, packet);
+    }
+    if (cached == nullptr)
+    {
+        uint64_t conditionAgeUs = 0;
+        cached = lookupCachedCondition(idx, packet, conditionAgeUs);
+        ageUs = conditionAgeUs;
+    }
+
+    if (cached != nullptr)
+    {
+        cached = addLocalSubPeripherals(cached, mLocalSubPeripheralMasks[idx]);
+        // Served without touching the bus
+        if (tag.binaryTag == TEXT_RESPONSE)
+        {
+            HexEncoder out;
+            putTextTag(out, tag);
+            putTextPacket(out, *cached, ageUs);
+            out.putChar('\n');
+        }
+        else
+        {
+            BinaryFrame::writeResponse(COMMAND_CHAR, tag.binaryTag, BinaryFrame::STATUS_OK, cached.get());
+        }
+        return true;
+    }
+
+    FlycastTransmitter& transmitter =
+        (tag.binaryTag == TEXT_RESPONSE) ? flycastEchoTransmitter : flycastBinaryTransmitter;
+    uint32_t id = mSchedulers[idx]->add(
+        PrioritizedTxScheduler::EXTERNAL_TRANSMISSION_PRIORITY,
+        PrioritizedTxScheduler::TX_TIME_ASAP,
+        &transmitter,
+        packet,
+        true);
+
+    const uint8_t localMask = mLocalSubPeripheralMasks[idx];
+    if (tag.binaryTag != TEXT_RESPONSE || tag.textTag[0] != '\0' || localMask != 0)
+    {
+        // Untagged text requests don't need to be tracked unless their response must show local
+        // peripherals; any number of them may be in flight
+        transmitter.addPending(mSenderAddresses[idx], id, tag, localMask);
+    }
+
+    return true;
+}
+
+void FlycastCommandParser::sendBatch(MaplePacket* packets, uint32_t numPackets, const ResponseTag& tag)
+{
+    uint32_t batchIdx = flycastBatchTransmitter.begin(tag, numPackets);
+    for (uint32_t i = 0; i < numPackets; ++i)
+    {
+        MaplePacket& packet = packets[i];
+        int32_t idx = findPlayerIndex(packet);
+        if (idx < 0)
+        {
+            flycastBatchTransmitter.setResult(batchIdx, i, BinaryFrame::STATUS_INVALID_SENDER, nullptr);
+            continue;
+        }
+
+        const uint8_t localMask = mLocalSubPeripheralMasks[idx];
+        std::shared_ptr<const MaplePacket> cached = handleLocally(idx, packet);
+        if (cached == nullptr)
+        {
+            cached = lookupCachedDeviceInfo(idx, packet);
+        }
+        if (cached != nullptr)
+        {
+            flycastBatchTransmitter.setResult(
+                batchIdx, i, BinaryFrame::STATUS_OK, addLocalSubPeripherals(cached, localMask));
+            continue;
+        }
+
+        uint64_t ageUs = 0;
+        cached = lookupCachedCondition(idx, packet, ageUs);
+        if (cached != nullptr)
+        {
+            flycastBatchTransmitter.setResult(
+                batchIdx, i, BinaryFrame::STATUS_OK, addLocalSubPeripherals(cached, localMask), ageUs);
+            continue;
+        }
+
+        uint32_t id = mSchedulers[idx]->add(
+            PrioritizedTxScheduler::EXTERNAL_TRANSMISSION_PRIORITY,
+            PrioritizedTxScheduler::TX_TIME_ASAP,
+            &flycastBatchTransmitter,
+            packet,
+            true);
+        flycastBatchTransmitter.setPending(batchIdx, i, mSenderAddresses[idx], id, localMask);
+    }
+
+    // Responds now if everything was served from cache
+    flycastBatchTransmitter.finishIfDone(batchIdx);
+}
+
+std::shared_ptr<const MaplePacket> FlycastCommandParser::handleLocally(
+    uint32_t idx,
+    const MaplePacket& packet)
+{
+    const uint8_t recipientAddr = packet.frame.recipientAddr;
+    const int32_t subSlot = DreamcastPeripheral::subPeripheralIndex(recipientAddr);
+    if (idx >= mNumSenders
+        || (recipientAddr & DreamcastPeripheral::MAIN_PERIPHERAL_ADDR_MASK) != 0
+        || subSlot < 0)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<MaplePacketHandler>& handler =
+        mLocalPeripherals[(idx * DreamcastPeripheral::MAX_SUB_PERIPHERALS) + subSlot];
+    if (handler == nullptr)
     {
-        printf("*failed missing data\n");
+        return nullptr;
     }
+
+    std::shared_ptr<MaplePacket> response = std::make_shared<MaplePacket>();
+    if (!handler->handlePacket(packet, *response))
+    {
+        response->frame.command = COMMAND_RESPONSE_UNKNOWN_COMMAND;
+        response->payload.clear();
+    }
+    // Answered as the addressed peripheral, regardless of which player it is attached to
+    response->frame.senderAddr = recipientAddr;
+    response->frame.recipientAddr = packet.frame.senderAddr;
+    response->updateFrameLength();
+    return response;
+}
+
+std::shared_ptr<const MaplePacket> FlycastCommandParser::lookupCachedDeviceInfo(
+    uint32_t idx,
+    const MaplePacket& packet)
+{
+    if (idx >= mPlayerData.size() || packet.frame.command != COMMAND_DEVICE_INFO_REQUEST)
+    {
+        return nullptr;
+    }
+
+    return mPlayerData[idx]->responseCache.lookupDeviceInfo(packet.frame.recipientAddr);
+}
+
+std::shared_ptr<const MaplePacket> FlycastCommandParser::lookupCachedCondition(
+    uint32_t idx,
+    const MaplePacket& packet,
+    uint64_t& ageUs)
+{
+    if (!mServeCachedCondition
+        || idx >= mPlayerData.size()
+        || packet.frame.command != COMMAND_GET_CONDITION
+        || (packet.frame.recipientAddr & 0x3F) != DreamcastPeripheral::MAIN_PERIPHERAL_ADDR_MASK
+        || packet.payload.size() < 1
+        || packet.payload[0] != DEVICE_FN_CONTROLLER)
+    {
+        return nullptr;
+    }
+
+    PlayerData& playerData = *mPlayerData[idx];
+    uint64_t receivedTimeUs = 0;
+    std::shared_ptr<const MaplePacket> condition = playerData.responseCache.getCondition(receivedTimeUs);
+    if (condition == nullptr)
+    {
+        // No controller connected or no condition received yet
+        return nullptr;
+    }
+
+    uint64_t currentTimeUs = playerData.clock.getTimeUs();
+    ageUs = (currentTimeUs > receivedTimeUs) ? (currentTimeUs - receivedTimeUs) : 0;
+    if (ageUs > MAX_CACHED_CONDITION_AGE_US)
+    {
+        // Too stale - let the bus handle it
+        return nullptr;
+    }
+
+    return condition;
 }
 
 void FlycastCommandParser::printHelp()
 {
     printf("X: commands from a flycast emulator\n");
+    printf("   XS<0|1>: disable/enable serving controller condition from cache;\n");
+    printf("            cached responses end with @<age in microseconds>\n");
+    printf("   X?: print response cache, screen write, and rumble latency statistics\n");
+    printf("   X[#<tag>] <packet>;<packet>...: batch of up to %lu packets, possibly to several\n"
+           "                     players; one response line holds all results, separated by ;\n",
+           (long unsigned int)MAX_BATCH_PACKETS);
+    printf("   X#<tag> <packet>: tag of up to %lu letters or digits, echoed as #<tag> at the start\n"
+           "                     of the response so that several requests may be in flight\n",
+           (long unsigned int)MAX_TEXT_TAG_LEN);
+    printf("   binary frame data: frame word then payload, each most significant byte first;\n"
+           "                      several packets back to back make a batch\n");
 }
@@ -5,6 +5,7 @@
 #include "PrioritizedTxScheduler.hpp"
 
 #include "PlayerData.hpp"
+#include "MaplePacketHandler.hpp"
 
 #include <memory>
 
@@ -24,14 +25,115 @@ public:
     virtual const char* getCommandChars() final;
 
     //! Called when newline reached; submit command and reset
-    virtual void submit(const char* chars, uint32_t len) final;
+    virtual bool submit(const char* chars, uint32_t len) final;
 
     //! Prints help message for this command
     virtual void printHelp() final;
 
+    //! @returns true since this parser handles binary frames
+    virtual bool isBinarySupported() final;
+
+    //! Called when a binary frame is received; data is the raw frame word followed by payload
+    virtual bool submitBinary(uint8_t tag, const uint8_t* data, uint32_t len) final;
+
+    //! Attaches a peripheral which answers the requests for a player's sub-slot locally, in place of
+    //! anything on the Maple Bus; the sub-slot is also shown as occupied in main peripheral responses
+    //! @param[in] playerIdx  The index of the player
+    //! @param[in] subSlot  The sub peripheral index [0,4]
+    //! @param[in] handler  The peripheral or nullptr to detach
+    //! @returns true iff playerIdx and subSlot are valid
+    bool attachLocalPeripheral(uint32_t playerIdx,
+                               uint32_t subSlot,
+                               std::shared_ptr<MaplePacketHandler> handler);
+
+    //! Value for binaryTag which selects a text response
+    static const int32_t TEXT_RESPONSE = -1;
+    //! Character which precedes the optional tag of a text command and of its response
+    static const char TEXT_TAG_CHAR = '#';
+    //! Maximum number of characters in the optional tag of a text command
+    static const uint32_t MAX_TEXT_TAG_LEN = 8;
+    //! Maximum number of packets in a single batch command
+    static const uint32_t MAX_BATCH_PACKETS = 16;
+    //! Character which separates packets of a text batch command
+    static const char BATCH_SEPARATOR_CHAR = ';';
+    //! Value for ageUs when a response wasn't served from the condition cache
+    static const int64_t NO_AGE = -1;
+
+    //! Selects how a request is answered and which tag is echoed with the answer
+    struct ResponseTag
+    {
+        //! The tag to respond with in a binary frame or TEXT_RESPONSE
+        int32_t binaryTag;
+        //! Null terminated tag echoed in a text response; empty when the request was untagged
+        char textTag[MAX_TEXT_TAG_LEN + 1];
+    };
+
+private:
+    //! Sends the given packet to the addressed player's bus, or answers it from cache
+    //! @param[in,out] packet  The packet received from the emulator
+    //! @param[in] tag  How to respond
+    //! @returns false iff the packet's sender address doesn't match any player
+    bool sendPacket(MaplePacket& packet, const ResponseTag& tag);
+
+    //! Sends the given packets together, or answers them from cache, then responds once with the
+    //! results of all of them when the last one completes
+    //! @param[in,out] packets  The packets received from the emulator
+    //! @param[in] numPackets  Number of packets in packets [1,MAX_BATCH_PACKETS]
+    //! @param[in] tag  How to respond
+    void sendBatch(MaplePacket* packets, uint32_t numPackets, const ResponseTag& tag);
+
+    //! Parses the text packets, separated by BATCH_SEPARATOR_CHAR, and sends them as a batch
+    //! @param[in] chars  The text following the command character and optional tag
+    //! @param[in] len  Number of characters in chars
+    //! @param[in] tag  How to respond
+    //! @returns false iff any of the packets is invalid, in which case none are sent
+    bool submitTextBatch(const char* chars, uint32_t len, const ResponseTag& tag);
+
+    //! Finds the player the given packet is destined for
+    //! @param[in,out] packet  The packet received from the emulator; addresses are set to the only
+    //!                        player when there is one
+    //! @returns the index of the player or -1 if no player has the packet's sender address
+    int32_t findPlayerIndex(MaplePacket& packet);
+
+    //! @param[in] idx  The index of the player the packet is destined for
+    //! @param[in] packet  The packet received from the emulator
+    //! @returns the cached device info if the given packet is a device info request and the info
+    //!          of the recipient peripheral is cached or nullptr otherwise
+    std::shared_ptr<const MaplePacket> lookupCachedDeviceInfo(uint32_t idx, const MaplePacket& packet);
+
+    //! @param[in] idx  The index of the player the packet is destined for
+    //! @param[in] packet  The packet received from the emulator
+    //! @param[out] ageUs  The age of the returned condition in microseconds
+    //! @returns the freshest cached controller condition if the given packet is a condition request
+    //!          for a connected controller and serving from cache is enabled or nullptr otherwise
+    std::shared_ptr<const MaplePacket> lookupCachedCondition(uint32_t idx,
+                                                             const MaplePacket& packet,
+                                                             uint64_t& ageUs);
+
+    //! @param[in] idx  The index of the player the packet is destined for
+    //! @param[in] packet  The packet received from the emulator
+    //! @returns the response of the local peripheral attached to the recipient sub-slot or nullptr
+    //!          if none is attached there
+    std::shared_ptr<const MaplePacket> handleLocally(uint32_t idx, const MaplePacket& packet);
+
 private:
+    //! Cached condition older than this is not served, and the request goes out on the bus instead
+    static const uint64_t MAX_CACHED_CONDITION_AGE_US = 50000;
+    //! Maximum number of words in a packet (frame word plus maximum payload)
+    static const uint32_t MAX_PACKET_WORDS = 256;
+    //! Player numbers above this are treated as invalid when resetting screen data
+    static const int32_t MAX_PLAYER_NUMBER = 255;
+
     std::shared_ptr<PrioritizedTxScheduler>* const mSchedulers;
     const uint8_t* const mSenderAddresses;
     const uint32_t mNumSenders;
     std::vector<std::shared_ptr<PlayerData>> mPlayerData;
+    //! When true, condition requests for a connected controller are answered from cache
+    bool mServeCachedCondition;
+    //! Fixed buffer each received packet is decoded into
+    uint32_t mWords[MAX_PACKET_WORDS];
+    //! Local peripherals, indexed by player index * DreamcastPeripheral::MAX_SUB_PERIPHERALS + sub-slot
+    std::vector<std::shared_ptr<MaplePacketHandler>> mLocalPeripherals;
+    //! Sub-slots answered by a local peripheral for each player index
+    std::vector<uint8_t> mLocalSubPeripheralMasks;
 };
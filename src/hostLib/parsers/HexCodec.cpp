@@ -0,0 +1,207 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "HexCodec.hpp"
+#include "hal/MapleBus/MaplePacket.hpp"
+
+#include <stdio.h>
+
+const int8_t HexDecoder::NIBBLE_LOOKUP[256] =
+{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x00
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x10
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x20
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1, // 0x30
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x40
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x50
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x60
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x70
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x80
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0x90
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0xA0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0xB0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0xC0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0xD0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 0xE0
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 // 0xF0
+};
+
+HexDecoder::HexDecoder(uint32_t* words, uint32_t maxWords) :
+    mWords(words),
+    mMaxWords(maxWords),
+    mNumWords(0),
+    mCurrentWord(0),
+    mNumNibbles(0),
+    mOverflowed(false)
+{}
+
+void HexDecoder::reset()
+{
+    mNumWords = 0;
+    mCurrentWord = 0;
+    mNumNibbles = 0;
+    mOverflowed = false;
+}
+
+void HexDecoder::feed(const char* chars, uint32_t len)
+{
+    for (const char* const end = chars + len; chars < end; ++chars)
+    {
+        int_fast8_t value = nibbleValue(*chars);
+        if (value < 0)
+        {
+            // Ignore this character
+            continue;
+        }
+
+        mCurrentWord = (mCurrentWord << 4) | static_cast<uint32_t>(value);
+        if (++mNumNibbles == 8)
+        {
+            if (mNumWords < mMaxWords)
+            {
+                mWords[mNumWords++] = mCurrentWord;
+            }
+            else
+            {
+                mOverflowed = true;
+            }
+            mCurrentWord = 0;
+            mNumNibbles = 0;
+        }
+    }
+}
+
+const char HexEncoder::HEX_DIGITS[16] =
+{
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+HexEncoder::HexEncoder() :
+    mBuffer(),
+    mLen(0)
+{}
+
+HexEncoder::~HexEncoder()
+{
+    flush();
+}
+
+void HexEncoder::putString(const char* str)
+{
+    while (*str != '\0')
+    {
+        putChar(*str++);
+    }
+}
+
+void HexEncoder::putWord(uint32_t word)
+{
+    if (mLen + 8 > sizeof(mBuffer))
+    {
+        flush();
+    }
+    char* out = &mBuffer[mLen];
+    for (int32_t shift = 28; shift >= 0; shift -= 4)
+    {
+        *out++ = HEX_DIGITS[(word >> shift) & 0x0F];
+    }
+    mLen += 8;
+}
+
+void HexEncoder::putWordBytes(uint32_t word)
+{
+    if (mLen + 12 > sizeof(mBuffer))
+    {
+        flush();
+    }
+    char* out = &mBuffer[mLen];
+    for (int32_t shift = 24; shift >= 0; shift -= 8)
+    {
+        *out++ = ' ';
+        *out++ = HEX_DIGITS[(word >> (shift + 4)) & 0x0F];
+        *out++ = HEX_DIGITS[(word >> shift) & 0x0F];
+    }
+    mLen += 12;
+}
+
+void HexEncoder::putPacketWords(const MaplePacket& packet)
+{
+    putWord(packet.frame.toWord());
+    for (std::vector<uint32_t>::const_iterator iter = packet.payload.begin();
+         iter != packet.payload.end();
+         ++iter)
+    {
+        putChar(' ');
+        putWord(*iter);
+    }
+}
+
+void HexEncoder::putPacketBytes(const MaplePacket& packet)
+{
+    putWordBytes(packet.frame.toWord());
+    for (std::vector<uint32_t>::const_iterator iter = packet.payload.begin();
+         iter != packet.payload.end();
+         ++iter)
+    {
+        putWordBytes(*iter);
+    }
+}
+
+void HexEncoder::putUnsigned(uint64_t value)
+{
+    // Digits are generated least significant first
+    char digits[20];
+    uint32_t numDigits = 0;
+    do
+    {
+        digits[numDigits++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (numDigits > 0)
+    {
+        putChar(digits[--numDigits]);
+    }
+}
+
+void HexEncoder::putSigned(int64_t value)
+{
+    if (value < 0)
+    {
+        putChar('-');
+        putUnsigned(0 - static_cast<uint64_t>(value));
+    }
+    else
+    {
+        putUnsigned(static_cast<uint64_t>(value));
+    }
+}
+
+void HexEncoder::flush()
+{
+    if (mLen > 0)
+    {
+        fwrite(mBuffer, 1, mLen, stdout);
+        mLen = 0;
+    }
+}
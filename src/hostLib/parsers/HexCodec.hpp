@@ -0,0 +1,139 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>
+
+class MaplePacket;
+
+//! Streaming decoder of hex text into a fixed buffer of words, most significant nibble first;
+//! characters which are not hex digits are ignored
+class HexDecoder
+{
+public:
+    //! Constructor
+    //! @param[out] words  Buffer to decode words into
+    //! @param[in] maxWords  Number of words which fit in words
+    HexDecoder(uint32_t* words, uint32_t maxWords);
+
+    //! Discards everything decoded so far
+    void reset();
+
+    //! Decodes the given characters, continuing any partial word from the previous call
+    //! @param[in] chars  The characters to decode
+    //! @param[in] len  Number of characters in chars
+    void feed(const char* chars, uint32_t len);
+
+    //! @returns the number of complete words decoded
+    inline uint32_t getNumWords() const
+    {
+        return mNumWords;
+    }
+
+    //! @returns true iff at least one word was decoded, no partial word is pending, and the buffer
+    //!          did not overflow
+    inline bool isComplete() const
+    {
+        return (mNumWords > 0 && mNumNibbles == 0 && !mOverflowed);
+    }
+
+    //! @returns true iff more words were given than fit in the buffer
+    inline bool isOverflowed() const
+    {
+        return mOverflowed;
+    }
+
+    //! @param[in] c  A character
+    //! @returns the value of the given hex digit or a negative value if c is not a hex digit
+    static inline int_fast8_t nibbleValue(char c)
+    {
+        return NIBBLE_LOOKUP[static_cast<uint8_t>(c)];
+    }
+
+private:
+    //! Hex digit value of each character or -1 for non-hex characters
+    static const int8_t NIBBLE_LOOKUP[256];
+
+    uint32_t* const mWords;
+    const uint32_t mMaxWords;
+    uint32_t mNumWords;
+    //! The word currently being decoded
+    uint32_t mCurrentWord;
+    //! Number of nibbles decoded into mCurrentWord
+    uint32_t mNumNibbles;
+    bool mOverflowed;
+};
+
+//! Formats text replies into a fixed buffer without varargs formatting, writing the buffer to
+//! stdout whenever it fills and on flush() or destruction; a long line reaches stdout in pieces, and
+//! the CDC driver only queues it once its newline arrives
+class HexEncoder
+{
+public:
+    HexEncoder();
+
+    //! Flushes anything left in the buffer
+    ~HexEncoder();
+
+    //! Appends a single character
+    inline void putChar(char c)
+    {
+        if (mLen >= sizeof(mBuffer))
+        {
+            flush();
+        }
+        mBuffer[mLen++] = c;
+    }
+
+    //! Appends a null terminated string
+    void putString(const char* str);
+
+    //! Appends the given word as 8 hex digits
+    void putWord(uint32_t word);
+
+    //! Appends the given word as 4 hex bytes, each preceded by a space
+    void putWordBytes(uint32_t word);
+
+    //! Appends the frame word then payload of the given packet as space-separated hex words
+    void putPacketWords(const MaplePacket& packet);
+
+    //! Appends the frame word then payload of the given packet as space-preceded hex bytes
+    void putPacketBytes(const MaplePacket& packet);
+
+    //! Appends the given value in decimal
+    void putUnsigned(uint64_t value);
+
+    //! Appends the given value in decimal
+    void putSigned(int64_t value);
+
+    //! Writes everything in the buffer to stdout
+    void flush();
+
+private:
+    //! Upper case hex digit characters
+    static const char HEX_DIGITS[16];
+
+    char mBuffer[256];
+    uint32_t mLen;
+};
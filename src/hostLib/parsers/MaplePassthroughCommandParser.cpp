@@ -23,9 +23,31 @@
 
 #include "MaplePassthroughCommandParser.hpp"
 #include "hal/MapleBus/MaplePacket.hpp"
+#include "dreamcast_constants.h"
+#include "HexCodec.hpp"
 
 #include <stdio.h>
 
+// Prints the completion message for the given transmission ID and received packet
+static void printCompletePacket(uint32_t transmissionId, const MaplePacket& packet)
+{
+    HexEncoder out;
+    out.putUnsigned(transmissionId);
+    out.putString(": complete {");
+    out.putPacketWords(packet);
+    out.putString("}\n");
+}
+
+// Prints the given failure message for the given transmission ID
+static void printFailure(uint32_t transmissionId, const char* message)
+{
+    HexEncoder out;
+    out.putUnsigned(transmissionId);
+    out.putString(": failed ");
+    out.putString(message);
+    out.putChar('\n');
+}
+
 // Simple definition of a transmitter which just echos status and received data
 class EchoTransmitter : public Transmitter
 {
@@ -37,37 +59,25 @@ public:
                           bool readFailed,
                           std::shared_ptr<const Transmission> tx) final
     {
-        if (writeFailed)
-        {
-            printf("%lu: failed write\n", (long unsigned int)tx->transmissionId);
-        }
-        else
-        {
-            printf("%lu: failed read\n", (long unsigned int)tx->transmissionId);
-        }
+        printFailure(tx->transmissionId, writeFailed ? "write" : "read");
     }
 
     virtual void txComplete(std::shared_ptr<const MaplePacket> packet,
                             std::shared_ptr<const Transmission> tx) final
     {
-        printf("%lu: complete {", (long unsigned int)tx->transmissionId);
-        printf("%08lX", (long unsigned int)packet->frame.toWord());
-        for (std::vector<uint32_t>::const_iterator iter = packet->payload.begin();
-             iter != packet->payload.end();
-             ++iter)
-        {
-            printf(" %08lX", (long unsigned int)*iter);
-        }
-        printf("}\n");
+        printCompletePacket(tx->transmissionId, *packet);
     }
 } echoTransmitter;
 
 MaplePassthroughCommandParser::MaplePassthroughCommandParser(std::shared_ptr<PrioritizedTxScheduler>* schedulers,
                                                              const uint8_t* senderAddresses,
-                                                             uint32_t numSenders) :
+                                                             uint32_t numSenders,
+                                                             const std::vector<std::shared_ptr<PlayerData>>& playerData) :
     mSchedulers(schedulers),
     mSenderAddresses(senderAddresses),
-    mNumSenders(numSenders)
+    mNumSenders(numSenders),
+    mPlayerData(playerData),
+    mWords()
 {}
 
 const char* MaplePassthroughCommandParser::getCommandChars()
@@ -76,56 +86,20 @@ const char* MaplePassthroughCommandParser::getCommandChars()
     return "0123456789ABCDEFabcdef";
 }
 
-void MaplePassthroughCommandParser::submit(const char* chars, uint32_t len)
+bool MaplePassthroughCommandParser::submit(const char* chars, uint32_t len)
 {
-    bool valid = false;
-    const char* const eol = chars + len;
-    std::vector<uint32_t> words;
-    const char* iter = chars;
-    while(iter < eol)
-    {
-        uint32_t word = 0;
-        uint32_t i = 0;
-        while (i < 8 && iter < eol)
-        {
-            char v = *iter++;
-            uint_fast8_t value = 0;
+    HexDecoder decoder(mWords, MAX_PACKET_WORDS);
+    decoder.feed(chars, len);
 
-            if (v >= '0' && v <= '9')
-            {
-                value = v - '0';
-            }
-            else if (v >= 'a' && v <= 'f')
-            {
-                value = v - 'a' + 0xa;
-            }
-            else if (v >= 'A' && v <= 'F')
-            {
-                value = v - 'A' + 0xA;
-            }
-            else
-            {
-                // Ignore this character
-                continue;
-            }
-
-            // Apply value into current word
-            word |= (value << ((8 - i) * 4 - 4));
-            ++i;
-        }
-
-        // Invalid if a partial word was given
-        valid = ((i == 8) || (i == 0));
-
-        if (i == 8)
-        {
-            words.push_back(word);
-        }
+    if (decoder.isOverflowed())
+    {
+        printFailure(0, "packet invalid");
+        return false;
     }
-
-    if (valid)
+    else if (decoder.isComplete())
     {
-        MaplePacket packet(&words[0], words.size());
+        const uint32_t numWords = decoder.getNumWords();
+        MaplePacket packet(MaplePacket::Frame::fromWord(mWords[0]), &mWords[1], numWords - 1);
         if (packet.isValid())
         {
             uint8_t sender = packet.frame.senderAddr;
@@ -142,37 +116,66 @@ void MaplePassthroughCommandParser::submit(const char* chars, uint32_t len)
 
             if (idx >= 0)
             {
-                uint32_t id = mSchedulers[idx]->add(
-                    PrioritizedTxScheduler::EXTERNAL_TRANSMISSION_PRIORITY,
-                    PrioritizedTxScheduler::TX_TIME_ASAP,
-                    &echoTransmitter,
-                    packet,
-                    true);
-                std::vector<uint32_t>::iterator iter = words.begin();
-                printf("%lu: added {%08lX", (long unsigned int)id, (long unsigned int)*iter++);
-                for(; iter < words.end(); ++iter)
+                std::shared_ptr<const MaplePacket> cached = nullptr;
+                if (packet.frame.command == COMMAND_DEVICE_INFO_REQUEST
+                    && static_cast<std::size_t>(idx) < mPlayerData.size())
+                {
+                    cached = mPlayerData[idx]->responseCache.lookupDeviceInfo(packet.frame.recipientAddr);
+                }
+
+                uint32_t id = PrioritizedTxScheduler::INVALID_TX_ID;
+                if (cached == nullptr)
+                {
+                    id = mSchedulers[idx]->add(
+                        PrioritizedTxScheduler::EXTERNAL_TRANSMISSION_PRIORITY,
+                        PrioritizedTxScheduler::TX_TIME_ASAP,
+                        &echoTransmitter,
+                        packet,
+                        true);
+                }
                 {
-                    printf(" %08lX", (long unsigned int)*iter);
+                    // Scoped so that this line is written before any completion line
+                    HexEncoder out;
+                    out.putUnsigned(id);
+                    out.putString(": added {");
+                    out.putWord(mWords[0]);
+                    for (uint32_t i = 1; i < numWords; ++i)
+                    {
+                        out.putChar(' ');
+                        out.putWord(mWords[i]);
+                    }
+                    out.putString("} -> [");
+                    out.putSigned(idx);
+                    out.putString("]\n");
                 }
-                printf("} -> [%li]\n", (long int)idx);
+
+                if (cached != nullptr)
+                {
+                    // Served from cache without touching the bus; transmission ID 0 flags this
+                    printCompletePacket(id, *cached);
+                }
+                return true;
             }
             else
             {
-                printf("0: failed invalid sender\n");
+                printFailure(0, "invalid sender");
             }
         }
         else
         {
-            printf("0: failed packet invalid\n");
+            printFailure(0, "packet invalid");
         }
     }
     else
     {
-        printf("0: failed missing data\n");
+        printFailure(0, "missing data");
     }
+
+    return false;
 }
 
 void MaplePassthroughCommandParser::printHelp()
 {
     printf("0-1 a-f A-F: the beginning of a hex value to send to maple bus without CRC\n");
+    printf("             (device info requests are answered from cache with ID 0 when possible)\n");
 }
@@ -27,6 +27,8 @@
 
 #include "PrioritizedTxScheduler.hpp"
 
+#include "PlayerData.hpp"
+
 #include <memory>
 
 // Command structure: [whitespace]<command-char>[command]<\n>
@@ -37,19 +39,26 @@ class MaplePassthroughCommandParser : public CommandParser
 public:
     MaplePassthroughCommandParser(std::shared_ptr<PrioritizedTxScheduler>* schedulers,
                                   const uint8_t* senderAddresses,
-                                  uint32_t numSenders);
+                                  uint32_t numSenders,
+                                  const std::vector<std::shared_ptr<PlayerData>>& playerData);
 
     //! @returns the string of command characters this parser handles
     virtual const char* getCommandChars() final;
 
     //! Called when newline reached; submit command and reset
-    virtual void submit(const char* chars, uint32_t len) final;
+    virtual bool submit(const char* chars, uint32_t len) final;
 
     //! Prints help message for this command
     virtual void printHelp() final;
 
 private:
+    //! Maximum number of words in a packet (frame word plus maximum payload)
+    static const uint32_t MAX_PACKET_WORDS = 256;
+
     std::shared_ptr<PrioritizedTxScheduler>* const mSchedulers;
     const uint8_t* const mSenderAddresses;
     const uint32_t mNumSenders;
+    std::vector<std::shared_ptr<PlayerData>> mPlayerData;
+    //! Fixed buffer each received packet is decoded into
+    uint32_t mWords[MAX_PACKET_WORDS];
 };
@@ -0,0 +1,415 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuTransferCommandParser.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
+
+#include <cctype>
+#include <stdio.h>
+#include <string.h>
+
+VmuTransferCommandParser::VmuTransferCommandParser(
+    const std::vector<std::shared_ptr<PlayerData>>& playerData) :
+    mPlayerData(playerData),
+    mDumpStorage(nullptr),
+    mReadMode(READ_MODE_DUMP),
+    mReadFirstBlock(0),
+    mReadLastBlock(0),
+    mDumpTag(0),
+    mDumpNextBlock(0),
+    mWriteStorage(nullptr),
+    mWriteTag(0),
+    mQueuedWrite(),
+    mBlocksRead(0),
+    mBlocksWritten(0),
+    mWriteFailures(0),
+    mWritesSkipped(0),
+    mResponse()
+{}
+
+VmuTransferCommandParser::~VmuTransferCommandParser()
+{
+    if (mDumpStorage != nullptr)
+    {
+        mDumpStorage->cancelBulk(this);
+    }
+    if (mWriteStorage != nullptr)
+    {
+        mWriteStorage->cancelBulk(this);
+    }
+}
+
+const char* VmuTransferCommandParser::getCommandChars()
+{
+    // V is reserved for VMU transfers
+    return "V";
+}
+
+bool VmuTransferCommandParser::submit(const char* chars, uint32_t len)
+{
+    const char* eol = chars + len;
+    const char* iter = chars + 1; // Skip past 'V' (implied)
+
+    while (iter < eol && std::isspace(*iter))
+    {
+        ++iter;
+    }
+    while (iter < eol && std::isspace(*(eol - 1)))
+    {
+        --eol;
+    }
+
+    if (iter < eol && !(*iter == '?' && (iter + 1) == eol))
+    {
+        printf("*failed transfers are only made through binary frames\n");
+        return false;
+    }
+
+    if (mDumpStorage != nullptr)
+    {
+        printf("*dump in progress at block %lu\n", (long unsigned int)mDumpNextBlock);
+    }
+    else
+    {
+        printf("*no dump in progress\n");
+    }
+    printf("*blocks read: %lu written: %lu unchanged: %lu write failures: %lu\n",
+           (long unsigned int)mBlocksRead,
+           (long unsigned int)mBlocksWritten,
+           (long unsigned int)mWritesSkipped,
+           (long unsigned int)mWriteFailures);
+    return true;
+}
+
+bool VmuTransferCommandParser::isBinarySupported()
+{
+    return true;
+}
+
+bool VmuTransferCommandParser::submitBinary(uint8_t tag, const uint8_t* data, uint32_t len)
+{
+    const char commandChar = getCommandChars()[0];
+
+    if (len == 0)
+    {
+        BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_INVALID_PACKET);
+        return false;
+    }
+
+    bool valid = true;
+    switch (data[0])
+    {
+        case OP_DUMP:
+            // FALL THROUGH
+        case OP_HASH:
+            valid = submitRead(tag, data, len);
+            break;
+
+        case OP_WRITE:
+            // FALL THROUGH
+        case OP_SYNC:
+            valid = submitWrite(tag, data, len);
+            break;
+
+        case OP_CANCEL:
+        {
+            if (mDumpStorage != nullptr)
+            {
+                // A write in progress is still answered
+                mDumpStorage->cancelBulkRead(this);
+                mDumpStorage = nullptr;
+                respondDumpEnd(mDumpTag, mDumpNextBlock, BinaryFrame::STATUS_FAILED_READ);
+            }
+            BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_OK);
+        }
+        break;
+
+        default:
+        {
+            BinaryFrame::writeResponse(commandChar, tag, BinaryFrame::STATUS_INVALID_PACKET);
+            valid = false;
+        }
+        break;
+    }
+
+    return valid;
+}
+
+bool VmuTransferCommandParser::submitRead(uint8_t tag, const uint8_t* data, uint32_t len)
+{
+    bool hash = (data[0] == OP_HASH);
+    if ((len != 5 && !(hash && len == 6)) || data[4] < data[3])
+    {
+        BinaryFrame::writeResponse(getCommandChars()[0], tag, BinaryFrame::STATUS_INVALID_PACKET);
+        return false;
+    }
+
+    if (mDumpStorage != nullptr)
+    {
+        respondDumpEnd(tag, data[3], BinaryFrame::STATUS_BUSY);
+        return true;
+    }
+
+    DreamcastStorage* storage = findStorage(data[1], data[2]);
+    if (storage == nullptr)
+    {
+        respondDumpEnd(tag, data[3], BinaryFrame::STATUS_INVALID_SENDER);
+        return false;
+    }
+
+    mDumpStorage = storage;
+    mReadMode = hash ? READ_MODE_HASH : READ_MODE_DUMP;
+    mReadFirstBlock = data[3];
+    mReadLastBlock = data[4];
+    mDumpTag = tag;
+    mDumpNextBlock = data[3];
+    // Blocks already read or written through this device only need their hash to be listed
+    bool unhashedOnly = hash && (len < 6 || (data[5] & HASH_FLAG_REREAD) == 0);
+    if (!storage->startBulkRead(data[3], data[4], this, unhashedOnly))
+    {
+        mDumpStorage = nullptr;
+        respondDumpEnd(tag, data[3], BinaryFrame::STATUS_BUSY);
+    }
+    return true;
+}
+
+bool VmuTransferCommandParser::submitWrite(uint8_t tag, const uint8_t* data, uint32_t len)
+{
+    if (len != (4 + BLOCK_SIZE + 2))
+    {
+        BinaryFrame::writeResponse(getCommandChars()[0], tag, BinaryFrame::STATUS_INVALID_PACKET);
+        return false;
+    }
+
+    uint8_t blockNum = data[3];
+    const uint8_t* blockData = &data[4];
+    uint16_t crc = (static_cast<uint16_t>(data[4 + BLOCK_SIZE]) << 8) | data[4 + BLOCK_SIZE + 1];
+    DreamcastStorage* storage = findStorage(data[1], data[2]);
+    if (BinaryFrame::crc16(blockData, BLOCK_SIZE) != crc)
+    {
+        respondWrite(tag, blockNum, BinaryFrame::STATUS_BAD_FRAME);
+        return false;
+    }
+    else if (storage == nullptr)
+    {
+        respondWrite(tag, blockNum, BinaryFrame::STATUS_INVALID_SENDER);
+        return false;
+    }
+
+    // A sync saves all phases of a block write when the block already holds the data
+    bool skipUnchanged = (data[0] == OP_SYNC);
+    if (mWriteStorage == nullptr)
+    {
+        mWriteStorage = storage;
+        mWriteTag = tag;
+        if (!storage->startBulkWrite(blockNum, blockData, this, skipUnchanged))
+        {
+            mWriteStorage = nullptr;
+            respondWrite(tag, blockNum, BinaryFrame::STATUS_BUSY);
+        }
+    }
+    else if (mWriteStorage == storage && !mQueuedWrite.valid)
+    {
+        // Started as soon as the write in progress finishes
+        mQueuedWrite.valid = true;
+        mQueuedWrite.tag = tag;
+        mQueuedWrite.blockNum = blockNum;
+        mQueuedWrite.skipUnchanged = skipUnchanged;
+        memcpy(mQueuedWrite.data, blockData, BLOCK_SIZE);
+    }
+    else
+    {
+        respondWrite(tag, blockNum, BinaryFrame::STATUS_BUSY);
+    }
+    return true;
+}
+
+void VmuTransferCommandParser::bulkBlockRead(uint8_t blockNum, const uint8_t* data)
+{
+    ++mBlocksRead;
+    if (mReadMode == READ_MODE_HASH)
+    {
+        // The storage keeps the hash
+        return;
+    }
+
+    uint16_t crc = BinaryFrame::crc16(data, BLOCK_SIZE);
+    mResponse[0] = RESPONSE_BLOCK;
+    mResponse[1] = blockNum;
+    memcpy(&mResponse[2], data, BLOCK_SIZE);
+    mResponse[2 + BLOCK_SIZE] = static_cast<uint8_t>(crc >> 8);
+    mResponse[2 + BLOCK_SIZE + 1] = static_cast<uint8_t>(crc);
+    if (!BinaryFrame::writeResponse(
+            getCommandChars()[0], mDumpTag, BinaryFrame::STATUS_OK, mResponse, sizeof(mResponse)))
+    {
+        // The host reads slower than the VMU; end here so that the dump has no holes, and the host
+        // may resume from this block
+        mDumpStorage->cancelBulkRead(this);
+        mDumpStorage = nullptr;
+        respondDumpEnd(mDumpTag, blockNum, BinaryFrame::STATUS_FAILED_READ);
+        return;
+    }
+
+    mDumpNextBlock = blockNum + 1;
+}
+
+void VmuTransferCommandParser::bulkReadDone(bool success, uint16_t nextBlock)
+{
+    if (success && mReadMode == READ_MODE_HASH)
+    {
+        respondHashes();
+        return;
+    }
+
+    mDumpStorage = nullptr;
+    respondDumpEnd(mDumpTag,
+                   nextBlock,
+                   success ? BinaryFrame::STATUS_OK : BinaryFrame::STATUS_FAILED_READ);
+}
+
+void VmuTransferCommandParser::bulkBlockWritten(uint8_t blockNum, bool success, bool written)
+{
+    if (success && !written)
+    {
+        ++mWritesSkipped;
+    }
+    else if (success)
+    {
+        ++mBlocksWritten;
+    }
+    else
+    {
+        ++mWriteFailures;
+    }
+    respondWrite(mWriteTag,
+                 blockNum,
+                 success ? BinaryFrame::STATUS_OK : BinaryFrame::STATUS_FAILED_WRITE,
+                 written);
+
+    if (mQueuedWrite.valid)
+    {
+        startQueuedWrite();
+    }
+    else
+    {
+        mWriteStorage = nullptr;
+    }
+}
+
+void VmuTransferCommandParser::respondHashes()
+{
+    DreamcastStorage* storage = mDumpStorage;
+    mDumpStorage = nullptr;
+
+    // Make sure every hash is still known before sending any
+    uint32_t hash = 0;
+    for (uint32_t block = mReadFirstBlock; block <= mReadLastBlock; ++block)
+    {
+        if (!storage->getBlockHash(block, hash))
+        {
+            // Written by the USB host in the meantime
+            respondDumpEnd(mDumpTag, block, BinaryFrame::STATUS_FAILED_READ);
+            return;
+        }
+    }
+
+    for (uint32_t block = mReadFirstBlock; block <= mReadLastBlock; )
+    {
+        uint32_t count = mReadLastBlock - block + 1;
+        if (count > MAX_HASHES_PER_RESPONSE)
+        {
+            count = MAX_HASHES_PER_RESPONSE;
+        }
+
+        uint8_t* ptr = mResponse;
+        *ptr++ = RESPONSE_HASHES;
+        *ptr++ = static_cast<uint8_t>(block);
+        *ptr++ = static_cast<uint8_t>(count);
+        for (uint32_t i = 0; i < count; ++i, ++block)
+        {
+            storage->getBlockHash(block, hash);
+            ptr = BinaryFrame::putWord(hash, ptr);
+        }
+        BinaryFrame::writeResponse(
+            getCommandChars()[0], mDumpTag, BinaryFrame::STATUS_OK, mResponse, ptr - mResponse);
+    }
+
+    respondDumpEnd(mDumpTag, mReadLastBlock + 1, BinaryFrame::STATUS_OK);
+}
+
+void VmuTransferCommandParser::startQueuedWrite()
+{
+    mQueuedWrite.valid = false;
+    mWriteTag = mQueuedWrite.tag;
+    if (!mWriteStorage->startBulkWrite(
+            mQueuedWrite.blockNum, mQueuedWrite.data, this, mQueuedWrite.skipUnchanged))
+    {
+        // The storage is going away or the USB host started a write in between
+        mWriteStorage = nullptr;
+        respondWrite(mQueuedWrite.tag, mQueuedWrite.blockNum, BinaryFrame::STATUS_BUSY);
+    }
+}
+
+DreamcastStorage* VmuTransferCommandParser::findStorage(uint8_t player, uint8_t slot)
+{
+    if (player >= mPlayerData.size())
+    {
+        return nullptr;
+    }
+    return mPlayerData[player]->storageRegistry.get(slot);
+}
+
+void VmuTransferCommandParser::respondWrite(uint8_t tag,
+                                            uint8_t blockNum,
+                                            uint8_t status,
+                                            bool written)
+{
+    uint8_t data[3] = {RESPONSE_ACK, blockNum, static_cast<uint8_t>(written ? 1 : 0)};
+    BinaryFrame::writeResponse(getCommandChars()[0], tag, status, data, sizeof(data));
+}
+
+void VmuTransferCommandParser::respondDumpEnd(uint8_t tag, uint16_t nextBlock, uint8_t status)
+{
+    uint8_t data[3] = {RESPONSE_END,
+                       static_cast<uint8_t>(nextBlock >> 8),
+                       static_cast<uint8_t>(nextBlock)};
+    BinaryFrame::writeResponse(getCommandChars()[0], tag, status, data, sizeof(data));
+}
+
+void VmuTransferCommandParser::printHelp()
+{
+    printf("V: VMU image transfer through binary frames (player and slot are indices)\n");
+    printf("   D<player><slot><first><last>: dump blocks; each block is answered by\n");
+    printf("      B<block><512 bytes><CRC-16 big endian> then the dump ends with\n");
+    printf("      E<next block, 2 bytes>; when FAILED_READ, dump again from next block\n");
+    printf("   H<player><slot><first><last>[<flags>]: list the FNV-1a hash of each block as\n");
+    printf("      L<first><count><32-bit hashes> then E<next block>; only blocks with no known\n");
+    printf("      hash are read unless flags bit 0 is set\n");
+    printf("   W<player><slot><block><512 bytes><CRC-16>: write block, answered by\n");
+    printf("      A<block><written>; one more block may be sent while a write is in progress,\n");
+    printf("      otherwise BUSY\n");
+    printf("   S<player><slot><block><512 bytes><CRC-16>: as W, but not written (written=0) when\n");
+    printf("      the block's known hash matches and the block read back holds the data\n");
+    printf("   C: cancel dump or hash list\n");
+    printf("   V?: print transfer status\n");
+}
@@ -0,0 +1,190 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "hal/Usb/CommandParser.hpp"
+
+#include "PlayerData.hpp"
+#include "DreamcastStorage.hpp"
+
+#include <memory>
+#include <vector>
+
+// Binary frame data: <operation><arguments...>
+//   D<player><slot><first block><last block>: dump; answered by one B frame per block then an E frame
+//   H<player><slot><first block><last block>[<flags>]: hash list; answered by L frames then an E frame
+//   W<player><slot><block><512 data bytes><CRC high><CRC low>: write a single block; answered by A
+//   S<player><slot><block><512 data bytes><CRC high><CRC low>: as W, but skipped when the block's
+//                                                             known hash matches and reading the
+//                                                             block back shows it holds the data
+//   C: cancel the dump or hash list in progress
+// Response data:
+//   B<block><512 data bytes><CRC high><CRC low>: a dumped block
+//   L<first block><count><count 32-bit hashes, most significant byte first>: block hashes
+//   E<next block high><next block low>: the dump ended; a failed dump may be resumed at next block
+//   A<block><written>: the result of a write, given by the status of the frame; written is 0 when
+//                      the block already held the data
+
+//! Command parser which streams whole VMU images to and from the host over binary frames
+class VmuTransferCommandParser : public CommandParser, public StorageBulkListener
+{
+public:
+    //! Constructor
+    //! @param[in] playerData  The data of each player, which lists the attached storage
+    VmuTransferCommandParser(const std::vector<std::shared_ptr<PlayerData>>& playerData);
+
+    //! Destructor
+    virtual ~VmuTransferCommandParser();
+
+    //! @returns the string of command characters this parser handles
+    virtual const char* getCommandChars() final;
+
+    //! Called when newline reached; submit command and reset
+    virtual bool submit(const char* chars, uint32_t len) final;
+
+    //! Prints help message for this command
+    virtual void printHelp() final;
+
+    //! @returns true since this parser handles binary frames
+    virtual bool isBinarySupported() final;
+
+    //! Called when a binary frame is received; data is the operation followed by its arguments
+    virtual bool submitBinary(uint8_t tag, const uint8_t* data, uint32_t len) final;
+
+    //! Inherited from StorageBulkListener
+    virtual void bulkBlockRead(uint8_t blockNum, const uint8_t* data) final;
+
+    //! Inherited from StorageBulkListener
+    virtual void bulkReadDone(bool success, uint16_t nextBlock) final;
+
+    //! Inherited from StorageBulkListener
+    virtual void bulkBlockWritten(uint8_t blockNum, bool success, bool written) final;
+
+    //! Operation which dumps a range of blocks
+    static const uint8_t OP_DUMP = 'D';
+    //! Operation which lists the hash of each block in a range
+    static const uint8_t OP_HASH = 'H';
+    //! Operation which writes a single block
+    static const uint8_t OP_WRITE = 'W';
+    //! Operation which writes a single block unless it already holds the data
+    static const uint8_t OP_SYNC = 'S';
+    //! Flag of OP_HASH which reads every block again instead of using hashes already known
+    static const uint8_t HASH_FLAG_REREAD = 0x01;
+    //! Operation which cancels the dump in progress
+    static const uint8_t OP_CANCEL = 'C';
+    //! Response holding a dumped block
+    static const uint8_t RESPONSE_BLOCK = 'B';
+    //! Response holding block hashes
+    static const uint8_t RESPONSE_HASHES = 'L';
+    //! Response which ends a dump or hash list
+    static const uint8_t RESPONSE_END = 'E';
+    //! Response to a write
+    static const uint8_t RESPONSE_ACK = 'A';
+    //! Number of bytes in each block transferred
+    static const uint32_t BLOCK_SIZE = 512;
+    //! Maximum number of hashes in a single RESPONSE_HASHES frame
+    static const uint32_t MAX_HASHES_PER_RESPONSE = 128;
+
+private:
+    //! @param[in] player  Player index
+    //! @param[in] slot  Sub-peripheral index of the storage
+    //! @returns the addressed storage or nullptr if none is attached
+    DreamcastStorage* findStorage(uint8_t player, uint8_t slot);
+
+    //! Handles OP_DUMP and OP_HASH
+    //! @returns false iff the request was invalid
+    bool submitRead(uint8_t tag, const uint8_t* data, uint32_t len);
+
+    //! Handles OP_WRITE and OP_SYNC
+    //! @returns false iff the request was invalid
+    bool submitWrite(uint8_t tag, const uint8_t* data, uint32_t len);
+
+    //! Sends the hash of each block in the hashed range then ends the hash list
+    void respondHashes();
+
+    //! Writes the response to a write
+    void respondWrite(uint8_t tag, uint8_t blockNum, uint8_t status, bool written = true);
+
+    //! Writes the response which ends a dump
+    void respondDumpEnd(uint8_t tag, uint16_t nextBlock, uint8_t status);
+
+    //! Starts the write of the queued block
+    void startQueuedWrite();
+
+    //! A block received from the host which waits for the write in progress
+    struct QueuedWrite
+    {
+        //! True iff this holds a block
+        bool valid;
+        //! Tag of the request
+        uint8_t tag;
+        //! The block number to write
+        uint8_t blockNum;
+        //! True iff the write is skipped when the block already holds the data
+        bool skipUnchanged;
+        //! The data to write
+        uint8_t data[BLOCK_SIZE];
+    };
+
+    //! Selects what is sent as blocks are read
+    enum ReadMode : uint8_t
+    {
+        //! Each block is sent
+        READ_MODE_DUMP = 0,
+        //! The hashes of the blocks are sent once all are read
+        READ_MODE_HASH
+    };
+
+private:
+    std::vector<std::shared_ptr<PlayerData>> mPlayerData;
+    //! The storage being dumped or nullptr
+    DreamcastStorage* mDumpStorage;
+    //! What the read in progress sends
+    ReadMode mReadMode;
+    //! The first block of the read in progress
+    uint8_t mReadFirstBlock;
+    //! The last block of the read in progress
+    uint8_t mReadLastBlock;
+    //! Tag of the dump request, echoed in each response of the dump
+    uint8_t mDumpTag;
+    //! The next block number the dump is expected to deliver
+    uint16_t mDumpNextBlock;
+    //! The storage being written or nullptr
+    DreamcastStorage* mWriteStorage;
+    //! Tag of the write in progress
+    uint8_t mWriteTag;
+    //! Block which waits for the write in progress to finish so that the host may keep one block
+    //! in flight while the previous one is committed
+    QueuedWrite mQueuedWrite;
+    //! Number of blocks dumped
+    uint32_t mBlocksRead;
+    //! Number of blocks written
+    uint32_t mBlocksWritten;
+    //! Number of blocks which failed to write
+    uint32_t mWriteFailures;
+    //! Number of blocks not written since they already held the data
+    uint32_t mWritesSkipped;
+    //! Data section of a response frame (a block with its CRC is larger than a full hash list)
+    uint8_t mResponse[2 + BLOCK_SIZE + 2];
+};
@@ -32,6 +32,8 @@ DreamcastController::DreamcastController(uint8_t addr,
                                          PlayerData playerData) :
     DreamcastPeripheral("controller", addr, fd, scheduler, playerData.playerIndex),
     mGamepad(playerData.gamepad),
+    mResponseCache(playerData.responseCache),
+    mClock(playerData.clock),
     mWaitingForData(false),
     mFirstTask(true),
     mConditionTxId(0)
@@ -41,6 +43,7 @@ DreamcastController::DreamcastController(uint8_t addr,
 
 DreamcastController::~DreamcastController()
 {
+    mResponseCache.clearCondition();
     mGamepad.controllerDisconnected();
 }
 
@@ -77,6 +80,7 @@ void DreamcastController::txComplete(std::shared_ptr<const MaplePacket> packet,
             DreamcastControllerObserver::ControllerCondition controllerCondition;
             memcpy(&controllerCondition, &packet->payload[1], 2 * sizeof(uint32_t));
             mGamepad.setControllerCondition(controllerCondition);
+            mResponseCache.setCondition(packet, mClock.getTimeUs());
         }
     }
 }
@@ -68,6 +68,10 @@ class DreamcastController : public DreamcastPeripheral
         static const uint32_t US_PER_CHECK = 16000;
         //! The gamepad to write button presses to
         DreamcastControllerObserver& mGamepad;
+        //! Cache which receives the latest condition
+        ResponseCache& mResponseCache;
+        //! Clock used to timestamp cached condition
+        ClockInterface& mClock;
         //! True iff the controller is waiting for data
         bool mWaitingForData;
         //! Initialized to true and set to false in task()
@@ -24,6 +24,8 @@
 #include "DreamcastScreen.hpp"
 #include "dreamcast_constants.h"
 
+#include <cstring>
+
 DreamcastScreen::DreamcastScreen(uint8_t addr,
                                  uint32_t fd,
                                  std::shared_ptr<EndpointTxSchedulerInterface> scheduler,
@@ -33,8 +35,12 @@ DreamcastScreen::DreamcastScreen(uint8_t addr,
     mWaitingForData(false),
     mUpdateRequired(true),
     mScreenData(playerData.screenData),
-    mTransmissionId(0)
-{}
+    mTransmissionId(0),
+    mSentFrame{}
+{
+    // A newly attached screen displays nothing that was previously written
+    mScreenData.clearLastWritten();
+}
 
 DreamcastScreen::~DreamcastScreen()
 {}
@@ -44,10 +50,20 @@ void DreamcastScreen::txComplete(std::shared_ptr<const MaplePacket> packet,
 {
     if (mWaitingForData && packet != nullptr)
     {
+        if (mTransmissionId > 0
+            && mTransmissionId == tx->transmissionId
+            && packet->frame.command == COMMAND_RESPONSE_ACK)
+        {
+            mScreenData.setLastWritten(mSentFrame);
+        }
+        else
+        {
+            // The displayed content is unknown - make sure the next screen goes out
+            mScreenData.clearLastWritten();
+        }
+
         mWaitingForData = false;
         mTransmissionId = 0;
-
-        // TODO: return code is ignored for now; in the future, try to resend on failure
     }
 }
 
@@ -66,6 +82,19 @@ void DreamcastScreen::task(uint64_t currentTimeUs)
             uint32_t payload[numPayloadWords] = {DEVICE_FN_LCD, writeAddrWord, 0};
             mScreenData.readData(&payload[2]);
 
+            // Content can only be compared when no write is in flight which could change the display
+            if (!mUpdateRequired && !mWaitingForData && mScreenData.isRedundantWrite(&payload[2]))
+            {
+                // Already displayed - cancel anything still queued since it would only be older
+                if (mTransmissionId > 0)
+                {
+                    mEndpointTxScheduler->cancelById(mTransmissionId);
+                    mTransmissionId = 0;
+                }
+                mNextCheckTime = currentTimeUs + US_PER_CHECK;
+                return;
+            }
+
             if (mTransmissionId > 0 && !mWaitingForData)
             {
                 // Make sure previous tx is canceled in case it hasn't gone out yet
@@ -80,6 +109,7 @@ void DreamcastScreen::task(uint64_t currentTimeUs)
                 numPayloadWords,
                 true,
                 0);
+            std::memcpy(mSentFrame, &payload[2], sizeof(mSentFrame));
             mNextCheckTime = currentTimeUs + US_PER_CHECK;
 
             mUpdateRequired = false;
@@ -103,6 +133,8 @@ void DreamcastScreen::txFailed(bool writeFailed,
     {
         mWaitingForData = false;
         mTransmissionId = 0;
+        // The screen may or may not have taken the data - make sure the next screen goes out
+        mScreenData.clearLastWritten();
         // TODO: in the future, try to resend on failure
     }
 }
@@ -78,4 +78,6 @@ class DreamcastScreen : public DreamcastPeripheral
         ScreenData& mScreenData;
         //! Transmission ID of the last screen
         uint32_t mTransmissionId;
+        //! The screen carried by the transmission identified by mTransmissionId
+        uint32_t mSentFrame[ScreenData::NUM_SCREEN_WORDS];
 };
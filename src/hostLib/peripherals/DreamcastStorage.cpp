@@ -37,22 +37,53 @@ DreamcastStorage::DreamcastStorage(uint8_t addr,
     mExiting(false),
     mClock(playerData.clock),
     mUsbFileSystem(playerData.fileSystem),
+    mStorageRegistry(playerData.storageRegistry),
     mFileName{},
-    mReadState(READ_WRITE_IDLE),
-    mReadingTxId(0),
-    mReadingBlock(-1),
-    mReadPacket(nullptr),
-    mReadKillTime(0),
+    mReadSlots(),
+    mReadAheadDepth(DEFAULT_READ_AHEAD_BLOCKS),
+    mLastReadBlock(-1),
+    mReadAheadHits(0),
     mWriteState(READ_WRITE_IDLE),
     mWritingTxId(0),
     mWritingBlock(0),
     mWriteBuffer(nullptr),
     mWriteBufferLen(0),
     mWriteKillTime(0),
+    mWriteTimedOut(false),
+    mWriteVerifying(false),
+    mWriteSkipped(false),
+    mWriteOwner(WRITE_OWNER_HOST),
+    mHostWriteDone(false),
+    mHostWriteResult(0),
+    mHostWriteTimedOut(false),
     mWritePhase(0),
-    mMinDurationBetweenWrites(DEFAULT_MIN_DURATION_US_BETWEEN_WRITES),
-    mLastWriteTimeUs(0)
+    mWritePacer(),
+    mLastWriteTimeUs(0),
+    mBlockCache(),
+    mFileSystem(),
+    mWriteCompareMode(WRITE_COMPARE_OFF),
+    mSkippedWrites(0),
+    mAsyncRead(),
+    mAsyncWrite(),
+    mCompareBlock(),
+    mBulkRead(),
+    mBulkWriteListener(nullptr),
+    mBulkWriteData(),
+    mWrittenElsewhere(),
+    mBlockHashes(),
+    mBlockHashValid()
 {
+    for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+    {
+        mReadSlots[i].state = READ_WRITE_IDLE;
+        mReadSlots[i].txId = 0;
+        mReadSlots[i].blockNum = 0;
+        mReadSlots[i].packet = nullptr;
+        mReadSlots[i].killTime = 0;
+        mReadSlots[i].stale = false;
+        mReadSlots[i].readAhead = false;
+    }
+
     // Memory access functionality relies on:
     // - 512 byte blocks (for UsbFile)
     // - No CRC (I'm not bothering with this computation)
@@ -77,6 +108,7 @@ DreamcastStorage::DreamcastStorage(uint8_t addr,
             }
 
             mUsbFileSystem.add(this);
+            mStorageRegistry.add(idx, this);
         }
     }
 }
@@ -86,62 +118,121 @@ DreamcastStorage::~DreamcastStorage()
     mExiting = true;
     // The following is externally serialized with any read() call
     mUsbFileSystem.remove(this);
-}
+    mStorageRegistry.remove(this);
 
-void DreamcastStorage::task(uint64_t currentTimeUs)
-{
-    switch(mReadState)
+    // Bulk transfers end here since no more responses will be received
+    if (mBulkRead.listener != nullptr)
     {
-        case READ_WRITE_STARTED:
+        StorageBulkListener* listener = mBulkRead.listener;
+        mBulkRead.listener = nullptr;
+        uint16_t nextBlock = mBulkRead.nextBlock;
+        for (uint32_t i = 0; i < MAX_BULK_READS; ++i)
         {
-            uint32_t payload[2] = {FUNCTION_CODE, mReadingBlock};
-            mReadingTxId = mEndpointTxScheduler->add(
-                PrioritizedTxScheduler::TX_TIME_ASAP,
-                this,
-                COMMAND_BLOCK_READ,
-                payload,
-                2,
-                true,
-                130);
-            mReadState = READ_WRITE_SENT;
+            if (mBulkRead.txIds[i] != 0 && mBulkRead.blockNums[i] < nextBlock)
+            {
+                nextBlock = mBulkRead.blockNums[i];
+            }
         }
-        break;
+        if (mBulkRead.failedBlock < nextBlock)
+        {
+            nextBlock = mBulkRead.failedBlock;
+        }
+        listener->bulkReadDone(false, nextBlock);
+    }
+    if (mWriteOwner == WRITE_OWNER_BULK && mWriteState != READ_WRITE_IDLE && mBulkWriteListener != nullptr)
+    {
+        StorageBulkListener* listener = mBulkWriteListener;
+        mBulkWriteListener = nullptr;
+        listener->bulkBlockWritten(mWritingBlock, false, false);
+    }
+}
 
-        case READ_WRITE_SENT:
+void DreamcastStorage::task(uint64_t currentTimeUs)
+{
+    // Schedule started reads in block order so that the block the host is waiting on goes first
+    while (true)
+    {
+        ReadSlot* nextSlot = nullptr;
+        for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
         {
-            if (currentTimeUs >= mReadKillTime)
+            ReadSlot& slot = mReadSlots[i];
+            if (slot.state == READ_WRITE_STARTED
+                && (nextSlot == nullptr || slot.blockNum < nextSlot->blockNum))
             {
-                // Timeout
-                mEndpointTxScheduler->cancelById(mReadingTxId);
-                mReadState = READ_WRITE_IDLE;
+                nextSlot = &slot;
             }
         }
-        break;
 
-        case READ_WRITE_PROCESSING:
-            // Already processing, so no need to check timeout value
-            // FALL THROUGH
-        default:
+        if (nextSlot == nullptr)
+        {
             break;
+        }
+
+        uint32_t payload[2] = {FUNCTION_CODE, nextSlot->blockNum};
+        nextSlot->txId = mEndpointTxScheduler->add(
+            PrioritizedTxScheduler::TX_TIME_ASAP,
+            this,
+            COMMAND_BLOCK_READ,
+            payload,
+            2,
+            true,
+            130);
+        nextSlot->state = READ_WRITE_SENT;
+    }
+
+    for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+    {
+        ReadSlot& slot = mReadSlots[i];
+        // Once processing, no need to check timeout value
+        if (slot.state == READ_WRITE_SENT && currentTimeUs >= slot.killTime)
+        {
+            // Timeout
+            mEndpointTxScheduler->cancelById(slot.txId);
+            slot.packet = nullptr;
+            slot.state = READ_DONE;
+        }
     }
 
     switch(mWriteState)
     {
         case READ_WRITE_STARTED:
         {
-            mWritePhase = 0;
-            mMinDurationBetweenWrites = DEFAULT_MIN_DURATION_US_BETWEEN_WRITES;
-            // Build the payload with write data
-            queueNextWritePhase();
+            if (mWriteVerifying)
+            {
+                // The hash matched, but only the data itself can show that nothing needs writing
+                uint32_t payload[2] = {FUNCTION_CODE, mWritingBlock};
+                mWritingTxId = mEndpointTxScheduler->add(
+                    PrioritizedTxScheduler::TX_TIME_ASAP,
+                    this,
+                    COMMAND_BLOCK_READ,
+                    payload,
+                    2,
+                    true,
+                    130);
+                mWriteState = READ_WRITE_SENT;
+            }
+            else
+            {
+                startWritePhases();
+            }
         }
         break;
 
         case READ_WRITE_SENT:
         {
-            if (currentTimeUs >= mWriteKillTime)
+            if (mWriteVerifying && currentTimeUs >= mWriteKillTime)
+            {
+                // Timeout before anything was written
+                mEndpointTxScheduler->cancelById(mWritingTxId);
+                mWriteVerifying = false;
+                mWriteBufferLen = -1;
+                finishWrite(false);
+            }
+            else if (currentTimeUs >= mWriteKillTime)
             {
                 // Timeout
                 mEndpointTxScheduler->cancelById(mWritingTxId);
+                mWriteTimedOut = true;
                 mWritePhase = getWriteAccesCount();
                 queueWriteCommit();
             }
@@ -157,13 +248,16 @@ void DreamcastStorage::task(uint64_t currentTimeUs)
         default:
             break;
     }
+
+    bulkReadTask();
 }
 
 void DreamcastStorage::txStarted(std::shared_ptr<const Transmission> tx)
 {
-    if (mReadState != READ_WRITE_IDLE && tx->transmissionId == mReadingTxId)
+    int32_t readIdx = findReadSlotByTxId(tx->transmissionId);
+    if (readIdx >= 0)
     {
-        mReadState = READ_WRITE_PROCESSING;
+        mReadSlots[readIdx].state = READ_WRITE_PROCESSING;
     }
     if (mWriteState != READ_WRITE_IDLE && tx->transmissionId == mWritingTxId)
     {
@@ -175,26 +269,31 @@ void DreamcastStorage::txFailed(bool writeFailed,
                                 bool readFailed,
                                 std::shared_ptr<const Transmission> tx)
 {
-    if (mReadState != READ_WRITE_IDLE && tx->transmissionId == mReadingTxId)
+    int32_t readIdx = findReadSlotByTxId(tx->transmissionId);
+    if (readIdx >= 0)
     {
         // Failure
-        mReadState = READ_WRITE_IDLE;
+        mReadSlots[readIdx].packet = nullptr;
+        mReadSlots[readIdx].state = READ_DONE;
+    }
+    int32_t bulkIdx = findBulkReadByTxId(tx->transmissionId);
+    if (bulkIdx >= 0)
+    {
+        bulkReadComplete(bulkIdx, nullptr);
     }
     if (mWriteState != READ_WRITE_IDLE && tx->transmissionId == mWritingTxId)
     {
-        // Failure
-        mLastWriteTimeUs = mClock.getTimeUs();
-        mMinDurationBetweenWrites += DURATION_US_BETWEEN_WRITES_INC;
-        if (mLastWriteTimeUs + getWriteAccesCount() * mMinDurationBetweenWrites > mWriteKillTime)
+        if (mWriteVerifying)
         {
-            mWriteBufferLen = -1;
-            mWriteState = READ_WRITE_IDLE;
+            // The block is unknown, so just write it
+            mWriteVerifying = false;
+            startWritePhases();
         }
         else
         {
-            // Try again
-            mWritePhase = 0;
-            queueNextWritePhase();
+            // Failure
+            mLastWriteTimeUs = mClock.getTimeUs();
+            handleWriteFailure();
         }
     }
 }
@@ -202,13 +301,38 @@ void DreamcastStorage::txFailed(bool writeFailed,
 void DreamcastStorage::txComplete(std::shared_ptr<const MaplePacket> packet,
                                   std::shared_ptr<const Transmission> tx)
 {
-    if (mReadState != READ_WRITE_IDLE && tx->transmissionId == mReadingTxId)
+    int32_t readIdx = findReadSlotByTxId(tx->transmissionId);
+    if (readIdx >= 0)
     {
         // Complete!
-        mReadPacket = packet;
-        mReadState = READ_WRITE_IDLE;
+        uint8_t block[VmuBlockCache::BLOCK_SIZE];
+        if (unpackBlock(*packet, block))
+        {
+            storeBlockHash(mReadSlots[readIdx].blockNum, block);
+        }
+        mReadSlots[readIdx].packet = packet;
+        mReadSlots[readIdx].state = READ_DONE;
     }
-    if (mWriteState != READ_WRITE_IDLE && tx->transmissionId == mWritingTxId)
+    int32_t bulkIdx = findBulkReadByTxId(tx->transmissionId);
+    if (bulkIdx >= 0)
+    {
+        bulkReadComplete(bulkIdx, packet);
+    }
+    if (mWriteState != READ_WRITE_IDLE && tx->transmissionId == mWritingTxId && mWriteVerifying)
+    {
+        mWriteVerifying = false;
+        uint8_t block[VmuBlockCache::BLOCK_SIZE];
+        if (unpackBlock(*packet, block) && memcmp(block, mWriteBuffer, sizeof(block)) == 0)
+        {
+            mWriteSkipped = true;
+            finishWrite(true);
+        }
+        else
+        {
+            startWritePhases();
+        }
+    }
+    else if (mWriteState != READ_WRITE_IDLE && tx->transmissionId == mWritingTxId)
     {
         mLastWriteTimeUs = mClock.getTimeUs();
         if (packet->frame.command == COMMAND_RESPONSE_ACK)
@@ -218,7 +342,11 @@ void DreamcastStorage::txComplete(std::shared_ptr<const MaplePacket> packet,
                 if (tx->packet->frame.command == COMMAND_GET_LAST_ERROR)
                 {
                     // Complete!
-                    mWriteState = READ_WRITE_IDLE;
+                    if (!mWriteTimedOut)
+                    {
+                        mWritePacer.blockSucceeded();
+                    }
+                    finishWrite(!mWriteTimedOut);
                 }
                 else
                 {
@@ -234,22 +362,71 @@ void DreamcastStorage::txComplete(std::shared_ptr<const MaplePacket> packet,
         }
         else
         {
-            mMinDurationBetweenWrites += DURATION_US_BETWEEN_WRITES_INC;
-            if (mLastWriteTimeUs + getWriteAccesCount() * mMinDurationBetweenWrites > mWriteKillTime)
-            {
-                mWriteBufferLen = -1;
-                mWriteState = READ_WRITE_IDLE;
-            }
-            else
-            {
-                // Try again
-                mWritePhase = 0;
-                queueNextWritePhase();
-            }
+            handleWriteFailure();
         }
     }
 }
 
+void DreamcastStorage::handleWriteFailure()
+{
+    mWritePacer.phaseFailed();
+    if (mLastWriteTimeUs + getWriteAccesCount() * mWritePacer.getGapUs() > mWriteKillTime)
+    {
+        mWriteBufferLen = -1;
+        finishWrite(false);
+    }
+    else
+    {
+        // Try again
+        mWritePhase = 0;
+        queueNextWritePhase();
+    }
+}
+
+void DreamcastStorage::startWritePhases()
+{
+    // Unknown until the write is committed
+    invalidateBlockHash(mWritingBlock);
+    mWritePhase = 0;
+    // Build the payload with write data
+    queueNextWritePhase();
+}
+
+void DreamcastStorage::finishWrite(bool success)
+{
+    if (success && mWriteBufferLen == static_cast<int32_t>(VmuBlockCache::BLOCK_SIZE))
+    {
+        mBlockHashes[mWritingBlock] = VmuBlockCache::hash(mWriteBuffer);
+        mBlockHashValid[mWritingBlock / 32] |= (1U << (mWritingBlock % 32));
+    }
+
+    if (mWriteOwner == WRITE_OWNER_BULK)
+    {
+        StorageBulkListener* listener = mBulkWriteListener;
+        uint8_t blockNum = mWritingBlock;
+        bool written = !mWriteSkipped;
+        mBulkWriteListener = nullptr;
+        if (written)
+        {
+            markWrittenElsewhere(blockNum);
+        }
+        mWriteState = READ_WRITE_IDLE;
+        // The listener may start the next write from here
+        if (listener != nullptr)
+        {
+            listener->bulkBlockWritten(blockNum, success, written);
+        }
+    }
+    else
+    {
+        // Saved separately since a bulk write may claim the state machine before write() polls
+        mHostWriteResult = mWriteBufferLen;
+        mHostWriteTimedOut = mWriteTimedOut;
+        mHostWriteDone = true;
+        mWriteState = READ_WRITE_IDLE;
+    }
+}
+
 void DreamcastStorage::queueNextWritePhase()
 {
     uint32_t numBlockWords = mWriteBufferLen / 4 / getWriteAccesCount();
@@ -264,7 +441,7 @@ void DreamcastStorage::queueNextWritePhase()
     }
 
     mWritingTxId = mEndpointTxScheduler->add(
-        mLastWriteTimeUs + mMinDurationBetweenWrites,
+        mLastWriteTimeUs + mWritePacer.getGapUs(),
         this,
         COMMAND_BLOCK_WRITE,
         payload,
@@ -282,7 +459,7 @@ void DreamcastStorage::queueWriteCommit()
     uint32_t payload[numPayloadWords] = {FUNCTION_CODE, mWritingBlock | ((uint32_t)mWritePhase << 16)};
 
     mWritingTxId = mEndpointTxScheduler->add(
-        mLastWriteTimeUs + mMinDurationBetweenWrites,
+        mLastWriteTimeUs + mWritePacer.getGapUs(),
         this,
         COMMAND_GET_LAST_ERROR,
         payload,
@@ -298,6 +475,19 @@ const char* DreamcastStorage::getFileName()
     return mFileName;
 }
 
+bool DreamcastStorage::getLocation(uint8_t& port, uint8_t& subSlot)
+{
+    int32_t idx = subPeripheralIndex(mAddr);
+    if (idx < 0)
+    {
+        return false;
+    }
+
+    port = mPlayerIndex;
+    subSlot = idx;
+    return true;
+}
+
 uint32_t DreamcastStorage::getFileSize()
 {
     return (128 * 1024);
@@ -313,66 +503,713 @@ int32_t DreamcastStorage::read(uint8_t blockNum,
                                uint16_t bufferLen,
                                uint32_t timeoutUs)
 {
-    assert(mReadState == READ_WRITE_IDLE);
+    // Wait for maple bus state machine to finish read
+    // I'm not too happy about this blocking operation, but it works
+    int32_t numRead = 0;
+    while ((numRead = readAsync(blockNum, buffer, bufferLen, timeoutUs)) == 0 && !mExiting);
+    return (numRead != 0) ? numRead : -1;
+}
+
+int32_t DreamcastStorage::readAsync(uint8_t blockNum,
+                                    void* buffer,
+                                    uint16_t bufferLen,
+                                    uint32_t timeoutUs)
+{
+    if (mExiting)
+    {
+        return -1;
+    }
+
+    checkWrittenElsewhere();
+
+    uint64_t currentTimeUs = mClock.getTimeUs();
+
+    if (!mAsyncRead.active || mAsyncRead.blockNum != blockNum)
+    {
+        // New request (any other pending read is abandoned and its slot reclaimed once finished)
+        bool sequential = (mLastReadBlock >= 0 && blockNum == (mLastReadBlock + 1));
+        mLastReadBlock = blockNum;
+        mAsyncRead.active = false;
+
+        if (mBlockCache.lookup(blockNum, buffer, bufferLen))
+        {
+            if (sequential)
+            {
+                queueReadAhead(blockNum, currentTimeUs);
+            }
+            return (bufferLen > VmuBlockCache::BLOCK_SIZE) ? VmuBlockCache::BLOCK_SIZE : bufferLen;
+        }
+
+        mAsyncRead.active = true;
+        mAsyncRead.blockNum = blockNum;
+        mAsyncRead.slot = findReadSlot(blockNum);
+        mAsyncRead.killTime = currentTimeUs + timeoutUs;
+        mAsyncRead.readAheadPending = sequential;
+
+        if (mAsyncRead.slot >= 0 && mReadSlots[mAsyncRead.slot].readAhead)
+        {
+            // This block was already read ahead
+            ++mReadAheadHits;
+        }
+    }
+
+    if (mAsyncRead.slot < 0)
+    {
+        // All slots may be occupied by reads ahead which are no longer needed
+        mAsyncRead.slot = acquireReadSlot(blockNum, blockNum);
+        if (mAsyncRead.slot >= 0)
+        {
+            startRead(mAsyncRead.slot, blockNum, mAsyncRead.killTime, false);
+        }
+    }
+
+    if (mAsyncRead.slot >= 0 && mAsyncRead.readAheadPending)
+    {
+        // Queued after the requested block so that it is scheduled first
+        queueReadAhead(blockNum, currentTimeUs);
+        mAsyncRead.readAheadPending = false;
+    }
+
+    if (mAsyncRead.slot >= 0 && mReadSlots[mAsyncRead.slot].state == READ_DONE)
+    {
+        mAsyncRead.active = false;
+        int32_t numRead = consumeRead(mAsyncRead.slot, buffer, bufferLen);
+        return (numRead > 0) ? numRead : -1;
+    }
+
+    if (currentTimeUs >= mAsyncRead.killTime)
+    {
+        // Timeout - the slot is reclaimed once the read finishes
+        mAsyncRead.active = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void DreamcastStorage::setReadAheadDepth(uint8_t depth)
+{
+    mReadAheadDepth = (depth > MAX_READ_AHEAD_BLOCKS) ? MAX_READ_AHEAD_BLOCKS : depth;
+}
+
+int32_t DreamcastStorage::findReadSlot(uint8_t blockNum)
+{
+    for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+    {
+        ReadSlot& slot = mReadSlots[i];
+        if (slot.state != READ_WRITE_IDLE && !slot.stale && slot.blockNum == blockNum)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int32_t DreamcastStorage::acquireReadSlot(uint32_t firstKeepBlock, uint32_t lastKeepBlock)
+{
+    int32_t reclaimIdx = -1;
+    for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+    {
+        ReadSlot& slot = mReadSlots[i];
+        ReadWriteState state = slot.state;
+        if (state == READ_WRITE_IDLE)
+        {
+            return i;
+        }
+        else if (reclaimIdx < 0
+                 && state == READ_DONE
+                 && (slot.stale || slot.blockNum < firstKeepBlock || slot.blockNum > lastKeepBlock))
+        {
+            reclaimIdx = i;
+        }
+    }
+
+    if (reclaimIdx >= 0)
+    {
+        mReadSlots[reclaimIdx].packet = nullptr;
+        mReadSlots[reclaimIdx].state = READ_WRITE_IDLE;
+    }
+
+    return reclaimIdx;
+}
+
+void DreamcastStorage::startRead(uint32_t idx, uint8_t blockNum, uint64_t killTime, bool readAhead)
+{
+    ReadSlot& slot = mReadSlots[idx];
+    assert(slot.state == READ_WRITE_IDLE);
     // Set data
-    mReadingTxId = 0;
-    mReadingBlock = blockNum;
-    mReadPacket = nullptr;
-    mReadKillTime = mClock.getTimeUs() + timeoutUs;
+    slot.txId = 0;
+    slot.blockNum = blockNum;
+    slot.packet = nullptr;
+    slot.killTime = killTime;
+    slot.stale = false;
+    slot.readAhead = readAhead;
     // Commit it
-    mReadState = READ_WRITE_STARTED;
+    slot.state = READ_WRITE_STARTED;
+}
 
-    // Wait for maple bus state machine to finish read
-    // I'm not too happy about this blocking operation, but it works
-    while(mReadState != READ_WRITE_IDLE && !mExiting);
+void DreamcastStorage::queueReadAhead(uint8_t blockNum, uint64_t currentTimeUs)
+{
+    queueReads(blockNum + 1, blockNum + mReadAheadDepth, blockNum, currentTimeUs);
+}
 
+void DreamcastStorage::queueReads(uint32_t firstBlock,
+                                  uint32_t lastBlock,
+                                  uint32_t firstKeepBlock,
+                                  uint64_t currentTimeUs)
+{
+    if (lastBlock > 0xFF)
+    {
+        lastBlock = 0xFF;
+    }
+
+    for (uint32_t aheadBlock = firstBlock; aheadBlock <= lastBlock; ++aheadBlock)
+    {
+        if (mBlockCache.peek(aheadBlock) == nullptr && findReadSlot(aheadBlock) < 0)
+        {
+            int32_t idx = acquireReadSlot(firstKeepBlock, lastBlock);
+            if (idx < 0)
+            {
+                // No more room to read ahead
+                break;
+            }
+            startRead(idx, aheadBlock, currentTimeUs + READ_AHEAD_TIMEOUT_US, true);
+        }
+    }
+}
+
+void DreamcastStorage::prefetch(uint8_t blockNum, uint8_t numBlocks)
+{
+    if (mExiting || numBlocks == 0)
+    {
+        return;
+    }
+
+    // Keep the block before the range since that is likely the one the host is waiting on
+    uint32_t firstKeepBlock = (blockNum > 0) ? (blockNum - 1) : 0;
+    queueReads(blockNum, blockNum + numBlocks - 1, firstKeepBlock, mClock.getTimeUs());
+}
+
+int32_t DreamcastStorage::consumeRead(uint32_t idx, void* buffer, uint16_t bufferLen)
+{
+    ReadSlot& slot = mReadSlots[idx];
     int32_t numRead = -1;
-    if (mReadPacket)
+    if (slot.packet)
     {
-        uint16_t copyLen = (bufferLen > (mReadPacket->payload.size() * 4)) ? (mReadPacket->payload.size() * 4) : bufferLen;
-        // Need to flip each word before copying
-        uint8_t* buffer8 = (uint8_t*)buffer;
-        for (uint32_t i = 2; i < (2U + (bufferLen / 4)); ++i)
+        // Need to flip each word before copying (first 2 payload words are function code and block)
+        uint32_t numDataWords = (slot.packet->payload.size() > 2) ? (slot.packet->payload.size() - 2) : 0;
+        if (numDataWords > (VmuBlockCache::BLOCK_SIZE / 4))
         {
-            uint32_t flippedWord = flipWordBytes(mReadPacket->payload[i]);
-            memcpy(buffer8, &flippedWord, 4);
-            buffer8 += 4;
+            numDataWords = VmuBlockCache::BLOCK_SIZE / 4;
         }
+        uint8_t block[VmuBlockCache::BLOCK_SIZE];
+        uint8_t* block8 = block;
+        for (uint32_t i = 2; i < (2U + numDataWords); ++i)
+        {
+            uint32_t flippedWord = flipWordBytes(slot.packet->payload[i]);
+            memcpy(block8, &flippedWord, 4);
+            block8 += 4;
+        }
+
+        if (slot.packet->frame.command == COMMAND_RESPONSE_DATA_XFER
+            && numDataWords == (VmuBlockCache::BLOCK_SIZE / 4))
+        {
+            mBlockCache.store(slot.blockNum, block);
+        }
+
+        uint16_t copyLen = (bufferLen > (numDataWords * 4)) ? (numDataWords * 4) : bufferLen;
+        memcpy(buffer, block, copyLen);
         numRead = copyLen;
     }
 
-    mReadPacket = nullptr;
+    slot.packet = nullptr;
+    slot.state = READ_WRITE_IDLE;
 
     return numRead;
 }
 
+int32_t DreamcastStorage::findReadSlotByTxId(uint32_t txId)
+{
+    for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+    {
+        ReadSlot& slot = mReadSlots[i];
+        ReadWriteState state = slot.state;
+        if ((state == READ_WRITE_SENT || state == READ_WRITE_PROCESSING) && slot.txId == txId)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
 int32_t DreamcastStorage::write(uint8_t blockNum,
                                 const void* buffer,
                                 uint16_t bufferLen,
                                 uint32_t timeoutUs)
 {
-    if (!isReadOnly())
+    // Wait for maple bus state machine to finish write
+    // I'm not too happy about this blocking operation, but it works
+    int32_t numWritten = 0;
+    while ((numWritten = writeAsync(blockNum, buffer, bufferLen, timeoutUs)) == 0 && !mExiting);
+    return (numWritten != 0) ? numWritten : -1;
+}
+
+int32_t DreamcastStorage::writeAsync(uint8_t blockNum,
+                                     const void* buffer,
+                                     uint16_t bufferLen,
+                                     uint32_t timeoutUs)
+{
+    if (isReadOnly() || mExiting)
     {
-        assert(mWriteState == READ_WRITE_IDLE);
+        return -1;
+    }
+
+    checkWrittenElsewhere();
+
+    if (mAsyncWrite.step == ASYNC_WRITE_WRITING
+        && mAsyncWrite.blockNum != blockNum
+        && !mHostWriteDone)
+    {
+        // The abandoned write is still sending its phases from mAsyncWrite.data, so the new data
+        // can't be copied in until it finishes (bounded by the abandoned write's timeout)
+        return 0;
+    }
+
+    if (mAsyncWrite.step == ASYNC_WRITE_IDLE || mAsyncWrite.blockNum != blockNum)
+    {
+        // New request - the data is copied since the caller's buffer isn't guaranteed to persist
         assert(bufferLen % 4 == 0);
+        if (mAsyncWrite.step == ASYNC_WRITE_WRITING)
+        {
+            // The abandoned write finished, but its result was never checked
+            mBlockCache.invalidate(mAsyncWrite.blockNum);
+        }
+        mAsyncWrite.step = ASYNC_WRITE_COMPARING;
+        mAsyncWrite.blockNum = blockNum;
+        mAsyncWrite.len = (bufferLen > VmuBlockCache::BLOCK_SIZE) ? VmuBlockCache::BLOCK_SIZE : bufferLen;
+        memcpy(mAsyncWrite.data, buffer, mAsyncWrite.len);
+        mAsyncWrite.killTime = mClock.getTimeUs() + timeoutUs;
+    }
+
+    if (mAsyncWrite.step == ASYNC_WRITE_COMPARING)
+    {
+        CompareResult result = compareAsync();
+        if (result == COMPARE_PENDING)
+        {
+            return 0;
+        }
+        else if (result == COMPARE_UNCHANGED)
+        {
+            // Nothing to write
+            mAsyncWrite.step = ASYNC_WRITE_IDLE;
+            ++mSkippedWrites;
+            return mAsyncWrite.len;
+        }
+        mAsyncWrite.step = ASYNC_WRITE_STARTING;
+    }
+
+    if (mAsyncWrite.step == ASYNC_WRITE_STARTING)
+    {
+        ReadWriteState idleState = READ_WRITE_IDLE;
+        if (!mWriteState.compare_exchange_strong(idleState, WRITE_CLAIMED))
+        {
+            // An abandoned or bulk write is still finishing up
+            if (mClock.getTimeUs() >= mAsyncWrite.killTime)
+            {
+                mAsyncWrite.step = ASYNC_WRITE_IDLE;
+                return -1;
+            }
+            return 0;
+        }
+
+        if (VmuBlockCache::isFileSystemBlock(blockNum))
+        {
+            // System, FAT or directory changed - the saves must be loaded again
+            mFileSystem.invalidate();
+        }
+
+        // Any read of this block already started may return the old data
+        for (uint32_t i = 0; i < NUM_READ_SLOTS; ++i)
+        {
+            ReadSlot& slot = mReadSlots[i];
+            if (slot.state != READ_WRITE_IDLE && slot.blockNum == blockNum)
+            {
+                slot.stale = true;
+            }
+        }
+
         // Set data
         mWritingBlock = blockNum;
-        mWriteBuffer = buffer;
-        mWriteBufferLen = bufferLen;
+        mWriteBuffer = mAsyncWrite.data;
+        mWriteBufferLen = mAsyncWrite.len;
         mWritingTxId = 0;
-        mWriteKillTime = mClock.getTimeUs() + timeoutUs;
+        mWriteKillTime = mAsyncWrite.killTime;
+        mWriteTimedOut = false;
+        mWriteVerifying = false;
+        mWriteOwner = WRITE_OWNER_HOST;
+        mHostWriteDone = false;
         // Commit it
+        mAsyncWrite.step = ASYNC_WRITE_WRITING;
         mWriteState = READ_WRITE_STARTED;
+        return 0;
+    }
+
+    if (!mHostWriteDone)
+    {
+        return 0;
+    }
+
+    mAsyncWrite.step = ASYNC_WRITE_IDLE;
+
+    if (mHostWriteResult == static_cast<int32_t>(VmuBlockCache::BLOCK_SIZE) && !mHostWriteTimedOut)
+    {
+        // Write through so subsequent reads of this block are served from cache
+        mBlockCache.store(blockNum, mAsyncWrite.data);
+    }
+    else
+    {
+        // Contents of the block on the device are now unknown
+        mBlockCache.invalidate(blockNum);
+    }
+
+    return mHostWriteResult;
+}
+
+int32_t DreamcastStorage::loadSubFilesAsync(uint32_t timeoutUs)
+{
+    if (mExiting)
+    {
+        return -1;
+    }
+    return mFileSystem.loadAsync(*this, timeoutUs);
+}
+
+uint32_t DreamcastStorage::getNumSubFiles()
+{
+    return mFileSystem.getNumFiles();
+}
+
+const char* DreamcastStorage::getSubFileName(uint32_t idx)
+{
+    return mFileSystem.getFileName(idx);
+}
+
+uint16_t DreamcastStorage::getSubFileNumBlocks(uint32_t idx)
+{
+    return mFileSystem.getFileNumBlocks(idx);
+}
+
+int32_t DreamcastStorage::getSubFileBlock(uint32_t idx, uint16_t blockIdx)
+{
+    return mFileSystem.getBlock(idx, blockIdx);
+}
 
-        // Wait for maple bus state machine to finish read
-        // I'm not too happy about this blocking operation, but it works
-        while(mWriteState != READ_WRITE_IDLE && !mExiting);
+void DreamcastStorage::setWriteCompareMode(WriteCompareMode mode)
+{
+    mWriteCompareMode = mode;
+}
 
-        return mWriteBufferLen;
+DreamcastStorage::CompareResult DreamcastStorage::compareAsync()
+{
+    if (mWriteCompareMode == WRITE_COMPARE_OFF || mAsyncWrite.len != VmuBlockCache::BLOCK_SIZE)
+    {
+        return COMPARE_CHANGED;
+    }
+
+    const uint8_t* current = mBlockCache.peek(mAsyncWrite.blockNum);
+    if (current == nullptr && mWriteCompareMode == WRITE_COMPARE_READ)
+    {
+        // A block read is much cheaper than writing all phases of a block
+        uint64_t currentTimeUs = mClock.getTimeUs();
+        uint32_t timeoutUs =
+            (mAsyncWrite.killTime > currentTimeUs) ? (mAsyncWrite.killTime - currentTimeUs) : 0;
+        int32_t numRead = readAsync(mAsyncWrite.blockNum, mCompareBlock, sizeof(mCompareBlock), timeoutUs);
+        if (numRead == 0)
+        {
+            return COMPARE_PENDING;
+        }
+        else if (numRead == static_cast<int32_t>(sizeof(mCompareBlock)))
+        {
+            current = mCompareBlock;
+        }
+    }
+
+    if (current != nullptr && memcmp(current, mAsyncWrite.data, VmuBlockCache::BLOCK_SIZE) == 0)
+    {
+        return COMPARE_UNCHANGED;
+    }
+
+    return COMPARE_CHANGED;
+}
+
+void DreamcastStorage::markWrittenElsewhere(uint8_t blockNum)
+{
+    mWrittenElsewhere[blockNum / 32].fetch_or(1U << (blockNum % 32));
+}
+
+void DreamcastStorage::checkWrittenElsewhere()
+{
+    for (uint32_t i = 0; i < (256 / 32); ++i)
+    {
+        uint32_t written = mWrittenElsewhere[i].exchange(0);
+        for (uint32_t bit = 0; written != 0; ++bit, written >>= 1)
+        {
+            if ((written & 1) == 0)
+            {
+                continue;
+            }
+
+            // This block was written underneath this core, so anything read before may be old
+            uint8_t blockNum = (i * 32) + bit;
+            mBlockCache.invalidate(blockNum);
+            if (VmuBlockCache::isFileSystemBlock(blockNum))
+            {
+                mFileSystem.invalidate();
+            }
+            for (uint32_t j = 0; j < NUM_READ_SLOTS; ++j)
+            {
+                ReadSlot& slot = mReadSlots[j];
+                if (slot.state != READ_WRITE_IDLE && slot.blockNum == blockNum)
+                {
+                    slot.stale = true;
+                    if (mAsyncRead.active && mAsyncRead.slot == static_cast<int32_t>(j))
+                    {
+                        // Read the block again rather than returning what may be the old data
+                        mAsyncRead.slot = -1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool DreamcastStorage::startBulkRead(uint8_t firstBlock,
+                                     uint8_t lastBlock,
+                                     StorageBulkListener* listener,
+                                     bool unhashedOnly)
+{
+    if (mExiting || listener == nullptr || mBulkRead.listener != nullptr || lastBlock < firstBlock)
+    {
+        return false;
+    }
+
+    mBulkRead.listener = listener;
+    mBulkRead.nextBlock = firstBlock;
+    mBulkRead.lastBlock = lastBlock;
+    mBulkRead.failedBlock = BULK_NO_FAILURE;
+    mBulkRead.unhashedOnly = unhashedOnly;
+    for (uint32_t i = 0; i < MAX_BULK_READS; ++i)
+    {
+        mBulkRead.txIds[i] = 0;
+    }
+
+    bulkReadTask();
+    return true;
+}
+
+void DreamcastStorage::bulkReadTask()
+{
+    if (mBulkRead.listener == nullptr)
+    {
+        return;
+    }
+
+    uint32_t numInFlight = 0;
+    for (uint32_t i = 0; i < MAX_BULK_READS; ++i)
+    {
+        while (mBulkRead.unhashedOnly
+               && mBulkRead.nextBlock <= mBulkRead.lastBlock
+               && isBlockHashed(mBulkRead.nextBlock))
+        {
+            ++mBulkRead.nextBlock;
+        }
+
+        if (mBulkRead.txIds[i] == 0
+            && mBulkRead.failedBlock == BULK_NO_FAILURE
+            && mBulkRead.nextBlock <= mBulkRead.lastBlock)
+        {
+            // Queued in block order, so responses arrive in block order
+            uint32_t payload[2] = {FUNCTION_CODE, mBulkRead.nextBlock};
+            mBulkRead.txIds[i] = mEndpointTxScheduler->add(
+                PrioritizedTxScheduler::TX_TIME_ASAP,
+                this,
+                COMMAND_BLOCK_READ,
+                payload,
+                2,
+                true,
+                130);
+            mBulkRead.blockNums[i] = mBulkRead.nextBlock++;
+        }
+
+        if (mBulkRead.txIds[i] != 0)
+        {
+            ++numInFlight;
+        }
+    }
+
+    if (numInFlight == 0)
+    {
+        bool success = (mBulkRead.failedBlock == BULK_NO_FAILURE);
+        uint16_t nextBlock = success ? mBulkRead.nextBlock : mBulkRead.failedBlock;
+        StorageBulkListener* listener = mBulkRead.listener;
+        // The listener may start another bulk read from here
+        mBulkRead.listener = nullptr;
+        listener->bulkReadDone(success, nextBlock);
+    }
+}
+
+void DreamcastStorage::bulkReadComplete(uint32_t idx, std::shared_ptr<const MaplePacket> packet)
+{
+    uint8_t blockNum = mBulkRead.blockNums[idx];
+    mBulkRead.txIds[idx] = 0;
+
+    if (mBulkRead.listener == nullptr || blockNum > mBulkRead.failedBlock)
+    {
+        // Cancelled, or a block before this one failed and the listener resumes from there
+        return;
+    }
+
+    uint8_t block[VmuBlockCache::BLOCK_SIZE];
+    if (packet && unpackBlock(*packet, block))
+    {
+        storeBlockHash(blockNum, block);
+        mBulkRead.listener->bulkBlockRead(blockNum, block);
+    }
+    else
+    {
+        mBulkRead.failedBlock = blockNum;
+    }
+}
+
+int32_t DreamcastStorage::findBulkReadByTxId(uint32_t txId)
+{
+    for (uint32_t i = 0; i < MAX_BULK_READS; ++i)
+    {
+        if (mBulkRead.txIds[i] != 0 && mBulkRead.txIds[i] == txId)
+        {
+            return i;
+        }
     }
     return -1;
 }
 
+bool DreamcastStorage::startBulkWrite(uint8_t blockNum,
+                                      const void* data,
+                                      StorageBulkListener* listener,
+                                      bool skipUnchanged)
+{
+    if (mExiting || isReadOnly() || listener == nullptr)
+    {
+        return false;
+    }
+
+    ReadWriteState idleState = READ_WRITE_IDLE;
+    if (!mWriteState.compare_exchange_strong(idleState, WRITE_CLAIMED))
+    {
+        return false;
+    }
+
+    memcpy(mBulkWriteData, data, sizeof(mBulkWriteData));
+    mBulkWriteListener = listener;
+    uint32_t hash = 0;
+    mWriteVerifying =
+        skipUnchanged && getBlockHash(blockNum, hash) && hash == VmuBlockCache::hash(mBulkWriteData);
+    mWriteSkipped = false;
+    if (!mWriteVerifying)
+    {
+        invalidateBlockHash(blockNum);
+    }
+    // Set data
+    mWritingBlock = blockNum;
+    mWriteBuffer = mBulkWriteData;
+    mWriteBufferLen = sizeof(mBulkWriteData);
+    mWritingTxId = 0;
+    mWriteKillTime = mClock.getTimeUs() + BULK_WRITE_TIMEOUT_US;
+    mWriteTimedOut = false;
+    mWriteOwner = WRITE_OWNER_BULK;
+    // Commit it
+    mWriteState = READ_WRITE_STARTED;
+    return true;
+}
+
+void DreamcastStorage::cancelBulk(StorageBulkListener* listener)
+{
+    cancelBulkRead(listener);
+    if (mBulkWriteListener == listener)
+    {
+        mBulkWriteListener = nullptr;
+    }
+}
+
+void DreamcastStorage::cancelBulkRead(StorageBulkListener* listener)
+{
+    if (mBulkRead.listener == listener)
+    {
+        // Reads in flight are dropped as they complete
+        mBulkRead.listener = nullptr;
+    }
+}
+
+void DreamcastStorage::storeBlockHash(uint8_t blockNum, const uint8_t* data)
+{
+    if (mWriteState != READ_WRITE_IDLE && mWritingBlock == blockNum)
+    {
+        // The data read may be from before or after the write
+        return;
+    }
+    mBlockHashes[blockNum] = VmuBlockCache::hash(data);
+    mBlockHashValid[blockNum / 32] |= (1U << (blockNum % 32));
+}
+
+void DreamcastStorage::invalidateBlockHash(uint8_t blockNum)
+{
+    mBlockHashValid[blockNum / 32] &= ~(1U << (blockNum % 32));
+}
+
+bool DreamcastStorage::getBlockHash(uint8_t blockNum, uint32_t& hash) const
+{
+    if (!isBlockHashed(blockNum))
+    {
+        return false;
+    }
+    hash = mBlockHashes[blockNum];
+    return true;
+}
+
+void DreamcastStorage::externalWriteObserved(const Transmission& tx)
+{
+    const MaplePacket& packet = *tx.packet;
+    if (tx.transmitter == this
+        || packet.payload.size() < 2
+        || packet.payload[0] != FUNCTION_CODE
+        || (packet.payload[1] & 0xFFFF) > 0xFF)
+    {
+        // Writes of this object are tracked as they are made
+        return;
+    }
+
+    uint8_t blockNum = packet.payload[1] & 0xFF;
+    invalidateBlockHash(blockNum);
+    markWrittenElsewhere(blockNum);
+}
+
+bool DreamcastStorage::unpackBlock(const MaplePacket& packet, uint8_t* block)
+{
+    if (packet.frame.command != COMMAND_RESPONSE_DATA_XFER
+        || packet.payload.size() != (2 + (VmuBlockCache::BLOCK_SIZE / 4)))
+    {
+        return false;
+    }
+
+    // First 2 payload words are function code and block
+    for (uint32_t i = 2; i < packet.payload.size(); ++i, block += 4)
+    {
+        uint32_t flippedWord = flipWordBytes(packet.payload[i]);
+        memcpy(block, &flippedWord, 4);
+    }
+    return true;
+}
+
 uint32_t DreamcastStorage::flipWordBytes(const uint32_t& word)
 {
     return (word << 24) | (word << 8 & 0xFF0000) | (word >> 8 & 0xFF00) | (word >> 24);
@@ -29,6 +29,35 @@
 #include "hal/Usb/UsbFile.hpp"
 #include "hal/Usb/UsbFileSystem.hpp"
 #include "hal/System/ClockInterface.hpp"
+#include "VmuBlockCache.hpp"
+#include "VmuFileSystem.hpp"
+#include "VmuWritePacer.hpp"
+
+//! Receives the results of bulk transfers started on a DreamcastStorage (called from the core which
+//! operates maple bus)
+class StorageBulkListener
+{
+    public:
+        //! Virtual destructor
+        virtual ~StorageBulkListener() {}
+
+        //! Called for each block read by a bulk read, in block order
+        //! @param[in] blockNum  The block number read
+        //! @param[in] data  The 512 bytes of the block
+        virtual void bulkBlockRead(uint8_t blockNum, const uint8_t* data) = 0;
+
+        //! Called once a bulk read ends
+        //! @param[in] success  true iff every block in the range was read
+        //! @param[in] nextBlock  The first block which wasn't passed to bulkBlockRead(); a failed
+        //!                       read may be resumed from here
+        virtual void bulkReadDone(bool success, uint16_t nextBlock) = 0;
+
+        //! Called once a block passed to DreamcastStorage::startBulkWrite() is committed or fails
+        //! @param[in] blockNum  The block number written
+        //! @param[in] success  true iff the block holds the data
+        //! @param[in] written  false when the block already held the data and wasn't written
+        virtual void bulkBlockWritten(uint8_t blockNum, bool success, bool written) = 0;
+};
 
 //! Handles communication with the Dreamcast storage peripheral
 class DreamcastStorage : public DreamcastPeripheral, UsbFile
@@ -46,7 +75,22 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
             //! Write commit message was sent
             WRITE_COMMIT_SENT,
             //! The Maple Bus state machine is currently processing r/w
-            READ_WRITE_PROCESSING
+            READ_WRITE_PROCESSING,
+            //! Read has finished (packet is set on success), waiting for read() to consume it
+            READ_DONE,
+            //! The write state machine has been claimed, and the write is being set up
+            WRITE_CLAIMED
+        };
+
+        //! Selects how write() checks whether a block already holds the data being written
+        enum WriteCompareMode : uint8_t
+        {
+            //! Always write
+            WRITE_COMPARE_OFF = 0,
+            //! Skip the write if the cached copy of the block matches
+            WRITE_COMPARE_CACHED,
+            //! Skip the write if the cached or a freshly read copy of the block matches
+            WRITE_COMPARE_READ
         };
 
         //! Constructor
@@ -89,7 +133,15 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
         //! @returns true iff this file is read only
         virtual bool isReadOnly() final;
 
-        //! Blocking read (must only be called from the core not operating maple bus)
+        //! Retrieves the controller port and sub-peripheral slot of this memory unit
+        //! @param[out] port  The controller port index
+        //! @param[out] subSlot  The sub-peripheral slot index
+        //! @returns true iff the location is known
+        virtual bool getLocation(uint8_t& port, uint8_t& subSlot) final;
+
+        //! Blocking read (must only be called from the core not operating maple bus); blocks held in
+        //! the block cache are returned without a Maple Bus round trip, and sequential reads keep
+        //! the next few blocks queued ahead of the host
         //! @param[in] blockNum  Block number to read (block is 512 bytes)
         //! @param[out] buffer  Buffer output
         //! @param[in] bufferLen  The length of buffer (but only up to 512 bytes will be written)
@@ -102,7 +154,9 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
                              uint16_t bufferLen,
                              uint32_t timeoutUs) final;
 
-        //! Blocking write (must only be called from the core not operating maple bus)
+        //! Blocking write (must only be called from the core not operating maple bus); when enabled
+        //! through setWriteCompareMode(), a block which already holds the given data completes
+        //! without being written
         //! @param[in] blockNum  Block number to write (block is 512 bytes)
         //! @param[in] buffer  Buffer
         //! @param[in] bufferLen  The length of buffer (but only up to 512 bytes will be written)
@@ -115,6 +169,116 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
                               uint16_t bufferLen,
                               uint32_t timeoutUs) final;
 
+        //! Non-blocking read (must only be called from the core not operating maple bus)
+        //! @param[in] blockNum  Block number to read (block is 512 bytes)
+        //! @param[out] buffer  Buffer output
+        //! @param[in] bufferLen  The length of buffer (but only up to 512 bytes will be written)
+        //! @param[in] timeoutUs  Timeout in microseconds
+        //! @returns Positive value indicating how many bytes were read
+        //! @returns Zero if the read is still in progress
+        //! @returns Negative value if read failure occurred or timeout elapsed
+        virtual int32_t readAsync(uint8_t blockNum,
+                                  void* buffer,
+                                  uint16_t bufferLen,
+                                  uint32_t timeoutUs) final;
+
+        //! Non-blocking write (must only be called from the core not operating maple bus)
+        //! @param[in] blockNum  Block number to write (block is 512 bytes)
+        //! @param[in] buffer  Buffer
+        //! @param[in] bufferLen  The length of buffer (but only up to 512 bytes will be written)
+        //! @param[in] timeoutUs  Timeout in microseconds
+        //! @returns Positive value indicating how many bytes were written
+        //! @returns Zero if the write is still in progress
+        //! @returns Negative value if write failure occurred or timeout elapsed
+        virtual int32_t writeAsync(uint8_t blockNum,
+                                   const void* buffer,
+                                   uint16_t bufferLen,
+                                   uint32_t timeoutUs) final;
+
+        //! Starts reads of the given blocks together so that a multi-block host transfer doesn't wait
+        //! on each block in turn; limited by the number of free read slots (must only be called from
+        //! the core not operating maple bus)
+        //! @param[in] blockNum  The first block number to be read
+        //! @param[in] numBlocks  The number of blocks to be read
+        virtual void prefetch(uint8_t blockNum, uint8_t numBlocks) final;
+
+        //! Non-blocking load of the saves on this VMU (must only be called from the core not
+        //! operating maple bus)
+        //! @param[in] timeoutUs  Timeout in microseconds for each block read
+        //! @returns Positive value once the list is loaded
+        //! @returns Zero while the load is in progress
+        //! @returns Negative value if the VMU isn't formatted or a read failed
+        virtual int32_t loadSubFilesAsync(uint32_t timeoutUs) final;
+
+        //! @returns the number of saves on this VMU (once loadSubFilesAsync() succeeds)
+        virtual uint32_t getNumSubFiles() final;
+
+        //! @param[in] idx  Index of the save
+        //! @returns the null terminated name of the save or nullptr if idx is invalid
+        virtual const char* getSubFileName(uint32_t idx) final;
+
+        //! @param[in] idx  Index of the save
+        //! @returns the number of blocks in the save
+        virtual uint16_t getSubFileNumBlocks(uint32_t idx) final;
+
+        //! @param[in] idx  Index of the save
+        //! @param[in] blockIdx  The index of the block within the save
+        //! @returns the VMU block number which holds the given block or -1 if invalid
+        virtual int32_t getSubFileBlock(uint32_t idx, uint16_t blockIdx) final;
+
+        //! Starts reading the given range of blocks, keeping up to MAX_BULK_READS reads in flight
+        //! (must only be called from the core operating maple bus)
+        //! @param[in] firstBlock  The first block number to read
+        //! @param[in] lastBlock  The last block number to read
+        //! @param[in] listener  Receives each block then the result once the read ends
+        //! @param[in] unhashedOnly  When true, blocks with a known hash (see getBlockHash()) are
+        //!                          skipped
+        //! @returns false if a bulk read is already in progress or the range is invalid
+        bool startBulkRead(uint8_t firstBlock,
+                           uint8_t lastBlock,
+                           StorageBulkListener* listener,
+                           bool unhashedOnly = false);
+
+        //! Starts writing a single block on behalf of a bulk transfer; the result is passed to
+        //! listener (must only be called from the core operating maple bus)
+        //! @param[in] blockNum  Block number to write
+        //! @param[in] data  The 512 bytes to write (copied)
+        //! @param[in] listener  Receives the result of the write
+        //! @param[in] skipUnchanged  When true and the known hash of the block matches the data, the
+        //!                           block is read back and the write is skipped if it holds the data
+        //! @returns false if another write is in progress; try again once it finishes
+        bool startBulkWrite(uint8_t blockNum,
+                            const void* data,
+                            StorageBulkListener* listener,
+                            bool skipUnchanged = false);
+
+        //! Stops notifying the given listener; a bulk read in progress is stopped, and a bulk write
+        //! in progress completes silently (must only be called from the core operating maple bus)
+        //! @param[in] listener  The listener which is going away
+        void cancelBulk(StorageBulkListener* listener);
+
+        //! Stops the bulk read of the given listener without notifying it; a bulk write in progress
+        //! is still reported (must only be called from the core operating maple bus)
+        //! @param[in] listener  The listener of the bulk read
+        void cancelBulkRead(StorageBulkListener* listener);
+
+        //! @returns true iff a bulk read is in progress
+        bool isBulkReadActive() const { return mBulkRead.listener != nullptr; }
+
+        //! Gets the hash (see VmuBlockCache::hash()) of a block as last read from or written to the
+        //! device through this object (must only be called from the core operating maple bus)
+        //! @param[in] blockNum  The block number
+        //! @param[out] hash  Set to the hash of the block when known
+        //! @returns true iff the hash of the block is known
+        bool getBlockHash(uint8_t blockNum, uint32_t& hash) const;
+
+        //! Drops anything known about a block which another transmitter (such as a flycast or
+        //! passthrough client) wrote to this device; the block's hash is forgotten immediately, and
+        //! cached data is dropped on the next read() or write() (must only be called from the core
+        //! operating maple bus)
+        //! @param[in] tx  A finished or failed BLOCK_WRITE or GET_LAST_ERROR addressed to this device
+        void externalWriteObserved(const Transmission& tx);
+
         //! @returns number of partitions on this device
         uint16_t getNumberOfPartitions() { return (mFd >> 24) + 1; }
         //! @returns the number of bytes per block of data
@@ -128,7 +292,192 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
         //! @returns true iff CRC calculation is required for reads and writes
         bool isCrcRequired() { return ((mFd >> 6) & 0x01) != 0; }
 
+        //! @returns the number of block reads which were served from the block cache
+        uint32_t getCacheHits() const { return mBlockCache.getHits(); }
+        //! @returns the number of block reads which required a Maple Bus round trip
+        uint32_t getCacheMisses() const { return mBlockCache.getMisses(); }
+        //! @returns the number of block reads which were served by a read-ahead
+        uint32_t getReadAheadHits() const { return mReadAheadHits; }
+
+        //! @returns the pacer which selects the duration between write phases of this device
+        const VmuWritePacer& getWritePacer() const { return mWritePacer; }
+
+        //! @returns the number of block writes skipped because the block was unchanged
+        uint32_t getSkippedWrites() const { return mSkippedWrites; }
+
+        //! Sets how write() checks for unchanged blocks (must only be called from the core not
+        //! operating maple bus)
+        //! @param[in] mode  The compare mode to use (WRITE_COMPARE_OFF by default)
+        void setWriteCompareMode(WriteCompareMode mode);
+
+        //! Sets how many blocks are read ahead once sequential reads are detected (must only be
+        //! called from the core not operating maple bus)
+        //! @param[in] depth  Number of blocks to read ahead (0 disables; limited to
+        //!                   MAX_READ_AHEAD_BLOCKS)
+        void setReadAheadDepth(uint8_t depth);
+
     private:
+        //! A single block read which is either being waited on or was read ahead
+        struct ReadSlot
+        {
+            //! The current state of this read
+            //! When READ_WRITE_IDLE or READ_DONE: read() can read and write the data below
+            //! Otherwise: peripheral callbacks can read and write the data below
+            std::atomic<ReadWriteState> state;
+            //! Transmission ID of the read operation sent (or 0)
+            uint32_t txId;
+            //! The block number being read (only written by read())
+            uint8_t blockNum;
+            //! Packet filled in as a result of the read operation
+            std::shared_ptr<const MaplePacket> packet;
+            //! Time at which read must be killed
+            uint64_t killTime;
+            //! Set by write() when the block was written after this read was started
+            bool stale;
+            //! True iff this read was started ahead of the host requesting it
+            bool readAhead;
+        };
+
+        //! @param[in] blockNum  The block number to look for
+        //! @returns index of the read slot started for the given block or -1 if none
+        int32_t findReadSlot(uint8_t blockNum);
+
+        //! Finds a free read slot, reclaiming finished reads outside of the given range of blocks
+        //! @param[in] firstKeepBlock  The first block of finished reads to keep
+        //! @param[in] lastKeepBlock  The last block of finished reads to keep
+        //! @returns index of a free read slot or -1 if all are in use
+        int32_t acquireReadSlot(uint32_t firstKeepBlock, uint32_t lastKeepBlock);
+
+        //! Hands a read slot over to task() to be scheduled
+        //! @param[in] idx  Index of the free read slot to use
+        //! @param[in] blockNum  Block number to read
+        //! @param[in] killTime  Time at which read must be killed
+        //! @param[in] readAhead  True iff this read is started ahead of the host requesting it
+        void startRead(uint32_t idx, uint8_t blockNum, uint64_t killTime, bool readAhead);
+
+        //! Starts reads of the blocks following the given block which aren't cached or started
+        //! @param[in] blockNum  The block number just requested by the host
+        //! @param[in] currentTimeUs  The current time
+        void queueReadAhead(uint8_t blockNum, uint64_t currentTimeUs);
+
+        //! Starts reads of the blocks in the given range which aren't cached or started
+        //! @param[in] firstBlock  The first block number to read
+        //! @param[in] lastBlock  The last block number to read (limited to 255)
+        //! @param[in] firstKeepBlock  The first block of finished reads to keep when reclaiming slots
+        //! @param[in] currentTimeUs  The current time
+        void queueReads(uint32_t firstBlock,
+                        uint32_t lastBlock,
+                        uint32_t firstKeepBlock,
+                        uint64_t currentTimeUs);
+
+        //! Copies the result of a finished read into buffer and the block cache then frees the slot
+        //! @param[in] idx  Index of the finished read slot
+        //! @param[out] buffer  Buffer output
+        //! @param[in] bufferLen  The length of buffer
+        //! @returns the number of bytes read or -1 on failure
+        int32_t consumeRead(uint32_t idx, void* buffer, uint16_t bufferLen);
+
+        //! Result of comparing the data of the pending asynchronous write with the device
+        enum CompareResult : uint8_t
+        {
+            //! A comparison read is still in progress
+            COMPARE_PENDING = 0,
+            //! The block already holds the data
+            COMPARE_UNCHANGED,
+            //! The block differs or its contents are unknown
+            COMPARE_CHANGED
+        };
+
+        //! Steps of an asynchronous write
+        enum AsyncWriteStep : uint8_t
+        {
+            //! No asynchronous write in progress
+            ASYNC_WRITE_IDLE = 0,
+            //! Checking whether the block already holds the data
+            ASYNC_WRITE_COMPARING,
+            //! Waiting for the write state machine to become available
+            ASYNC_WRITE_STARTING,
+            //! Waiting for the write state machine to finish
+            ASYNC_WRITE_WRITING
+        };
+
+        //! State of the asynchronous read requested through readAsync()
+        struct AsyncRead
+        {
+            //! True iff a read is in progress
+            bool active;
+            //! The block number requested
+            uint8_t blockNum;
+            //! Index of the read slot for this block or -1 if none acquired yet
+            int32_t slot;
+            //! Time at which the request fails
+            uint64_t killTime;
+            //! True when read-ahead is to be queued once the requested block has a slot
+            bool readAheadPending;
+        };
+
+        //! State of the asynchronous write requested through writeAsync()
+        struct AsyncWrite
+        {
+            //! The current step
+            AsyncWriteStep step;
+            //! The block number requested
+            uint8_t blockNum;
+            //! Number of bytes in data
+            uint16_t len;
+            //! Time at which the request fails
+            uint64_t killTime;
+            //! Copy of the data to write
+            uint8_t data[VmuBlockCache::BLOCK_SIZE];
+        };
+
+        //! Selects who started the current write
+        enum WriteOwner : uint8_t
+        {
+            //! Started by write() or writeAsync()
+            WRITE_OWNER_HOST = 0,
+            //! Started by startBulkWrite()
+            WRITE_OWNER_BULK
+        };
+
+        //! Maximum number of block reads of a bulk read queued at once
+        static const uint32_t MAX_BULK_READS = 4;
+        //! Value of BulkRead::failedBlock when no read failed
+        static const uint16_t BULK_NO_FAILURE = 0xFFFF;
+
+        //! State of the bulk read started through startBulkRead()
+        struct BulkRead
+        {
+            //! Receives the results or nullptr when no bulk read is in progress
+            StorageBulkListener* listener;
+            //! The next block number to schedule
+            uint16_t nextBlock;
+            //! The last block number to read
+            uint16_t lastBlock;
+            //! The lowest block number which failed or BULK_NO_FAILURE
+            uint16_t failedBlock;
+            //! When true, blocks with a known hash are skipped
+            bool unhashedOnly;
+            //! Transmission IDs of reads in flight (0 when unused)
+            uint32_t txIds[MAX_BULK_READS];
+            //! Block numbers of reads in flight
+            uint8_t blockNums[MAX_BULK_READS];
+        };
+
+        //! Compares the pending asynchronous write against the cached or a freshly read block
+        //! @returns the result of the comparison
+        CompareResult compareAsync();
+
+        //! @param[in] txId  A transmission ID
+        //! @returns index of the read slot waiting on the given transmission or -1 if none
+        int32_t findReadSlotByTxId(uint32_t txId);
+
+        //! Copies the data of a full block read response into block
+        //! @param[in] packet  The response to a block read
+        //! @param[out] block  Buffer of 512 bytes
+        //! @returns false if the packet doesn't hold a full block
+        static bool unpackBlock(const MaplePacket& packet, uint8_t* block);
+
         //! Flips the endianness of a word
         //! @param[in] word  Input word
         //! @returns output word
@@ -140,13 +489,63 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
         //! Queues transmission which commits the written set of data
         void queueWriteCommit();
 
+        //! Backs off after a write phase or commit failed then either retries the block or gives up
+        void handleWriteFailure();
+
+        //! Sends the first write phase of the current write
+        void startWritePhases();
+
+        //! Releases the write state machine and passes the result to whoever started the write
+        //! @param[in] success  true iff the block was written
+        void finishWrite(bool success);
+
+        //! Schedules the next reads of the bulk read in progress and reports once it ends
+        void bulkReadTask();
+
+        //! Passes the result of a bulk read transmission to the listener
+        //! @param[in] idx  Index into mBulkRead.txIds of the transmission
+        //! @param[in] packet  The response or nullptr on failure
+        void bulkReadComplete(uint32_t idx, std::shared_ptr<const MaplePacket> packet);
+
+        //! Records the hash of a block just read unless a write to it is in progress
+        //! @param[in] blockNum  The block number read
+        //! @param[in] data  512 bytes of block data
+        void storeBlockHash(uint8_t blockNum, const uint8_t* data);
+
+        //! Forgets the hash of a block
+        //! @param[in] blockNum  The block number
+        void invalidateBlockHash(uint8_t blockNum);
+
+        //! @param[in] blockNum  The block number
+        //! @returns true iff the hash of the given block is known
+        bool isBlockHashed(uint8_t blockNum) const
+        {
+            return ((mBlockHashValid[blockNum / 32] >> (blockNum % 32)) & 0x01) != 0;
+        }
+
+        //! @param[in] txId  A transmission ID
+        //! @returns index into mBulkRead.txIds of the given transmission or -1 if none
+        int32_t findBulkReadByTxId(uint32_t txId);
+
+        //! Flags a block written other than through write() so that the other core drops its data
+        //! @param[in] blockNum  The block number
+        void markWrittenElsewhere(uint8_t blockNum);
+
+        //! Drops cached data of blocks written other than through write() (must only be called from
+        //! the core not operating maple bus)
+        void checkWrittenElsewhere();
+
     public:
         //! Function code for storage
         static const uint32_t FUNCTION_CODE = DEVICE_FN_STORAGE;
-        //! The minimum duration between writes
-        static const uint32_t DEFAULT_MIN_DURATION_US_BETWEEN_WRITES = 10000;
-        //! Amount of time to increment time between writes after failure
-        static const uint32_t DURATION_US_BETWEEN_WRITES_INC = 5000;
+        //! Maximum number of blocks which may be read ahead of the host
+        static const uint8_t MAX_READ_AHEAD_BLOCKS = 4;
+        //! Default number of blocks to read ahead of the host
+        static const uint8_t DEFAULT_READ_AHEAD_BLOCKS = MAX_READ_AHEAD_BLOCKS;
+        //! Timeout of reads started ahead of the host
+        static const uint32_t READ_AHEAD_TIMEOUT_US = 250000;
+        //! Timeout of each block written through startBulkWrite()
+        static const uint32_t BULK_WRITE_TIMEOUT_US = 1000000;
 
     private:
         //! Initialized false and set to true when destructor called
@@ -155,22 +554,21 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
         ClockInterface& mClock;
         //! Reference to a file system where this object may be added to
         UsbFileSystem& mUsbFileSystem;
+        //! Reference to the registry of the player's storage where this object may be added to
+        StorageRegistry& mStorageRegistry;
         //! File name for this storage device
         char mFileName[12];
 
-        //! The current state in the read state machine
-        //! When READ_WRITE_IDLE: read() can read and write the data below
-        //! Otherwise: peripheral callbacks can read and write the data below
-        std::atomic<ReadWriteState> mReadState;
-
-        //! Transmission ID of the read operation sent (or 0)
-        uint32_t mReadingTxId;
-        //! The block number of the current read operation
-        uint8_t mReadingBlock;
-        //! Packet filled in as a result of a read operation
-        std::shared_ptr<const MaplePacket> mReadPacket;
-        //! Time at which read must be killed
-        uint64_t mReadKillTime;
+        //! Number of read slots (one for the block being waited on plus read-ahead blocks)
+        static const uint32_t NUM_READ_SLOTS = MAX_READ_AHEAD_BLOCKS + 1;
+        //! Block reads which are in progress or waiting to be consumed
+        ReadSlot mReadSlots[NUM_READ_SLOTS];
+        //! Number of blocks to read ahead once sequential reads are detected
+        uint8_t mReadAheadDepth;
+        //! The last block number requested through read() or -1 if none
+        int16_t mLastReadBlock;
+        //! Number of block reads served by a read-ahead
+        uint32_t mReadAheadHits;
 
         //! The current state in the write state machine
         //! When READ_WRITE_IDLE: write() can read and write the data below
@@ -187,11 +585,55 @@ class DreamcastStorage : public DreamcastPeripheral, UsbFile
         int32_t mWriteBufferLen;
         //! Time at which write must be killed
         uint64_t mWriteKillTime;
+        //! Set when the current write timed out and was committed early
+        bool mWriteTimedOut;
+        //! Set while the block of the current write is read back to see if it already holds the data
+        bool mWriteVerifying;
+        //! Set when the current write was skipped since the block already held the data
+        bool mWriteSkipped;
+        //! Selects who is notified once the current write finishes
+        WriteOwner mWriteOwner;
+        //! Set by the maple bus core once a write started by write() finishes
+        std::atomic<bool> mHostWriteDone;
+        //! Result of the last write started by write() (bytes written or negative on failure)
+        int32_t mHostWriteResult;
+        //! Set when the last write started by write() timed out
+        bool mHostWriteTimedOut;
 
         //! The current write phase
         uint8_t mWritePhase;
-        //! Current minimum duration between writes
-        uint32_t mMinDurationBetweenWrites;
+        //! Selects the minimum duration between writes (persists across blocks)
+        VmuWritePacer mWritePacer;
         //! The last time write was completed
         uint64_t mLastWriteTimeUs;
+
+        //! Cache of blocks read from or written to this device (only accessed by read() and write())
+        //! Since this object is destroyed on disconnect, the cache never outlives the device
+        VmuBlockCache mBlockCache;
+        //! The saves on this device (only accessed by the core which executes read() and write())
+        VmuFileSystem mFileSystem;
+        //! How write() checks for unchanged blocks
+        WriteCompareMode mWriteCompareMode;
+        //! Number of block writes skipped because the block was unchanged
+        uint32_t mSkippedWrites;
+        //! State of readAsync()
+        AsyncRead mAsyncRead;
+        //! State of writeAsync()
+        AsyncWrite mAsyncWrite;
+        //! Buffer which blocks are read into for comparison before writing
+        uint8_t mCompareBlock[VmuBlockCache::BLOCK_SIZE];
+
+        //! State of the bulk read (only accessed by the core operating maple bus)
+        BulkRead mBulkRead;
+        //! Receives the result of the bulk write in progress or nullptr
+        StorageBulkListener* mBulkWriteListener;
+        //! Copy of the data of the bulk write in progress
+        uint8_t mBulkWriteData[VmuBlockCache::BLOCK_SIZE];
+        //! One bit per block, set by the core operating maple bus once a block was written by a bulk
+        //! transfer or another transmitter so that the other core drops data it cached
+        std::atomic<uint32_t> mWrittenElsewhere[256 / 32];
+        //! Hash of each block as last read or written (only accessed by the core operating maple bus)
+        uint32_t mBlockHashes[256];
+        //! One bit per block, set when the block's entry in mBlockHashes is valid
+        uint32_t mBlockHashValid[256 / 32];
 };
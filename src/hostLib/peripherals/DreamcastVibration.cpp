@@ -78,7 +78,14 @@ DreamcastVibration::DreamcastVibration(uint8_t addr,
                                        PlayerData playerData) :
     DreamcastPeripheral("vibration", addr, fd, scheduler, playerData.playerIndex),
     mTransmissionId(0),
-    mFirst(true)
+    mFirst(true),
+    mEffectCompiler(),
+    mEffectTransmissionIds{},
+    mEffectCommands{},
+    mNumEffectTransmissions(0),
+    mRumbleSlot(playerData.rumbleSlot),
+    mRumbleTransmissionId(0),
+    mRumbleReceivedTimeUs(0)
 {
 }
 
@@ -92,12 +99,37 @@ void DreamcastVibration::task(uint64_t currentTimeUs)
         mFirst = false;
 
         // Send some vibrations on connection
-        send(currentTimeUs, 5, 0, 0, 250);
+        static const RumbleEnvelope connectionEffect = {5, 0, 250, 0};
+        play(currentTimeUs, &connectionEffect, 1);
+    }
+
+    // Play the latest request from the USB host, replacing whatever hasn't been sent yet
+    RumbleEnvelope envelope;
+    uint64_t receivedTimeUs = 0;
+    if (mRumbleSlot.take(envelope, receivedTimeUs))
+    {
+        mRumbleTransmissionId = 0;
+        if (envelope.intensity == 0)
+        {
+            stop();
+            mRumbleTransmissionId = mTransmissionId;
+        }
+        else if (play(currentTimeUs, &envelope, 1) && mNumEffectTransmissions > 0)
+        {
+            mRumbleTransmissionId = mEffectTransmissionIds[0];
+        }
+        mRumbleReceivedTimeUs = receivedTimeUs;
     }
 }
 
 void DreamcastVibration::txStarted(std::shared_ptr<const Transmission> tx)
 {
+    if (mRumbleTransmissionId > 0 && tx->transmissionId == mRumbleTransmissionId)
+    {
+        mRumbleSlot.recordSent(mRumbleReceivedTimeUs);
+        mRumbleTransmissionId = 0;
+    }
+
     if (tx->transmissionId == mTransmissionId)
     {
         mTransmissionId = 0;
@@ -108,11 +140,22 @@ void DreamcastVibration::txFailed(bool writeFailed,
                                   bool readFailed,
                                   std::shared_ptr<const Transmission> tx)
 {
+    if (tx->packet->frame.command == COMMAND_BLOCK_WRITE)
+    {
+        // Auto-stop time may not have been set
+        mEffectCompiler.forgetAutoStop();
+    }
 }
 
 void DreamcastVibration::txComplete(std::shared_ptr<const MaplePacket> packet,
                                     std::shared_ptr<const Transmission> tx)
 {
+    if (tx->packet->frame.command == COMMAND_BLOCK_WRITE
+        && (packet == nullptr || packet->frame.command != COMMAND_RESPONSE_ACK))
+    {
+        // Auto-stop time was not set
+        mEffectCompiler.forgetAutoStop();
+    }
 }
 
 uint8_t DreamcastVibration::computeNumIncrements(uint8_t power, int8_t inclination)
@@ -172,8 +215,8 @@ void DreamcastVibration::send(uint64_t timeUs, uint8_t power, int8_t inclination
     // Byte 3: 10 or 11
     //         - Most sig nibble must be 1 for the command to be accepted
     //         - Least sig nibble must be 0 or 1 for the command to be accepted
-    //         - The least significant nibble when set to 1: augments total duration
-    //            - Not going to support this since I can't find a game which used this bit
+    //         - The least significant nibble when set to 1: vibrate continuously until the
+    //           auto-stop time elapses (used by play())
     // A value of 0x10000000 will stop current vibration
     uint32_t vibrationWord = 0x10000000;
 
@@ -252,12 +295,8 @@ void DreamcastVibration::send(uint64_t timeUs, uint8_t power, int8_t inclination
     }
     // else: send "stop" command
 
-    // Remove past transmission if it hasn't been sent yet
-    if (mTransmissionId > 0)
-    {
-        mEndpointTxScheduler->cancelById(mTransmissionId);
-        mTransmissionId = 0;
-    }
+    // Remove past transmissions if they haven't been sent yet
+    cancelPending();
 
     // Send it!
     uint32_t payload[2] = {FUNCTION_CODE, vibrationWord};
@@ -287,12 +326,8 @@ void DreamcastVibration::start(uint8_t power, uint8_t desiredFreq)
     // Automatically repeat at half the duration
     uint32_t autoRepeatUs = COMPUTE_DURATION_US(freq, 0) * 0.5;
 
-    // Remove past transmission if it hasn't been sent yet
-    if (mTransmissionId > 0)
-    {
-        mEndpointTxScheduler->cancelById(mTransmissionId);
-        mTransmissionId = 0;
-    }
+    // Remove past transmissions if they haven't been sent yet
+    cancelPending();
 
     // Send it!
     uint32_t payload[2] = {FUNCTION_CODE, vibrationWord};
@@ -311,3 +346,64 @@ void DreamcastVibration::stop()
 {
     send(PrioritizedTxScheduler::TX_TIME_ASAP, 0, 0, 0, 0);
 }
+
+bool DreamcastVibration::play(uint64_t timeUs, const RumbleEnvelope* envelopes, uint32_t numEnvelopes)
+{
+    // Remove past transmissions if they haven't been sent yet (before compiling since this may
+    // leave the auto-stop time unknown)
+    cancelPending();
+
+    RumbleCommand commands[RumbleEffectCompiler::MAX_COMMANDS];
+    uint32_t numCommands = 0;
+    if (!mEffectCompiler.compile(
+        envelopes, numEnvelopes, commands, RumbleEffectCompiler::MAX_COMMANDS, numCommands))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < numCommands; ++i)
+    {
+        uint32_t payload[3] = {FUNCTION_CODE, commands[i].word, 0};
+        uint8_t payloadLen = 2;
+        if (commands[i].command == COMMAND_BLOCK_WRITE)
+        {
+            // Partition, phase, and block are all 0 when writing the auto-stop time
+            payload[1] = 0;
+            payload[2] = commands[i].word;
+            payloadLen = 3;
+        }
+
+        mEffectCommands[i] = commands[i].command;
+        mEffectTransmissionIds[i] = mEndpointTxScheduler->add(
+            timeUs + commands[i].offsetUs,
+            this,
+            commands[i].command,
+            payload,
+            payloadLen,
+            true,
+            0);
+    }
+    mNumEffectTransmissions = numCommands;
+
+    return true;
+}
+
+void DreamcastVibration::cancelPending()
+{
+    if (mTransmissionId > 0)
+    {
+        mEndpointTxScheduler->cancelById(mTransmissionId);
+        mTransmissionId = 0;
+    }
+
+    for (uint32_t i = 0; i < mNumEffectTransmissions; ++i)
+    {
+        if (mEndpointTxScheduler->cancelById(mEffectTransmissionIds[i]) > 0
+            && mEffectCommands[i] == COMMAND_BLOCK_WRITE)
+        {
+            // The auto-stop time the compiler expected won't be set
+            mEffectCompiler.forgetAutoStop();
+        }
+    }
+    mNumEffectTransmissions = 0;
+}
@@ -25,6 +25,7 @@
 
 #include "DreamcastPeripheral.hpp"
 #include "PlayerData.hpp"
+#include "RumbleEffect.hpp"
 
 //! Handles communication with the Dreamcast vibration peripheral
 class DreamcastVibration : public DreamcastPeripheral
@@ -79,7 +80,17 @@ class DreamcastVibration : public DreamcastPeripheral
         //! Immediately stops current vibration
         void stop();
 
+        //! Plays an effect, replacing anything not yet sent
+        //! @param[in] timeUs  The time to start the effect (must be an actual time, not ASAP)
+        //! @param[in] envelopes  The segments of the effect, played back to back
+        //! @param[in] numEnvelopes  Number of segments
+        //! @returns false iff the effect needs more than RumbleEffectCompiler::MAX_COMMANDS commands
+        bool play(uint64_t timeUs, const RumbleEnvelope* envelopes, uint32_t numEnvelopes);
+
     private:
+        //! Cancels all vibration transmissions which haven't been sent yet
+        void cancelPending();
+
         //! Computes the number of power increments that will be executed
         //! @param[in] power  Starting power intensity [1,7]
         //! @param[in] inclination  -1: ramp down, 0: constant, 1: ramp up
@@ -112,6 +123,20 @@ class DreamcastVibration : public DreamcastPeripheral
         uint32_t mTransmissionId;
         //! Initialized to true and set to false on first task execution
         bool mFirst;
+        //! Compiles effects passed to play()
+        RumbleEffectCompiler mEffectCompiler;
+        //! Transmission IDs of the commands scheduled by the last played effect
+        uint32_t mEffectTransmissionIds[RumbleEffectCompiler::MAX_COMMANDS];
+        //! Maple command of each entry in mEffectTransmissionIds
+        uint8_t mEffectCommands[RumbleEffectCompiler::MAX_COMMANDS];
+        //! Number of valid entries in mEffectTransmissionIds
+        uint32_t mNumEffectTransmissions;
+        //! Latest vibration requested by the USB host
+        RumbleSlot& mRumbleSlot;
+        //! Transmission ID of the first command sent for the last request taken from mRumbleSlot
+        uint32_t mRumbleTransmissionId;
+        //! The time the last request taken from mRumbleSlot was received
+        uint64_t mRumbleReceivedTimeUs;
         //! Lookup table used to maximize pulsation frequency for a given duration
         static const uint32_t MAX_DURATION_MS_LOOKUP[NUM_FREQ_VALUES];
 };
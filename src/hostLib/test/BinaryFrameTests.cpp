@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "hal/Usb/BinaryFrame.hpp"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+//! Encodes then decodes the given data, expecting to get the same data back
+static void expectRoundTrip(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> encoded(BinaryFrame::maxEncodedSize(data.size()));
+    uint32_t encodedLen = BinaryFrame::encode(data.data(), data.size(), encoded.data());
+    ASSERT_LE(encodedLen, encoded.size());
+    ASSERT_GT(encodedLen, 0);
+
+    // Only the final byte may be the delimiter
+    const uint8_t delimiter = BinaryFrame::DELIMITER;
+    EXPECT_EQ(encoded[encodedLen - 1], delimiter);
+    for (uint32_t i = 0; i < encodedLen - 1; ++i)
+    {
+        EXPECT_NE(encoded[i], delimiter) << "at index " << i;
+    }
+
+    int32_t decodedLen = BinaryFrame::decode(encoded.data(), encodedLen - 1);
+    ASSERT_EQ(decodedLen, static_cast<int32_t>(data.size()));
+    encoded.resize(decodedLen);
+    EXPECT_EQ(encoded, data);
+}
+
+TEST(BinaryFrameTest, encodeKnownValue)
+{
+    // --- TEST EXECUTION ---
+    uint8_t data[] = {0x11, 0x22, 0x00, 0x33};
+    uint8_t encoded[8] = {};
+    uint32_t len = BinaryFrame::encode(data, sizeof(data), encoded);
+
+    // --- EXPECTATIONS ---
+    ASSERT_EQ(len, 6);
+    EXPECT_EQ(encoded[0], 0x03);
+    EXPECT_EQ(encoded[1], 0x11);
+    EXPECT_EQ(encoded[2], 0x22);
+    EXPECT_EQ(encoded[3], 0x02);
+    EXPECT_EQ(encoded[4], 0x33);
+    EXPECT_EQ(encoded[5], 0x00);
+}
+
+TEST(BinaryFrameTest, roundTrip)
+{
+    expectRoundTrip({});
+    expectRoundTrip({0x00});
+    expectRoundTrip({0x00, 0x00});
+    expectRoundTrip({0x01, 0x02, 0x03});
+    expectRoundTrip({0x09, 0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01});
+
+    // Long runs without zeros cross the 254 byte block boundary
+    for (uint32_t len : {253, 254, 255, 508, 1031})
+    {
+        std::vector<uint8_t> data(len);
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            data[i] = static_cast<uint8_t>((i % 255) + 1);
+        }
+        expectRoundTrip(data);
+        data[len / 2] = 0;
+        expectRoundTrip(data);
+    }
+}
+
+TEST(BinaryFrameTest, decodeRejectsInvalid)
+{
+    // Code points past end of data
+    uint8_t overrun[] = {0x05, 0x11, 0x22};
+    EXPECT_LT(BinaryFrame::decode(overrun, sizeof(overrun)), 0);
+
+    // Zero within the frame
+    uint8_t zero[] = {0x03, 0x11, 0x00};
+    EXPECT_LT(BinaryFrame::decode(zero, sizeof(zero)), 0);
+}
+
+TEST(BinaryFrameTest, checksumIsXor)
+{
+    uint8_t data[] = {0x58, 0x01, 0x09, 0x20, 0x00, 0x01};
+    EXPECT_EQ(BinaryFrame::checksum(data, sizeof(data)), 0x58 ^ 0x01 ^ 0x09 ^ 0x20 ^ 0x00 ^ 0x01);
+}
+
+TEST(BinaryFrameTest, crc16CheckValue)
+{
+    const char* data = "123456789";
+    EXPECT_EQ(BinaryFrame::crc16(reinterpret_cast<const uint8_t*>(data), strlen(data)), 0x29B1);
+    EXPECT_EQ(BinaryFrame::crc16(nullptr, 0), 0xFFFF);
+}
@@ -0,0 +1,135 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Throughput benchmarks of the flycast and passthrough command parsers when commands are answered
+// from cache. These are disabled by default; run them with:
+//   testExe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+
+#include "MockClock.hpp"
+#include "MockDreamcastControllerObserver.hpp"
+#include "MockUsbFileSystem.hpp"
+
+#include "FlycastCommandParser.hpp"
+#include "MaplePassthroughCommandParser.hpp"
+#include "PrioritizedTxScheduler.hpp"
+#include "PlayerData.hpp"
+#include "dreamcast_constants.h"
+
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::NiceMock;
+using ::testing::Return;
+
+class CommandParserBenchmark : public ::testing::Test
+{
+    public:
+        CommandParserBenchmark() :
+            mRumbleSlot(mClock),
+            mScheduler(std::make_shared<PrioritizedTxScheduler>(0x00)),
+            mPlayerData(std::make_shared<PlayerData>(0,
+                                                     mDreamcastControllerObserver,
+                                                     mScreenData,
+                                                     mClock,
+                                                     mUsbFileSystem,
+                                                     mResponseCache,
+                                                     mStorageRegistry,
+                                                     mRumbleSlot)),
+            mFlycastParser(&mScheduler, SENDER_ADDRESSES, 1, {mPlayerData}),
+            mPassthroughParser(&mScheduler, SENDER_ADDRESSES, 1, {mPlayerData})
+        {
+            ON_CALL(mClock, getTimeUs()).WillByDefault(Return(1250));
+
+            uint32_t conditionWords[] = {0x08002003, DEVICE_FN_CONTROLLER, 0xFFFF0000, 0x80808080};
+            mResponseCache.setCondition(std::make_shared<MaplePacket>(conditionWords, 4), 1000);
+            uint32_t infoWords[] = {0x05002004, DEVICE_FN_CONTROLLER, 0x12345678, 0x9ABCDEF0, 0x00000000};
+            mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(infoWords, 5));
+        }
+
+    protected:
+        //! Submits the given command to the parser repeatedly with stdout sent to /dev/null
+        //! @returns number of commands per second
+        double run(CommandParser& parser, const char* command)
+        {
+            const uint32_t NUM_COMMANDS = 200000;
+            const uint32_t len = strlen(command);
+
+            fflush(stdout);
+            int savedStdout = dup(STDOUT_FILENO);
+            int devNull = open("/dev/null", O_WRONLY);
+            dup2(devNull, STDOUT_FILENO);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < NUM_COMMANDS; ++i)
+            {
+                parser.submit(command, len);
+            }
+            fflush(stdout);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            dup2(savedStdout, STDOUT_FILENO);
+            close(savedStdout);
+            close(devNull);
+
+            // Nothing may have gone to the bus, or the cache wasn't used
+            EXPECT_EQ(mScheduler->countRecipients(0x20), 0U);
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            double rate = NUM_COMMANDS / seconds;
+            printf("%-40s %.0fk commands/s\n", command, rate / 1000);
+            return rate;
+        }
+
+    protected:
+        static const uint8_t SENDER_ADDRESSES[1];
+        MockDreamcastControllerObserver mDreamcastControllerObserver;
+        NiceMock<MockClock> mClock;
+        MockUsbFileSystem mUsbFileSystem;
+        ScreenData mScreenData;
+        ResponseCache mResponseCache;
+        StorageRegistry mStorageRegistry;
+        RumbleSlot mRumbleSlot;
+        std::shared_ptr<PrioritizedTxScheduler> mScheduler;
+        std::shared_ptr<PlayerData> mPlayerData;
+        FlycastCommandParser mFlycastParser;
+        MaplePassthroughCommandParser mPassthroughParser;
+};
+
+const uint8_t CommandParserBenchmark::SENDER_ADDRESSES[1] = {0x00};
+
+TEST_F(CommandParserBenchmark, DISABLED_cachedCommandThroughput)
+{
+    mFlycastParser.submit("XS1", 3);
+
+    run(mFlycastParser, "X09200001 00000001");
+    run(mFlycastParser, "X 09 20 00 01 00 00 00 01");
+    run(mFlycastParser, "X01200000");
+    run(mPassthroughParser, "01200000");
+}
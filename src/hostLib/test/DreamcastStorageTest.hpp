@@ -0,0 +1,514 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "MockMapleBus.hpp"
+#include "MockDreamcastControllerObserver.hpp"
+#include "MockClock.hpp"
+#include "MockUsbFileSystem.hpp"
+
+#include "DreamcastStorage.hpp"
+#include "EndpointTxScheduler.hpp"
+#include "PrioritizedTxScheduler.hpp"
+#include "TransmissionTimeliner.hpp"
+#include "dreamcast_constants.h"
+#include "configuration.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::_;
+using ::testing::Return;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+//! Address of the storage peripheral under test
+static const uint8_t STORAGE_ADDR = 0x01;
+//! Standard VMU function definition
+static const uint32_t STORAGE_FD = 0x000F4100;
+
+//! Records what a DreamcastStorage reports of bulk transfers
+class RecordingBulkListener : public StorageBulkListener
+{
+    public:
+        virtual void bulkBlockRead(uint8_t blockNum, const uint8_t* data) override
+        {
+            blocksRead.push_back(blockNum);
+            blockData.push_back(std::vector<uint8_t>(data, data + 512));
+        }
+
+        virtual void bulkReadDone(bool success, uint16_t nextBlock) override
+        {
+            readSuccess = success;
+            readNextBlock = nextBlock;
+            readDone = true;
+        }
+
+        virtual void bulkBlockWritten(uint8_t blockNum, bool success, bool written) override
+        {
+            blocksWritten.push_back(blockNum);
+            writeSuccess.push_back(success);
+            writeWritten.push_back(written);
+            ++numWritten;
+        }
+
+        std::vector<uint8_t> blocksRead;
+        std::vector<std::vector<uint8_t>> blockData;
+        std::atomic<bool> readDone{false};
+        bool readSuccess = false;
+        uint16_t readNextBlock = 0;
+        std::vector<uint8_t> blocksWritten;
+        std::vector<bool> writeSuccess;
+        std::vector<bool> writeWritten;
+        std::atomic<uint32_t> numWritten{0};
+};
+
+//! Stands in for a flycast or passthrough client which writes to the storage directly
+class CountingTransmitter : public Transmitter
+{
+    public:
+        virtual void txStarted(std::shared_ptr<const Transmission> tx) override
+        {}
+
+        virtual void txFailed(bool writeFailed,
+                              bool readFailed,
+                              std::shared_ptr<const Transmission> tx) override
+        {
+            ++numFinished;
+        }
+
+        virtual void txComplete(std::shared_ptr<const MaplePacket> packet,
+                                std::shared_ptr<const Transmission> tx) override
+        {
+            ++numFinished;
+        }
+
+        std::atomic<uint32_t> numFinished{0};
+};
+
+//! Runs a DreamcastStorage against a simulated VMU behind a MockMapleBus. A background thread
+//! stands in for the core which operates the Maple Bus while the test thread makes the blocking
+//! UsbFile calls, just as the USB core would.
+class DreamcastStorageTest : public ::testing::Test
+{
+    public:
+        DreamcastStorageTest() :
+            mDreamcastControllerObserver(),
+            mRumbleSlot(mClock),
+            mPlayerData{0, mDreamcastControllerObserver, mScreenData, mClock, mUsbFileSystem, mResponseCache, mStorageRegistry, mRumbleSlot},
+            mMapleBus(),
+            mPrioritizedTxScheduler(std::make_shared<PrioritizedTxScheduler>(0x00)),
+            mEndpointTxScheduler(std::make_shared<EndpointTxScheduler>(
+                mPrioritizedTxScheduler, PrioritizedTxScheduler::SUB_TRANSMISSION_PRIORITY, STORAGE_ADDR)),
+            mTimeliner(mMapleBus, mPrioritizedTxScheduler),
+            mStorage(nullptr),
+            mRunning(false),
+            mBusThreadId(),
+            mTimeUs(1000000),
+            mLockstep(false),
+            mHostPolled(false),
+            mMemory(),
+            mBlockReads(),
+            mWritePhases(0),
+            mCommits(0),
+            mFailWrites(false),
+            mFailReadBlock(-1),
+            mRequiredWriteGapUs(0),
+            mLastWriteEndUs(0),
+            mResponse(),
+            mResponseLen(0),
+            mResponseTimeUs(0),
+            mConditionTimes()
+        {}
+
+    protected:
+        //! Simulated time which elapses on each iteration of the Maple Bus thread
+        static const uint64_t TICK_US = 100;
+        //! Timeout used for blocking calls
+        static const uint32_t TIMEOUT_US = 1000000;
+
+        MockDreamcastControllerObserver mDreamcastControllerObserver;
+        NiceMock<MockClock> mClock;
+        NiceMock<MockUsbFileSystem> mUsbFileSystem;
+        ScreenData mScreenData;
+        ResponseCache mResponseCache;
+        StorageRegistry mStorageRegistry;
+        RumbleSlot mRumbleSlot;
+        PlayerData mPlayerData;
+        NiceMock<MockMapleBus> mMapleBus;
+        std::shared_ptr<PrioritizedTxScheduler> mPrioritizedTxScheduler;
+        std::shared_ptr<EndpointTxScheduler> mEndpointTxScheduler;
+        TransmissionTimeliner mTimeliner;
+        std::unique_ptr<DreamcastStorage> mStorage;
+        std::thread mBusThread;
+        std::atomic<bool> mRunning;
+        std::atomic<std::thread::id> mBusThreadId;
+        std::atomic<uint64_t> mTimeUs;
+        //! When true, simulated time only advances once the test thread has observed the clock so
+        //! that thread scheduling doesn't affect timing measurements
+        std::atomic<bool> mLockstep;
+        //! Set when the test thread reads the clock
+        std::atomic<bool> mHostPolled;
+
+        //! Simulated VMU memory in Maple Bus word order
+        uint32_t mMemory[256][128];
+        //! Number of BLOCK_READ commands received for each block
+        uint32_t mBlockReads[256];
+        //! Number of BLOCK_WRITE commands received
+        uint32_t mWritePhases;
+        //! Block number and payload data words of each BLOCK_WRITE command received
+        std::vector<std::pair<uint8_t, std::vector<uint32_t>>> mWritePhaseData;
+        //! Serializes access to mWritePhaseData
+        std::mutex mWritePhaseDataMutex;
+        //! Number of GET_LAST_ERROR (commit) commands received
+        uint32_t mCommits;
+        //! When true, the simulated VMU responds to BLOCK_WRITE with a file error
+        std::atomic<bool> mFailWrites;
+        //! The simulated VMU responds to BLOCK_READ of this block with a file error (-1 for none)
+        std::atomic<int32_t> mFailReadBlock;
+        //! Action to execute on the Maple Bus thread, as the maple bus core does for a TTY command
+        std::function<void()> mBusAction;
+        //! Serializes access to mBusAction
+        std::mutex mBusActionMutex;
+        //! Write phases and commits which arrive sooner than this after the previous one are
+        //! rejected by the simulated VMU
+        std::atomic<uint32_t> mRequiredWriteGapUs;
+        //! Simulated time at which the last write phase or commit finished
+        uint64_t mLastWriteEndUs;
+        //! The response to return on next processEvents() (frame word first)
+        uint32_t mResponse[256];
+        //! Number of words in mResponse or 0 when no response is pending
+        uint32_t mResponseLen;
+        //! Simulated time at which the bus finishes receiving mResponse
+        uint64_t mResponseTimeUs;
+        //! Times at which controller condition requests were written to the bus
+        std::vector<uint64_t> mConditionTimes;
+
+        virtual void SetUp()
+        {
+            ON_CALL(mClock, getTimeUs).WillByDefault(Invoke([this](){ return getTimeUs(); }));
+            ON_CALL(mMapleBus, isBusy).WillByDefault(Invoke([this](){ return mResponseLen > 0; }));
+            ON_CALL(mMapleBus, mockWrite).WillByDefault(Invoke(this, &DreamcastStorageTest::busWrite));
+            ON_CALL(mMapleBus, processEvents)
+                .WillByDefault(Invoke(this, &DreamcastStorageTest::busProcessEvents));
+
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint8_t data[512];
+                for (uint32_t j = 0; j < sizeof(data); ++j)
+                {
+                    data[j] = i + j;
+                }
+                setBlock(i, data);
+            }
+
+            connect();
+        }
+
+        virtual void TearDown()
+        {
+            disconnect();
+        }
+
+        //! Creates the storage peripheral and starts the Maple Bus thread
+        void connect()
+        {
+            mStorage = std::make_unique<DreamcastStorage>(
+                STORAGE_ADDR, STORAGE_FD, mEndpointTxScheduler, mPlayerData);
+            mRunning = true;
+            mBusThread = std::thread(&DreamcastStorageTest::busThread, this);
+        }
+
+        //! @returns the simulated time
+        uint64_t getTimeUs()
+        {
+            if (mLockstep && std::this_thread::get_id() != mBusThreadId.load())
+            {
+                mHostPolled = true;
+                std::this_thread::yield();
+            }
+            return mTimeUs;
+        }
+
+        //! Simulates the USB host taking some time between each request
+        void hostDelay(uint64_t delayUs)
+        {
+            uint64_t endTimeUs = getTimeUs() + delayUs;
+            while (getTimeUs() < endTimeUs);
+        }
+
+        //! Stops the Maple Bus thread and destroys the storage peripheral
+        void disconnect()
+        {
+            mRunning = false;
+            if (mBusThread.joinable())
+            {
+                mBusThread.join();
+            }
+            mStorage.reset();
+        }
+
+        //! Executes the given action on the Maple Bus thread and waits for it to finish
+        void runOnBus(std::function<void()> action)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mBusActionMutex);
+                mBusAction = action;
+            }
+            while (true)
+            {
+                std::lock_guard<std::mutex> lock(mBusActionMutex);
+                if (!mBusAction)
+                {
+                    break;
+                }
+            }
+        }
+
+        //! Sets simulated VMU memory from the bytes the host would see
+        void setBlock(uint8_t blockNum, const uint8_t* data)
+        {
+            for (uint32_t i = 0; i < 128; ++i, data += 4)
+            {
+                mMemory[blockNum][i] = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+            }
+        }
+
+        //! Gets simulated VMU memory as the bytes the host would see
+        void getBlock(uint8_t blockNum, uint8_t* data)
+        {
+            for (uint32_t i = 0; i < 128; ++i, data += 4)
+            {
+                uint32_t word = mMemory[blockNum][i];
+                data[0] = word >> 24;
+                data[1] = word >> 16;
+                data[2] = word >> 8;
+                data[3] = word;
+            }
+        }
+
+        //! Executes what the Maple Bus core does for a single node
+        void busThread()
+        {
+            mBusThreadId = std::this_thread::get_id();
+            while (mRunning)
+            {
+                if (mLockstep)
+                {
+                    while (mRunning && !mHostPolled.exchange(false))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+
+                uint64_t currentTimeUs = (mTimeUs += TICK_US);
+
+                TransmissionTimeliner::ReadStatus readStatus = mTimeliner.readTask(currentTimeUs);
+                if (readStatus.transmission != nullptr)
+                {
+                    mStorageRegistry.txFinished(*readStatus.transmission);
+                }
+                if (readStatus.transmission != nullptr && readStatus.transmission->transmitter != nullptr)
+                {
+                    if (readStatus.received != nullptr)
+                    {
+                        readStatus.transmission->transmitter->txComplete(
+                            readStatus.received, readStatus.transmission);
+                    }
+                    else
+                    {
+                        readStatus.transmission->transmitter->txFailed(
+                            readStatus.busPhase == MapleBusInterface::Phase::WRITE_FAILED,
+                            readStatus.busPhase == MapleBusInterface::Phase::READ_FAILED,
+                            readStatus.transmission);
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mBusActionMutex);
+                    if (mBusAction)
+                    {
+                        mBusAction();
+                        mBusAction = nullptr;
+                    }
+                }
+
+                mStorage->task(currentTimeUs);
+
+                std::shared_ptr<const Transmission> sentTx = mTimeliner.writeTask(currentTimeUs);
+                if (sentTx != nullptr && sentTx->transmitter != nullptr)
+                {
+                    sentTx->transmitter->txStarted(sentTx);
+                }
+            }
+        }
+
+        //! Sets the response which the simulated VMU sends back; the bus is busy for as long as the
+        //! scheduler estimates the request and response take
+        void respond(const MaplePacket& request, uint8_t command, const uint32_t* payload, uint8_t len)
+        {
+            uint32_t durationNs = MAPLE_OPEN_LINE_CHECK_TIME_US * 1000
+                + MaplePacket::getTxTimeNs(request.payload.size(), MAPLE_NS_PER_BIT)
+                + MAPLE_RESPONSE_DELAY_NS
+                + MaplePacket::getTxTimeNs(len, MAPLE_RESPONSE_NS_PER_BIT);
+            mResponseTimeUs = mTimeUs + (durationNs / 1000);
+            mResponse[0] = (command << 24) | (STORAGE_ADDR << 8) | len;
+            for (uint32_t i = 0; i < len; ++i)
+            {
+                mResponse[i + 1] = payload[i];
+            }
+            mResponseLen = len + 1;
+        }
+
+        //! @returns true iff the simulated VMU isn't ready for the next write phase or commit
+        bool isWriteTooSoon()
+        {
+            return (mTimeUs < mLastWriteEndUs + mRequiredWriteGapUs);
+        }
+
+        //! Writes blocks with distinct data, expecting each write to succeed
+        void writeBlocks(uint32_t firstBlock, uint32_t numBlocks, uint8_t seed)
+        {
+            uint8_t data[512];
+            for (uint32_t i = firstBlock; i < firstBlock + numBlocks; ++i)
+            {
+                memset(data, seed + i, sizeof(data));
+                ASSERT_EQ(mStorage->write(i, data, sizeof(data), TIMEOUT_US), 512) << "block " << i;
+            }
+        }
+
+        //! Expects the simulated VMU to hold the data written by writeBlocks()
+        void expectBlocks(uint32_t firstBlock, uint32_t numBlocks, uint8_t seed)
+        {
+            uint8_t expected[512];
+            uint8_t stored[512];
+            for (uint32_t i = firstBlock; i < firstBlock + numBlocks; ++i)
+            {
+                memset(expected, seed + i, sizeof(expected));
+                getBlock(i, stored);
+                EXPECT_EQ(memcmp(stored, expected, sizeof(stored)), 0) << "block " << i;
+            }
+        }
+
+        //! Simulated VMU which handles a packet written to the bus
+        bool busWrite(const MaplePacket& packet, bool expectResponse, uint64_t readTimeoutUs)
+        {
+            (void)expectResponse;
+            (void)readTimeoutUs;
+
+            uint8_t block = packet.payload[1] & 0xFF;
+            uint8_t phase = (packet.payload[1] >> 16) & 0xFF;
+            switch (packet.frame.command)
+            {
+                case COMMAND_BLOCK_READ:
+                {
+                    ++mBlockReads[block];
+                    if (mFailReadBlock == block)
+                    {
+                        respond(packet, COMMAND_RESPONSE_FILE_ERROR, nullptr, 0);
+                        break;
+                    }
+                    uint32_t payload[130] = {DEVICE_FN_STORAGE, packet.payload[1]};
+                    memcpy(&payload[2], mMemory[block], sizeof(mMemory[block]));
+                    respond(packet, COMMAND_RESPONSE_DATA_XFER, payload, 130);
+                }
+                break;
+
+                case COMMAND_BLOCK_WRITE:
+                {
+                    ++mWritePhases;
+                    {
+                        std::lock_guard<std::mutex> lock(mWritePhaseDataMutex);
+                        mWritePhaseData.emplace_back(
+                            block, std::vector<uint32_t>(packet.payload.begin() + 2, packet.payload.end()));
+                    }
+                    if (mFailWrites || isWriteTooSoon())
+                    {
+                        respond(packet, COMMAND_RESPONSE_FILE_ERROR, nullptr, 0);
+                    }
+                    else
+                    {
+                        uint32_t numWords = packet.payload.size() - 2;
+                        memcpy(&mMemory[block][phase * numWords], &packet.payload[2], numWords * 4);
+                        respond(packet, COMMAND_RESPONSE_ACK, nullptr, 0);
+                    }
+                    mLastWriteEndUs = mResponseTimeUs;
+                }
+                break;
+
+                case COMMAND_GET_CONDITION:
+                {
+                    mConditionTimes.push_back(mTimeUs);
+                    uint32_t payload[3] = {DEVICE_FN_CONTROLLER, 0xFFFFFFFF, 0x80808080};
+                    respond(packet, COMMAND_RESPONSE_DATA_XFER, payload, 3);
+                }
+                break;
+
+                case COMMAND_GET_LAST_ERROR:
+                {
+                    ++mCommits;
+                    respond(packet, isWriteTooSoon() ? COMMAND_RESPONSE_FILE_ERROR : COMMAND_RESPONSE_ACK, nullptr, 0);
+                    mLastWriteEndUs = mResponseTimeUs;
+                }
+                break;
+
+                default:
+                {
+                    respond(packet, COMMAND_RESPONSE_UNKNOWN_COMMAND, nullptr, 0);
+                }
+                break;
+            }
+            return true;
+        }
+
+        //! Returns the pending response of the simulated VMU, if any
+        MapleBusInterface::Status busProcessEvents(uint64_t currentTimeUs)
+        {
+            MapleBusInterface::Status status;
+            if (mResponseLen > 0 && currentTimeUs >= mResponseTimeUs)
+            {
+                status.phase = MapleBusInterface::Phase::READ_COMPLETE;
+                status.readBuffer = mResponse;
+                status.readBufferLen = mResponseLen;
+                mResponseLen = 0;
+            }
+            else if (mResponseLen > 0)
+            {
+                status.phase = MapleBusInterface::Phase::READ_IN_PROGRESS;
+            }
+            else
+            {
+                status.phase = MapleBusInterface::Phase::IDLE;
+            }
+            return status;
+        }
+};
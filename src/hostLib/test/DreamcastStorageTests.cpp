@@ -0,0 +1,652 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DreamcastStorageTest.hpp"
+
+TEST_F(DreamcastStorageTest, readReturnsBlockData)
+{
+    uint8_t expected[512];
+    uint8_t buffer[512];
+    getBlock(10, expected);
+
+    EXPECT_EQ(mStorage->read(10, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    EXPECT_EQ(memcmp(buffer, expected, sizeof(buffer)), 0);
+    EXPECT_EQ(mBlockReads[10], 1U);
+}
+
+TEST_F(DreamcastStorageTest, locationIsPortAndSubSlot)
+{
+    uint8_t port = 0xFF;
+    uint8_t subSlot = 0xFF;
+
+    EXPECT_TRUE(mStorage->getLocation(port, subSlot));
+
+    EXPECT_EQ(port, 0);
+    EXPECT_EQ(subSlot, 0);
+    EXPECT_STREQ(mStorage->getFileName(), "vmu0.bin");
+}
+
+TEST_F(DreamcastStorageTest, repeatedReadsServedFromCache)
+{
+    uint8_t first[512];
+    uint8_t second[512];
+
+    EXPECT_EQ(mStorage->read(VmuBlockCache::FAT_BLOCK, first, sizeof(first), TIMEOUT_US), 512);
+    EXPECT_EQ(mStorage->read(VmuBlockCache::FAT_BLOCK, second, sizeof(second), TIMEOUT_US), 512);
+
+    EXPECT_EQ(memcmp(first, second, sizeof(first)), 0);
+    EXPECT_EQ(mBlockReads[VmuBlockCache::FAT_BLOCK], 1U);
+    EXPECT_EQ(mStorage->getCacheHits(), 1U);
+    EXPECT_EQ(mStorage->getCacheMisses(), 1U);
+}
+
+TEST_F(DreamcastStorageTest, writeUpdatesCache)
+{
+    uint8_t data[512];
+    uint8_t buffer[512];
+    EXPECT_EQ(mStorage->read(20, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    memset(data, 0x5A, sizeof(data));
+
+    EXPECT_EQ(mStorage->write(20, data, sizeof(data), TIMEOUT_US), 512);
+    EXPECT_EQ(mStorage->read(20, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    uint8_t stored[512];
+    getBlock(20, stored);
+    EXPECT_EQ(memcmp(stored, data, sizeof(data)), 0);
+    EXPECT_EQ(memcmp(buffer, data, sizeof(data)), 0);
+    EXPECT_EQ(mBlockReads[20], 1U);
+    EXPECT_EQ(mWritePhases, 4U);
+    EXPECT_EQ(mCommits, 1U);
+}
+
+TEST_F(DreamcastStorageTest, failedWriteInvalidatesCache)
+{
+    uint8_t data[512];
+    uint8_t buffer[512];
+    EXPECT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    memset(data, 0x5A, sizeof(data));
+    mFailWrites = true;
+
+    EXPECT_LT(mStorage->write(30, data, sizeof(data), 50000), 0);
+    EXPECT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mBlockReads[30], 2U);
+}
+
+TEST_F(DreamcastStorageTest, reconnectStartsWithEmptyCache)
+{
+    uint8_t buffer[512];
+    EXPECT_EQ(mStorage->read(VmuBlockCache::SYSTEM_BLOCK, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    disconnect();
+    connect();
+    EXPECT_EQ(mStorage->read(VmuBlockCache::SYSTEM_BLOCK, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mBlockReads[VmuBlockCache::SYSTEM_BLOCK], 2U);
+    EXPECT_EQ(mStorage->getCacheMisses(), 1U);
+}
+
+TEST_F(DreamcastStorageTest, sequentialReadsAreReadAhead)
+{
+    uint8_t buffer[512];
+    uint8_t expected[512];
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        ASSERT_EQ(mStorage->read(i, buffer, sizeof(buffer), TIMEOUT_US), 512);
+        getBlock(i, expected);
+        EXPECT_EQ(memcmp(buffer, expected, sizeof(buffer)), 0) << "block " << i;
+        hostDelay(1000);
+    }
+
+    // Only the first two reads had to wait on the bus, and no block was read twice
+    EXPECT_EQ(mStorage->getReadAheadHits(), 14U);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        EXPECT_EQ(mBlockReads[i], 1U) << "block " << i;
+    }
+}
+
+TEST_F(DreamcastStorageTest, readAheadReducesWholeCardReadTime)
+{
+    uint8_t buffer[512];
+    uint64_t durationUs[2];
+    mLockstep = true;
+
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        // First pass without read-ahead, second with the default depth
+        if (pass == 0)
+        {
+            mStorage->setReadAheadDepth(0);
+        }
+        uint64_t startTimeUs = getTimeUs();
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            ASSERT_EQ(mStorage->read(i, buffer, sizeof(buffer), TIMEOUT_US), 512);
+            hostDelay(1000);
+        }
+        durationUs[pass] = getTimeUs() - startTimeUs;
+        disconnect();
+        connect();
+    }
+
+    // The bus stays busy while the host is turning around each request, hiding at least half of it
+    EXPECT_LT(durationUs[1] + (256 * 1000 / 2), durationUs[0]);
+}
+
+TEST_F(DreamcastStorageTest, readAheadGivesWayToControllerPolling)
+{
+    const uint32_t pollPeriodUs = 16000;
+    MaplePacket condition({.command=COMMAND_GET_CONDITION, .recipientAddr=0x20}, DEVICE_FN_CONTROLLER);
+    mPrioritizedTxScheduler->add(
+        PrioritizedTxScheduler::MAIN_TRANSMISSION_PRIORITY,
+        PrioritizedTxScheduler::TX_TIME_ASAP,
+        nullptr,
+        condition,
+        true,
+        3,
+        pollPeriodUs);
+
+    uint8_t buffer[512];
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        ASSERT_EQ(mStorage->read(i, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    }
+    disconnect();
+
+    ASSERT_GT(mConditionTimes.size(), 2U);
+    for (uint32_t i = 1; i < mConditionTimes.size(); ++i)
+    {
+        EXPECT_LE(mConditionTimes[i] - mConditionTimes[i - 1], pollPeriodUs + 2 * TICK_US);
+    }
+}
+
+TEST_F(DreamcastStorageTest, writeDiscardsStaleReadAhead)
+{
+    uint8_t buffer[512];
+    uint8_t data[512];
+    memset(data, 0xC3, sizeof(data));
+
+    EXPECT_EQ(mStorage->read(0, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    EXPECT_EQ(mStorage->read(1, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    // Block 3 was read ahead before being written
+    EXPECT_EQ(mStorage->write(3, data, sizeof(data), TIMEOUT_US), 512);
+    mStorage->setReadAheadDepth(0);
+    EXPECT_EQ(mStorage->read(2, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    EXPECT_EQ(mStorage->read(3, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    EXPECT_EQ(memcmp(buffer, data, sizeof(data)), 0);
+}
+
+TEST_F(DreamcastStorageTest, writePacingSpeedsUpForFastVmu)
+{
+    mRequiredWriteGapUs = 2000;
+
+    writeBlocks(0, 40, 0x10);
+
+    expectBlocks(0, 40, 0x10);
+    EXPECT_LT(mStorage->getWritePacer().getGapUs(), 6000U);
+    // At most one probe went below what the VMU handles
+    EXPECT_LE(mStorage->getWritePacer().getFailureCount(), 1U);
+}
+
+TEST_F(DreamcastStorageTest, writePacingBacksOffForSlowVmu)
+{
+    mRequiredWriteGapUs = 14000;
+
+    writeBlocks(0, 40, 0x20);
+
+    expectBlocks(0, 40, 0x20);
+    EXPECT_GE(mStorage->getWritePacer().getReliableGapUs(), 14000U);
+    // Occasional probes fail, but most blocks are written on the first attempt
+    EXPECT_LT(mStorage->getWritePacer().getFailureCount(), 15U);
+}
+
+TEST_F(DreamcastStorageTest, writePacingRecoversWhenVmuBecomesFast)
+{
+    mRequiredWriteGapUs = 14000;
+    writeBlocks(0, 20, 0x30);
+    uint32_t slowGapUs = mStorage->getWritePacer().getGapUs();
+
+    mRequiredWriteGapUs = 2000;
+    writeBlocks(20, 60, 0x30);
+
+    expectBlocks(0, 80, 0x30);
+    EXPECT_GE(slowGapUs, 14000U);
+    EXPECT_LT(mStorage->getWritePacer().getGapUs(), 10000U);
+}
+
+TEST_F(DreamcastStorageTest, unchangedWriteSkipped)
+{
+    uint8_t data[512];
+    getBlock(40, data);
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_READ);
+
+    EXPECT_EQ(mStorage->write(40, data, sizeof(data), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mBlockReads[40], 1U);
+    EXPECT_EQ(mWritePhases, 0U);
+    EXPECT_EQ(mCommits, 0U);
+    EXPECT_EQ(mStorage->getSkippedWrites(), 1U);
+}
+
+TEST_F(DreamcastStorageTest, cachedCompareModeDoesNotRead)
+{
+    uint8_t data[512];
+    getBlock(41, data);
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_CACHED);
+
+    // Not cached, so this is written
+    EXPECT_EQ(mStorage->write(41, data, sizeof(data), TIMEOUT_US), 512);
+    // Now cached through the write above, so this is skipped
+    EXPECT_EQ(mStorage->write(41, data, sizeof(data), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mBlockReads[41], 0U);
+    EXPECT_EQ(mCommits, 1U);
+    EXPECT_EQ(mStorage->getSkippedWrites(), 1U);
+}
+
+TEST_F(DreamcastStorageTest, compareOffByDefault)
+{
+    uint8_t data[512];
+    EXPECT_EQ(mStorage->read(42, data, sizeof(data), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mStorage->write(42, data, sizeof(data), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mWritePhases, 4U);
+    EXPECT_EQ(mCommits, 1U);
+    EXPECT_EQ(mStorage->getSkippedWrites(), 0U);
+}
+
+TEST_F(DreamcastStorageTest, wholeCardSyncOnlyWritesChangedBlocks)
+{
+    uint8_t data[512];
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_READ);
+
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        getBlock(i, data);
+        if (i == 7 || i == 100)
+        {
+            data[0] ^= 0xFF;
+        }
+        ASSERT_EQ(mStorage->write(i, data, sizeof(data), TIMEOUT_US), 512) << "block " << i;
+    }
+
+    EXPECT_EQ(mCommits, 2U);
+    EXPECT_EQ(mStorage->getSkippedWrites(), 254U);
+    getBlock(7, data);
+    EXPECT_EQ(data[0], static_cast<uint8_t>(7 ^ 0xFF));
+    getBlock(100, data);
+    EXPECT_EQ(data[0], static_cast<uint8_t>(100 ^ 0xFF));
+}
+
+TEST_F(DreamcastStorageTest, readAsyncCompletesLater)
+{
+    uint8_t buffer[512];
+    uint8_t expected[512];
+    getBlock(50, expected);
+
+    int32_t numRead = mStorage->readAsync(50, buffer, sizeof(buffer), TIMEOUT_US);
+    EXPECT_EQ(numRead, 0);
+    while ((numRead = mStorage->readAsync(50, buffer, sizeof(buffer), TIMEOUT_US)) == 0);
+
+    EXPECT_EQ(numRead, 512);
+    EXPECT_EQ(memcmp(buffer, expected, sizeof(buffer)), 0);
+    // Served from cache without waiting from now on
+    EXPECT_EQ(mStorage->readAsync(50, buffer, sizeof(buffer), TIMEOUT_US), 512);
+}
+
+TEST_F(DreamcastStorageTest, readAsyncRequestForAnotherBlockAbandonsPending)
+{
+    uint8_t buffer[512];
+    uint8_t expected[512];
+    getBlock(60, expected);
+
+    EXPECT_EQ(mStorage->readAsync(55, buffer, sizeof(buffer), TIMEOUT_US), 0);
+    int32_t numRead = 0;
+    while ((numRead = mStorage->readAsync(60, buffer, sizeof(buffer), TIMEOUT_US)) == 0);
+
+    EXPECT_EQ(numRead, 512);
+    EXPECT_EQ(memcmp(buffer, expected, sizeof(buffer)), 0);
+}
+
+TEST_F(DreamcastStorageTest, prefetchReadsFollowingBlocksTogether)
+{
+    // Prefetch alone must get the blocks of a multi-block transfer started
+    mStorage->setReadAheadDepth(0);
+    uint8_t buffer[512];
+    uint8_t expected[512];
+
+    EXPECT_EQ(mStorage->readAsync(80, buffer, sizeof(buffer), TIMEOUT_US), 0);
+    mStorage->prefetch(81, 3);
+    for (uint8_t block = 80; block < 84; ++block)
+    {
+        int32_t numRead = 0;
+        while ((numRead = mStorage->readAsync(block, buffer, sizeof(buffer), TIMEOUT_US)) == 0);
+        EXPECT_EQ(numRead, 512);
+        getBlock(block, expected);
+        EXPECT_EQ(memcmp(buffer, expected, sizeof(buffer)), 0);
+        EXPECT_EQ(mBlockReads[block], 1U);
+    }
+
+    EXPECT_EQ(mStorage->getReadAheadHits(), 3U);
+    EXPECT_EQ(mBlockReads[84], 0U);
+}
+
+TEST_F(DreamcastStorageTest, writeAsyncCopiesDataAndCompletesLater)
+{
+    uint8_t data[512];
+    uint8_t expected[512];
+    memset(data, 0x77, sizeof(data));
+    memcpy(expected, data, sizeof(expected));
+
+    int32_t numWritten = mStorage->writeAsync(70, data, sizeof(data), TIMEOUT_US);
+    EXPECT_EQ(numWritten, 0);
+    // Data is only read on the first call
+    memset(data, 0x00, sizeof(data));
+    while ((numWritten = mStorage->writeAsync(70, data, sizeof(data), TIMEOUT_US)) == 0);
+
+    EXPECT_EQ(numWritten, 512);
+    uint8_t stored[512];
+    getBlock(70, stored);
+    EXPECT_EQ(memcmp(stored, expected, sizeof(stored)), 0);
+    EXPECT_EQ(mCommits, 1U);
+}
+
+TEST_F(DreamcastStorageTest, writeAsyncForAnotherBlockWaitsForWriteInProgress)
+{
+    uint8_t first[512];
+    uint8_t second[512];
+    memset(first, 0x77, sizeof(first));
+    memset(second, 0x55, sizeof(second));
+
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_OFF);
+
+    {
+        // Holding this pauses the Maple Bus thread, so no phase is sent until both requests are made
+        std::lock_guard<std::mutex> lock(mBusActionMutex);
+        // Claims the write state machine for block 70
+        ASSERT_EQ(mStorage->writeAsync(70, first, sizeof(first), TIMEOUT_US), 0);
+        // Block 70 is abandoned for block 71 before any of its phases are sent
+        ASSERT_EQ(mStorage->writeAsync(71, second, sizeof(second), TIMEOUT_US), 0);
+    }
+    int32_t numWritten = 0;
+    while ((numWritten = mStorage->writeAsync(71, second, sizeof(second), TIMEOUT_US)) == 0);
+
+    EXPECT_EQ(numWritten, 512);
+    uint8_t stored[512];
+    getBlock(70, stored);
+    EXPECT_EQ(memcmp(stored, first, sizeof(stored)), 0);
+    getBlock(71, stored);
+    EXPECT_EQ(memcmp(stored, second, sizeof(stored)), 0);
+    std::lock_guard<std::mutex> lock(mWritePhaseDataMutex);
+    ASSERT_EQ(mWritePhaseData.size(), 8U);
+    for (uint32_t i = 0; i < mWritePhaseData.size(); ++i)
+    {
+        uint8_t block = mWritePhaseData[i].first;
+        uint32_t expectedWord = (block == 70) ? 0x77777777 : 0x55555555;
+        EXPECT_EQ(block, (i < 4) ? 70 : 71) << "phase " << i;
+        for (uint32_t word : mWritePhaseData[i].second)
+        {
+            EXPECT_EQ(word, expectedWord) << "phase " << i;
+        }
+    }
+}
+
+TEST_F(DreamcastStorageTest, bulkReadDeliversWholeCardInOrder)
+{
+    RecordingBulkListener listener;
+    bool started = false;
+    runOnBus([&](){ started = mStorage->startBulkRead(0, 255, &listener); });
+    ASSERT_TRUE(started);
+    while (!listener.readDone);
+
+    EXPECT_TRUE(listener.readSuccess);
+    EXPECT_EQ(listener.readNextBlock, 256U);
+    ASSERT_EQ(listener.blocksRead.size(), 256U);
+    uint8_t expected[512];
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        EXPECT_EQ(listener.blocksRead[i], i);
+        getBlock(i, expected);
+        EXPECT_EQ(memcmp(listener.blockData[i].data(), expected, sizeof(expected)), 0) << "block " << i;
+        EXPECT_EQ(mBlockReads[i], 1U) << "block " << i;
+    }
+}
+
+TEST_F(DreamcastStorageTest, bulkReadReportsResumeBlockOnFailure)
+{
+    RecordingBulkListener listener;
+    mFailReadBlock = 15;
+    runOnBus([&](){ mStorage->startBulkRead(10, 20, &listener); });
+    while (!listener.readDone);
+
+    EXPECT_FALSE(listener.readSuccess);
+    EXPECT_EQ(listener.readNextBlock, 15U);
+    EXPECT_EQ(listener.blocksRead, (std::vector<uint8_t>{10, 11, 12, 13, 14}));
+    // Reads already in flight are dropped, and nothing past them is read
+    EXPECT_EQ(mBlockReads[20], 0U);
+}
+
+TEST_F(DreamcastStorageTest, bulkWriteCommitsBlockAndDropsHostCache)
+{
+    uint8_t buffer[512];
+    ASSERT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    RecordingBulkListener listener;
+    uint8_t data[512];
+    memset(data, 0x5A, sizeof(data));
+    bool started = false;
+    bool secondStarted = true;
+    runOnBus([&]()
+    {
+        started = mStorage->startBulkWrite(30, data, &listener);
+        // Only a single write may be in progress
+        secondStarted = mStorage->startBulkWrite(31, data, &listener);
+    });
+    ASSERT_TRUE(started);
+    EXPECT_FALSE(secondStarted);
+    while (listener.numWritten == 0);
+
+    ASSERT_EQ(listener.blocksWritten, (std::vector<uint8_t>{30}));
+    EXPECT_TRUE(listener.writeSuccess[0]);
+    uint8_t stored[512];
+    getBlock(30, stored);
+    EXPECT_EQ(memcmp(stored, data, sizeof(stored)), 0);
+
+    // The block cached before the bulk write must not be served
+    ASSERT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    EXPECT_EQ(memcmp(buffer, data, sizeof(buffer)), 0);
+    EXPECT_EQ(mBlockReads[30], 2U);
+}
+
+TEST_F(DreamcastStorageTest, externalWriteDropsCachedBlocks)
+{
+    uint8_t buffer[512];
+    ASSERT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    ASSERT_EQ(mStorage->read(VmuBlockCache::FAT_BLOCK, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    // Another client writes the first phase of a data block and the pinned FAT then commits them
+    CountingTransmitter client;
+    runOnBus([&]()
+    {
+        const uint8_t blocks[2] = {30, VmuBlockCache::FAT_BLOCK};
+        for (uint8_t blockNum : blocks)
+        {
+            uint32_t payload[34] = {DEVICE_FN_STORAGE, blockNum};
+            for (uint32_t i = 2; i < 34; ++i)
+            {
+                payload[i] = 0xA5A5A5A5;
+            }
+            mEndpointTxScheduler->add(
+                PrioritizedTxScheduler::TX_TIME_ASAP, &client, COMMAND_BLOCK_WRITE, payload, 34, true);
+            uint32_t commit[2] = {DEVICE_FN_STORAGE, blockNum | (4U << 16)};
+            mEndpointTxScheduler->add(
+                PrioritizedTxScheduler::TX_TIME_ASAP, &client, COMMAND_GET_LAST_ERROR, commit, 2, true);
+        }
+    });
+    while (client.numFinished < 4);
+
+    bool known = true;
+    uint32_t hash = 0;
+    runOnBus([&]()
+    {
+        known = mStorage->getBlockHash(30, hash)
+            || mStorage->getBlockHash(VmuBlockCache::FAT_BLOCK, hash);
+    });
+    EXPECT_FALSE(known);
+
+    // Neither block may be served from the cache any longer
+    ASSERT_EQ(mStorage->read(30, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    EXPECT_EQ(buffer[0], 0xA5);
+    EXPECT_EQ(mBlockReads[30], 2U);
+    ASSERT_EQ(mStorage->read(VmuBlockCache::FAT_BLOCK, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    EXPECT_EQ(buffer[0], 0xA5);
+    EXPECT_EQ(mBlockReads[VmuBlockCache::FAT_BLOCK], 2U);
+}
+
+TEST_F(DreamcastStorageTest, compareSeesExternalWrites)
+{
+    uint8_t original[512];
+    ASSERT_EQ(mStorage->read(31, original, sizeof(original), TIMEOUT_US), 512);
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_CACHED);
+
+    // A game saves over the block through another client
+    CountingTransmitter client;
+    runOnBus([&]()
+    {
+        uint32_t payload[34] = {DEVICE_FN_STORAGE, 31};
+        for (uint32_t i = 2; i < 34; ++i)
+        {
+            payload[i] = 0xA5A5A5A5;
+        }
+        mEndpointTxScheduler->add(
+            PrioritizedTxScheduler::TX_TIME_ASAP, &client, COMMAND_BLOCK_WRITE, payload, 34, true);
+    });
+    while (client.numFinished < 1);
+
+    // Writing back what was cached before must not be skipped
+    EXPECT_EQ(mStorage->write(31, original, sizeof(original), TIMEOUT_US), 512);
+
+    EXPECT_EQ(mStorage->getSkippedWrites(), 0U);
+    uint8_t stored[512];
+    getBlock(31, stored);
+    EXPECT_EQ(memcmp(stored, original, sizeof(stored)), 0);
+}
+
+TEST_F(DreamcastStorageTest, ownWritesKeepCachedBlock)
+{
+    uint8_t data[512];
+    memset(data, 0x3C, sizeof(data));
+    mStorage->setWriteCompareMode(DreamcastStorage::WRITE_COMPARE_OFF);
+    ASSERT_EQ(mStorage->write(60, data, sizeof(data), TIMEOUT_US), 512);
+
+    uint8_t buffer[512];
+    ASSERT_EQ(mStorage->read(60, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    // The write passed through the same hook as writes of other clients, but was written through
+    EXPECT_EQ(memcmp(buffer, data, sizeof(buffer)), 0);
+    EXPECT_EQ(mBlockReads[60], 0U);
+}
+
+TEST_F(DreamcastStorageTest, blockHashesKnownAfterReadsAndWrites)
+{
+    uint8_t buffer[512];
+    uint8_t data[512];
+    memset(data, 0x3C, sizeof(data));
+    bool known = true;
+    uint32_t hash = 0;
+    runOnBus([&](){ known = mStorage->getBlockHash(40, hash); });
+    EXPECT_FALSE(known);
+
+    ASSERT_EQ(mStorage->read(40, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    ASSERT_EQ(mStorage->write(41, data, sizeof(data), TIMEOUT_US), 512);
+
+    uint32_t writtenHash = 0;
+    runOnBus([&]()
+    {
+        known = mStorage->getBlockHash(40, hash) && mStorage->getBlockHash(41, writtenHash);
+    });
+    EXPECT_TRUE(known);
+    EXPECT_EQ(hash, VmuBlockCache::hash(buffer));
+    EXPECT_EQ(writtenHash, VmuBlockCache::hash(data));
+}
+
+TEST_F(DreamcastStorageTest, bulkWriteSkipsBlockHoldingData)
+{
+    uint8_t data[512];
+    ASSERT_EQ(mStorage->read(45, data, sizeof(data), TIMEOUT_US), 512);
+
+    RecordingBulkListener listener;
+    runOnBus([&](){ ASSERT_TRUE(mStorage->startBulkWrite(45, data, &listener, true)); });
+    while (listener.numWritten == 0);
+
+    ASSERT_EQ(listener.blocksWritten, (std::vector<uint8_t>{45}));
+    EXPECT_TRUE(listener.writeSuccess[0]);
+    EXPECT_FALSE(listener.writeWritten[0]);
+    // Read back to confirm the hash
+    EXPECT_EQ(mBlockReads[45], 2U);
+    EXPECT_EQ(mWritePhases, 0U);
+    EXPECT_EQ(mCommits, 0U);
+}
+
+TEST_F(DreamcastStorageTest, bulkWriteWithMatchingHashWritesChangedBlock)
+{
+    uint8_t data[512];
+    ASSERT_EQ(mStorage->read(46, data, sizeof(data), TIMEOUT_US), 512);
+    // The card changed without this object seeing the write, so the known hash is stale
+    uint8_t changed[512];
+    memset(changed, 0x77, sizeof(changed));
+    setBlock(46, changed);
+
+    RecordingBulkListener listener;
+    runOnBus([&](){ ASSERT_TRUE(mStorage->startBulkWrite(46, data, &listener, true)); });
+    while (listener.numWritten == 0);
+
+    EXPECT_TRUE(listener.writeSuccess[0]);
+    EXPECT_TRUE(listener.writeWritten[0]);
+    EXPECT_EQ(mCommits, 1U);
+    uint8_t stored[512];
+    getBlock(46, stored);
+    EXPECT_EQ(memcmp(stored, data, sizeof(stored)), 0);
+}
+
+TEST_F(DreamcastStorageTest, unhashedOnlyBulkReadSkipsKnownBlocks)
+{
+    uint8_t buffer[512];
+    ASSERT_EQ(mStorage->read(50, buffer, sizeof(buffer), TIMEOUT_US), 512);
+    ASSERT_EQ(mStorage->read(52, buffer, sizeof(buffer), TIMEOUT_US), 512);
+
+    RecordingBulkListener listener;
+    runOnBus([&](){ mStorage->startBulkRead(50, 53, &listener, true); });
+    while (!listener.readDone);
+
+    EXPECT_TRUE(listener.readSuccess);
+    EXPECT_EQ(listener.readNextBlock, 54U);
+    EXPECT_EQ(listener.blocksRead, (std::vector<uint8_t>{51, 53}));
+    EXPECT_EQ(mBlockReads[50], 1U);
+    EXPECT_EQ(mBlockReads[52], 1U);
+}
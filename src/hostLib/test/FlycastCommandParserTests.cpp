@@ -0,0 +1,542 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MockClock.hpp"
+#include "MockDreamcastControllerObserver.hpp"
+#include "MockUsbFileSystem.hpp"
+#include "MockUsbCdc.hpp"
+
+#include "FlycastCommandParser.hpp"
+#include "PrioritizedTxScheduler.hpp"
+#include "PlayerData.hpp"
+#include "dreamcast_constants.h"
+#include "hal/Usb/BinaryFrame.hpp"
+
+#include <memory>
+#include <string>
+#include <cstring>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::Return;
+
+// Local peripheral which answers each packet with a data transfer echoing the packet's payload
+class EchoPacketHandler : public MaplePacketHandler
+{
+    public:
+        virtual bool handlePacket(const MaplePacket& in, MaplePacket& out) final
+        {
+            ++numHandled;
+            out.frame.command = COMMAND_RESPONSE_DATA_XFER;
+            out.setPayload(in.payload.data(), in.payload.size());
+            return true;
+        }
+
+        uint32_t numHandled = 0;
+};
+
+class FlycastCommandParserTest : public ::testing::Test
+{
+    public:
+        FlycastCommandParserTest() :
+            mRumbleSlot(mClock),
+            mScheduler(std::make_shared<PrioritizedTxScheduler>(0x00)),
+            mPlayerData(std::make_shared<PlayerData>(0,
+                                                     mDreamcastControllerObserver,
+                                                     mScreenData,
+                                                     mClock,
+                                                     mUsbFileSystem,
+                                                     mResponseCache,
+                                                     mStorageRegistry,
+                                                     mRumbleSlot)),
+            mParser(&mScheduler, SENDER_ADDRESSES, 1, {mPlayerData})
+        {
+            MockUsbCdc::reset();
+        }
+
+    protected:
+        //! Submits the given string to the parser and returns what the parser printed
+        std::string submit(const char* str)
+        {
+            testing::internal::CaptureStdout();
+            mParser.submit(str, strlen(str));
+            return testing::internal::GetCapturedStdout();
+        }
+
+        //! Submits the given words as a binary frame with the given tag
+        bool submitBinary(uint8_t tag, const std::vector<uint32_t>& words)
+        {
+            std::vector<uint8_t> data(words.size() * sizeof(uint32_t));
+            for (uint32_t i = 0; i < words.size(); ++i)
+            {
+                BinaryFrame::putWord(words[i], &data[i * sizeof(uint32_t)]);
+            }
+            return mParser.submitBinary(tag, data.data(), data.size());
+        }
+
+        //! @returns the decoded binary response frame written to the CDC TTY
+        std::vector<uint8_t> decodeWritten()
+        {
+            std::vector<uint8_t> frame(MockUsbCdc::written);
+            if (frame.empty() || frame.back() != BinaryFrame::DELIMITER)
+            {
+                return std::vector<uint8_t>();
+            }
+            int32_t len = BinaryFrame::decode(frame.data(), frame.size() - 1);
+            frame.resize(len > 0 ? len : 0);
+            return frame;
+        }
+
+        //! Caches a controller condition, received at the given time
+        void cacheCondition(uint64_t timeUs)
+        {
+            uint32_t words[] = {0x08002003, DEVICE_FN_CONTROLLER, 0xFFFF0000, 0x80808080};
+            mResponseCache.setCondition(std::make_shared<MaplePacket>(words, 4), timeUs);
+        }
+
+        //! Pops the next scheduled transmission
+        std::shared_ptr<Transmission> popScheduled()
+        {
+            PrioritizedTxScheduler::ScheduleItem item = mScheduler->peekNext(0);
+            std::shared_ptr<Transmission> tx = item.getTx();
+            mScheduler->popItem(item);
+            return tx;
+        }
+
+        //! Completes the given transmission with the given response and returns what was printed
+        std::string complete(std::shared_ptr<Transmission> tx, const std::vector<uint32_t>& words)
+        {
+            testing::internal::CaptureStdout();
+            tx->transmitter->txComplete(std::make_shared<MaplePacket>(words.data(), words.size()), tx);
+            return testing::internal::GetCapturedStdout();
+        }
+
+        //! @returns the number of transmissions currently scheduled
+        uint32_t numScheduled()
+        {
+            return mScheduler->countRecipients(0x20);
+        }
+
+    protected:
+        static const uint8_t SENDER_ADDRESSES[1];
+        MockDreamcastControllerObserver mDreamcastControllerObserver;
+        MockClock mClock;
+        MockUsbFileSystem mUsbFileSystem;
+        ScreenData mScreenData;
+        ResponseCache mResponseCache;
+        StorageRegistry mStorageRegistry;
+        RumbleSlot mRumbleSlot;
+        std::shared_ptr<PrioritizedTxScheduler> mScheduler;
+        std::shared_ptr<PlayerData> mPlayerData;
+        FlycastCommandParser mParser;
+};
+
+const uint8_t FlycastCommandParserTest::SENDER_ADDRESSES[1] = {0x00};
+
+TEST_F(FlycastCommandParserTest, conditionGoesToBusByDefault)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+
+    // --- TEST EXECUTION ---
+    std::string output = submit("X09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(numScheduled(), 1);
+}
+
+TEST_F(FlycastCommandParserTest, conditionServedFromCache)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillOnce(Return(1250));
+
+    // --- TEST EXECUTION ---
+    std::string enableOutput = submit("XS1");
+    std::string output = submit("X09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(enableOutput, "*cached condition on\n");
+    EXPECT_EQ(output, " 08 00 20 03 00 00 00 01 FF FF 00 00 80 80 80 80 @250\n");
+    EXPECT_EQ(numScheduled(), 0);
+}
+
+TEST_F(FlycastCommandParserTest, staleConditionGoesToBus)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillOnce(Return(1000 + 50001));
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    std::string output = submit("X09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(numScheduled(), 1);
+}
+
+TEST_F(FlycastCommandParserTest, noCachedConditionGoesToBus)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    mResponseCache.clearCondition();
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    std::string output = submit("X09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(numScheduled(), 1);
+}
+
+TEST_F(FlycastCommandParserTest, cacheDisabledGoesToBus)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    std::string disableOutput = submit("XS0");
+    std::string output = submit("X09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(disableOutput, "*cached condition off\n");
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(numScheduled(), 1);
+}
+
+TEST_F(FlycastCommandParserTest, deviceInfoServedFromCache)
+{
+    // --- MOCKING ---
+    uint32_t words[] = {0x05002004, DEVICE_FN_CONTROLLER, 0x12345678, 0x9ABCDEF0, 0x00000000};
+    mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(words, 5));
+
+    // --- TEST EXECUTION ---
+    std::string output = submit("X01200000");
+    std::string statsOutput = submit("X?");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, " 05 00 20 04 00 00 00 01 12 34 56 78 9A BC DE F0 00 00 00 00\n");
+    EXPECT_EQ(numScheduled(), 0);
+    EXPECT_EQ(statsOutput, "*P1 device info cache hits: 1 misses: 0 ratio: 100%\n"
+                           "*P1 screen writes saved: 0\n"
+                           "*P1 rumble latency last: 0 us max: 0 us late: 0 replaced: 0\n");
+}
+
+TEST_F(FlycastCommandParserTest, deviceInfoMissGoesToBus)
+{
+    // --- TEST EXECUTION ---
+    std::string output = submit("X01200000");
+    std::string statsOutput = submit("X?");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(numScheduled(), 1);
+    EXPECT_EQ(statsOutput, "*P1 device info cache hits: 0 misses: 1 ratio: 0%\n"
+                           "*P1 screen writes saved: 0\n"
+                           "*P1 rumble latency last: 0 us max: 0 us late: 0 replaced: 0\n");
+}
+
+TEST_F(FlycastCommandParserTest, binaryConditionServedFromCache)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillOnce(Return(1250));
+    submit("XS1");
+
+    // --- TEST EXECUTION ---
+    bool accepted = submitBinary(0x5A, {0x09200001, DEVICE_FN_CONTROLLER});
+
+    // --- EXPECTATIONS ---
+    EXPECT_TRUE(accepted);
+    EXPECT_EQ(numScheduled(), 0);
+    std::vector<uint8_t> expected = {
+        'X', 0x5A, BinaryFrame::STATUS_OK,
+        0x08, 0x00, 0x20, 0x03,
+        0x00, 0x00, 0x00, 0x01,
+        0xFF, 0xFF, 0x00, 0x00,
+        0x80, 0x80, 0x80, 0x80
+    };
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(decodeWritten(), expected);
+}
+
+TEST_F(FlycastCommandParserTest, binaryPacketGoesToBus)
+{
+    // --- TEST EXECUTION ---
+    bool accepted = submitBinary(0x01, {0x09200001, DEVICE_FN_CONTROLLER});
+
+    // --- EXPECTATIONS ---
+    EXPECT_TRUE(accepted);
+    EXPECT_EQ(numScheduled(), 1);
+    EXPECT_TRUE(MockUsbCdc::written.empty());
+}
+
+TEST_F(FlycastCommandParserTest, binaryLengthMismatch)
+{
+    // --- TEST EXECUTION ---
+    // Frame word claims 2 payload words, but only 1 given
+    bool accepted = submitBinary(0x02, {0x09200002, DEVICE_FN_CONTROLLER});
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(accepted);
+    EXPECT_EQ(numScheduled(), 0);
+    std::vector<uint8_t> expected = {'X', 0x02, BinaryFrame::STATUS_INVALID_PACKET};
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(decodeWritten(), expected);
+}
+
+TEST_F(FlycastCommandParserTest, binaryInvalidSenderRejected)
+{
+    // --- MOCKING ---
+    // With more than one sender, the sender address must match one of them
+    static const uint8_t senders[2] = {0x00, 0x40};
+    std::shared_ptr<PrioritizedTxScheduler> otherScheduler = std::make_shared<PrioritizedTxScheduler>(0x40);
+    std::shared_ptr<PrioritizedTxScheduler> schedulers[2] = {mScheduler, otherScheduler};
+    FlycastCommandParser parser(schedulers, senders, 2, {mPlayerData, mPlayerData});
+
+    // --- TEST EXECUTION ---
+    std::vector<uint8_t> data(2 * sizeof(uint32_t));
+    BinaryFrame::putWord(0x09208001, &data[0]);
+    BinaryFrame::putWord(DEVICE_FN_CONTROLLER, &data[sizeof(uint32_t)]);
+    bool accepted = parser.submitBinary(0x04, data.data(), data.size());
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(accepted);
+    EXPECT_EQ(numScheduled(), 0);
+    std::vector<uint8_t> expected = {'X', 0x04, BinaryFrame::STATUS_INVALID_SENDER};
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(decodeWritten(), expected);
+}
+
+TEST_F(FlycastCommandParserTest, oversizedResponsePacketNotSentAsOk)
+{
+    // --- TEST EXECUTION ---
+    // More payload words than a frame word can describe
+    MaplePacket packet({.command=COMMAND_RESPONSE_DATA_XFER, .recipientAddr=0x00});
+    packet.payload.assign(256, 0x12345678);
+    BinaryFrame::writeResponse('X', 0x03, BinaryFrame::STATUS_OK, &packet);
+
+    // --- EXPECTATIONS ---
+    std::vector<uint8_t> expected = {'X', 0x03, BinaryFrame::STATUS_TRUNCATED};
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(decodeWritten(), expected);
+}
+
+TEST_F(FlycastCommandParserTest, taggedRequestsCompleteOutOfOrder)
+{
+    // --- TEST EXECUTION ---
+    std::string output1 = submit("X#a1 0C200002 00000004 00000000");
+    std::string output2 = submit("X#b2 09200001 00000001");
+    std::string output3 = submit("X09200001 00000001");
+    ASSERT_EQ(numScheduled(), 3);
+    std::shared_ptr<Transmission> tx1 = popScheduled();
+    std::shared_ptr<Transmission> tx2 = popScheduled();
+    std::shared_ptr<Transmission> tx3 = popScheduled();
+    std::string completeOutput3 = complete(tx3, {0x07002000});
+    std::string completeOutput2 = complete(tx2, {0x08002001, DEVICE_FN_CONTROLLER});
+    std::string completeOutput1 = complete(tx1, {0x07002000});
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output1, "");
+    EXPECT_EQ(output2, "");
+    EXPECT_EQ(output3, "");
+    EXPECT_EQ(completeOutput3, " 07 00 20 00\n");
+    EXPECT_EQ(completeOutput2, "#b2 08 00 20 01 00 00 00 01\n");
+    EXPECT_EQ(completeOutput1, "#a1 07 00 20 00\n");
+}
+
+TEST_F(FlycastCommandParserTest, taggedRequestFailures)
+{
+    // --- TEST EXECUTION ---
+    std::string missingOutput = submit("X#7 0920000");
+    std::string emptyTagOutput = submit("X# 09200001 00000001");
+    std::string longTagOutput = submit("X#123456789 09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(missingOutput, "#7 *failed missing data\n");
+    EXPECT_EQ(emptyTagOutput, "*failed invalid tag\n");
+    EXPECT_EQ(longTagOutput, "*failed invalid tag\n");
+    EXPECT_EQ(numScheduled(), 0);
+}
+
+TEST_F(FlycastCommandParserTest, taggedConditionServedFromCache)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillRepeatedly(Return(1500));
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    std::string output = submit("X#12345678 09200001 00000001");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "#12345678 08 00 20 03 00 00 00 01 FF FF 00 00 80 80 80 80 @500\n");
+    EXPECT_EQ(numScheduled(), 0);
+}
+
+TEST_F(FlycastCommandParserTest, textBatchRespondsOnceAllComplete)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillRepeatedly(Return(1200));
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    std::string output = submit("X#f1 09200001 00000001; 0C200002 00000004 00000000;0D010000");
+    ASSERT_EQ(numScheduled(), 1);
+    std::shared_ptr<Transmission> tx1 = popScheduled();
+    std::shared_ptr<Transmission> tx2 = popScheduled();
+    std::string completeOutput2 = complete(tx2, {0x07000100});
+    testing::internal::CaptureStdout();
+    tx1->transmitter->txFailed(false, true, tx1);
+    std::string completeOutput1 = testing::internal::GetCapturedStdout();
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(completeOutput2, "");
+    EXPECT_EQ(completeOutput1,
+              "#f1 08 00 20 03 00 00 00 01 FF FF 00 00 80 80 80 80 @200; *failed read; 07 00 01 00\n");
+}
+
+TEST_F(FlycastCommandParserTest, textBatchPartialPacketSendsNothing)
+{
+    // --- TEST EXECUTION ---
+    std::string output = submit("X09200001 00000001;0920000");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, "*failed missing data\n");
+    EXPECT_EQ(numScheduled(), 0);
+}
+
+TEST_F(FlycastCommandParserTest, binaryBatchFromCache)
+{
+    // --- MOCKING ---
+    cacheCondition(1000);
+    EXPECT_CALL(mClock, getTimeUs()).WillRepeatedly(Return(1000));
+    uint32_t infoWords[] = {0x05002004, DEVICE_FN_CONTROLLER, 0, 0, 0};
+    mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(infoWords, 5));
+
+    // --- TEST EXECUTION ---
+    submit("XS1");
+    bool accepted = submitBinary(0x05, {0x01200000, 0x09200001, DEVICE_FN_CONTROLLER});
+
+    // --- EXPECTATIONS ---
+    EXPECT_TRUE(accepted);
+    EXPECT_EQ(numScheduled(), 0);
+    std::vector<uint8_t> expected = {
+        'X', 0x05, BinaryFrame::STATUS_OK,
+        BinaryFrame::STATUS_OK,
+        0x05, 0x00, 0x20, 0x04,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        BinaryFrame::STATUS_OK,
+        0x08, 0x00, 0x20, 0x03,
+        0x00, 0x00, 0x00, 0x01,
+        0xFF, 0xFF, 0x00, 0x00,
+        0x80, 0x80, 0x80, 0x80};
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(decodeWritten(), expected);
+}
+
+TEST_F(FlycastCommandParserTest, submitReportsRejectedCommands)
+{
+    // --- TEST EXECUTION ---
+    testing::internal::CaptureStdout();
+    bool packetAccepted = mParser.submit("X09200001 00000001", 18);
+    bool specialAccepted = mParser.submit("XS0", 3);
+    bool partialAccepted = mParser.submit("X0920000", 8);
+    bool tagAccepted = mParser.submit("X# 09200001", 11);
+    testing::internal::GetCapturedStdout();
+
+    // --- EXPECTATIONS ---
+    EXPECT_TRUE(packetAccepted);
+    EXPECT_TRUE(specialAccepted);
+    EXPECT_FALSE(partialAccepted);
+    EXPECT_FALSE(tagAccepted);
+}
+
+TEST_F(FlycastCommandParserTest, localPeripheralAnsweredWithoutBus)
+{
+    // --- MOCKING ---
+    std::shared_ptr<EchoPacketHandler> handler = std::make_shared<EchoPacketHandler>();
+    ASSERT_TRUE(mParser.attachLocalPeripheral(0, 0, handler));
+
+    // --- TEST EXECUTION ---
+    std::string output = submit("X0B010002 00000002 00000010");
+    std::string otherSlotOutput = submit("X0B020002 00000002 00000010");
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, " 08 00 01 02 00 00 00 02 00 00 00 10\n");
+    EXPECT_EQ(handler->numHandled, 1U);
+    EXPECT_EQ(mScheduler->countRecipients(0x01), 0U);
+    EXPECT_EQ(otherSlotOutput, "");
+    EXPECT_EQ(mScheduler->countRecipients(0x02), 1U);
+}
+
+TEST_F(FlycastCommandParserTest, localPeripheralShownInMainPeripheralResponse)
+{
+    // --- MOCKING ---
+    ASSERT_TRUE(mParser.attachLocalPeripheral(0, 0, std::make_shared<EchoPacketHandler>()));
+    EXPECT_FALSE(mParser.attachLocalPeripheral(1, 0, std::make_shared<EchoPacketHandler>()));
+
+    // --- TEST EXECUTION ---
+    submit("X09200001 00000001");
+    ASSERT_EQ(numScheduled(), 1);
+    std::string attachedOutput = complete(popScheduled(), {0x08002001, DEVICE_FN_CONTROLLER});
+    ASSERT_TRUE(mParser.attachLocalPeripheral(0, 0, nullptr));
+    submit("X09200001 00000001");
+    ASSERT_EQ(numScheduled(), 1);
+    std::string detachedOutput = complete(popScheduled(), {0x08002001, DEVICE_FN_CONTROLLER});
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(attachedOutput, " 08 00 21 01 00 00 00 01\n");
+    EXPECT_EQ(detachedOutput, " 08 00 20 01 00 00 00 01\n");
+}
+
+TEST_F(FlycastCommandParserTest, localPeripheralsKeptPerParser)
+{
+    // --- MOCKING ---
+    ASSERT_TRUE(mParser.attachLocalPeripheral(0, 0, std::make_shared<EchoPacketHandler>()));
+    uint32_t words[] = {0x05002004, DEVICE_FN_CONTROLLER, 0x12345678, 0x9ABCDEF0, 0x00000000};
+    mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(words, 5));
+
+    // --- TEST EXECUTION ---
+    // Another parser, constructed later, has no local peripherals of its own
+    std::shared_ptr<PrioritizedTxScheduler> otherScheduler = std::make_shared<PrioritizedTxScheduler>(0x00);
+    FlycastCommandParser otherParser(&otherScheduler, SENDER_ADDRESSES, 1, {mPlayerData});
+    std::string output = submit("X01200000");
+    testing::internal::CaptureStdout();
+    otherParser.submit("X01200000", 9);
+    std::string otherOutput = testing::internal::GetCapturedStdout();
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(output, " 05 00 21 04 00 00 00 01 12 34 56 78 9A BC DE F0 00 00 00 00\n");
+    EXPECT_EQ(otherOutput, " 05 00 20 04 00 00 00 01 12 34 56 78 9A BC DE F0 00 00 00 00\n");
+}
@@ -0,0 +1,137 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "HexCodec.hpp"
+#include "hal/MapleBus/MaplePacket.hpp"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+//! Runs the given function, returning everything it wrote to stdout
+template<typename Func>
+static std::string captureOutput(Func func)
+{
+    testing::internal::CaptureStdout();
+    func();
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(HexDecoderTest, decodesWordsIgnoringNonHex)
+{
+    uint32_t words[4] = {};
+    HexDecoder decoder(words, 4);
+    const std::string text = "09 20 00 01 xyz0000 0001\r\n";
+
+    decoder.feed(text.data(), text.size());
+
+    EXPECT_TRUE(decoder.isComplete());
+    EXPECT_FALSE(decoder.isOverflowed());
+    ASSERT_EQ(decoder.getNumWords(), 2U);
+    EXPECT_EQ(words[0], 0x09200001U);
+    EXPECT_EQ(words[1], 0x00000001U);
+}
+
+TEST(HexDecoderTest, continuesPartialWordAcrossFeeds)
+{
+    uint32_t words[2] = {};
+    HexDecoder decoder(words, 2);
+
+    decoder.feed("aBcD", 4);
+    EXPECT_FALSE(decoder.isComplete());
+    EXPECT_EQ(decoder.getNumWords(), 0U);
+
+    decoder.feed("eF01", 4);
+    EXPECT_TRUE(decoder.isComplete());
+    ASSERT_EQ(decoder.getNumWords(), 1U);
+    EXPECT_EQ(words[0], 0xABCDEF01U);
+
+    decoder.feed("12", 2);
+    EXPECT_FALSE(decoder.isComplete());
+
+    decoder.reset();
+    EXPECT_FALSE(decoder.isComplete());
+    EXPECT_EQ(decoder.getNumWords(), 0U);
+}
+
+TEST(HexDecoderTest, flagsOverflow)
+{
+    uint32_t words[2] = {0, 0};
+    HexDecoder decoder(words, 1);
+    const std::string text = "11111111 22222222";
+
+    decoder.feed(text.data(), text.size());
+
+    EXPECT_TRUE(decoder.isOverflowed());
+    EXPECT_FALSE(decoder.isComplete());
+    EXPECT_EQ(decoder.getNumWords(), 1U);
+    EXPECT_EQ(words[0], 0x11111111U);
+    // Nothing written past the end of the buffer
+    EXPECT_EQ(words[1], 0U);
+}
+
+TEST(HexEncoderTest, formatsPacketAndNumbers)
+{
+    uint32_t words[] = {0x08200102, 0x00000001, 0xFEDCBA98};
+    MaplePacket packet(words, 3);
+
+    std::string out = captureOutput(
+        [&packet]()
+        {
+            HexEncoder encoder;
+            encoder.putPacketWords(packet);
+            encoder.putChar('|');
+            encoder.putPacketBytes(packet);
+            encoder.putString(" @");
+            encoder.putUnsigned(0);
+            encoder.putChar(' ');
+            encoder.putUnsigned(18446744073709551615ULL);
+            encoder.putChar(' ');
+            encoder.putSigned(-42);
+        });
+
+    EXPECT_EQ(out,
+              "08200102 00000001 FEDCBA98"
+              "| 08 20 01 02 00 00 00 01 FE DC BA 98"
+              " @0 18446744073709551615 -42");
+}
+
+TEST(HexEncoderTest, flushesWhenBufferFills)
+{
+    std::string expected;
+    std::string out = captureOutput(
+        [&expected]()
+        {
+            HexEncoder encoder;
+            for (uint32_t i = 0; i < 200; ++i)
+            {
+                encoder.putWordBytes(i);
+                expected += " 00 00 00 ";
+                const char hex[] = "0123456789ABCDEF";
+                expected += hex[(i >> 4) & 0x0F];
+                expected += hex[i & 0x0F];
+            }
+        });
+
+    EXPECT_EQ(out, expected);
+}
@@ -24,7 +24,6 @@
 #include "MockMapleBus.hpp"
 #include "MockDreamcastControllerObserver.hpp"
 #include "MockDreamcastPeripheral.hpp"
-#include "MockMutex.hpp"
 #include "MockClock.hpp"
 #include "MockUsbFileSystem.hpp"
 
@@ -135,9 +134,8 @@ class MainNodeTest : public ::testing::Test
         //! Sets up the DreamcastMainNode with mocked interfaces
         MainNodeTest() :
             mDreamcastControllerObserver(),
-            mMutex(),
-            mScreenData(mMutex),
-            mPlayerData{0, mDreamcastControllerObserver, mScreenData, mClock, mUsbFileSystem},
+            mRumbleSlot(mClock),
+            mPlayerData{0, mDreamcastControllerObserver, mScreenData, mClock, mUsbFileSystem, mResponseCache, mStorageRegistry, mRumbleSlot},
             mMapleBus(),
             mPrioritizedTxScheduler(std::make_shared<PrioritizedTxScheduler>(0x00)),
             mDreamcastMainNode(mMapleBus, mPlayerData, mPrioritizedTxScheduler)
@@ -145,10 +143,12 @@ class MainNodeTest : public ::testing::Test
 
     protected:
         MockDreamcastControllerObserver mDreamcastControllerObserver;
-        MockMutex mMutex;
         MockClock mClock;
         MockUsbFileSystem mUsbFileSystem;
         ScreenData mScreenData;
+        ResponseCache mResponseCache;
+        StorageRegistry mStorageRegistry;
+        RumbleSlot mRumbleSlot;
         PlayerData mPlayerData;
         MockMapleBus mMapleBus;
         std::shared_ptr<PrioritizedTxScheduler> mPrioritizedTxScheduler;
@@ -269,6 +269,10 @@ TEST_F(MainNodeTest, peripheralConnect)
     mDreamcastMainNode.task(1000000);
 
     // --- EXPECTATIONS ---
+    // The device info response is cached for the main peripheral
+    std::shared_ptr<const MaplePacket> cached = mResponseCache.lookupDeviceInfo(0x20);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->frame.toWord(), 0x05002004);
 }
 
 TEST_F(MainNodeTest, peripheralDisconnect)
@@ -283,6 +287,9 @@ TEST_F(MainNodeTest, peripheralDisconnect)
     EXPECT_CALL(mMapleBus, mockWrite(_, _, _)).Times(AnyNumber()).WillRepeatedly(Return(true));
     mDreamcastMainNode.getEndpointTxScheduler()->add(0, &mDreamcastMainNode, 123, (uint32_t*)nullptr, 0, true);
     mDreamcastMainNode.getTransmissionTimeliner().writeTask(0);
+    // Device info was previously cached
+    uint32_t deviceInfo[5] = {0x05002004, 0x00000001, 0, 0, 0};
+    mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(deviceInfo, 5));
 
     // --- MOCKING ---
     // The task will process events, and it will return read failure
@@ -326,4 +333,52 @@ TEST_F(MainNodeTest, peripheralDisconnect)
     // --- EXPECTATIONS ---
     // All peripherals removed
     EXPECT_EQ(mDreamcastMainNode.getPeripherals().size(), 0);
+    // Cached device info invalidated
+    EXPECT_EQ(mResponseCache.lookupDeviceInfo(0x20), nullptr);
+}
+
+TEST_F(MainNodeTest, subPeripheralInsertionInvalidatesMainDeviceInfo)
+{
+    // --- SETUP ---
+    EXPECT_CALL(mMapleBus, isBusy).Times(AnyNumber()).WillRepeatedly(Return(false));
+    // A main peripheral is currently connected with nothing inserted
+    std::shared_ptr<MockDreamcastPeripheral> mockedDreamcastPeripheral =
+        std::make_shared<MockDreamcastPeripheral>(0x20, 0, mDreamcastMainNode.getEndpointTxScheduler(), mPlayerData.playerIndex);
+    mDreamcastMainNode.getPeripherals().push_back(mockedDreamcastPeripheral);
+    // This is a bad way to do it, but I need mCurrentTx in TransmissionTimeliner to be set to something
+    EXPECT_CALL(mMapleBus, mockWrite(_, _, _)).Times(AnyNumber()).WillRepeatedly(Return(true));
+    mDreamcastMainNode.getEndpointTxScheduler()->add(0, nullptr, COMMAND_GET_CONDITION, (uint32_t*)nullptr, 0, true);
+    mDreamcastMainNode.getTransmissionTimeliner().writeTask(0);
+    // Device info was previously cached without any sub peripheral bits set
+    uint32_t deviceInfo[5] = {0x05002004, 0x00000001, 0, 0, 0};
+    mResponseCache.setDeviceInfo(0x20, std::make_shared<MaplePacket>(deviceInfo, 5));
+
+    // --- MOCKING ---
+    // A condition response arrives showing a sub peripheral inserted in the first slot
+    uint32_t data[2] = {0x08002101, 0x00000001};
+    MapleBusInterface::Status status;
+    status.readBuffer = data;
+    status.readBufferLen = 2;
+    status.phase = MapleBusInterface::Phase::READ_COMPLETE;
+    EXPECT_CALL(mMapleBus, processEvents(1000000))
+        .Times(1)
+        .WillOnce(Return(status));
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[0], setConnected(true, _)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[1], setConnected(false, _)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[2], setConnected(false, _)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[3], setConnected(false, _)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[4], setConnected(false, _)).Times(1);
+    EXPECT_CALL(*mockedDreamcastPeripheral, task(1000000)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[0], task(1000000)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[1], task(1000000)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[2], task(1000000)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[3], task(1000000)).Times(1);
+    EXPECT_CALL(*mDreamcastMainNode.mMockedSubNodes[4], task(1000000)).Times(1);
+
+    // --- TEST EXECUTION ---
+    mDreamcastMainNode.task(1000000);
+
+    // --- EXPECTATIONS ---
+    // The stale presence bits are no longer served from cache
+    EXPECT_EQ(mResponseCache.lookupDeviceInfo(0x20), nullptr);
 }
@@ -0,0 +1,146 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RumbleEffect.hpp"
+#include "dreamcast_constants.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+class RumbleEffectTest : public ::testing::Test
+{
+    protected:
+        //! Compiles envelopes into mCommands, expecting success
+        uint32_t compile(const RumbleEnvelope* envelopes, uint32_t numEnvelopes)
+        {
+            uint32_t numCommands = 0;
+            EXPECT_TRUE(mCompiler.compile(
+                envelopes, numEnvelopes, mCommands, RumbleEffectCompiler::MAX_COMMANDS, numCommands));
+            return numCommands;
+        }
+
+        void expectCommand(uint32_t idx, uint32_t offsetUs, uint8_t command, uint32_t word)
+        {
+            EXPECT_EQ(mCommands[idx].offsetUs, offsetUs);
+            EXPECT_EQ(mCommands[idx].command, command);
+            EXPECT_EQ(mCommands[idx].word, word);
+        }
+
+        RumbleEffectCompiler mCompiler;
+        RumbleCommand mCommands[RumbleEffectCompiler::MAX_COMMANDS];
+};
+
+TEST_F(RumbleEffectTest, constantUsesAutoStopInsteadOfRepeats)
+{
+    RumbleEnvelope envelope = {5, 0, 250, 0};
+
+    ASSERT_EQ(compile(&envelope, 1), 2U);
+    expectCommand(0, 0, COMMAND_BLOCK_WRITE, 0x00020000);
+    expectCommand(1, 0, COMMAND_SET_CONDITION, 0x11503B00);
+
+    // Auto-stop time is already set the second time around
+    ASSERT_EQ(compile(&envelope, 1), 1U);
+    expectCommand(0, 0, COMMAND_SET_CONDITION, 0x11503B00);
+
+    // Unless it became unknown
+    mCompiler.forgetAutoStop();
+    EXPECT_EQ(compile(&envelope, 1), 2U);
+}
+
+TEST_F(RumbleEffectTest, constantStoppedWhenAutoStopOvershoots)
+{
+    RumbleEnvelope envelope = {7, 0x20, 300, 0};
+
+    ASSERT_EQ(compile(&envelope, 1), 3U);
+    expectCommand(0, 0, COMMAND_BLOCK_WRITE, 0x00020100);
+    expectCommand(1, 0, COMMAND_SET_CONDITION, 0x11702000);
+    expectCommand(2, 300000, COMMAND_SET_CONDITION, 0x10000000);
+}
+
+TEST_F(RumbleEffectTest, matchingConstantsMerge)
+{
+    RumbleEnvelope envelopes[] = {{3, 0, 500, 0}, {3, 0, 500, 0}, {3, 0, 1000, 0}};
+
+    ASSERT_EQ(compile(envelopes, 3), 2U);
+    expectCommand(0, 0, COMMAND_BLOCK_WRITE, 0x00020700);
+    expectCommand(1, 0, COMMAND_SET_CONDITION, 0x11303B00);
+}
+
+TEST_F(RumbleEffectTest, longConstantRestartedInChunks)
+{
+    RumbleEnvelope envelope = {1, 0, 100000, 0};
+
+    ASSERT_EQ(compile(&envelope, 1), 4U);
+    expectCommand(0, 0, COMMAND_BLOCK_WRITE, 0x0002FF00);
+    expectCommand(1, 0, COMMAND_SET_CONDITION, 0x11103B00);
+    expectCommand(2, 64000000, COMMAND_BLOCK_WRITE, 0x00028F00);
+    expectCommand(3, 64000000, COMMAND_SET_CONDITION, 0x11103B00);
+}
+
+TEST_F(RumbleEffectTest, fullDecayIsSingleCommand)
+{
+    RumbleEnvelope envelope = {7, 0, 1000, 7};
+
+    ASSERT_EQ(compile(&envelope, 1), 1U);
+    expectCommand(0, 0, COMMAND_SET_CONDITION, 0x10873B03);
+}
+
+TEST_F(RumbleEffectTest, partialRampStoppedAtEnd)
+{
+    // Rise from 2 to 4 - the pack would continue on up to 7
+    RumbleEnvelope envelope = {2, 0x3B, 600, -2};
+
+    ASSERT_EQ(compile(&envelope, 1), 2U);
+    expectCommand(0, 0, COMMAND_SET_CONDITION, 0x10283B08);
+    expectCommand(1, 600000, COMMAND_SET_CONDITION, 0x10000000);
+}
+
+TEST_F(RumbleEffectTest, nextSegmentReplacesPreviousWithoutStop)
+{
+    RumbleEnvelope envelopes[] = {{2, 0x3B, 600, -2}, {4, 0, 250, 0}, {0, 0, 1000, 0}, {7, 0, 1000, 7}};
+
+    ASSERT_EQ(compile(envelopes, 4), 4U);
+    expectCommand(0, 0, COMMAND_SET_CONDITION, 0x10283B08);
+    expectCommand(1, 600000, COMMAND_BLOCK_WRITE, 0x00020000);
+    expectCommand(2, 600000, COMMAND_SET_CONDITION, 0x11403B00);
+    // The constant segment stopped itself during the silence
+    expectCommand(3, 1850000, COMMAND_SET_CONDITION, 0x10873B03);
+}
+
+TEST_F(RumbleEffectTest, tooManyCommandsRejectedWithoutSideEffects)
+{
+    RumbleEnvelope envelopes[RumbleEffectCompiler::MAX_COMMANDS];
+    for (uint32_t i = 0; i < RumbleEffectCompiler::MAX_COMMANDS; ++i)
+    {
+        envelopes[i] = {static_cast<uint8_t>(3 + (i % 2)), 0, 250, 0};
+    }
+
+    uint32_t numCommands = 0;
+    EXPECT_FALSE(mCompiler.compile(
+        envelopes, RumbleEffectCompiler::MAX_COMMANDS, mCommands, RumbleEffectCompiler::MAX_COMMANDS, numCommands));
+    EXPECT_EQ(numCommands, 0U);
+
+    // Auto-stop time wasn't committed by the failed compile
+    RumbleEnvelope envelope = {5, 0, 250, 0};
+    EXPECT_EQ(compile(&envelope, 1), 2U);
+}
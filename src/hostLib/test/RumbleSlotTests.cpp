@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RumbleSlot.hpp"
+#include "MockClock.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::NiceMock;
+
+class RumbleSlotTest : public ::testing::Test
+{
+    public:
+        RumbleSlotTest() :
+            mTimeUs(1000),
+            mClock(),
+            mSlot(mClock)
+        {
+            ON_CALL(mClock, getTimeUs()).WillByDefault([this](){ return mTimeUs; });
+        }
+
+    protected:
+        uint64_t mTimeUs;
+        NiceMock<MockClock> mClock;
+        RumbleSlot mSlot;
+};
+
+TEST_F(RumbleSlotTest, requestConvertedToEnvelope)
+{
+    RumbleEnvelope envelope = {};
+    uint64_t receivedTimeUs = 0;
+    EXPECT_FALSE(mSlot.take(envelope, receivedTimeUs));
+
+    mSlot.vibrate(15.0f, 1.0f, -1, 0.5f);
+
+    ASSERT_TRUE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(envelope.intensity, 7U);
+    EXPECT_EQ(envelope.frequency, 29U);
+    EXPECT_EQ(envelope.decay, 7);
+    EXPECT_EQ(envelope.durationMs, 500U);
+    EXPECT_EQ(receivedTimeUs, 1000U);
+
+    // Only taken once
+    EXPECT_FALSE(mSlot.take(envelope, receivedTimeUs));
+}
+
+TEST_F(RumbleSlotTest, unspecifiedDurationIsBounded)
+{
+    mSlot.vibrate(0.0f, 0.5f, 0, 0.0f);
+
+    RumbleEnvelope envelope = {};
+    uint64_t receivedTimeUs = 0;
+    ASSERT_TRUE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(envelope.intensity, 4U);
+    EXPECT_EQ(envelope.frequency, 0U);
+    EXPECT_EQ(envelope.decay, 0);
+    EXPECT_EQ(envelope.durationMs, 64000U);
+}
+
+TEST_F(RumbleSlotTest, latestRequestReplacesUntakenOne)
+{
+    mSlot.vibrate(0.0f, 1.0f / 7, 0, 1.0f);
+    mSlot.vibrate(0.0f, 2.0f / 7, 0, 1.0f);
+    mSlot.vibrate(0.0f, 3.0f / 7, 0, 1.0f);
+
+    RumbleEnvelope envelope = {};
+    uint64_t receivedTimeUs = 0;
+    ASSERT_TRUE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(envelope.intensity, 3U);
+    EXPECT_FALSE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(mSlot.getNumReplaced(), 2U);
+}
+
+TEST_F(RumbleSlotTest, waitingShortensDuration)
+{
+    mSlot.vibrate(0.0f, 1.0f, 0, 0.25f);
+
+    RumbleEnvelope envelope = {};
+    uint64_t receivedTimeUs = 0;
+    mTimeUs = 101000;
+    ASSERT_TRUE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(envelope.intensity, 7U);
+    EXPECT_EQ(envelope.durationMs, 150U);
+
+    // Nothing is left to play of a request which waited longer than its duration
+    mSlot.vibrate(0.0f, 1.0f, 0, 0.25f);
+    mTimeUs = 351000;
+    ASSERT_TRUE(mSlot.take(envelope, receivedTimeUs));
+    EXPECT_EQ(envelope.intensity, 0U);
+    EXPECT_EQ(envelope.durationMs, 0U);
+}
+
+TEST_F(RumbleSlotTest, latencyMeasured)
+{
+    mTimeUs = 3000;
+    mSlot.recordSent(1000);
+    mTimeUs = 1000 + RumbleSlot::MAX_LATENCY_US + 1;
+    mSlot.recordSent(1000);
+    mTimeUs = 2500;
+    mSlot.recordSent(1000);
+
+    EXPECT_EQ(mSlot.getLastLatencyUs(), 1500U);
+    EXPECT_EQ(mSlot.getMaxLatencyUs(), 10001U);
+    EXPECT_EQ(mSlot.getNumLate(), 1U);
+}
@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ScreenData.hpp"
+
+#include <thread>
+#include <atomic>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+//! Fills a screen where every word holds the given value
+static void fillScreen(uint32_t* screen, uint32_t value)
+{
+    for (uint32_t i = 0; i < ScreenData::NUM_SCREEN_WORDS; ++i)
+    {
+        screen[i] = value;
+    }
+}
+
+TEST(ScreenDataTest, defaultScreenIsNew)
+{
+    ScreenData screenData;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS] = {};
+
+    EXPECT_TRUE(screenData.isNewDataAvailable());
+    screenData.readData(screen);
+
+    EXPECT_FALSE(screenData.isNewDataAvailable());
+    EXPECT_EQ(screen[0], 0x0000FFFFU);
+    EXPECT_EQ(screen[ScreenData::NUM_SCREEN_WORDS - 1], 0xFFFF0000U);
+}
+
+TEST(ScreenDataTest, readGetsLatestOfSeveralWrites)
+{
+    ScreenData screenData;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS] = {};
+    screenData.readData(screen);
+
+    for (uint32_t i = 1; i <= 5; ++i)
+    {
+        fillScreen(screen, i);
+        screenData.setData(screen);
+    }
+    fillScreen(screen, 0);
+
+    EXPECT_TRUE(screenData.isNewDataAvailable());
+    screenData.readData(screen);
+
+    EXPECT_FALSE(screenData.isNewDataAvailable());
+    for (uint32_t i = 0; i < ScreenData::NUM_SCREEN_WORDS; ++i)
+    {
+        EXPECT_EQ(screen[i], 5U);
+    }
+}
+
+TEST(ScreenDataTest, sameScreenAsLastWrittenIsRedundant)
+{
+    ScreenData screenData;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS] = {};
+    screenData.readData(screen);
+
+    // Nothing has been written yet
+    EXPECT_FALSE(screenData.isRedundantWrite(screen));
+    screenData.setLastWritten(screen);
+
+    // Same screen set again
+    screenData.setData(screen);
+    screenData.readData(screen);
+    EXPECT_TRUE(screenData.isRedundantWrite(screen));
+    EXPECT_TRUE(screenData.isRedundantWrite(screen));
+
+    // Different screen
+    screen[10] ^= 1;
+    EXPECT_FALSE(screenData.isRedundantWrite(screen));
+
+    EXPECT_EQ(screenData.getWritesSaved(), 2U);
+}
+
+TEST(ScreenDataTest, clearedLastWrittenIsNeverRedundant)
+{
+    ScreenData screenData;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS] = {};
+    screenData.readData(screen);
+    screenData.setLastWritten(screen);
+
+    screenData.clearLastWritten();
+
+    EXPECT_FALSE(screenData.isRedundantWrite(screen));
+    EXPECT_EQ(screenData.getWritesSaved(), 0U);
+}
+
+TEST(ScreenDataTest, partialWriteKeepsRestOfScreen)
+{
+    ScreenData screenData;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS] = {};
+    fillScreen(screen, 0x11111111);
+    screenData.setData(screen);
+    // Let the writer cycle through all buffers so a stale one would show
+    screenData.setData(screen);
+    screenData.setData(screen);
+
+    uint32_t words[2] = {0x22222222, 0x33333333};
+    screenData.setData(words, 10, 2);
+    screenData.readData(screen);
+
+    EXPECT_EQ(screen[9], 0x11111111U);
+    EXPECT_EQ(screen[10], 0x22222222U);
+    EXPECT_EQ(screen[11], 0x33333333U);
+    EXPECT_EQ(screen[12], 0x11111111U);
+}
+
+TEST(ScreenDataTest, concurrentReadsNeverTear)
+{
+    ScreenData screenData;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]()
+    {
+        uint32_t screen[ScreenData::NUM_SCREEN_WORDS];
+        for (uint32_t i = 1; i <= 20000; ++i)
+        {
+            fillScreen(screen, i);
+            screenData.setData(screen);
+        }
+        done = true;
+    });
+
+    uint32_t numTorn = 0;
+    uint32_t lastValue = 0;
+    uint32_t screen[ScreenData::NUM_SCREEN_WORDS];
+    while (!done || screenData.isNewDataAvailable())
+    {
+        screenData.readData(screen);
+        if (screen[0] == 0x0000FFFF)
+        {
+            // Still the default screen
+            continue;
+        }
+
+        for (uint32_t i = 1; i < ScreenData::NUM_SCREEN_WORDS; ++i)
+        {
+            if (screen[i] != screen[0])
+            {
+                ++numTorn;
+                break;
+            }
+        }
+        // Screens are only ever seen in the order they were written
+        EXPECT_GE(screen[0], lastValue);
+        lastValue = screen[0];
+    }
+    writer.join();
+
+    EXPECT_EQ(numTorn, 0U);
+    EXPECT_EQ(lastValue, 20000U);
+}
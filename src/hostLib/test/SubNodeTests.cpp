@@ -24,7 +24,6 @@
 #include "MockMapleBus.hpp"
 #include "MockDreamcastControllerObserver.hpp"
 #include "MockDreamcastPeripheral.hpp"
-#include "MockMutex.hpp"
 #include "MockClock.hpp"
 #include "MockUsbFileSystem.hpp"
 
@@ -95,9 +94,8 @@ class SubNodeTest : public ::testing::Test
         //! Sets up the DreamcastMainNode with mocked interfaces
         SubNodeTest() :
             mDreamcastControllerObserver(),
-            mMutex(),
-            mScreenData(mMutex),
-            mPlayerData{1, mDreamcastControllerObserver, mScreenData, mClock, mUsbFileSystem},
+            mRumbleSlot(mClock),
+            mPlayerData{1, mDreamcastControllerObserver, mScreenData, mClock, mUsbFileSystem, mResponseCache, mStorageRegistry, mRumbleSlot},
             mPrioritizedTxScheduler(std::make_shared<PrioritizedTxScheduler>(0x00)),
             mEndpointTxScheduler(std::make_shared<EndpointTxScheduler>(
                 mPrioritizedTxScheduler, 0, DreamcastPeripheral::getRecipientAddress(1, 0x01))),
@@ -106,10 +104,12 @@ class SubNodeTest : public ::testing::Test
 
     protected:
         MockDreamcastControllerObserver mDreamcastControllerObserver;
-        MockMutex mMutex;
         MockClock mClock;
         MockUsbFileSystem mUsbFileSystem;
         ScreenData mScreenData;
+        ResponseCache mResponseCache;
+        StorageRegistry mStorageRegistry;
+        RumbleSlot mRumbleSlot;
         PlayerData mPlayerData;
         std::shared_ptr<PrioritizedTxScheduler> mPrioritizedTxScheduler;
         std::shared_ptr<EndpointTxScheduler> mEndpointTxScheduler;
@@ -0,0 +1,168 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuBlockCache.hpp"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+class VmuBlockCacheTest : public ::testing::Test
+{
+    protected:
+        VmuBlockCache mCache;
+
+        //! Stores a block whose bytes are all set to the given value
+        void storeFilled(uint8_t blockNum, uint8_t value)
+        {
+            uint8_t data[VmuBlockCache::BLOCK_SIZE];
+            memset(data, value, sizeof(data));
+            mCache.store(blockNum, data);
+        }
+};
+
+TEST_F(VmuBlockCacheTest, missThenHit)
+{
+    uint8_t buffer[VmuBlockCache::BLOCK_SIZE] = {};
+
+    EXPECT_FALSE(mCache.lookup(7, buffer, sizeof(buffer)));
+    storeFilled(7, 0xA5);
+    ASSERT_TRUE(mCache.lookup(7, buffer, sizeof(buffer)));
+
+    EXPECT_EQ(buffer[0], 0xA5);
+    EXPECT_EQ(buffer[VmuBlockCache::BLOCK_SIZE - 1], 0xA5);
+    EXPECT_EQ(mCache.getHits(), 1U);
+    EXPECT_EQ(mCache.getMisses(), 1U);
+}
+
+TEST_F(VmuBlockCacheTest, partialLookupOnlyCopiesBufferLength)
+{
+    uint8_t buffer[8];
+    memset(buffer, 0x11, sizeof(buffer));
+    storeFilled(3, 0x22);
+
+    ASSERT_TRUE(mCache.lookup(3, buffer, 4));
+
+    EXPECT_EQ(buffer[3], 0x22);
+    EXPECT_EQ(buffer[4], 0x11);
+}
+
+TEST_F(VmuBlockCacheTest, pinnedBlocks)
+{
+    EXPECT_TRUE(VmuBlockCache::isPinned(255));
+    EXPECT_TRUE(VmuBlockCache::isPinned(254));
+    EXPECT_FALSE(VmuBlockCache::isPinned(253));
+    EXPECT_FALSE(VmuBlockCache::isPinned(0));
+}
+
+TEST_F(VmuBlockCacheTest, fileSystemBlocks)
+{
+    EXPECT_TRUE(VmuBlockCache::isFileSystemBlock(255));
+    EXPECT_TRUE(VmuBlockCache::isFileSystemBlock(254));
+    EXPECT_TRUE(VmuBlockCache::isFileSystemBlock(253));
+    EXPECT_TRUE(VmuBlockCache::isFileSystemBlock(241));
+    EXPECT_FALSE(VmuBlockCache::isFileSystemBlock(240));
+    EXPECT_FALSE(VmuBlockCache::isFileSystemBlock(0));
+}
+
+TEST_F(VmuBlockCacheTest, leastRecentlyUsedEvicted)
+{
+    uint8_t buffer[4];
+    uint32_t numUnpinned = VmuBlockCache::NUM_ENTRIES;
+    for (uint32_t i = 0; i < numUnpinned; ++i)
+    {
+        storeFilled(i, i);
+    }
+    // Touch block 0 so that block 1 becomes least recently used
+    ASSERT_TRUE(mCache.lookup(0, buffer, sizeof(buffer)));
+
+    storeFilled(100, 100);
+
+    EXPECT_NE(mCache.peek(0), nullptr);
+    EXPECT_EQ(mCache.peek(1), nullptr);
+    EXPECT_NE(mCache.peek(2), nullptr);
+    EXPECT_NE(mCache.peek(100), nullptr);
+}
+
+TEST_F(VmuBlockCacheTest, pinnedBlocksSurviveEviction)
+{
+    storeFilled(VmuBlockCache::SYSTEM_BLOCK, 1);
+    storeFilled(VmuBlockCache::FAT_BLOCK, 2);
+    storeFilled(VmuBlockCache::DIRECTORY_FIRST_BLOCK, 3);
+    // Stream many data blocks through the cache
+    for (uint32_t i = 0; i < 200; ++i)
+    {
+        storeFilled(i, 4);
+    }
+
+    const uint8_t* system = mCache.peek(VmuBlockCache::SYSTEM_BLOCK);
+    ASSERT_NE(system, nullptr);
+    EXPECT_EQ(system[0], 1);
+    const uint8_t* fat = mCache.peek(VmuBlockCache::FAT_BLOCK);
+    ASSERT_NE(fat, nullptr);
+    EXPECT_EQ(fat[0], 2);
+    // Directory blocks are evicted like data blocks
+    EXPECT_EQ(mCache.peek(VmuBlockCache::DIRECTORY_FIRST_BLOCK), nullptr);
+    // Only the most recent data blocks remain
+    uint32_t numData = VmuBlockCache::NUM_ENTRIES - VmuBlockCache::NUM_PINNED_BLOCKS;
+    EXPECT_NE(mCache.peek(199), nullptr);
+    EXPECT_NE(mCache.peek(200 - numData), nullptr);
+    EXPECT_EQ(mCache.peek(199 - numData), nullptr);
+}
+
+TEST_F(VmuBlockCacheTest, storeReplacesExisting)
+{
+    storeFilled(VmuBlockCache::FAT_BLOCK, 1);
+    storeFilled(VmuBlockCache::FAT_BLOCK, 2);
+
+    const uint8_t* fat = mCache.peek(VmuBlockCache::FAT_BLOCK);
+    ASSERT_NE(fat, nullptr);
+    EXPECT_EQ(fat[0], 2);
+}
+
+TEST_F(VmuBlockCacheTest, invalidate)
+{
+    uint8_t buffer[4];
+    storeFilled(VmuBlockCache::SYSTEM_BLOCK, 1);
+    storeFilled(5, 1);
+
+    mCache.invalidate(5);
+    EXPECT_FALSE(mCache.lookup(5, buffer, sizeof(buffer)));
+    EXPECT_TRUE(mCache.lookup(VmuBlockCache::SYSTEM_BLOCK, buffer, sizeof(buffer)));
+
+    mCache.invalidateAll();
+    EXPECT_FALSE(mCache.lookup(VmuBlockCache::SYSTEM_BLOCK, buffer, sizeof(buffer)));
+}
+
+TEST_F(VmuBlockCacheTest, hashIsFnv1a)
+{
+    uint8_t data[VmuBlockCache::BLOCK_SIZE] = {};
+    EXPECT_EQ(VmuBlockCache::hash(data), 0x4D7705C5U);
+
+    for (uint32_t i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = i;
+    }
+    EXPECT_EQ(VmuBlockCache::hash(data), 0xA0F813C5U);
+}
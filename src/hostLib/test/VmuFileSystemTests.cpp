@@ -0,0 +1,233 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuFileSystem.hpp"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+//! In-memory VMU whose reads each take one extra call to complete
+class FakeVmuFile : public UsbFile
+{
+    public:
+        FakeVmuFile() : mMemory(), mPending(false), mFailBlock(-1), mReads(0)
+        {}
+
+        virtual const char* getFileName() final { return "vmu0.bin"; }
+        virtual uint32_t getFileSize() final { return sizeof(mMemory); }
+        virtual bool isReadOnly() final { return false; }
+
+        virtual int32_t read(uint8_t blockNum,
+                             void* buffer,
+                             uint16_t bufferLen,
+                             uint32_t timeoutUs) final
+        {
+            int32_t numRead = 0;
+            while ((numRead = readAsync(blockNum, buffer, bufferLen, timeoutUs)) == 0);
+            return numRead;
+        }
+
+        virtual int32_t write(uint8_t blockNum,
+                              const void* buffer,
+                              uint16_t bufferLen,
+                              uint32_t timeoutUs) final
+        {
+            return -1;
+        }
+
+        virtual int32_t readAsync(uint8_t blockNum,
+                                  void* buffer,
+                                  uint16_t bufferLen,
+                                  uint32_t timeoutUs) final
+        {
+            if (!mPending)
+            {
+                mPending = true;
+                return 0;
+            }
+            mPending = false;
+            ++mReads;
+            if (blockNum == mFailBlock)
+            {
+                return -1;
+            }
+            memcpy(buffer, mMemory[blockNum], bufferLen);
+            return bufferLen;
+        }
+
+        virtual int32_t writeAsync(uint8_t blockNum,
+                                   const void* buffer,
+                                   uint16_t bufferLen,
+                                   uint32_t timeoutUs) final
+        {
+            return -1;
+        }
+
+        uint8_t mMemory[256][512];
+        bool mPending;
+        int32_t mFailBlock;
+        uint32_t mReads;
+};
+
+class VmuFileSystemTest : public ::testing::Test
+{
+    protected:
+        FakeVmuFile mVmu;
+        VmuFileSystem mFileSystem;
+
+        virtual void SetUp()
+        {
+            // Standard layout: FAT at 254, 13 directory blocks from 253 down
+            uint8_t* system = mVmu.mMemory[255];
+            memset(system, 0x55, 16);
+            setU16(&system[0x46], 254);
+            setU16(&system[0x48], 1);
+            setU16(&system[0x4A], 253);
+            setU16(&system[0x4C], 13);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                setFat(i, VmuFileSystem::FAT_FREE);
+            }
+        }
+
+        void setU16(uint8_t* data, uint16_t value)
+        {
+            data[0] = value & 0xFF;
+            data[1] = value >> 8;
+        }
+
+        void setFat(uint8_t block, uint16_t value)
+        {
+            setU16(&mVmu.mMemory[254][block * 2], value);
+        }
+
+        //! Adds a directory entry and chains the given blocks in the FAT
+        void addFile(uint8_t dirBlock,
+                     uint32_t entryIdx,
+                     uint8_t type,
+                     const char* name12,
+                     const uint8_t* blocks,
+                     uint16_t numBlocks)
+        {
+            uint8_t* entry = &mVmu.mMemory[dirBlock][entryIdx * 32];
+            entry[0] = type;
+            setU16(&entry[0x02], blocks[0]);
+            memcpy(&entry[0x04], name12, 12);
+            setU16(&entry[0x18], numBlocks);
+            for (uint16_t i = 0; i < numBlocks; ++i)
+            {
+                setFat(blocks[i], (i + 1U < numBlocks) ? blocks[i + 1] : VmuFileSystem::FAT_END);
+            }
+        }
+
+        int32_t load()
+        {
+            int32_t result = 0;
+            while ((result = mFileSystem.loadAsync(mVmu, 1000)) == 0);
+            return result;
+        }
+};
+
+TEST_F(VmuFileSystemTest, unformattedFails)
+{
+    mVmu.mMemory[255][0] = 0x00;
+
+    EXPECT_LT(load(), 0);
+    EXPECT_FALSE(mFileSystem.isLoaded());
+    EXPECT_EQ(mFileSystem.getNumFiles(), 0U);
+}
+
+TEST_F(VmuFileSystemTest, emptyCardLoadsNoFiles)
+{
+    EXPECT_GT(load(), 0);
+    EXPECT_TRUE(mFileSystem.isLoaded());
+    EXPECT_EQ(mFileSystem.getNumFiles(), 0U);
+    // System, FAT and all directory blocks
+    EXPECT_EQ(mVmu.mReads, 15U);
+}
+
+TEST_F(VmuFileSystemTest, filesFollowFatChains)
+{
+    const uint8_t saveBlocks[] = {199, 198, 197};
+    const uint8_t gameBlocks[] = {0, 1};
+    addFile(253, 0, 0x33, "SONICADV_INT", saveBlocks, 3);
+    addFile(252, 5, 0xCC, "GAME________", gameBlocks, 2);
+
+    ASSERT_GT(load(), 0);
+    ASSERT_EQ(mFileSystem.getNumFiles(), 2U);
+
+    EXPECT_STREQ(mFileSystem.getFileName(0), "SONICADV_INT");
+    EXPECT_EQ(mFileSystem.getFileNumBlocks(0), 3U);
+    EXPECT_EQ(mFileSystem.getBlock(0, 0), 199);
+    EXPECT_EQ(mFileSystem.getBlock(0, 1), 198);
+    EXPECT_EQ(mFileSystem.getBlock(0, 2), 197);
+    EXPECT_EQ(mFileSystem.getBlock(0, 3), -1);
+
+    EXPECT_STREQ(mFileSystem.getFileName(1), "GAME________");
+    EXPECT_EQ(mFileSystem.getBlock(1, 1), 1);
+
+    EXPECT_EQ(mFileSystem.getFileName(2), nullptr);
+}
+
+TEST_F(VmuFileSystemTest, brokenChainReturnsInvalidBlock)
+{
+    const uint8_t saveBlocks[] = {100, 101};
+    addFile(253, 0, 0x33, "BROKEN______", saveBlocks, 2);
+    setFat(100, VmuFileSystem::FAT_END);
+
+    ASSERT_GT(load(), 0);
+    EXPECT_EQ(mFileSystem.getBlock(0, 0), 100);
+    EXPECT_EQ(mFileSystem.getBlock(0, 1), -1);
+}
+
+TEST_F(VmuFileSystemTest, readFailureStartsOver)
+{
+    const uint8_t saveBlocks[] = {150};
+    addFile(250, 0, 0x33, "SAVE________", saveBlocks, 1);
+    mVmu.mFailBlock = 250;
+
+    EXPECT_LT(load(), 0);
+    EXPECT_FALSE(mFileSystem.isLoaded());
+
+    mVmu.mFailBlock = -1;
+    ASSERT_GT(load(), 0);
+    EXPECT_EQ(mFileSystem.getNumFiles(), 1U);
+}
+
+TEST_F(VmuFileSystemTest, invalidateReloads)
+{
+    ASSERT_GT(load(), 0);
+    EXPECT_EQ(mFileSystem.getNumFiles(), 0U);
+
+    const uint8_t saveBlocks[] = {150};
+    addFile(253, 1, 0x33, "SAVE________", saveBlocks, 1);
+    // Still the old list until invalidated
+    EXPECT_GT(mFileSystem.loadAsync(mVmu, 1000), 0);
+    EXPECT_EQ(mFileSystem.getNumFiles(), 0U);
+
+    mFileSystem.invalidate();
+    ASSERT_GT(load(), 0);
+    EXPECT_EQ(mFileSystem.getNumFiles(), 1U);
+}
@@ -0,0 +1,391 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DreamcastStorageTest.hpp"
+#include "MockUsbCdc.hpp"
+
+#include "VmuTransferCommandParser.hpp"
+#include "VmuBlockCache.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
+
+#include <memory>
+#include <vector>
+
+//! Drives a VmuTransferCommandParser with binary frames, on the Maple Bus thread as the TTY parser
+//! would, against a DreamcastStorage on a simulated VMU
+class VmuTransferCommandParserTest : public DreamcastStorageTest
+{
+    public:
+        VmuTransferCommandParserTest() :
+            DreamcastStorageTest(),
+            mParser()
+        {}
+
+    protected:
+        //! Simulated time to wait for responses
+        static const uint64_t WAIT_US = 10000000;
+        //! Command character of the parser
+        static const uint8_t CMD = 'V';
+
+        std::unique_ptr<VmuTransferCommandParser> mParser;
+
+        virtual void SetUp()
+        {
+            MockUsbCdc::reset();
+            DreamcastStorageTest::SetUp();
+            // The fixture owns the player data
+            std::shared_ptr<PlayerData> playerData(std::shared_ptr<PlayerData>(), &mPlayerData);
+            mParser = std::make_unique<VmuTransferCommandParser>(
+                std::vector<std::shared_ptr<PlayerData>>{playerData});
+        }
+
+        virtual void TearDown()
+        {
+            if (mRunning)
+            {
+                runOnBus([this](){ mParser.reset(); });
+            }
+            else
+            {
+                mParser.reset();
+            }
+            DreamcastStorageTest::TearDown();
+        }
+
+        //! Submits the given frame data on the Maple Bus thread
+        bool submit(uint8_t tag, const std::vector<uint8_t>& data)
+        {
+            bool valid = false;
+            runOnBus([&](){ valid = mParser->submitBinary(tag, data.data(), data.size()); });
+            return valid;
+        }
+
+        //! @returns the data of an OP_WRITE or OP_SYNC request of a block filled with the given value
+        static std::vector<uint8_t> writeRequest(uint8_t op, uint8_t blockNum, uint8_t fill)
+        {
+            std::vector<uint8_t> data = {op, 0, 0, blockNum};
+            data.insert(data.end(), 512, fill);
+            uint16_t crc = BinaryFrame::crc16(&data[4], 512);
+            data.push_back(static_cast<uint8_t>(crc >> 8));
+            data.push_back(static_cast<uint8_t>(crc));
+            return data;
+        }
+
+        //! @returns the decoded response frame of the given tag, status, and data
+        static std::vector<uint8_t> response(uint8_t tag, uint8_t status, std::vector<uint8_t> data = {})
+        {
+            std::vector<uint8_t> frame = {CMD, tag, status};
+            frame.insert(frame.end(), data.begin(), data.end());
+            frame.push_back(BinaryFrame::checksum(frame.data(), frame.size()));
+            return frame;
+        }
+
+        //! @returns the decoded B response frame of the given block as the simulated VMU holds it
+        std::vector<uint8_t> blockResponse(uint8_t tag, uint8_t blockNum)
+        {
+            uint8_t block[512];
+            getBlock(blockNum, block);
+            uint16_t crc = BinaryFrame::crc16(block, sizeof(block));
+            std::vector<uint8_t> data = {VmuTransferCommandParser::RESPONSE_BLOCK, blockNum};
+            data.insert(data.end(), block, block + sizeof(block));
+            data.push_back(static_cast<uint8_t>(crc >> 8));
+            data.push_back(static_cast<uint8_t>(crc));
+            return response(tag, BinaryFrame::STATUS_OK, data);
+        }
+
+        //! @returns the decoded E response frame
+        static std::vector<uint8_t> endResponse(uint8_t tag, uint8_t status, uint16_t nextBlock)
+        {
+            return response(
+                tag,
+                status,
+                {VmuTransferCommandParser::RESPONSE_END,
+                 static_cast<uint8_t>(nextBlock >> 8),
+                 static_cast<uint8_t>(nextBlock)});
+        }
+
+        //! @returns the decoded A response frame
+        static std::vector<uint8_t> ackResponse(uint8_t tag, uint8_t status, uint8_t blockNum, bool written)
+        {
+            return response(
+                tag,
+                status,
+                {VmuTransferCommandParser::RESPONSE_ACK, blockNum, static_cast<uint8_t>(written ? 1 : 0)});
+        }
+
+        //! @returns the frames written so far, once at least count are written or on timeout
+        std::vector<std::vector<uint8_t>> waitForFrames(uint32_t count)
+        {
+            std::vector<std::vector<uint8_t>> frames;
+            uint64_t endTimeUs = mTimeUs + WAIT_US;
+            do
+            {
+                runOnBus([&](){ frames = MockUsbCdc::decodeFrames(); });
+            } while (frames.size() < count && mTimeUs < endTimeUs);
+            return frames;
+        }
+
+        //! @returns the frames written once nothing more is expected
+        std::vector<std::vector<uint8_t>> settledFrames()
+        {
+            hostDelay(100000);
+            return waitForFrames(0);
+        }
+};
+
+TEST_F(VmuTransferCommandParserTest, invalidLengthsRejected)
+{
+    // --- TEST EXECUTION ---
+    bool emptyValid = submit(0x01, {});
+    bool dumpValid = submit(0x02, {VmuTransferCommandParser::OP_DUMP, 0, 0, 0});
+    bool hashValid = submit(0x03, {VmuTransferCommandParser::OP_HASH, 0, 0, 0, 1, 0, 0});
+    std::vector<uint8_t> write = writeRequest(VmuTransferCommandParser::OP_WRITE, 5, 0x11);
+    write.pop_back();
+    bool writeValid = submit(0x04, write);
+    bool rangeValid = submit(0x05, {VmuTransferCommandParser::OP_DUMP, 0, 0, 6, 5});
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(emptyValid);
+    EXPECT_FALSE(dumpValid);
+    EXPECT_FALSE(hashValid);
+    EXPECT_FALSE(writeValid);
+    EXPECT_FALSE(rangeValid);
+    EXPECT_EQ(settledFrames(),
+              std::vector<std::vector<uint8_t>>({
+                  response(0x01, BinaryFrame::STATUS_INVALID_PACKET),
+                  response(0x02, BinaryFrame::STATUS_INVALID_PACKET),
+                  response(0x03, BinaryFrame::STATUS_INVALID_PACKET),
+                  response(0x04, BinaryFrame::STATUS_INVALID_PACKET),
+                  response(0x05, BinaryFrame::STATUS_INVALID_PACKET)}));
+    EXPECT_EQ(mWritePhases, 0U);
+}
+
+TEST_F(VmuTransferCommandParserTest, writeWithBadCrcRejected)
+{
+    std::vector<uint8_t> write = writeRequest(VmuTransferCommandParser::OP_WRITE, 5, 0x11);
+    write.back() ^= 0x01;
+
+    // --- TEST EXECUTION ---
+    bool valid = submit(0x01, write);
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(valid);
+    EXPECT_EQ(settledFrames(),
+              std::vector<std::vector<uint8_t>>({
+                  ackResponse(0x01, BinaryFrame::STATUS_BAD_FRAME, 5, true)}));
+    EXPECT_EQ(mWritePhases, 0U);
+}
+
+TEST_F(VmuTransferCommandParserTest, missingStorageRejected)
+{
+    std::vector<uint8_t> write = writeRequest(VmuTransferCommandParser::OP_WRITE, 5, 0x11);
+    write[1] = 1;
+
+    // --- TEST EXECUTION ---
+    bool dumpValid = submit(0x01, {VmuTransferCommandParser::OP_DUMP, 0, 1, 0, 0});
+    bool writeValid = submit(0x02, write);
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(dumpValid);
+    EXPECT_FALSE(writeValid);
+    EXPECT_EQ(settledFrames(),
+              std::vector<std::vector<uint8_t>>({
+                  endResponse(0x01, BinaryFrame::STATUS_INVALID_SENDER, 0),
+                  ackResponse(0x02, BinaryFrame::STATUS_INVALID_SENDER, 5, true)}));
+}
+
+TEST_F(VmuTransferCommandParserTest, dumpSendsEachBlockThenEnds)
+{
+    // --- TEST EXECUTION ---
+    EXPECT_TRUE(submit(0x01, {VmuTransferCommandParser::OP_DUMP, 0, 0, 10, 12}));
+    std::vector<std::vector<uint8_t>> frames = waitForFrames(4);
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(frames,
+              std::vector<std::vector<uint8_t>>({
+                  blockResponse(0x01, 10),
+                  blockResponse(0x01, 11),
+                  blockResponse(0x01, 12),
+                  endResponse(0x01, BinaryFrame::STATUS_OK, 13)}));
+}
+
+TEST_F(VmuTransferCommandParserTest, secondDumpIsBusy)
+{
+    // --- TEST EXECUTION ---
+    bool firstValid = false;
+    bool secondValid = false;
+    runOnBus([&](){
+        const uint8_t first[] = {VmuTransferCommandParser::OP_DUMP, 0, 0, 0, 1};
+        const uint8_t second[] = {VmuTransferCommandParser::OP_HASH, 0, 0, 7, 8};
+        firstValid = mParser->submitBinary(0x01, first, sizeof(first));
+        secondValid = mParser->submitBinary(0x02, second, sizeof(second));
+    });
+    std::vector<std::vector<uint8_t>> frames = waitForFrames(4);
+
+    // --- EXPECTATIONS ---
+    EXPECT_TRUE(firstValid);
+    EXPECT_TRUE(secondValid);
+    EXPECT_EQ(frames,
+              std::vector<std::vector<uint8_t>>({
+                  endResponse(0x02, BinaryFrame::STATUS_BUSY, 7),
+                  blockResponse(0x01, 0),
+                  blockResponse(0x01, 1),
+                  endResponse(0x01, BinaryFrame::STATUS_OK, 2)}));
+}
+
+TEST_F(VmuTransferCommandParserTest, queuedWriteStartsWhenWriteFinishes)
+{
+    // --- TEST EXECUTION ---
+    // The first write starts, the second is queued, and there is no room for the third
+    runOnBus([&](){
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            std::vector<uint8_t> write =
+                writeRequest(VmuTransferCommandParser::OP_WRITE, 20 + i, 0x30 + i);
+            EXPECT_TRUE(mParser->submitBinary(0x01 + i, write.data(), write.size()));
+        }
+    });
+    std::vector<std::vector<uint8_t>> frames = waitForFrames(3);
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(frames,
+              std::vector<std::vector<uint8_t>>({
+                  ackResponse(0x03, BinaryFrame::STATUS_BUSY, 22, true),
+                  ackResponse(0x01, BinaryFrame::STATUS_OK, 20, true),
+                  ackResponse(0x02, BinaryFrame::STATUS_OK, 21, true)}));
+    uint8_t stored[512];
+    getBlock(20, stored);
+    EXPECT_EQ(stored[0], 0x30);
+    getBlock(21, stored);
+    EXPECT_EQ(stored[0], 0x31);
+    EXPECT_EQ(mWritePhases, 8U);
+    EXPECT_EQ(mCommits, 2U);
+
+    // Both writes are done, so the next one starts right away
+    EXPECT_TRUE(submit(0x04, writeRequest(VmuTransferCommandParser::OP_WRITE, 22, 0x32)));
+    frames = waitForFrames(4);
+    ASSERT_EQ(frames.size(), 4U);
+    EXPECT_EQ(frames[3], ackResponse(0x04, BinaryFrame::STATUS_OK, 22, true));
+}
+
+TEST_F(VmuTransferCommandParserTest, queuedWriteBusyWhenStorageGoes)
+{
+    // --- TEST EXECUTION ---
+    runOnBus([&](){
+        std::vector<uint8_t> first = writeRequest(VmuTransferCommandParser::OP_WRITE, 20, 0x30);
+        std::vector<uint8_t> second = writeRequest(VmuTransferCommandParser::OP_WRITE, 21, 0x31);
+        EXPECT_TRUE(mParser->submitBinary(0x01, first.data(), first.size()));
+        EXPECT_TRUE(mParser->submitBinary(0x02, second.data(), second.size()));
+        // Hold the bus so that the first write is still in progress as the storage goes away
+        mLockstep = true;
+    });
+    disconnect();
+
+    // --- EXPECTATIONS ---
+    // The queued write can't start on storage which is going away
+    EXPECT_EQ(MockUsbCdc::decodeFrames(),
+              std::vector<std::vector<uint8_t>>({
+                  ackResponse(0x01, BinaryFrame::STATUS_FAILED_WRITE, 20, false),
+                  ackResponse(0x02, BinaryFrame::STATUS_BUSY, 21, true)}));
+}
+
+TEST_F(VmuTransferCommandParserTest, cancelEndsDump)
+{
+    EXPECT_TRUE(submit(0x01, {VmuTransferCommandParser::OP_DUMP, 0, 0, 0, 255}));
+    ASSERT_GE(waitForFrames(2).size(), 2U);
+
+    // --- TEST EXECUTION ---
+    EXPECT_TRUE(submit(0x02, {VmuTransferCommandParser::OP_CANCEL}));
+    std::vector<std::vector<uint8_t>> frames = settledFrames();
+
+    // --- EXPECTATIONS ---
+    // Every block before the end is sent, then the dump ends at the next block
+    ASSERT_GE(frames.size(), 4U);
+    uint16_t numBlocks = frames.size() - 2;
+    ASSERT_LT(numBlocks, 256U);
+    for (uint16_t i = 0; i < numBlocks; ++i)
+    {
+        EXPECT_EQ(frames[i], blockResponse(0x01, i)) << "block " << i;
+    }
+    EXPECT_EQ(frames[numBlocks], endResponse(0x01, BinaryFrame::STATUS_FAILED_READ, numBlocks));
+    EXPECT_EQ(frames[numBlocks + 1], response(0x02, BinaryFrame::STATUS_OK));
+}
+
+TEST_F(VmuTransferCommandParserTest, dumpEndsWhenBlockDoesNotFit)
+{
+    EXPECT_TRUE(submit(0x01, {VmuTransferCommandParser::OP_DUMP, 0, 0, 0, 255}));
+    ASSERT_GE(waitForFrames(2).size(), 2U);
+
+    // --- TEST EXECUTION ---
+    // The host stops reading; only short frames still fit
+    runOnBus([](){ MockUsbCdc::maxWriteLen = 64; });
+    std::vector<std::vector<uint8_t>> frames = settledFrames();
+
+    // --- EXPECTATIONS ---
+    // No block is skipped, and the dump may be resumed at the block which didn't fit
+    ASSERT_GE(frames.size(), 3U);
+    uint16_t numBlocks = frames.size() - 1;
+    ASSERT_LT(numBlocks, 256U);
+    for (uint16_t i = 0; i < numBlocks; ++i)
+    {
+        EXPECT_EQ(frames[i], blockResponse(0x01, i)) << "block " << i;
+    }
+    EXPECT_EQ(frames[numBlocks], endResponse(0x01, BinaryFrame::STATUS_FAILED_READ, numBlocks));
+    EXPECT_EQ(MockUsbCdc::overflowCount, 1U);
+
+    runOnBus([](){ MockUsbCdc::reset(); });
+    EXPECT_TRUE(submit(0x02, {VmuTransferCommandParser::OP_DUMP, 0, 0, static_cast<uint8_t>(numBlocks), 255}));
+    frames = waitForFrames(256 - numBlocks + 1);
+    ASSERT_EQ(frames.size(), 256U - numBlocks + 1);
+    EXPECT_EQ(frames.front(), blockResponse(0x02, numBlocks));
+    EXPECT_EQ(frames.back(), endResponse(0x02, BinaryFrame::STATUS_OK, 256));
+}
+
+TEST_F(VmuTransferCommandParserTest, hashListSplitAcrossResponses)
+{
+    const uint32_t NUM_BLOCKS = VmuTransferCommandParser::MAX_HASHES_PER_RESPONSE + 72;
+
+    // --- TEST EXECUTION ---
+    EXPECT_TRUE(submit(0x01, {VmuTransferCommandParser::OP_HASH, 0, 0, 0, NUM_BLOCKS - 1}));
+    std::vector<std::vector<uint8_t>> frames = waitForFrames(3);
+
+    // --- EXPECTATIONS ---
+    std::vector<uint8_t> first = {VmuTransferCommandParser::RESPONSE_HASHES, 0, 128};
+    std::vector<uint8_t> second = {VmuTransferCommandParser::RESPONSE_HASHES, 128, 72};
+    for (uint32_t i = 0; i < NUM_BLOCKS; ++i)
+    {
+        uint8_t block[512];
+        uint8_t hash[4];
+        getBlock(i, block);
+        BinaryFrame::putWord(VmuBlockCache::hash(block), hash);
+        std::vector<uint8_t>& data = (i < 128) ? first : second;
+        data.insert(data.end(), hash, hash + sizeof(hash));
+    }
+    EXPECT_EQ(frames,
+              std::vector<std::vector<uint8_t>>({
+                  response(0x01, BinaryFrame::STATUS_OK, first),
+                  response(0x01, BinaryFrame::STATUS_OK, second),
+                  endResponse(0x01, BinaryFrame::STATUS_OK, NUM_BLOCKS)}));
+    EXPECT_EQ(mBlockReads[0], 1U);
+    EXPECT_EQ(mBlockReads[NUM_BLOCKS - 1], 1U);
+}
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "VmuWritePacer.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+TEST(VmuWritePacerTest, startsAtDefault)
+{
+    VmuWritePacer pacer;
+
+    EXPECT_EQ(pacer.getGapUs(), static_cast<uint32_t>(VmuWritePacer::DEFAULT_GAP_US));
+    EXPECT_EQ(pacer.getReliableGapUs(), static_cast<uint32_t>(VmuWritePacer::DEFAULT_GAP_US));
+}
+
+TEST(VmuWritePacerTest, probesFasterAfterSuccesses)
+{
+    VmuWritePacer pacer(10000);
+
+    for (uint32_t i = 0; i < VmuWritePacer::SUCCESSES_PER_PROBE - 1; ++i)
+    {
+        pacer.blockSucceeded();
+        EXPECT_EQ(pacer.getGapUs(), 10000U);
+    }
+    pacer.blockSucceeded();
+    EXPECT_EQ(pacer.getGapUs(), 9000U);
+
+    // The probed duration becomes reliable once a block succeeds with it
+    pacer.blockSucceeded();
+    EXPECT_EQ(pacer.getReliableGapUs(), 9000U);
+}
+
+TEST(VmuWritePacerTest, neverProbesBelowMinimum)
+{
+    VmuWritePacer pacer(VmuWritePacer::MIN_GAP_US + 500);
+
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        pacer.blockSucceeded();
+    }
+
+    EXPECT_EQ(pacer.getGapUs(), static_cast<uint32_t>(VmuWritePacer::MIN_GAP_US + 500));
+}
+
+TEST(VmuWritePacerTest, backsOffThenRecoversToReliable)
+{
+    VmuWritePacer pacer(10000);
+
+    pacer.phaseFailed();
+
+    EXPECT_EQ(pacer.getGapUs(), 15000U);
+    EXPECT_EQ(pacer.getReliableGapUs(), 11000U);
+    EXPECT_EQ(pacer.getFailureCount(), 1U);
+
+    // Recovery is one step per successful block
+    pacer.blockSucceeded();
+    EXPECT_EQ(pacer.getGapUs(), 14000U);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        pacer.blockSucceeded();
+    }
+    EXPECT_EQ(pacer.getGapUs(), 11000U);
+}
+
+TEST(VmuWritePacerTest, failingDurationNotProbedAgainImmediately)
+{
+    VmuWritePacer pacer(10000);
+    // Probe down to 9000 and fail there
+    for (uint32_t i = 0; i < VmuWritePacer::SUCCESSES_PER_PROBE; ++i)
+    {
+        pacer.blockSucceeded();
+    }
+    ASSERT_EQ(pacer.getGapUs(), 9000U);
+    pacer.phaseFailed();
+    // Recover back to 10000
+    while (pacer.getGapUs() > pacer.getReliableGapUs())
+    {
+        pacer.blockSucceeded();
+    }
+    ASSERT_EQ(pacer.getGapUs(), 10000U);
+
+    // The next probe window is spent forgetting the failure rather than probing 9000 again
+    for (uint32_t i = 0; i < VmuWritePacer::SUCCESSES_PER_PROBE; ++i)
+    {
+        pacer.blockSucceeded();
+    }
+    EXPECT_EQ(pacer.getGapUs(), 10000U);
+    for (uint32_t i = 0; i < VmuWritePacer::SUCCESSES_PER_PROBE; ++i)
+    {
+        pacer.blockSucceeded();
+    }
+    EXPECT_EQ(pacer.getGapUs(), 9000U);
+}
+
+TEST(VmuWritePacerTest, backOffLimitedToMaximum)
+{
+    VmuWritePacer pacer;
+
+    for (uint32_t i = 0; i < 50; ++i)
+    {
+        pacer.phaseFailed();
+    }
+
+    EXPECT_EQ(pacer.getGapUs(), static_cast<uint32_t>(VmuWritePacer::MAX_GAP_US));
+    EXPECT_LE(pacer.getReliableGapUs(), pacer.getGapUs());
+}
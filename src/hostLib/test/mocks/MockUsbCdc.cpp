@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MockUsbCdc.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
+
+#include <algorithm>
+#include <limits>
+
+std::vector<uint8_t> MockUsbCdc::written;
+uint32_t MockUsbCdc::maxWriteLen = std::numeric_limits<uint32_t>::max();
+uint32_t MockUsbCdc::overflowCount = 0;
+
+void MockUsbCdc::reset()
+{
+    written.clear();
+    maxWriteLen = std::numeric_limits<uint32_t>::max();
+    overflowCount = 0;
+}
+
+std::vector<std::vector<uint8_t>> MockUsbCdc::decodeFrames()
+{
+    std::vector<std::vector<uint8_t>> frames;
+    const uint8_t delimiter = BinaryFrame::DELIMITER;
+    std::vector<uint8_t>::const_iterator start = written.begin();
+    std::vector<uint8_t>::const_iterator end;
+    while ((end = std::find(start, written.cend(), delimiter)) != written.cend())
+    {
+        std::vector<uint8_t> frame(start, end);
+        int32_t len = BinaryFrame::decode(frame.data(), frame.size());
+        frame.resize(len > 0 ? len : 0);
+        frames.push_back(frame);
+        start = end + 1;
+    }
+    return frames;
+}
+
+bool usb_cdc_write(const char* buf, uint32_t len)
+{
+    if (len > MockUsbCdc::maxWriteLen)
+    {
+        ++MockUsbCdc::overflowCount;
+        return false;
+    }
+    MockUsbCdc::written.insert(MockUsbCdc::written.end(), buf, buf + len);
+    return true;
+}
+
+uint32_t usb_cdc_tx_overflow_count()
+{
+    return MockUsbCdc::overflowCount;
+}
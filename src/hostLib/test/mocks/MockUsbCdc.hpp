@@ -0,0 +1,49 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "hal/Usb/TtyParser.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+//! Stands in for the CDC driver which implements usb_cdc_write() and usb_cdc_tx_overflow_count()
+//! in firmware; the test executable links this in their place
+class MockUsbCdc
+{
+    public:
+        //! Forgets everything written and accepts writes of any length again
+        static void reset();
+
+        //! @returns each binary frame in written, decoded and without delimiter; a frame which fails
+        //!          to decode is returned empty
+        static std::vector<std::vector<uint8_t>> decodeFrames();
+
+        //! Everything usb_cdc_write() queued since reset()
+        static std::vector<uint8_t> written;
+        //! usb_cdc_write() drops anything longer than this as though the TX buffer were too full
+        static uint32_t maxWriteLen;
+        //! Number of writes dropped, returned by usb_cdc_tx_overflow_count()
+        static uint32_t overflowCount;
+};
@@ -33,8 +33,10 @@
 #include "PlayerData.hpp"
 #include "MaplePassthroughCommandParser.hpp"
 #include "FlycastCommandParser.hpp"
+#include "VmuTransferCommandParser.hpp"
+#include "DreamcastVmu.hpp"
+#include "NonVolatilePicoSystemMemory.hpp"
 
-#include "CriticalSectionMutex.hpp"
 #include "Mutex.hpp"
 #include "Clock.hpp"
 
@@ -51,6 +53,17 @@
 
 const uint8_t MAPLE_HOST_ADDRESSES[MAX_DEVICES] = {0x00, 0x40, 0x80, 0xC0};
 
+#if HOST_VIRTUAL_VMU_PLAYER >= 0
+#if !PICO_COPY_TO_RAM
+#error "HOST_VIRTUAL_VMU_PLAYER writes flash, so the host must be built with pico_set_binary_type(copy_to_ram)"
+#endif
+// Storage of the virtual VMU, placed at the end of flash
+std::shared_ptr<NonVolatilePicoSystemMemory> virtualVmuMemory =
+    std::make_shared<NonVolatilePicoSystemMemory>(
+        PICO_FLASH_SIZE_BYTES - client::DreamcastStorage::MEMORY_SIZE_BYTES,
+        client::DreamcastStorage::MEMORY_SIZE_BYTES);
+#endif
+
 // Second Core Process
 // The second core is in charge of handling communication with Dreamcast peripherals
 void core1()
@@ -69,8 +82,10 @@ void core1()
     int32_t mapleDirPins[MAX_DEVICES] = {
         P1_DIR_PIN, P2_DIR_PIN, P3_DIR_PIN, P4_DIR_PIN
     };
-    CriticalSectionMutex screenMutexes[numDevices];
     std::shared_ptr<ScreenData> screenData[numDevices];
+    std::shared_ptr<ResponseCache> responseCaches[numDevices];
+    std::shared_ptr<StorageRegistry> storageRegistries[numDevices];
+    std::shared_ptr<RumbleSlot> rumbleSlots[numDevices];
     std::vector<std::shared_ptr<PlayerData>> playerData;
     playerData.resize(numDevices);
     DreamcastControllerObserver** observers = get_usb_controller_observers();
@@ -80,12 +95,20 @@ void core1()
     Clock clock;
     for (uint32_t i = 0; i < numDevices; ++i)
     {
-        screenData[i] = std::make_shared<ScreenData>(screenMutexes[i]);
+        screenData[i] = std::make_shared<ScreenData>();
+        responseCaches[i] = std::make_shared<ResponseCache>();
+        storageRegistries[i] = std::make_shared<StorageRegistry>();
+        rumbleSlots[i] = std::make_shared<RumbleSlot>(clock);
         playerData[i] = std::make_shared<PlayerData>(i,
                                                      *(observers[i]),
                                                      *screenData[i],
                                                      clock,
-                                                     usb_msc_get_file_system());
+                                                     usb_msc_get_file_system(),
+                                                     *responseCaches[i],
+                                                     *storageRegistries[i],
+                                                     *rumbleSlots[i]);
+        // Vibration output reports from the USB host are passed straight to this player's slot
+        set_usb_vibration_observer(i, rumbleSlots[i].get());
         buses[i] = create_maple_bus(maplePins[i], mapleDirPins[i], DIR_OUT_HIGH);
         schedulers[i] = std::make_shared<PrioritizedTxScheduler>(MAPLE_HOST_ADDRESSES[i]);
         dreamcastMainNodes[i] = std::make_shared<DreamcastMainNode>(
@@ -99,10 +122,19 @@ void core1()
     TtyParser* ttyParser = usb_cdc_create_parser(&ttyParserMutex, 'h');
     ttyParser->addCommandParser(
         std::make_shared<MaplePassthroughCommandParser>(
-            &schedulers[0], MAPLE_HOST_ADDRESSES, numDevices));
-    ttyParser->addCommandParser(
-        std::make_shared<FlycastCommandParser>(
             &schedulers[0], MAPLE_HOST_ADDRESSES, numDevices, playerData));
+    std::shared_ptr<FlycastCommandParser> flycastCommandParser =
+        std::make_shared<FlycastCommandParser>(
+            &schedulers[0], MAPLE_HOST_ADDRESSES, numDevices, playerData);
+    ttyParser->addCommandParser(flycastCommandParser);
+#if HOST_VIRTUAL_VMU_PLAYER >= 0
+    // Flycast storage requests for this slot are answered from flash instead of over maple bus
+    flycastCommandParser->attachLocalPeripheral(
+        HOST_VIRTUAL_VMU_PLAYER,
+        0,
+        std::make_shared<client::DreamcastVmu>(0x01, virtualVmuMemory, 0));
+#endif
+    ttyParser->addCommandParser(std::make_shared<VmuTransferCommandParser>(playerData));
 
     while(true)
     {
@@ -138,6 +170,10 @@ int main()
     while(true)
     {
         usb_task();
+#if HOST_VIRTUAL_VMU_PLAYER >= 0
+        // Flash writes of the virtual VMU are processed on this core
+        virtualVmuMemory->process();
+#endif
     }
 }
 
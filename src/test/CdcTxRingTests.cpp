@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CdcTxRing.hpp"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+//! @returns everything the consumer may read from the ring, consuming it
+template <uint32_t SIZE>
+static std::string drain(CdcTxRing<SIZE>& ring)
+{
+    std::string out;
+    const uint8_t* ptr = nullptr;
+    uint32_t len = 0;
+    while ((len = ring.peek(ptr)) > 0)
+    {
+        out.append(reinterpret_cast<const char*>(ptr), len);
+        ring.consume(len);
+    }
+    return out;
+}
+
+TEST(CdcTxRingTest, recordHiddenUntilCommitted)
+{
+    CdcTxRing<64> ring;
+
+    EXPECT_TRUE(ring.append("abc", 3));
+    EXPECT_TRUE(ring.append("def\n", 4));
+    EXPECT_EQ(drain(ring), "");
+
+    EXPECT_TRUE(ring.commit());
+    EXPECT_EQ(drain(ring), "abcdef\n");
+}
+
+TEST(CdcTxRingTest, recordWhichDoesNotFitDroppedWhole)
+{
+    CdcTxRing<16> ring;
+    ASSERT_TRUE(ring.write("0123456789", 10));
+
+    // The first piece fits, but the second doesn't
+    EXPECT_TRUE(ring.append("abc", 3));
+    EXPECT_FALSE(ring.append("defg", 4));
+    EXPECT_FALSE(ring.append("\n", 1));
+    EXPECT_FALSE(ring.commit());
+
+    EXPECT_EQ(ring.getOverflowCount(), 1U);
+    EXPECT_EQ(drain(ring), "0123456789");
+
+    // The next record starts clean, wrapping around the end of the buffer
+    EXPECT_TRUE(ring.write("xyz\n", 4));
+    EXPECT_EQ(drain(ring), "xyz\n");
+}
+
+TEST(CdcTxRingTest, writeCommitsAppendedBytes)
+{
+    CdcTxRing<16> ring;
+
+    ring.append("ab", 2);
+    EXPECT_TRUE(ring.write("cd", 2));
+
+    EXPECT_EQ(drain(ring), "abcd");
+    EXPECT_EQ(ring.getOverflowCount(), 0U);
+}
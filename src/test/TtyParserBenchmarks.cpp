@@ -0,0 +1,108 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Throughput benchmarks of the TTY parser. These are disabled by default; run them with:
+//   testExe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+
+#include "UsbCdcTtyParser.hpp"
+#include "hal/System/MutexInterface.hpp"
+#include "hal/Usb/CommandParser.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <stdio.h>
+
+#include <gtest/gtest.h>
+
+// Mutex which does nothing so that only parser work is measured
+class NoOpMutex : public MutexInterface
+{
+    public:
+        virtual void lock() final {}
+        virtual void unlock() final {}
+        virtual int8_t tryLock() final { return 1; }
+};
+
+// Command parser which only counts the commands it receives
+class CountingCommandParser : public CommandParser
+{
+    public:
+        virtual const char* getCommandChars() final { return "X"; }
+        virtual bool submit(const char* chars, uint32_t len) final
+        {
+            ++numCommands;
+            return true;
+        }
+        virtual void printHelp() final {}
+
+        uint32_t numCommands = 0;
+};
+
+// Feeds bursts of 19-byte commands to the parser in 64-byte chunks, as they arrive from USB, then
+// processes until the whole burst is handled. Prints the average time per command.
+static void runTtyParserBenchmark(uint32_t commandsPerBurst)
+{
+    const uint32_t CHUNK_SIZE = 64;
+    const uint32_t NUM_COMMANDS = 1000000;
+    const std::string COMMAND = "X09200001 00000001\n";
+
+    NoOpMutex mutex;
+    UsbCdcTtyParser ttyParser(mutex, 'h');
+    std::shared_ptr<CountingCommandParser> parser = std::make_shared<CountingCommandParser>();
+    ttyParser.addCommandParser(parser);
+
+    std::string burst;
+    for (uint32_t i = 0; i < commandsPerBurst; ++i)
+    {
+        burst += COMMAND;
+    }
+
+    const uint32_t numBursts = NUM_COMMANDS / commandsPerBurst;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < numBursts; ++i)
+    {
+        for (uint32_t offset = 0; offset < burst.size(); offset += CHUNK_SIZE)
+        {
+            uint32_t len = burst.size() - offset;
+            ttyParser.addChars(&burst[offset], (len < CHUNK_SIZE) ? len : CHUNK_SIZE);
+        }
+        while (parser->numCommands < (i + 1) * commandsPerBurst)
+        {
+            ttyParser.process();
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    const uint32_t numCommands = numBursts * commandsPerBurst;
+    ASSERT_EQ(parser->numCommands, numCommands);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("burst of %u: %.0f ns/command\n", (unsigned)commandsPerBurst, ns / numCommands);
+}
+
+TEST(TtyParserBenchmark, DISABLED_commandThroughput)
+{
+    runTtyParserBenchmark(1);
+    runTtyParserBenchmark(16);
+    runTtyParserBenchmark(60);
+}
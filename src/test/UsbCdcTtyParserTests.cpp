@@ -0,0 +1,231 @@
+// MIT License
+//
+// Copyright (c) 2022-2025 James Smith of OrangeFox86
+// https://github.com/OrangeFox86/DreamcastControllerUsbPico
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "UsbCdcTtyParser.hpp"
+#include "MockMutex.hpp"
+#include "MockUsbCdc.hpp"
+#include "hal/Usb/BinaryFrame.hpp"
+#include "hal/Usb/CommandParser.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::NiceMock;
+using ::testing::Return;
+
+// Command parser which records each command and binary frame it receives
+class RecordingCommandParser : public CommandParser
+{
+    public:
+        virtual const char* getCommandChars() final { return "XY"; }
+
+        virtual bool submit(const char* chars, uint32_t len) final
+        {
+            commands.push_back(std::string(chars, len));
+            return true;
+        }
+
+        virtual void printHelp() final {}
+
+        virtual bool isBinarySupported() final { return true; }
+
+        virtual bool submitBinary(uint8_t tag, const uint8_t* data, uint32_t len) final
+        {
+            frames.push_back(std::vector<uint8_t>(data, data + len));
+            return true;
+        }
+
+        std::vector<std::string> commands;
+        std::vector<std::vector<uint8_t>> frames;
+};
+
+class UsbCdcTtyParserTest : public ::testing::Test
+{
+    public:
+        UsbCdcTtyParserTest() :
+            mMutex(),
+            mTtyParser(mMutex, 'h'),
+            mParser(std::make_shared<RecordingCommandParser>())
+        {}
+
+    protected:
+        //! Size of the parser's RX ring buffer
+        static const uint32_t RX_QUEUE_SIZE = 2048;
+
+        NiceMock<MockMutex> mMutex;
+        UsbCdcTtyParser mTtyParser;
+        std::shared_ptr<RecordingCommandParser> mParser;
+
+        virtual void SetUp()
+        {
+            ON_CALL(mMutex, tryLock).WillByDefault(Return(1));
+            mTtyParser.addCommandParser(mParser);
+            MockUsbCdc::reset();
+        }
+
+        //! Adds the given characters as they would arrive from USB
+        void addChars(const std::string& chars)
+        {
+            mTtyParser.addChars(chars.data(), chars.size());
+        }
+
+        //! Processes all waiting commands and returns what was printed
+        std::string process()
+        {
+            testing::internal::CaptureStdout();
+            mTtyParser.process();
+            return testing::internal::GetCapturedStdout();
+        }
+
+        //! @returns the given frame contents with checksum appended, COBS encoded and delimited
+        static std::string encodeFrame(std::vector<uint8_t> frame)
+        {
+            frame.push_back(BinaryFrame::checksum(frame.data(), frame.size()));
+            std::vector<uint8_t> encoded(BinaryFrame::maxEncodedSize(frame.size()));
+            uint32_t len = BinaryFrame::encode(frame.data(), frame.size(), encoded.data());
+            return std::string(encoded.begin(), encoded.begin() + len);
+        }
+
+        //! Switches the TTY parser into binary mode
+        void enterBinaryMode()
+        {
+            addChars("#\n");
+            process();
+            ASSERT_TRUE(mTtyParser.isBinaryMode());
+        }
+};
+
+TEST_F(UsbCdcTtyParserTest, backspaceAcrossRingWrap)
+{
+    // Leave the next character at the last index of the ring
+    addChars("X" + std::string(RX_QUEUE_SIZE - 2, 'a') + "\n");
+    process();
+    mParser->commands.clear();
+
+    // --- TEST EXECUTION ---
+    // "X" is stored at the end of the ring, "bc" wraps to the start, then all three are erased
+    addChars("Xbc\x08\x08\x7FYd\n");
+    process();
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(mParser->commands, std::vector<std::string>({"Yd"}));
+}
+
+TEST_F(UsbCdcTtyParserTest, overflowDropsOnlyOverflowingCommand)
+{
+    // --- TEST EXECUTION ---
+    testing::internal::CaptureStdout();
+    addChars("Xfirst\n");
+    addChars("X" + std::string(RX_QUEUE_SIZE, 'a') + "\n");
+    addChars("Xlast\n");
+    std::string printed = testing::internal::GetCapturedStdout();
+    process();
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(mParser->commands, std::vector<std::string>({"Xfirst", "Xlast"}));
+    EXPECT_NE(printed.find("Error: Command input overflow"), std::string::npos);
+}
+
+TEST_F(UsbCdcTtyParserTest, fullEolQueueDropsCommand)
+{
+    // --- TEST EXECUTION ---
+    std::vector<std::string> expected;
+    testing::internal::CaptureStdout();
+    for (uint32_t i = 0; i < 65; ++i)
+    {
+        std::string command = "X" + std::to_string(i);
+        addChars(command + "\n");
+        if (i < 64)
+        {
+            expected.push_back(command);
+        }
+    }
+    std::string printed = testing::internal::GetCapturedStdout();
+    process();
+    addChars("Xafter\n");
+    process();
+
+    // --- EXPECTATIONS ---
+    // The queue holds 64 commands, and the one which didn't fit leaves no trace in the next one
+    expected.push_back("Xafter");
+    EXPECT_EQ(mParser->commands, expected);
+    EXPECT_NE(printed.find("Error: Command input overflow"), std::string::npos);
+}
+
+TEST_F(UsbCdcTtyParserTest, enteringBinaryModeDropsPendingText)
+{
+    // --- TEST EXECUTION ---
+    addChars("#\nXtext\n");
+    std::string printed = process();
+    addChars(encodeFrame({'X', 0x01, 0xAB}));
+    process();
+
+    // --- EXPECTATIONS ---
+    EXPECT_EQ(printed, "*binary\n");
+    EXPECT_TRUE(mTtyParser.isBinaryMode());
+    EXPECT_TRUE(mParser->commands.empty());
+    EXPECT_EQ(mParser->frames, std::vector<std::vector<uint8_t>>({{0xAB}}));
+}
+
+TEST_F(UsbCdcTtyParserTest, resetModeDropsPendingFrames)
+{
+    enterBinaryMode();
+
+    // --- TEST EXECUTION ---
+    addChars(encodeFrame({'X', 0x01, 0xAB}));
+    mTtyParser.resetMode();
+    process();
+    addChars("Xtext\n");
+    process();
+
+    // --- EXPECTATIONS ---
+    EXPECT_FALSE(mTtyParser.isBinaryMode());
+    EXPECT_TRUE(mParser->frames.empty());
+    EXPECT_EQ(mParser->commands, std::vector<std::string>({"Xtext"}));
+}
+
+TEST_F(UsbCdcTtyParserTest, badFrameChecksumRejected)
+{
+    enterBinaryMode();
+    std::vector<uint8_t> frame = {'X', 0x07, 0x12, 0x34, 0x56};
+    std::vector<uint8_t> raw(frame);
+    raw.push_back(BinaryFrame::checksum(frame.data(), frame.size()) ^ 0x01);
+    std::vector<uint8_t> encoded(BinaryFrame::maxEncodedSize(raw.size()));
+    uint32_t len = BinaryFrame::encode(raw.data(), raw.size(), encoded.data());
+
+    // --- TEST EXECUTION ---
+    mTtyParser.addChars(reinterpret_cast<const char*>(encoded.data()), len);
+    addChars(encodeFrame(frame));
+    process();
+
+    // --- EXPECTATIONS ---
+    // Only the intact frame reaches the parser
+    EXPECT_EQ(mParser->frames, std::vector<std::vector<uint8_t>>({{0x12, 0x34, 0x56}}));
+    std::vector<uint8_t> expected = {'X', 0x07, BinaryFrame::STATUS_BAD_FRAME};
+    expected.push_back(BinaryFrame::checksum(expected.data(), expected.size()));
+    EXPECT_EQ(MockUsbCdc::decodeFrames(), std::vector<std::vector<uint8_t>>({expected}));
+}